@@ -56,6 +56,22 @@ endif
 ifeq ($(HWC_ENABLE_GE2D_COMPOSITION), true)
 HWC_C_FLAGS += -DHWC_ENABLE_GE2D_COMPOSITION
 endif
+#blend a few small layers on cpu instead of gpu.
+ifeq ($(HWC_ENABLE_CPU_COMPOSITION), true)
+HWC_C_FLAGS += -DHWC_ENABLE_CPU_COMPOSITION
+endif
+#ddr budget of vpu planes scanout, in MB/s.
+ifneq ($(HWC_DDR_BANDWIDTH_BUDGET),)
+HWC_C_FLAGS += -DHWC_DDR_BANDWIDTH_BUDGET=$(HWC_DDR_BANDWIDTH_BUDGET)
+endif
+#record frame stage timestamps, summary in dumpsys and atrace events.
+ifeq ($(HWC_ENABLE_FRAME_TIMELINE), true)
+HWC_C_FLAGS += -DHWC_ENABLE_FRAME_TIMELINE
+endif
+#count heap allocations per frame, shown in dumpsys.
+ifeq ($(HWC_ENABLE_ALLOC_STAT), true)
+HWC_C_FLAGS += -DHWC_ENABLE_ALLOC_STAT
+endif
 ifeq ($(HWC_ENABLE_DISPLAY_MODE_MANAGEMENT), true)
 HWC_C_FLAGS += -DHWC_ENABLE_DISPLAY_MODE_MANAGEMENT
 endif
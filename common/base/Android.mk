@@ -26,7 +26,9 @@ LOCAL_SHARED_LIBRARIES := $(HWC_SHARED_LIBS)
 LOCAL_SRC_FILES := \
     DrmTypes.cpp \
     DrmSync.cpp \
-    DrmFramebuffer.cpp
+    DrmFramebuffer.cpp \
+    DrmBufferRegistry.cpp \
+    FenceWatcher.cpp
 
 LOCAL_C_INCLUDES := \
     system/core/include \
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <am_gralloc_ext.h>
+#include <DrmBufferRegistry.h>
+#include <MesonLog.h>
+#include <misc.h>
+
+ANDROID_SINGLETON_STATIC_INSTANCE(DrmBufferRegistry)
+
+static thread_local int32_t sCurrentDisplay = -1;
+
+static void releaseBuffer(native_handle_t * hnd) {
+    gralloc_unref_dma_buf(hnd);
+}
+
+DrmBufferRegistry::DrmBufferRegistry() {
+    mEntries.reserve(BUFFER_REGISTRY_SIZE);
+    memset(mFrames, 0, sizeof(mFrames));
+    mImports = mReuses = mDropped = mUncached = mSavedCalls = 0;
+    mLastDumpTime = systemTime(CLOCK_MONOTONIC);
+    mLastDumpSaved = 0;
+}
+
+DrmBufferRegistry::~DrmBufferRegistry() {
+}
+
+int32_t DrmBufferRegistry::readInfo(const native_handle_t * hnd, drm_buffer_info_t & info) {
+    memset(&info, 0, sizeof(info));
+    if (!hnd)
+        return -EINVAL;
+
+    info.id = gralloc_get_buffer_id(hnd);
+    info.format = am_gralloc_get_format(hnd);
+    info.width = am_gralloc_get_width(hnd);
+    info.height = am_gralloc_get_height(hnd);
+    info.byteStride = am_gralloc_get_stride_in_byte(hnd);
+    info.pixelStride = am_gralloc_get_stride_in_pixel(hnd);
+    info.afbcMask = am_gralloc_get_vpu_afbc_mask(hnd);
+    info.coherent = am_gralloc_is_coherent_buffer(hnd);
+    info.secure = am_gralloc_is_secure_buffer(hnd);
+    info.omxMetadata = am_gralloc_is_omx_metadata_buffer(hnd);
+    info.overlay = am_gralloc_is_overlay_buffer(hnd);
+    return 0;
+}
+
+std::shared_ptr<native_handle_t> DrmBufferRegistry::importBuffer(
+    const native_handle_t * hnd) {
+    native_handle_t * imported = gralloc_ref_dma_buf(hnd);
+    if (!imported)
+        return NULL;
+    return std::shared_ptr<native_handle_t>(imported, releaseBuffer);
+}
+
+int32_t DrmBufferRegistry::getDisplayIdx(int32_t display) {
+    if (display < 0 || display >= BUFFER_REGISTRY_DISPLAYS)
+        return 0;
+    return display;
+}
+
+int32_t DrmBufferRegistry::getFreeEntry() {
+    int32_t idx = -1;
+    uint64_t maxIdle = 0;
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        Entry & entry = mEntries[i];
+        if (entry.handle.use_count() != 1)
+            continue;
+        uint64_t idle = mFrames[entry.display] - entry.lastFrame;
+        if (idx < 0 || idle > maxIdle) {
+            idx = (int32_t)i;
+            maxIdle = idle;
+        }
+    }
+    return idx;
+}
+
+std::shared_ptr<native_handle_t> DrmBufferRegistry::import(
+    const native_handle_t * hnd, drm_buffer_info_t & info) {
+    if (!hnd) {
+        memset(&info, 0, sizeof(info));
+        return NULL;
+    }
+
+    uint64_t id = gralloc_get_buffer_id(hnd);
+    if (id == 0) {
+        readInfo(hnd, info);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mImports++;
+            mUncached++;
+        }
+        return importBuffer(hnd);
+    }
+
+    int32_t display = getDisplayIdx(sCurrentDisplay);
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); it++) {
+        if (it->info.id == id) {
+            it->display = display;
+            it->lastFrame = mFrames[display];
+            mReuses++;
+            mSavedCalls += hnd->numFds * 2;
+            info = it->info;
+            return it->handle;
+        }
+    }
+
+    readInfo(hnd, info);
+    std::shared_ptr<native_handle_t> handle = importBuffer(hnd);
+    mImports++;
+    if (!handle)
+        return NULL;
+
+    Entry entry = {handle, info, display, mFrames[display]};
+    if (mEntries.size() < BUFFER_REGISTRY_SIZE) {
+        mEntries.push_back(entry);
+    } else {
+        /*all in use, the buffer gets a private import.*/
+        int32_t idx = getFreeEntry();
+        if (idx >= 0) {
+            mEntries[idx] = entry;
+            mDropped++;
+        }
+    }
+    return handle;
+}
+
+void DrmBufferRegistry::trim(int32_t display) {
+    display = getDisplayIdx(display);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFrames[display]++;
+    for (size_t i = 0; i < mEntries.size();) {
+        Entry & entry = mEntries[i];
+        if (entry.display == display && entry.handle.use_count() == 1 &&
+            mFrames[display] - entry.lastFrame > BUFFER_REGISTRY_IDLE) {
+            entry = mEntries.back();
+            mEntries.pop_back();
+            mDropped++;
+        } else {
+            i++;
+        }
+    }
+}
+
+void DrmBufferRegistry::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    nsecs_t now = systemTime(CLOCK_MONOTONIC);
+    double seconds = (double)(now - mLastDumpTime) / 1000000000.0;
+    double savedRate = seconds > 0 ? (mSavedCalls - mLastDumpSaved) / seconds : 0.0;
+    mLastDumpTime = now;
+    mLastDumpSaved = mSavedCalls;
+
+    dumpstr.appendFormat("Imported buffers: %zu/%d, imports %" PRIu64 ", reuses %" PRIu64
+        ", dropped %" PRIu64 ", no gralloc id %" PRIu64 ", syscalls saved %" PRIu64
+        " (%.1f/s since last dump)\n",
+        mEntries.size(), BUFFER_REGISTRY_SIZE, mImports, mReuses, mDropped, mUncached,
+        mSavedCalls, savedRate);
+}
+
+BufferRegistryScope::BufferRegistryScope(int32_t display) {
+    mLastDisplay = sCurrentDisplay;
+    sCurrentDisplay = display;
+}
+
+BufferRegistryScope::~BufferRegistryScope() {
+    sCurrentDisplay = mLastDisplay;
+}
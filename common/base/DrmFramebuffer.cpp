@@ -7,6 +7,8 @@
  * Description:
  */
 
+#include <string.h>
+
 #include <DrmFramebuffer.h>
 #include <MesonLog.h>
 #include <misc.h>
@@ -27,8 +29,8 @@ DrmFramebuffer::DrmFramebuffer(
     if (bufferhnd) {
         mDisplayFrame.left   = mSourceCrop.left   = 0;
         mDisplayFrame.top    = mSourceCrop.top    = 0;
-        mDisplayFrame.right  = mSourceCrop.right  = am_gralloc_get_width(bufferhnd);
-        mDisplayFrame.bottom = mSourceCrop.bottom = am_gralloc_get_height(bufferhnd);
+        mDisplayFrame.right  = mSourceCrop.right  = mBufferInfo.width;
+        mDisplayFrame.bottom = mSourceCrop.bottom = mBufferInfo.height;
     }
 }
 
@@ -36,8 +38,12 @@ DrmFramebuffer::~DrmFramebuffer() {
     reset();
 }
 
+/*no fence is shared, saves an allocation per frame.*/
 int32_t DrmFramebuffer::setAcquireFence(int32_t fenceFd) {
-    mAcquireFence = std::make_shared<DrmFence>(fenceFd);
+    if (fenceFd < 0)
+        mAcquireFence = DrmFence::NO_FENCE;
+    else
+        mAcquireFence = std::make_shared<DrmFence>(fenceFd);
     return 0;
 }
 
@@ -46,7 +52,10 @@ std::shared_ptr<DrmFence> DrmFramebuffer::getAcquireFence() {
 }
 
 int32_t DrmFramebuffer::setReleaseFence(int32_t fenceFd) {
-    mReleaseFence.reset(new DrmFence(fenceFd));
+    if (fenceFd < 0)
+        mReleaseFence = DrmFence::NO_FENCE;
+    else
+        mReleaseFence = std::make_shared<DrmFence>(fenceFd);
     return 0;
 }
 
@@ -70,6 +79,7 @@ void DrmFramebuffer::reset() {
     mZorder          = 0xFFFFFFFF; //set to special value for debug.
     mDataspace       = 0;
     mCompositionType = 0;
+    mContentUpdated  = true;
 
     mAcquireFence = mReleaseFence = DrmFence::NO_FENCE;
 
@@ -83,7 +93,8 @@ void DrmFramebuffer::setBufferInfo(
     const native_handle_t * bufferhnd,
     int32_t acquireFence) {
     if (bufferhnd) {
-        mBufferHandle = gralloc_ref_dma_buf(bufferhnd);
+        mImportedBuffer = DrmBufferRegistry::getInstance().import(bufferhnd, mBufferInfo);
+        mBufferHandle = mImportedBuffer.get();
         if (acquireFence >= 0)
             mAcquireFence = std::make_shared<DrmFence>(acquireFence);
     }
@@ -92,9 +103,10 @@ void DrmFramebuffer::setBufferInfo(
 void DrmFramebuffer::clearBufferInfo() {
     if (mBufferHandle) {
         unlock();
-        gralloc_unref_dma_buf(mBufferHandle);
+        mImportedBuffer.reset();
         mBufferHandle  = NULL;
     }
+    memset(&mBufferInfo, 0, sizeof(mBufferInfo));
 
     mAcquireFence.reset();
     mAcquireFence  = DrmFence::NO_FENCE;
@@ -127,3 +139,27 @@ bool DrmFramebuffer::isRotated() {
     return mTransform != 0;
 }
 
+void DrmFramebuffer::copyFrom(const DrmFramebuffer & fb, bool refBuffer) {
+    if (refBuffer) {
+        clearBufferInfo();
+        mImportedBuffer = fb.mImportedBuffer;
+        mBufferHandle = mImportedBuffer.get();
+        mBufferInfo = fb.mBufferInfo;
+    }
+
+    mColor           = fb.mColor;
+    mFbType          = fb.mFbType;
+    mSourceCrop      = fb.mSourceCrop;
+    mDisplayFrame    = fb.mDisplayFrame;
+    mBlendMode       = fb.mBlendMode;
+    mPlaneAlpha      = fb.mPlaneAlpha;
+    mTransform       = fb.mTransform;
+    mZorder          = fb.mZorder;
+    mDataspace       = fb.mDataspace;
+    mSecure          = fb.mSecure;
+    mCompositionType = fb.mCompositionType;
+    mContentUpdated  = fb.mContentUpdated;
+    mHdrMetaData     = fb.mHdrMetaData;
+
+    mAcquireFence = fb.mAcquireFence;
+}
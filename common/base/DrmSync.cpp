@@ -8,13 +8,29 @@
  */
 
 #include <DrmSync.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sync/sync.h>
+#include <sys/ioctl.h>
 #include <sys/types.h>
 
 #include <MesonLog.h>
 
 
+/*sw_sync uapi, libsync does not export it.*/
+struct sw_sync_create_fence_data {
+    uint32_t value;
+    char name[32];
+    int32_t fence;
+};
+
+#define SW_SYNC_IOC_MAGIC           'W'
+#define SW_SYNC_IOC_CREATE_FENCE    _IOWR(SW_SYNC_IOC_MAGIC, 0, struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC             _IOW(SW_SYNC_IOC_MAGIC, 1, uint32_t)
+
+#define SW_SYNC_DEBUGFS_PATH        "/sys/kernel/debug/sync/sw_sync"
+#define SW_SYNC_DEV_PATH            "/dev/sw_sync"
+
 const std::shared_ptr<DrmFence> DrmFence::NO_FENCE =
     std::make_shared<DrmFence>(-1);
 
@@ -92,4 +108,46 @@ int32_t DrmFence::dup() const{
     return dupFence;
 }
 
+DrmTimeLine::DrmTimeLine() {
+    mTimelineFd = open(SW_SYNC_DEBUGFS_PATH, O_RDWR | O_CLOEXEC);
+    if (mTimelineFd < 0)
+        mTimelineFd = open(SW_SYNC_DEV_PATH, O_RDWR | O_CLOEXEC);
+    if (mTimelineFd < 0) {
+        MESON_LOGE("open sw_sync timeline failed (%d)", errno);
+        mTimelineFd = -1;
+    }
+}
 
+DrmTimeLine::~DrmTimeLine() {
+    /*pending fences are signaled when timeline is closed.*/
+    if (mTimelineFd >= 0) {
+        close(mTimelineFd);
+        mTimelineFd = -1;
+    }
+}
+
+int32_t DrmTimeLine::createFence(const char * name, uint32_t value) {
+    if (mTimelineFd == -1)
+        return -1;
+
+    struct sw_sync_create_fence_data data;
+    memset(&data, 0, sizeof(data));
+    data.value = value;
+    strncpy(data.name, name, sizeof(data.name) - 1);
+    if (ioctl(mTimelineFd, SW_SYNC_IOC_CREATE_FENCE, &data) != 0) {
+        MESON_LOGE("create sw_sync fence %u failed (%d)", value, errno);
+        return -1;
+    }
+    return data.fence;
+}
+
+int32_t DrmTimeLine::inc(uint32_t count) {
+    if (mTimelineFd == -1)
+        return -EINVAL;
+
+    if (ioctl(mTimelineFd, SW_SYNC_IOC_INC, &count) != 0) {
+        MESON_LOGE("inc sw_sync timeline failed (%d)", errno);
+        return -errno;
+    }
+    return 0;
+}
@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sync/sync.h>
+
+#include <FenceWatcher.h>
+#include <MesonLog.h>
+
+ANDROID_SINGLETON_STATIC_INSTANCE(FenceWatcher)
+
+#define FENCE_WATCH_WAKE_SLOT   FENCE_WATCH_MAX
+#define FENCE_EPOLL_EVENTS      8
+
+static const char * sTypeNames[FENCE_WATCH_TYPE_NUM] = {
+    "present",
+    "release",
+    "acquire",
+};
+
+static thread_local int32_t sCurrentDisplay = -1;
+static thread_local uint32_t sCurrentFrameSeq = 0;
+
+/*1 signaled with signal time, 0 active, < 0 error.*/
+static int32_t getFenceStatus(int32_t fd, nsecs_t wakeTime, nsecs_t & signalTime) {
+    struct sync_file_info * info = sync_file_info(fd);
+    if (!info) {
+        /*no fence info from driver, epoll told it is ready.*/
+        signalTime = wakeTime;
+        return 1;
+    }
+
+    int32_t status = info->status;
+    if (status == 1) {
+        struct sync_fence_info * fences = sync_get_fence_info(info);
+        signalTime = 0;
+        for (uint32_t i = 0; i < info->num_fences; i++) {
+            if ((nsecs_t)fences[i].timestamp_ns > signalTime)
+                signalTime = fences[i].timestamp_ns;
+        }
+        if (signalTime == 0)
+            signalTime = wakeTime;
+    }
+    sync_file_info_free(info);
+    return status;
+}
+
+FenceWatcher::FenceWatcher() {
+    mThreadStarted = false;
+    mExit = false;
+    mEpollFd = -1;
+    mWakeFd = -1;
+    for (uint32_t i = 0; i < FENCE_WATCH_MAX; i++)
+        mWatches[i].fd = -1;
+    mWatchNum = 0;
+    mCallingListener = NULL;
+    mDroppedNum = 0;
+    mErrorNum = 0;
+}
+
+FenceWatcher::~FenceWatcher() {
+    if (mThreadStarted) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mExit = true;
+        }
+        uint64_t val = 1;
+        write(mWakeFd, &val, sizeof(val));
+        pthread_join(mThread, NULL);
+    }
+
+    for (uint32_t i = 0; i < FENCE_WATCH_MAX; i++) {
+        if (mWatches[i].fd >= 0)
+            removeWatch(i);
+    }
+    if (mEpollFd >= 0)
+        close(mEpollFd);
+    if (mWakeFd >= 0)
+        close(mWakeFd);
+}
+
+/*called with lock held.*/
+int32_t FenceWatcher::startThread() {
+    if (mThreadStarted)
+        return 0;
+
+    if (mEpollFd < 0) {
+        mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (mEpollFd < 0 || mWakeFd < 0) {
+            MESON_LOGE("fence watcher create epoll failed (%d)", errno);
+            return -ENODEV;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = FENCE_WATCH_WAKE_SLOT;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &ev) != 0) {
+            MESON_LOGE("fence watcher add wake fd failed (%d)", errno);
+            return -ENODEV;
+        }
+    }
+
+    int ret = pthread_create(&mThread, NULL, FenceWatcher::threadMain, (void *)this);
+    if (ret) {
+        MESON_LOGE("failed to start fence watcher: %s", strerror(ret));
+        return -ret;
+    }
+    mThreadStarted = true;
+    return 0;
+}
+
+int32_t FenceWatcher::watch(int32_t fd, const fence_watch_tag_t & tag,
+    FenceListener * listener) {
+    if (fd < 0)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    int32_t ret = startThread();
+    if (ret != 0) {
+        close(fd);
+        return ret;
+    }
+
+    if (mWatchNum == FENCE_WATCH_MAX) {
+        /*drop the oldest one nobody waits for.*/
+        int32_t oldest = -1;
+        for (uint32_t i = 0; i < FENCE_WATCH_MAX; i++) {
+            if (mWatches[i].listener == NULL && (oldest < 0 ||
+                mWatches[i].submitTime < mWatches[oldest].submitTime))
+                oldest = i;
+        }
+        if (oldest < 0) {
+            close(fd);
+            return -EBUSY;
+        }
+        removeWatch(oldest);
+        mDroppedNum++;
+    }
+
+    uint32_t slot = 0;
+    while (mWatches[slot].fd >= 0)
+        slot++;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = slot;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        ret = -errno;
+        MESON_LOGE("fence watcher add fence %d failed (%d)", fd, ret);
+        close(fd);
+        mErrorNum++;
+        return ret;
+    }
+
+    Watch & w = mWatches[slot];
+    w.fd = fd;
+    w.tag = tag;
+    w.submitTime = systemTime(CLOCK_MONOTONIC);
+    w.listener = listener;
+    mWatchNum++;
+    return 0;
+}
+
+/*called with lock held.*/
+void FenceWatcher::removeWatch(uint32_t slot) {
+    Watch & w = mWatches[slot];
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, w.fd, NULL);
+    close(w.fd);
+    w.fd = -1;
+    w.listener = NULL;
+    mWatchNum--;
+}
+
+void FenceWatcher::cancel(FenceListener * listener) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (uint32_t i = 0; i < FENCE_WATCH_MAX; i++) {
+        if (mWatches[i].fd >= 0 && mWatches[i].listener == listener)
+            removeWatch(i);
+    }
+    while (mCallingListener == listener)
+        mCallbackCond.wait(lock);
+}
+
+class FenceWaitListener : public FenceListener {
+public:
+    FenceWaitListener() : mSignaled(false) { }
+
+    void onFenceSignaled(const fence_watch_tag_t & tag __unused,
+        nsecs_t submitTime __unused, nsecs_t signalTime __unused) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSignaled = true;
+        mCond.notify_one();
+    }
+
+    bool waitFor(int32_t timeoutMs) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mCond.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+            [this] { return mSignaled; });
+    }
+
+protected:
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    bool mSignaled;
+};
+
+int32_t FenceWatcher::waitForever(int32_t fd, const fence_watch_tag_t & tag) {
+    if (fd < 0)
+        return 0;
+
+    FenceWaitListener listener;
+    bool watched = watch(::dup(fd), tag, &listener) == 0;
+    int32_t ret = 0;
+    if (!watched || !listener.waitFor(FENCE_WARNING_TIMEOUT_MS)) {
+        /*not watched, or too slow: keep waiting here as DrmFence does.*/
+        if (watched)
+            MESON_LOGE("%s fence %d (display %d plane %d) didn't signal in %d ms",
+                sTypeNames[tag.type], fd, tag.display, tag.plane,
+                FENCE_WARNING_TIMEOUT_MS);
+        if (sync_wait(fd, -1) < 0)
+            ret = -errno;
+    }
+    /*listener is on stack, wait its callback returned.*/
+    cancel(&listener);
+    close(fd);
+    return ret;
+}
+
+void FenceWatcher::setVsyncPeriod(int32_t display, nsecs_t period) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats[display].vsyncPeriod = period;
+}
+
+int32_t FenceWatcher::getStats(int32_t display, fence_display_stats_t & stats) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mStats.find(display);
+    if (it == mStats.end())
+        return -ENOENT;
+    stats = it->second;
+    return 0;
+}
+
+/*called with lock held.*/
+void FenceWatcher::recordLatency(const fence_watch_tag_t & tag, nsecs_t latency) {
+    fence_display_stats_t & stats = mStats[tag.display];
+    fence_latency_stats_t & lat = stats.latency[tag.type];
+    lat.count++;
+    lat.total += latency;
+    if (latency > lat.max)
+        lat.max = latency;
+    nsecs_t bucket = latency / 1000000;
+    lat.hist[bucket < FENCE_LATENCY_BUCKETS ? bucket : FENCE_LATENCY_BUCKETS - 1]++;
+
+    /*flip should be on screen at the first vsync after it.*/
+    if (tag.type == FENCE_WATCH_PRESENT && stats.vsyncPeriod > 0 &&
+        latency > stats.vsyncPeriod + FENCE_VSYNC_SLACK_NS) {
+        stats.missedFrames++;
+        stats.missedVsyncs += (latency - FENCE_VSYNC_SLACK_NS) / stats.vsyncPeriod;
+        stats.lastMissedSeq = tag.frameSeq;
+    }
+}
+
+void FenceWatcher::handleSignaled(uint32_t slot, nsecs_t wakeTime) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    Watch w = mWatches[slot];
+    if (w.fd < 0)
+        return;
+
+    nsecs_t signalTime = wakeTime;
+    int32_t status = getFenceStatus(w.fd, wakeTime, signalTime);
+    if (status == 0) {
+        /*slot reused after the event, new fence not ready yet.*/
+        return;
+    }
+    removeWatch(slot);
+
+    if (status < 0) {
+        mErrorNum++;
+    } else {
+        nsecs_t latency = signalTime > w.submitTime ? signalTime - w.submitTime : 0;
+        recordLatency(w.tag, latency);
+        if (latency > ms2ns(FENCE_WARNING_TIMEOUT_MS))
+            MESON_LOGE("%s fence (display %d plane %d frame %u) signaled after %" PRId64 " ms",
+                sTypeNames[w.tag.type], w.tag.display, w.tag.plane, w.tag.frameSeq,
+                ns2ms(latency));
+    }
+
+    if (w.listener) {
+        mCallingListener = w.listener;
+        lock.unlock();
+        w.listener->onFenceSignaled(w.tag, w.submitTime, signalTime);
+        lock.lock();
+        mCallingListener = NULL;
+        mCallbackCond.notify_all();
+    }
+}
+
+void * FenceWatcher::threadMain(void * data) {
+    MESON_ASSERT(data, "FenceWatcher data should not be NULL.");
+    FenceWatcher * pThis = (FenceWatcher *) data;
+    pThis->threadLoop();
+    return NULL;
+}
+
+void FenceWatcher::threadLoop() {
+    struct epoll_event events[FENCE_EPOLL_EVENTS];
+    while (true) {
+        int num = epoll_wait(mEpollFd, events, FENCE_EPOLL_EVENTS, -1);
+        if (num < 0) {
+            if (errno == EINTR)
+                continue;
+            MESON_LOGE("fence watcher epoll_wait failed (%d)", errno);
+            break;
+        }
+
+        nsecs_t wakeTime = systemTime(CLOCK_MONOTONIC);
+        for (int i = 0; i < num; i++) {
+            if (events[i].data.u32 == FENCE_WATCH_WAKE_SLOT) {
+                uint64_t val;
+                read(mWakeFd, &val, sizeof(val));
+                continue;
+            }
+            handleSignaled(events[i].data.u32, wakeTime);
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mExit)
+            break;
+    }
+}
+
+/*upper bound of the bucket holding pct of samples, in ms.*/
+static uint32_t histPercentile(const fence_latency_stats_t & lat, uint32_t pct) {
+    uint64_t target = (lat.count * pct + 99) / 100;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < FENCE_LATENCY_BUCKETS; i++) {
+        sum += lat.hist[i];
+        if (sum >= target)
+            return i + 1;
+    }
+    return FENCE_LATENCY_BUCKETS;
+}
+
+void FenceWatcher::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    dumpstr.appendFormat("Fence watcher: watching %u, dropped %" PRIu64 ", errors %" PRIu64 "\n",
+        mWatchNum, mDroppedNum, mErrorNum);
+
+    for (auto it = mStats.begin(); it != mStats.end(); ++it) {
+        fence_display_stats_t & stats = it->second;
+        dumpstr.appendFormat("  display %d: vsync %.2f ms, missed %" PRIu64
+            " frames (%" PRIu64 " vsyncs), last at frame %u\n",
+            it->first, stats.vsyncPeriod / 1000000.0, stats.missedFrames,
+            stats.missedVsyncs, stats.lastMissedSeq);
+        dumpstr.appendFormat("    %-8s %8s %8s %8s %6s %6s %6s (ms)\n",
+            "fence", "count", "avg", "max", "p50<", "p95<", "p99<");
+        for (int32_t i = 0; i < FENCE_WATCH_TYPE_NUM; i++) {
+            fence_latency_stats_t & lat = stats.latency[i];
+            if (lat.count == 0)
+                continue;
+            dumpstr.appendFormat("    %-8s %8" PRIu64 " %8.2f %8.2f %6u %6u %6u\n",
+                sTypeNames[i], lat.count, lat.total / 1000000.0 / lat.count,
+                lat.max / 1000000.0, histPercentile(lat, 50),
+                histPercentile(lat, 95), histPercentile(lat, 99));
+            dumpstr.appendFormat("    %-8s", "");
+            for (uint32_t j = 0; j < FENCE_LATENCY_BUCKETS; j++) {
+                if (lat.hist[j] > 0)
+                    dumpstr.appendFormat(" %u:%u", j, lat.hist[j]);
+            }
+            dumpstr.append("\n");
+        }
+    }
+}
+
+fence_watch_tag_t FenceWatcher::makeTag(fence_watch_type_t type, int32_t plane) {
+    fence_watch_tag_t tag;
+    tag.display = sCurrentDisplay;
+    tag.plane = plane;
+    tag.frameSeq = sCurrentFrameSeq;
+    tag.type = type;
+    return tag;
+}
+
+FenceWatchScope::FenceWatchScope(int32_t display, uint32_t frameSeq) {
+    mLastDisplay = sCurrentDisplay;
+    mLastFrameSeq = sCurrentFrameSeq;
+    sCurrentDisplay = display;
+    sCurrentFrameSeq = frameSeq;
+}
+
+FenceWatchScope::~FenceWatchScope() {
+    sCurrentDisplay = mLastDisplay;
+    sCurrentFrameSeq = mLastFrameSeq;
+}
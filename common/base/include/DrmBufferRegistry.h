@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Imported buffer handles and their gralloc info, shared by
+ *     framebuffers of the same buffer across frames.
+ */
+
+#ifndef DRM_BUFFER_REGISTRY_H
+#define DRM_BUFFER_REGISTRY_H
+
+#include <mutex>
+#include <vector>
+#include <cutils/native_handle.h>
+
+#include <BasicTypes.h>
+
+#define BUFFER_REGISTRY_SIZE    64
+/*frames of its display an unused import stays registered.*/
+#define BUFFER_REGISTRY_IDLE    8
+/*displays with own frame count, others count as the first.*/
+#define BUFFER_REGISTRY_DISPLAYS    3
+
+/*per buffer info, the same for all handles of the buffer.*/
+typedef struct drm_buffer_info {
+    uint64_t id;            /*gralloc buffer id, 0 if not known.*/
+    int32_t format;
+    int32_t width;
+    int32_t height;
+    int32_t byteStride;
+    int32_t pixelStride;
+    int32_t afbcMask;
+    bool coherent;
+    bool secure;
+    bool omxMetadata;
+    bool overlay;
+} drm_buffer_info_t;
+
+/*
+ * Importing a buffer dups all its fds and registers it to mapper, and
+ * releasing closes them again. Swapchain buffers come back every few
+ * frames with new handles, so the import and the gralloc info read with
+ * it are kept and handed out again by the gralloc buffer id.
+ * A registered import holds the buffer alive, it is dropped with its info
+ * once no framebuffer used it for BUFFER_REGISTRY_IDLE frames of the
+ * display that imported it last, see BufferRegistryScope.
+ */
+class DrmBufferRegistry : public Singleton<DrmBufferRegistry> {
+public:
+    DrmBufferRegistry();
+    ~DrmBufferRegistry();
+
+    /*
+     * import of the buffer and its info. Buffer without gralloc id gets a
+     * private import and info read from gralloc.
+     */
+    std::shared_ptr<native_handle_t> import(const native_handle_t * hnd,
+        drm_buffer_info_t & info);
+
+    /*called once per frame of the display, drops its idle imports.*/
+    void trim(int32_t display);
+
+    void dump(String8 & dumpstr);
+
+    static int32_t readInfo(const native_handle_t * hnd, drm_buffer_info_t & info);
+
+protected:
+    std::shared_ptr<native_handle_t> importBuffer(const native_handle_t * hnd);
+    /*unused entry to replace, or -1. Called with mMutex held.*/
+    int32_t getFreeEntry();
+
+    static int32_t getDisplayIdx(int32_t display);
+
+protected:
+    struct Entry {
+        std::shared_ptr<native_handle_t> handle;
+        drm_buffer_info_t info;
+        int32_t display;        /*display idx of the last import.*/
+        uint64_t lastFrame;     /*frame of that display at the last import.*/
+    };
+
+    std::mutex mMutex;
+    std::vector<Entry> mEntries;
+    uint64_t mFrames[BUFFER_REGISTRY_DISPLAYS];
+
+    /*stats.*/
+    uint64_t mImports;
+    uint64_t mReuses;
+    uint64_t mDropped;
+    uint64_t mUncached;     /*buffers without gralloc id.*/
+    uint64_t mSavedCalls;   /*dup and close saved by reuse.*/
+    nsecs_t mLastDumpTime;
+    uint64_t mLastDumpSaved;
+};
+
+/*display of the imports done by calling thread in the scope.*/
+class BufferRegistryScope {
+public:
+    BufferRegistryScope(int32_t display);
+    ~BufferRegistryScope();
+
+protected:
+    int32_t mLastDisplay;
+};
+
+#endif/*DRM_BUFFER_REGISTRY_H*/
@@ -15,6 +15,7 @@
 #include <BasicTypes.h>
 #include <DrmSync.h>
 #include <DrmTypes.h>
+#include <DrmBufferRegistry.h>
 
 #include <am_gralloc_ext.h>
 
@@ -38,6 +39,12 @@ public:
 
     bool isRotated();
 
+    /*
+     * copy display state of fb, shares its fences. Buffer is referenced
+     * again only if refBuffer, or the current one is kept.
+     */
+    void copyFrom(const DrmFramebuffer & fb, bool refBuffer);
+
 protected:
     void setBufferInfo(const native_handle_t * bufferhnd, int32_t acquireFence);
     void clearBufferInfo();
@@ -46,6 +53,8 @@ protected:
 
 public:
     native_handle_t * mBufferHandle;
+    /*gralloc info of mBufferHandle, zero without buffer.*/
+    drm_buffer_info_t mBufferInfo;
     drm_color_t mColor;
     drm_fb_type_t mFbType;
 
@@ -60,11 +69,16 @@ public:
 
     int32_t mCompositionType;
 
+    /*new buffer or damage since last present, plane can skip a clean fb.*/
+    bool mContentUpdated;
+
     std::map<drm_hdr_meatadata_t, float> mHdrMetaData;
 protected:
     std::shared_ptr<DrmFence> mAcquireFence;
     std::shared_ptr<DrmFence> mReleaseFence;
     void * mMapBase;
+    /*owns mBufferHandle, shared by fbs of the same buffer.*/
+    std::shared_ptr<native_handle_t> mImportedBuffer;
 };
 
 #endif/*DRM_FRAMEBUFFER_H*/
@@ -35,8 +35,19 @@ protected:
     int32_t mFenceFd;
 };
 
+/*software sync timeline, a fence signals when timeline reaches its value.*/
 class DrmTimeLine {
 public:
+    DrmTimeLine();
+    ~DrmTimeLine();
+
+    bool isValid() const { return mTimelineFd != -1; }
+
+    int32_t createFence(const char * name, uint32_t value);
+    int32_t inc(uint32_t count);
+
+protected:
+    int32_t mTimelineFd;
 };
 
 #endif/*DRM_SYNC_H*/
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     One thread watching fences with epoll, records when they signal.
+ */
+
+#ifndef FENCE_WATCHER_H
+#define FENCE_WATCHER_H
+
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <pthread.h>
+#include <utils/Timers.h>
+
+#include <BasicTypes.h>
+
+#define FENCE_WATCH_MAX             64
+#define FENCE_LATENCY_BUCKETS       48      /*1ms each, last one for the rest.*/
+#define FENCE_VSYNC_SLACK_NS        (2 * 1000000LL)
+#define FENCE_WARNING_TIMEOUT_MS    3000
+
+typedef enum {
+    FENCE_WATCH_PRESENT = 0,    /*page flip returned to scanout.*/
+    FENCE_WATCH_RELEASE,        /*release fence returned to buffer free.*/
+    FENCE_WATCH_ACQUIRE,        /*acquire fence waited by hwc.*/
+    FENCE_WATCH_TYPE_NUM,
+} fence_watch_type_t;
+
+typedef struct fence_watch_tag {
+    int32_t display;            /*crtc id, or -1.*/
+    int32_t plane;              /*plane id, or -1.*/
+    uint32_t frameSeq;
+    fence_watch_type_t type;
+} fence_watch_tag_t;
+
+typedef struct fence_latency_stats {
+    uint64_t count;
+    nsecs_t total;
+    nsecs_t max;
+    uint32_t hist[FENCE_LATENCY_BUCKETS];
+} fence_latency_stats_t;
+
+typedef struct fence_display_stats {
+    fence_latency_stats_t latency[FENCE_WATCH_TYPE_NUM];
+    nsecs_t vsyncPeriod;
+    /*present fences signaled after the vsync following the flip.*/
+    uint64_t missedFrames;
+    uint64_t missedVsyncs;
+    uint32_t lastMissedSeq;
+} fence_display_stats_t;
+
+/*called on watcher thread, should return fast.*/
+class FenceListener {
+public:
+    virtual ~FenceListener() { }
+    virtual void onFenceSignaled(const fence_watch_tag_t & tag,
+        nsecs_t submitTime, nsecs_t signalTime) = 0;
+};
+
+class FenceWatcher : public Singleton<FenceWatcher> {
+public:
+    FenceWatcher();
+    ~FenceWatcher();
+
+    /*
+     * fd is owned by the watcher from now on, even if failed.
+     * When the table is full the oldest watch is dropped.
+     */
+    int32_t watch(int32_t fd, const fence_watch_tag_t & tag,
+        FenceListener * listener = NULL);
+    /*drop listener from pending watches, and wait its running callback.*/
+    void cancel(FenceListener * listener);
+    /*wait on calling thread and close fd, signal time still goes to stats.*/
+    int32_t waitForever(int32_t fd, const fence_watch_tag_t & tag);
+
+    void setVsyncPeriod(int32_t display, nsecs_t period);
+    int32_t getStats(int32_t display, fence_display_stats_t & stats);
+    void dump(String8 & dumpstr);
+
+    /*tag with display and frame of the calling thread's FenceWatchScope.*/
+    static fence_watch_tag_t makeTag(fence_watch_type_t type, int32_t plane = -1);
+
+protected:
+    struct Watch {
+        int32_t fd;
+        fence_watch_tag_t tag;
+        nsecs_t submitTime;
+        FenceListener * listener;
+    };
+
+    int32_t startThread();
+    void removeWatch(uint32_t slot);
+    void handleSignaled(uint32_t slot, nsecs_t wakeTime);
+    void recordLatency(const fence_watch_tag_t & tag, nsecs_t latency);
+
+    static void * threadMain(void * data);
+    void threadLoop();
+
+protected:
+    std::mutex mMutex;
+    std::condition_variable mCallbackCond;
+    pthread_t mThread;
+    bool mThreadStarted;
+    bool mExit;
+    int32_t mEpollFd;
+    int32_t mWakeFd;
+
+    Watch mWatches[FENCE_WATCH_MAX];
+    uint32_t mWatchNum;
+    FenceListener * mCallingListener;
+
+    std::map<int32_t, fence_display_stats_t> mStats;
+    uint64_t mDroppedNum;
+    uint64_t mErrorNum;
+};
+
+/*display and frame of fences watched by calling thread in the scope.*/
+class FenceWatchScope {
+public:
+    FenceWatchScope(int32_t display, uint32_t frameSeq);
+    ~FenceWatchScope();
+
+protected:
+    int32_t mLastDisplay;
+    uint32_t mLastFrameSeq;
+};
+
+#endif/*FENCE_WATCHER_H*/
@@ -25,13 +25,16 @@ LOCAL_CFLAGS := $(HWC_C_FLAGS)
 LOCAL_SHARED_LIBRARIES := $(HWC_SHARED_LIBS)
 
 LOCAL_SRC_FILES := \
-    DebugHelper.cpp
+    DebugHelper.cpp \
+    FrameTimeline.cpp \
+    CompositionTrace.cpp
 
 LOCAL_C_INCLUDES := \
     $(LOCAL_PATH)/include
 
 LOCAL_STATIC_LIBRARIES := \
-    hwc.utils_static
+    hwc.utils_static \
+    hwc.base_static
 
 LOCAL_EXPORT_C_INCLUDE_DIRS := \
     $(LOCAL_PATH)/include
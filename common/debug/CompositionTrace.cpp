@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <CompositionTrace.h>
+#include <MesonLog.h>
+
+static int32_t readFully(int fd, void * buf, size_t len) {
+    uint8_t * ptr = (uint8_t *)buf;
+    while (len > 0) {
+        ssize_t ret = read(fd, ptr, len);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        if (ret == 0)
+            return -ENODATA;
+        ptr += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+static int32_t writeFully(int fd, const void * buf, size_t len) {
+    const uint8_t * ptr = (const uint8_t *)buf;
+    while (len > 0) {
+        ssize_t ret = write(fd, ptr, len);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        ptr += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+static void copyRect(int32_t * dst, drm_rect_t & rect) {
+    dst[0] = rect.left;
+    dst[1] = rect.top;
+    dst[2] = rect.right;
+    dst[3] = rect.bottom;
+}
+
+CompositionTraceWriter::CompositionTraceWriter()
+    : mFd(-1),
+      mFrameSeq(0) {
+}
+
+CompositionTraceWriter::~CompositionTraceWriter() {
+    close();
+}
+
+int32_t CompositionTraceWriter::open(const char * path, int32_t crtcId) {
+    close();
+
+    mFd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (mFd < 0) {
+        MESON_LOGE("open trace file %s failed (%d)", path, errno);
+        return -errno;
+    }
+
+    trace_file_header_t header;
+    header.magic = COMPOSITION_TRACE_MAGIC;
+    header.version = COMPOSITION_TRACE_VERSION;
+    header.layerSize = sizeof(trace_layer_t);
+    header.crtcId = crtcId;
+    int32_t ret = writeFully(mFd, &header, sizeof(header));
+    if (ret < 0) {
+        MESON_LOGE("write trace header failed (%d)", ret);
+        close();
+        return ret;
+    }
+
+    mFrameSeq = 0;
+    MESON_LOGI("start composition trace to %s", path);
+    return 0;
+}
+
+void CompositionTraceWriter::close() {
+    if (mFd >= 0) {
+        MESON_LOGI("stop composition trace, %u frames.", mFrameSeq);
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+int32_t CompositionTraceWriter::writeFrame(uint32_t flags, drm_mode_info_t & mode,
+    std::vector<std::shared_ptr<DrmFramebuffer>> & fbs) {
+    if (mFd < 0)
+        return -EBADF;
+
+    uint32_t layerNum = fbs.size();
+    if (layerNum > COMPOSITION_TRACE_MAX_LAYERS)
+        layerNum = COMPOSITION_TRACE_MAX_LAYERS;
+
+    /*one write per frame, a killed process leaves only whole frames.*/
+    mBuffer.resize(sizeof(trace_frame_header_t) + layerNum * sizeof(trace_layer_t));
+
+    trace_frame_header_t * header = (trace_frame_header_t *)mBuffer.data();
+    header->timestamp = systemTime(CLOCK_MONOTONIC);
+    header->frameSeq = mFrameSeq;
+    header->compositionFlags = flags;
+    header->displayWidth = mode.pixelW;
+    header->displayHeight = mode.pixelH;
+    header->refreshRate = mode.refreshRate;
+    header->layerNum = layerNum;
+
+    trace_layer_t * layer = (trace_layer_t *)(header + 1);
+    for (uint32_t i = 0; i < layerNum; i++, layer++) {
+        std::shared_ptr<DrmFramebuffer> & fb = fbs[i];
+        memset(layer, 0, sizeof(trace_layer_t));
+        layer->fbType = fb->mFbType;
+        layer->zorder = fb->mZorder;
+        layer->compositionType = fb->mCompositionType;
+        copyRect(layer->crop, fb->mSourceCrop);
+        copyRect(layer->frame, fb->mDisplayFrame);
+        layer->blendMode = fb->mBlendMode;
+        layer->planeAlpha = fb->mPlaneAlpha;
+        layer->transform = fb->mTransform;
+        layer->secure = fb->mSecure ? 1 : 0;
+        if (fb->mBufferHandle) {
+            layer->format = fb->mBufferInfo.format;
+            layer->afbc = fb->mBufferInfo.afbcMask;
+            layer->bufferWidth = fb->mBufferInfo.width;
+            layer->bufferHeight = fb->mBufferInfo.height;
+            layer->coherent = fb->mBufferInfo.coherent ? 1 : 0;
+        }
+    }
+
+    int32_t ret = writeFully(mFd, mBuffer.data(), mBuffer.size());
+    if (ret < 0) {
+        MESON_LOGE("write trace frame failed (%d), stop trace.", ret);
+        close();
+        return ret;
+    }
+
+    mFrameSeq++;
+    return 0;
+}
+
+CompositionTraceReader::CompositionTraceReader()
+    : mFd(-1) {
+    memset(&mHeader, 0, sizeof(mHeader));
+}
+
+CompositionTraceReader::~CompositionTraceReader() {
+    close();
+}
+
+int32_t CompositionTraceReader::open(const char * path) {
+    close();
+
+    mFd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (mFd < 0) {
+        MESON_LOGE("open trace file %s failed (%d)", path, errno);
+        return -errno;
+    }
+
+    int32_t ret = readFully(mFd, &mHeader, sizeof(mHeader));
+    if (ret < 0 || mHeader.magic != COMPOSITION_TRACE_MAGIC ||
+        mHeader.version != COMPOSITION_TRACE_VERSION ||
+        mHeader.layerSize != sizeof(trace_layer_t)) {
+        MESON_LOGE("%s is not a composition trace (v%u).", path, mHeader.version);
+        close();
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+void CompositionTraceReader::close() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+int32_t CompositionTraceReader::readFrame(trace_frame_t & frame) {
+    if (mFd < 0)
+        return -EBADF;
+
+    int32_t ret = readFully(mFd, &frame.header, sizeof(frame.header));
+    if (ret < 0)
+        return ret;
+
+    if (frame.header.layerNum > COMPOSITION_TRACE_MAX_LAYERS) {
+        MESON_LOGE("trace frame %u has invalid layer num %u.",
+            frame.header.frameSeq, frame.header.layerNum);
+        return -EINVAL;
+    }
+
+    frame.layers.resize(frame.header.layerNum);
+    if (frame.header.layerNum > 0) {
+        ret = readFully(mFd, frame.layers.data(),
+            frame.header.layerNum * sizeof(trace_layer_t));
+    }
+    return ret;
+}
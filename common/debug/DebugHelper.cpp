@@ -32,6 +32,8 @@ ANDROID_SINGLETON_STATIC_INSTANCE(DebugHelper)
 #define COMMAND_HIDE_PLANE "--hide-plane"
 #define COMMAND_MONITOR_DEVICE_COMPOSITION "--monitor-composition"
 #define COMMAND_DEVICE_COMPOSITION_THRESHOLD "--device-layers-threshold"
+#define COMMAND_CAPTURE_TRACE "--capture-trace"
+#define COMMAND_SAVE_TIMELINE "--save-timeline"
 
 #define MAX_DEBUG_COMMANDS (20)
 
@@ -54,6 +56,7 @@ DebugHelper::~DebugHelper() {
 
 void DebugHelper::clearOnePassCmd() {
     mDumpUsage = false;
+    mSaveTimeline = false;
 }
 
 void DebugHelper::clearPersistCmd() {
@@ -74,6 +77,8 @@ void DebugHelper::clearPersistCmd() {
 
     mDebugHideLayer = false;
     mDebugHidePlane = false;
+
+    mCaptureTraceFrames = 0;
 }
 
 void DebugHelper::addHideLayer(int id) {
@@ -201,6 +206,19 @@ void DebugHelper::resolveCmd() {
                     continue;
                 }
 
+                if (strcmp(paramArray[i], COMMAND_CAPTURE_TRACE) == 0) {
+                    i++;
+                    CHECK_CMD_INT_PARAMETER();
+                    int frames = atoi(paramArray[i]);
+                    mCaptureTraceFrames = frames > 0 ? frames : 0;
+                    continue;
+                }
+
+                if (strcmp(paramArray[i], COMMAND_SAVE_TIMELINE) == 0) {
+                    mSaveTimeline = true;
+                    continue;
+                }
+
                 if (strcmp(paramArray[i], COMMAND_IN_FENCE) == 0) {
                     i++;
                     CHECK_CMD_INT_PARAMETER();
@@ -334,7 +352,9 @@ void DebugHelper::dump(String8 & dumpstr) {
             "\t " COMMAND_HIDE_PLANE "/" COMMAND_SHOW_PLANE " [planeId]: hide/unhide specific plane by plane id. \n"
             "\t " COMMAND_LOG_FPS " 0|1: start/stop log fps.\n"
             "\t " COMMAND_SAVE_LAYER " [layerId]: save specific layer's raw data by layer id. \n"
-            "\t " COMMAND_MONITOR_DEVICE_COMPOSITION " 0|1: monitor non device composition. \n";
+            "\t " COMMAND_MONITOR_DEVICE_COMPOSITION " 0|1: monitor non device composition. \n"
+            "\t " COMMAND_CAPTURE_TRACE " [frames]: capture layer stacks to composition trace, 0 to stop. \n"
+            "\t " COMMAND_SAVE_TIMELINE ": save frame timeline of each display in this dump. \n";
 
         dumpstr.append("\nMesonHwc debug helper:\n");
         dumpstr.append(usage);
@@ -351,6 +371,7 @@ void DebugHelper::dump(String8 & dumpstr) {
         dumpstr.appendFormat(COMMAND_LOG_FPS " (%d)\n", mLogFps);
         dumpstr.appendFormat(COMMAND_MONITOR_DEVICE_COMPOSITION " (%d)\n", mMonitorDeviceComposition);
         dumpstr.appendFormat(COMMAND_DEVICE_COMPOSITION_THRESHOLD " (%d)\n", mDeviceCompositionThreshold);
+        dumpstr.appendFormat(COMMAND_CAPTURE_TRACE " (%u)\n", mCaptureTraceFrames);
 
         dumpstr.append(COMMAND_HIDE_PLANE " (");
         for (it = mHidePlanes.begin(); it < mHidePlanes.end(); it++) {
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include <cutils/trace.h>
+#include <sync/sync.h>
+
+#include <FrameTimeline.h>
+#include <MesonLog.h>
+
+#ifdef HWC_ENABLE_FRAME_TIMELINE
+
+static const char * sStageNames[FRAME_STAGE_NUM] = {
+    "validate",
+    "decide",
+    "present",
+    "commit",
+    "setPlane",
+    "pageFlip",
+    "postProcess",
+    "fenceSignal",
+};
+
+static thread_local FrameTimeline * sCurrentTimeline = NULL;
+
+FrameTimeline::FrameTimeline() {
+    memset(mEvents, 0, sizeof(mEvents));
+    mHead.store(0);
+    mFrameSeq = 0;
+    mFrameEnded = false;
+    mFenceNum = 0;
+}
+
+FrameTimeline::~FrameTimeline() {
+    for (uint32_t i = 0; i < mFenceNum; i++)
+        close(mFences[i].fd);
+}
+
+FrameTimeline * FrameTimeline::getCurrent() {
+    return sCurrentTimeline;
+}
+
+void FrameTimeline::setCurrent(FrameTimeline * timeline) {
+    sCurrentTimeline = timeline;
+}
+
+void FrameTimeline::pushEvent(frame_stage_t stage, int32_t arg,
+    uint32_t frameSeq, nsecs_t begin, nsecs_t end) {
+    uint64_t head = mHead.load(std::memory_order_relaxed);
+    frame_timeline_event_t & event = mEvents[head & (FRAME_TIMELINE_EVENTS - 1)];
+    event.begin = begin;
+    event.end = end;
+    event.frameSeq = frameSeq;
+    event.stage = stage;
+    event.arg = arg;
+    mHead.store(head + 1, std::memory_order_release);
+}
+
+void FrameTimeline::addEvent(frame_stage_t stage, int32_t arg,
+    nsecs_t begin, nsecs_t end) {
+    pushEvent(stage, arg, mFrameSeq, begin, end);
+    /*present is the outer stage, later events go to next frame.*/
+    if (stage == FRAME_STAGE_PRESENT && mFrameEnded) {
+        mFrameSeq++;
+        mFrameEnded = false;
+    }
+}
+
+void FrameTimeline::endFrame(int32_t presentFence) {
+    updateFences();
+
+    if (presentFence >= 0) {
+        /*keep the newest fences, drop the oldest one if full.*/
+        if (mFenceNum == FRAME_TIMELINE_PENDING_FENCES) {
+            close(mFences[0].fd);
+            memmove(&mFences[0], &mFences[1], sizeof(PendingFence) * (mFenceNum - 1));
+            mFenceNum--;
+        }
+        PendingFence & fence = mFences[mFenceNum];
+        fence.fd = ::dup(presentFence);
+        fence.frameSeq = mFrameSeq;
+        fence.presentTime = systemTime(CLOCK_MONOTONIC);
+        if (fence.fd >= 0)
+            mFenceNum++;
+    }
+
+    mFrameEnded = true;
+}
+
+/*pick up signal time of pending present fences, never wait.*/
+void FrameTimeline::updateFences() {
+    uint32_t i = 0;
+    while (i < mFenceNum) {
+        PendingFence & fence = mFences[i];
+        struct sync_file_info * info = sync_file_info(fence.fd);
+        int32_t status = info ? info->status : -1;
+        if (status == 0) {
+            sync_file_info_free(info);
+            i++;
+            continue;
+        }
+
+        if (status == 1) {
+            struct sync_fence_info * fences = sync_get_fence_info(info);
+            nsecs_t signalTime = 0;
+            for (uint32_t j = 0; j < info->num_fences; j++) {
+                if ((nsecs_t)fences[j].timestamp_ns > signalTime)
+                    signalTime = fences[j].timestamp_ns;
+            }
+            pushEvent(FRAME_STAGE_FENCE_SIGNAL, -1, fence.frameSeq,
+                fence.presentTime, signalTime);
+            ATRACE_INT64("hwc-present-fence-us", (signalTime - fence.presentTime) / 1000);
+        }
+        if (info)
+            sync_file_info_free(info);
+
+        close(fence.fd);
+        memmove(&mFences[i], &mFences[i + 1], sizeof(PendingFence) * (mFenceNum - i - 1));
+        mFenceNum--;
+    }
+}
+
+void FrameTimeline::copyEvents(std::vector<frame_timeline_event_t> & events) {
+    uint64_t head = mHead.load(std::memory_order_acquire);
+    uint64_t first = head > FRAME_TIMELINE_EVENTS ? head - FRAME_TIMELINE_EVENTS : 0;
+
+    events.clear();
+    for (uint64_t i = first; i < head; i++)
+        events.push_back(mEvents[i & (FRAME_TIMELINE_EVENTS - 1)]);
+
+    /*writer may have rewritten the oldest slots while copying.*/
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newHead = mHead.load(std::memory_order_relaxed);
+    if (newHead + 1 > first + FRAME_TIMELINE_EVENTS) {
+        uint64_t dropped = std::min<uint64_t>(
+            newHead + 1 - FRAME_TIMELINE_EVENTS - first, events.size());
+        events.erase(events.begin(), events.begin() + dropped);
+    }
+}
+
+int32_t FrameTimeline::save(const char * path, int32_t crtcId) {
+    std::vector<frame_timeline_event_t> events;
+    copyEvents(events);
+
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        MESON_LOGE("open timeline file %s failed (%d)", path, errno);
+        return -errno;
+    }
+
+    frame_timeline_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FRAME_TIMELINE_MAGIC;
+    header.version = FRAME_TIMELINE_VERSION;
+    header.eventSize = sizeof(frame_timeline_event_t);
+    header.crtcId = crtcId;
+    header.eventNum = events.size();
+
+    int32_t ret = 0;
+    size_t eventBytes = events.size() * sizeof(frame_timeline_event_t);
+    if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+        (eventBytes > 0 &&
+            write(fd, events.data(), eventBytes) != (ssize_t)eventBytes)) {
+        MESON_LOGE("write timeline file %s failed (%d)", path, errno);
+        ret = -EIO;
+    }
+    ::close(fd);
+    return ret;
+}
+
+static nsecs_t percentile(std::vector<nsecs_t> & sorted, uint32_t pct) {
+    return sorted[(sorted.size() - 1) * pct / 100];
+}
+
+static void dumpLatency(String8 & dumpstr, const char * name,
+    std::vector<nsecs_t> & times) {
+    if (times.empty())
+        return;
+    std::sort(times.begin(), times.end());
+    dumpstr.appendFormat("    %-12s %6zu %10.1f %10.1f %10.1f\n", name, times.size(),
+        percentile(times, 50) / 1000.0, percentile(times, 95) / 1000.0,
+        percentile(times, 99) / 1000.0);
+}
+
+void FrameTimeline::dump(String8 & dumpstr) {
+    std::vector<frame_timeline_event_t> events;
+    copyEvents(events);
+    if (events.empty())
+        return;
+
+    std::vector<nsecs_t> stageTimes[FRAME_STAGE_NUM];
+    std::vector<nsecs_t> frameTimes;
+    uint32_t frameSeq = events.front().frameSeq;
+    nsecs_t frameBegin = 0;
+    for (auto it = events.begin(); it != events.end(); ++it) {
+        if (it->stage >= FRAME_STAGE_NUM)
+            continue;
+        stageTimes[it->stage].push_back(it->end - it->begin);
+
+        /*hal time of a frame, first stage to end of present.*/
+        if (it->stage == FRAME_STAGE_FENCE_SIGNAL)
+            continue;
+        if (it->frameSeq != frameSeq || frameBegin == 0) {
+            frameSeq = it->frameSeq;
+            frameBegin = it->begin;
+        } else if (it->begin < frameBegin) {
+            frameBegin = it->begin;
+        }
+        if (it->stage == FRAME_STAGE_PRESENT)
+            frameTimes.push_back(it->end - frameBegin);
+    }
+
+    dumpstr.appendFormat("Frame timeline (%zu events, us):\n", events.size());
+    dumpstr.appendFormat("    %-12s %6s %10s %10s %10s\n", "stage", "count", "p50", "p95", "p99");
+    dumpLatency(dumpstr, "frame", frameTimes);
+    for (int32_t i = 0; i < FRAME_STAGE_NUM; i++)
+        dumpLatency(dumpstr, sStageNames[i], stageTimes[i]);
+}
+
+FrameTimelineStage::FrameTimelineStage(frame_stage_t stage, int32_t arg) {
+    mTimeline = FrameTimeline::getCurrent();
+    mStage = stage;
+    mArg = arg;
+    mBegin = systemTime(CLOCK_MONOTONIC);
+    ATRACE_BEGIN(sStageNames[stage]);
+}
+
+FrameTimelineStage::~FrameTimelineStage() {
+    ATRACE_END();
+    if (mTimeline)
+        mTimeline->addEvent(mStage, mArg, mBegin, systemTime(CLOCK_MONOTONIC));
+}
+
+FrameTimelineBinder::FrameTimelineBinder(FrameTimeline * timeline) {
+    mLast = FrameTimeline::getCurrent();
+    FrameTimeline::setCurrent(timeline);
+}
+
+FrameTimelineBinder::~FrameTimelineBinder() {
+    FrameTimeline::setCurrent(mLast);
+}
+
+#endif
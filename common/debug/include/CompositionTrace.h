@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#ifndef COMPOSITION_TRACE_H
+#define COMPOSITION_TRACE_H
+
+#include <BasicTypes.h>
+#include <DrmFramebuffer.h>
+
+/*
+ * Binary trace of the layer stacks passed to composition strategy.
+ * File layout:
+ *     trace_file_header_t
+ *     { trace_frame_header_t, trace_layer_t * layerNum } * frames
+ * All fields are 32/64bit, little endian as the device writes it.
+ */
+#define COMPOSITION_TRACE_MAGIC     0x54435748  /*"HWCT"*/
+#define COMPOSITION_TRACE_VERSION   1
+#define COMPOSITION_TRACE_PATH      "/data/vendor/hwc/composition_crtc%d.trace"
+#define COMPOSITION_TRACE_MAX_LAYERS 256
+
+typedef struct trace_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layerSize;     /*sizeof(trace_layer_t), for compatible check.*/
+    int32_t crtcId;
+} trace_file_header_t;
+
+typedef struct trace_frame_header {
+    int64_t timestamp;
+    uint32_t frameSeq;
+    uint32_t compositionFlags;
+    uint32_t displayWidth;
+    uint32_t displayHeight;
+    float refreshRate;
+    uint32_t layerNum;
+} trace_frame_header_t;
+
+typedef struct trace_layer {
+    int32_t fbType;
+    uint32_t zorder;
+    int32_t compositionType;    /*requested type before strategy decide.*/
+    int32_t crop[4];            /*left, top, right, bottom*/
+    int32_t frame[4];
+    int32_t blendMode;
+    float planeAlpha;
+    int32_t transform;
+    int32_t format;
+    int32_t afbc;
+    int32_t bufferWidth;
+    int32_t bufferHeight;
+    uint32_t secure;
+    uint32_t coherent;
+} trace_layer_t;
+
+typedef struct trace_frame {
+    trace_frame_header_t header;
+    std::vector<trace_layer_t> layers;
+} trace_frame_t;
+
+class CompositionTraceWriter {
+public:
+    CompositionTraceWriter();
+    ~CompositionTraceWriter();
+
+    int32_t open(const char * path, int32_t crtcId);
+    void close();
+    bool isOpened() { return mFd >= 0; }
+
+    int32_t writeFrame(uint32_t flags, drm_mode_info_t & mode,
+        std::vector<std::shared_ptr<DrmFramebuffer>> & fbs);
+    uint32_t getFrameCount() { return mFrameSeq; }
+
+protected:
+    int mFd;
+    uint32_t mFrameSeq;
+    std::vector<uint8_t> mBuffer;
+};
+
+class CompositionTraceReader {
+public:
+    CompositionTraceReader();
+    ~CompositionTraceReader();
+
+    int32_t open(const char * path);
+    void close();
+    int32_t getCrtcId() { return mHeader.crtcId; }
+
+    /*return 0 for one frame, -ENODATA at end of trace.*/
+    int32_t readFrame(trace_frame_t & frame);
+
+protected:
+    int mFd;
+    trace_file_header_t mHeader;
+};
+
+#endif/*COMPOSITION_TRACE_H*/
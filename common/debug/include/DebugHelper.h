@@ -47,6 +47,12 @@ public:
     /*save layer's raw data by layerid.*/
     inline void getSavedLayers(std::vector<int> & layers) {layers = mSaveLayers;}
 
+    /*capture layer stacks to composition trace, max frames, 0 to stop.*/
+    inline uint32_t captureTraceFrames() {return mCaptureTraceFrames;}
+
+    /*save frame timeline to file in this dump.*/
+    inline bool saveTimeline() {return mSaveTimeline;}
+
     /*remove debug layer*/
     void removeDebugLayer(int id);
 
@@ -64,6 +70,7 @@ protected:
 protected:
     bool mEnabled;
     bool mDumpUsage;
+    bool mSaveTimeline;
     bool mDisableUiHwc;
     bool mDumpDetail;
 
@@ -80,6 +87,8 @@ protected:
     bool mDebugHideLayer;
     bool mDebugHidePlane;
 
+    uint32_t mCaptureTraceFrames;
+
     /*handle osd in/out fence in hwc.*/
     bool mDiscardInFence;
     bool mDiscardOutFence;
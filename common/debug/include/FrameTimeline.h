@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Per display timestamps of frame stages, built in with
+ *     HWC_ENABLE_FRAME_TIMELINE, or the macros below are empty.
+ */
+
+#ifndef FRAME_TIMELINE_H
+#define FRAME_TIMELINE_H
+
+#include <atomic>
+#include <BasicTypes.h>
+#include <utils/Timers.h>
+
+typedef enum {
+    FRAME_STAGE_VALIDATE = 0,
+    FRAME_STAGE_DECIDE,
+    FRAME_STAGE_PRESENT,
+    FRAME_STAGE_COMMIT,
+    FRAME_STAGE_SET_PLANE,
+    FRAME_STAGE_PAGE_FLIP,
+    FRAME_STAGE_POST_PROCESS,
+    FRAME_STAGE_FENCE_SIGNAL,   /*present returned to present fence signaled.*/
+    FRAME_STAGE_NUM,
+} frame_stage_t;
+
+/*
+ * Binary dump layout:
+ *     frame_timeline_header_t
+ *     frame_timeline_event_t * eventNum, oldest first.
+ * Fence signal events come later than the other events of their frame.
+ */
+#define FRAME_TIMELINE_MAGIC        0x4c545748  /*"HWTL"*/
+#define FRAME_TIMELINE_VERSION      1
+#define FRAME_TIMELINE_PATH         "/data/vendor/hwc/timeline_crtc%d.bin"
+#define FRAME_TIMELINE_EVENTS       2048        /*power of 2.*/
+#define FRAME_TIMELINE_PENDING_FENCES 4
+
+typedef struct frame_timeline_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t eventSize;     /*sizeof(frame_timeline_event_t).*/
+    int32_t crtcId;
+    uint32_t eventNum;
+    uint32_t reserved;
+} frame_timeline_header_t;
+
+typedef struct frame_timeline_event {
+    int64_t begin;          /*CLOCK_MONOTONIC ns.*/
+    int64_t end;
+    uint32_t frameSeq;
+    uint16_t stage;
+    int16_t arg;            /*plane id for set plane, or -1.*/
+} frame_timeline_event_t;
+
+/*
+ * Ring of events with one writer, the thread composing the display.
+ * Readers copy it without lock and drop the slots overwritten meanwhile.
+ */
+class FrameTimeline {
+public:
+    FrameTimeline();
+    ~FrameTimeline();
+
+    /*writer side.*/
+    void addEvent(frame_stage_t stage, int32_t arg, nsecs_t begin, nsecs_t end);
+    /*
+     * current frame is closed by its present stage, fence signal time is
+     * picked up by later frames.
+     */
+    void endFrame(int32_t presentFence);
+
+    /*reader side.*/
+    void copyEvents(std::vector<frame_timeline_event_t> & events);
+    int32_t save(const char * path, int32_t crtcId);
+    void dump(String8 & dumpstr);
+
+    /*timeline of calling thread, stages are recorded to it.*/
+    static FrameTimeline * getCurrent();
+    static void setCurrent(FrameTimeline * timeline);
+
+protected:
+    void pushEvent(frame_stage_t stage, int32_t arg, uint32_t frameSeq,
+        nsecs_t begin, nsecs_t end);
+    void updateFences();
+
+protected:
+    struct PendingFence {
+        int32_t fd;
+        uint32_t frameSeq;
+        nsecs_t presentTime;
+    };
+
+    frame_timeline_event_t mEvents[FRAME_TIMELINE_EVENTS];
+    std::atomic<uint64_t> mHead;
+    uint32_t mFrameSeq;
+    bool mFrameEnded;
+
+    PendingFence mFences[FRAME_TIMELINE_PENDING_FENCES];
+    uint32_t mFenceNum;
+};
+
+/*record a stage of current frame from construct to destruct.*/
+class FrameTimelineStage {
+public:
+    FrameTimelineStage(frame_stage_t stage, int32_t arg = -1);
+    ~FrameTimelineStage();
+
+protected:
+    FrameTimeline * mTimeline;
+    frame_stage_t mStage;
+    int32_t mArg;
+    nsecs_t mBegin;
+};
+
+/*bind timeline to calling thread in the scope.*/
+class FrameTimelineBinder {
+public:
+    FrameTimelineBinder(FrameTimeline * timeline);
+    ~FrameTimelineBinder();
+
+protected:
+    FrameTimeline * mLast;
+};
+
+#ifdef HWC_ENABLE_FRAME_TIMELINE
+#define FRAME_TIMELINE_BIND(timeline) \
+    FrameTimelineBinder frameTimelineBinder(timeline)
+#define FRAME_TIMELINE_STAGE(stage) \
+    FrameTimelineStage frameTimelineStage(stage)
+#define FRAME_TIMELINE_PLANE_STAGE(stage, planeId) \
+    FrameTimelineStage frameTimelineStage(stage, planeId)
+#define FRAME_TIMELINE_END_FRAME(presentFence) \
+    if (FrameTimeline::getCurrent()) \
+        FrameTimeline::getCurrent()->endFrame(presentFence)
+#else
+#define FRAME_TIMELINE_BIND(timeline)
+#define FRAME_TIMELINE_STAGE(stage)
+#define FRAME_TIMELINE_PLANE_STAGE(stage, planeId)
+#define FRAME_TIMELINE_END_FRAME(presentFence)
+#endif
+
+#endif/*FRAME_TIMELINE_H*/
@@ -30,6 +30,7 @@ LOCAL_SRC_FILES := \
     HwDisplayManager.cpp \
     HwDisplayCrtc.cpp \
     HwDisplayPlane.cpp \
+    HwDisplayCommit.cpp \
     DummyPlane.cpp \
     OsdPlane.cpp \
     CursorPlane.cpp \
@@ -39,6 +40,8 @@ LOCAL_SRC_FILES := \
     HwConnectorFactory.cpp \
     HwDisplayConnector.cpp \
     HwDisplayEventListener.cpp \
+    UeventParser.cpp \
+    SysfsCache.cpp \
     ConnectorHdmi.cpp \
     ConnectorCvbs.cpp \
     ConnectorPanel.cpp \
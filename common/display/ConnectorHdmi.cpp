@@ -10,6 +10,8 @@
 #include <fcntl.h>
 #include <MesonLog.h>
 #include <misc.h>
+#include <SysfsWriter.h>
+#include <SysfsCache.h>
 #include <systemcontrol.h>
 
 #include "AmVinfo.h"
@@ -89,7 +91,8 @@ bool ConnectorHdmi::isSecure() {
 }
 
 bool ConnectorHdmi::checkConnectState() {
-    return sysfs_get_int(HDMI_TX_HPD_STATE, 0) == 1 ? true : false;
+    return SysfsCache::getInstance().getInt(HDMI_TX_HPD_STATE, 0,
+        SYSFS_EVENT_MASK(DRM_EVENT_HDMITX_HOTPLUG)) == 1 ? true : false;
 }
 
 int32_t ConnectorHdmi::loadDisplayModes() {
@@ -182,15 +185,16 @@ int32_t ConnectorHdmi::setMode(drm_mode_info_t & mode) {
 }
 
 int32_t ConnectorHdmi::switchRatePolicy(bool fracRatePolicy) {
+    /*policy may be set by others too, compare with the node.*/
     if (fracRatePolicy) {
-        if (!sysfs_set_string(HDMI_FRAC_RATE_POLICY, "1")) {
+        if (!SysfsWriter::getInstance().write(HDMI_FRAC_RATE_POLICY, "1", true)) {
             MESON_LOGV("Switch to frac rate policy SUCCESS.");
         } else {
             MESON_LOGE("Switch to frac rate policy FAIL.");
             return -EFAULT;
         }
     } else {
-        if (!sysfs_set_string(HDMI_FRAC_RATE_POLICY, "0")) {
+        if (!SysfsWriter::getInstance().write(HDMI_FRAC_RATE_POLICY, "0", true)) {
             MESON_LOGV("Switch to normal rate policy SUCCESS.");
         } else {
             MESON_LOGE("Switch to normal rate policy FAIL.");
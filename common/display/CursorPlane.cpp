@@ -8,6 +8,7 @@
  */
 #include <sys/mman.h>
 #include <misc.h>
+#include <FrameTimeline.h>
 
 #include "CursorPlane.h"
 
@@ -58,7 +59,7 @@ uint32_t CursorPlane::getPossibleCrtcs() {
 
 bool CursorPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
     if (fb->mFbType == DRM_FB_CURSOR &&
-        am_gralloc_get_format(fb->mBufferHandle) == HAL_PIXEL_FORMAT_RGBA_8888) {
+        fb->mBufferInfo.format == HAL_PIXEL_FORMAT_RGBA_8888) {
         return true;
     }
 
@@ -68,6 +69,7 @@ bool CursorPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
 int32_t CursorPlane::setPlane(
     std::shared_ptr<DrmFramebuffer> fb,
     uint32_t zorder __unused, int blankOp) {
+    FRAME_TIMELINE_PLANE_STAGE(FRAME_STAGE_SET_PLANE, mId);
     if (mDrvFd < 0) {
         MESON_LOGE("cursor plane fd is not valiable!");
         return -EBADF;
@@ -82,11 +84,11 @@ int32_t CursorPlane::setPlane(
         mPlaneInfo.transform     = fb->mTransform;
         mPlaneInfo.dst_x         = disFrame.left;
         mPlaneInfo.dst_y         = disFrame.top;
-        mPlaneInfo.format        = am_gralloc_get_format(buf);
+        mPlaneInfo.format        = fb->mBufferInfo.format;
         mPlaneInfo.shared_fd     = am_gralloc_get_buffer_fd(buf);
-        mPlaneInfo.stride        = am_gralloc_get_stride_in_pixel(buf);
-        mPlaneInfo.buf_w         = am_gralloc_get_width(buf);
-        mPlaneInfo.buf_h         = am_gralloc_get_height(buf);
+        mPlaneInfo.stride        = fb->mBufferInfo.pixelStride;
+        mPlaneInfo.buf_w         = fb->mBufferInfo.width;
+        mPlaneInfo.buf_h         = fb->mBufferInfo.height;
 
         updateCursorBuffer(fb);
         setCursorPosition(mPlaneInfo.dst_x, mPlaneInfo.dst_y);
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/ioctl.h>
+
+#include <HwDisplayCommit.h>
+#include <HwDisplayPlane.h>
+#include <MesonLog.h>
+
+#define COMMIT_REQUESTS_RESERVED (8)
+
+int32_t FbDisplayBackend::ioctl(int32_t fd, unsigned long cmd, void * arg) {
+    if (::ioctl(fd, cmd, arg) != 0)
+        return -errno;
+    return 0;
+}
+
+HwDisplayCommit::HwDisplayCommit(std::shared_ptr<HwDisplayBackend> backend) {
+    mBackend = backend;
+    mRequests.reserve(COMMIT_REQUESTS_RESERVED);
+    mFrames = mBatchedFrames = mPlaneRequests = mFailedRequests = 0;
+    mAbortedRequests = 0;
+}
+
+HwDisplayCommit::~HwDisplayCommit() {
+}
+
+int32_t HwDisplayCommit::addPlaneRequest(HwDisplayPlane * plane,
+    int32_t fd, unsigned long cmd, void * arg) {
+    hw_commit_request_t request = {plane, fd, cmd, arg, 0};
+    /*plane set again before the flip, only its last state is posted.*/
+    for (auto it = mRequests.begin(); it != mRequests.end(); ++it) {
+        if (it->plane == plane) {
+            MESON_LOGW("plane %s set twice in one commit.", plane->getName());
+            *it = request;
+            return 0;
+        }
+    }
+    mRequests.push_back(request);
+    mPlaneRequests++;
+    return 0;
+}
+
+int32_t HwDisplayCommit::submit(int32_t fd, unsigned long cmd, void * arg) {
+    hw_commit_request_t flip = {NULL, fd, cmd, arg, 0};
+    mRequests.push_back(flip);
+    mFrames++;
+
+    if (mBackend->commit(*this) == 0) {
+        mBatchedFrames++;
+    } else {
+        /*legacy sequence, planes first and the flip latches them.*/
+        for (auto it = mRequests.begin(); it != mRequests.end(); ++it)
+            it->result = mBackend->ioctl(it->fd, it->cmd, it->arg);
+    }
+
+    int32_t ret = 0;
+    for (auto it = mRequests.begin(); it != mRequests.end(); ++it) {
+        if (it->result != 0)
+            mFailedRequests++;
+        if (it->plane)
+            it->plane->onCommitted(it->arg, it->result);
+        else
+            ret = it->result;
+    }
+    mRequests.clear();
+    return ret;
+}
+
+void HwDisplayCommit::abort() {
+    for (auto it = mRequests.begin(); it != mRequests.end(); ++it) {
+        if (it->plane)
+            it->plane->onAborted(it->arg);
+        mAbortedRequests++;
+    }
+    mRequests.clear();
+}
+
+void HwDisplayCommit::dump(String8 & dumpstr) {
+    dumpstr.appendFormat("Commit: %" PRIu64 " frames (%" PRIu64 " batched), %" PRIu64
+        " plane requests, %" PRIu64 " failed, %" PRIu64 " aborted\n",
+        mFrames, mBatchedFrames, mPlaneRequests, mFailedRequests, mAbortedRequests);
+}
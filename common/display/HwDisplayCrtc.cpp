@@ -10,9 +10,13 @@
 #include <HwDisplayCrtc.h>
 #include <MesonLog.h>
 #include <DebugHelper.h>
+#include <FrameTimeline.h>
+#include <FenceWatcher.h>
 #include <cutils/properties.h>
 #include <systemcontrol.h>
 #include <misc.h>
+#include <SysfsWriter.h>
+#include <SysfsCache.h>
 #include <math.h>
 #include <OmxUtil.h>
 
@@ -36,10 +40,12 @@ HwDisplayCrtc::HwDisplayCrtc(int drvFd, int32_t id) {
     *for new vpu, it can be 1 or 2.
     */
     mOsdChannels = 1;
+    mScaleUpdated = true;
+    memset(&mScaleInfo, 0, sizeof(mScaleInfo));
     memset(&nullHdr, 0, sizeof(nullHdr));
 
     hdrVideoInfo = malloc(sizeof(vframe_master_display_colour_s_t));
-
+    mCommit = std::make_shared<HwDisplayCommit>(std::make_shared<FbDisplayBackend>());
 }
 
 HwDisplayCrtc::~HwDisplayCrtc() {
@@ -53,17 +59,28 @@ int32_t HwDisplayCrtc::bind(
         if (mConnector.get())
             mConnector->setCrtc(NULL);
         mConnector.reset();
-        mPlanes.clear();
+        releasePlanes();
         mBinded =  false;
     }
 
     mConnector = connector;
     mConnector->setCrtc(this);
     mPlanes = planes;
+    for (auto it = mPlanes.begin(); it != mPlanes.end(); ++it)
+        (*it)->setCommit(mCommit);
     mBinded = true;
     return 0;
 }
 
+/*planes may be bound to another crtc already.*/
+void HwDisplayCrtc::releasePlanes() {
+    for (auto it = mPlanes.begin(); it != mPlanes.end(); ++it) {
+        if ((*it)->getCommit() == mCommit)
+            (*it)->setCommit(NULL);
+    }
+    mPlanes.clear();
+}
+
 int32_t HwDisplayCrtc::unbind() {
     /*TODO: temp disable here.
     * systemcontrol and hwc set display mode
@@ -85,7 +102,7 @@ int32_t HwDisplayCrtc::unbind() {
         if (mConnector.get())
             mConnector->setCrtc(NULL);
         mConnector.reset();
-        mPlanes.clear();
+        releasePlanes();
 
         mBinded = false;
     }
@@ -186,19 +203,27 @@ int32_t HwDisplayCrtc::update() {
 }
 
 int32_t HwDisplayCrtc::setDisplayFrame(display_zoom_info_t & info) {
-    mScaleInfo = info;
+    display_zoom_info_t scaleInfo = info;
     /*not used now, clear to 0.*/
-    mScaleInfo.crtc_w = 0;
-    mScaleInfo.crtc_h = 0;
+    scaleInfo.crtc_w = 0;
+    scaleInfo.crtc_h = 0;
+    if (memcmp(&mScaleInfo, &scaleInfo, sizeof(scaleInfo)) != 0) {
+        mScaleInfo = scaleInfo;
+        mScaleUpdated = true;
+    }
     return 0;
 }
 
 int32_t HwDisplayCrtc::setOsdChannels(int32_t channels) {
-    mOsdChannels = channels;
+    if (mOsdChannels != (uint32_t)channels) {
+        mOsdChannels = channels;
+        mScaleUpdated = true;
+    }
     return 0;
 }
 
 int32_t HwDisplayCrtc::pageFlip(int32_t &out_fence) {
+    FRAME_TIMELINE_STAGE(FRAME_STAGE_PAGE_FLIP);
     if (mFirstPresent) {
         mFirstPresent = false;
         closeLogoDisplay();
@@ -215,12 +240,17 @@ int32_t HwDisplayCrtc::pageFlip(int32_t &out_fence) {
     flipInfo.curPosition_h = mScaleInfo.crtc_display_h;
     flipInfo.hdr_mode = (mOsdChannels == 1) ? 1 : 0;
 
-    ioctl(mDrvFd, FBIOPUT_OSD_DO_HWC, &flipInfo);
+    flipInfo.out_fen_fd = -1;
+
+    /*planes posted before the flip latches them.*/
+    int32_t ret = mCommit->submit(mDrvFd, FBIOPUT_OSD_DO_HWC, &flipInfo);
+    if (ret != 0)
+        MESON_LOGE("crtc %d FBIOPUT_OSD_DO_HWC return(%d)", mId, ret);
+    mScaleUpdated = false;
 
     if (DebugHelper::getInstance().discardOutFence()) {
-        std::shared_ptr<DrmFence> outfence =
-            std::make_shared<DrmFence>(flipInfo.out_fen_fd);
-        outfence->waitForever("crtc-output");
+        FenceWatcher::getInstance().waitForever(flipInfo.out_fen_fd,
+            FenceWatcher::makeTag(FENCE_WATCH_PRESENT));
         out_fence = -1;
     } else {
         out_fence = (flipInfo.out_fen_fd >= 0) ? flipInfo.out_fen_fd : -1;
@@ -229,6 +259,18 @@ int32_t HwDisplayCrtc::pageFlip(int32_t &out_fence) {
     return 0;
 }
 
+void HwDisplayCrtc::abortCommit() {
+    mCommit->abort();
+}
+
+void HwDisplayCrtc::setBackend(std::shared_ptr<HwDisplayBackend> backend) {
+    mCommit->setBackend(backend);
+}
+
+void HwDisplayCrtc::dump(String8 & dumpstr) {
+    mCommit->dump(dumpstr);
+}
+
 int32_t HwDisplayCrtc::getHdrMetadataKeys(
     std::vector<drm_hdr_meatadata_t> & keys) {
     static drm_hdr_meatadata_t supportedKeys[] = {
@@ -327,16 +369,20 @@ bool HwDisplayCrtc::updateHdrMetadata(
 }
 
 void HwDisplayCrtc::closeLogoDisplay() {
-    sysfs_set_string(DISPLAY_LOGO_INDEX, "-1");
-    sysfs_set_string(DISPLAY_FB0_FREESCALE_SWTICH, "0x10001");
+    /*off the frame path, nothing of the frame depends on them.*/
+    SysfsWriter::getInstance().writeAsync(DISPLAY_LOGO_INDEX, "-1");
+    SysfsWriter::getInstance().writeAsync(DISPLAY_FB0_FREESCALE_SWTICH, "0x10001");
 }
 
 int32_t  HwDisplayCrtc::readCurDisplayMode(std::string & dispmode) {
     int32_t ret = 0;
+    uint32_t hotplug = SYSFS_EVENT_MASK(DRM_EVENT_HDMITX_HOTPLUG);
     if (mId == CRTC_VOUT1) {
-        ret = sc_read_sysfs(VIU1_DISPLAY_MODE_SYSFS, dispmode);
+        ret = SysfsCache::getInstance().read(VIU1_DISPLAY_MODE_SYSFS, dispmode,
+            hotplug | SYSFS_EVENT_MASK(DRM_EVENT_VOUT1_MODE_CHANGED), true);
     }  else if (mId == CRTC_VOUT2) {
-        ret = sc_read_sysfs(VIU2_DISPLAY_MODE_SYSFS, dispmode);
+        ret = SysfsCache::getInstance().read(VIU2_DISPLAY_MODE_SYSFS, dispmode,
+            hotplug | SYSFS_EVENT_MASK(DRM_EVENT_VOUT2_MODE_CHANGED), true);
     }
 
     return ret;
@@ -353,6 +399,8 @@ int32_t HwDisplayCrtc::writeCurDisplayMode(std::string & dispmode) {
         ret = sc_write_sysfs(VIU2_DISPLAY_MODE_SYSFS, dispmode);
     }
 
+    SysfsCache::getInstance().invalidate(
+        mId == CRTC_VOUT1 ? VIU1_DISPLAY_MODE_SYSFS : VIU2_DISPLAY_MODE_SYSFS);
     return ret;
 }
 
@@ -7,76 +7,59 @@
  * Description:
  */
 
+#include <algorithm>
 #include <poll.h>
 #include <string.h>
 #include <cutils/uevent.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <MesonLog.h>
+#include <SysfsCache.h>
+#include <misc.h>
 
 #include "HwDisplayEventListener.h"
 
 
 ANDROID_SINGLETON_STATIC_INSTANCE(HwDisplayEventListener)
 
-#define HDMITX_HOTPLUG_EVENT \
-    "change@/devices/virtual/amhdmitx/amhdmitx0/hdmi"
-#define HDMITX_HDCP_EVENT \
-    "change@/devices/virtual/amhdmitx/amhdmitx0/hdcp"
-#define VOUT_MODE_EVENT \
-    "change@/devices/platform/vout/extcon/setmode"
-#define VOUT2_MODE_EVENT \
-    "change@/devices/platform/vout2/extcon/setmode2"
-
 #define UEVENT_MAX_LEN (4096)
 
-#define OLD_EVENT_STATE_ENABLE "SWITCH_STATE=1"
-#define OLD_EVENT_STATE_DISABLE "SWITCH_STATE=0"
-#define NEW_EVENT_STATE_ENABLE "STATE=HDMI=1"
-#define NEW_EVENT_STATE_DISABLE "STATE=HDMI=0"
-#define VOUT_EVENT_MODESWITCH_BEGIN "STATE=ACA=1"
-#define VOUT_EVENT_MODESWITCH_COMPLETE "STATE=ACA=0"
-
-typedef struct drm_uevent_info {
-    const char * head;
-    drm_display_event eventType;
-    const char * stateEnable;
-    const char * stateDisable;
-}drm_uevent_info_t;
-
-/*load uevent parser*/
-#if PLATFORM_SDK_VERSION >= 28
-static drm_uevent_info_t mUeventParser[] = {
-    {HDMITX_HOTPLUG_EVENT, DRM_EVENT_HDMITX_HOTPLUG,
-        NEW_EVENT_STATE_ENABLE, NEW_EVENT_STATE_DISABLE},
-    {HDMITX_HDCP_EVENT, DRM_EVENT_HDMITX_HDCP,
-        NEW_EVENT_STATE_ENABLE, NEW_EVENT_STATE_DISABLE},
-    {VOUT_MODE_EVENT, DRM_EVENT_VOUT1_MODE_CHANGED,
-        VOUT_EVENT_MODESWITCH_COMPLETE, VOUT_EVENT_MODESWITCH_BEGIN},
-    {VOUT2_MODE_EVENT, DRM_EVENT_VOUT2_MODE_CHANGED,
-        VOUT_EVENT_MODESWITCH_COMPLETE, VOUT_EVENT_MODESWITCH_BEGIN}
-};
-#else
-static drm_uevent_info_t mUeventParser[] = {
-    {HDMITX_HOTPLUG_EVENT, DRM_EVENT_HDMITX_HOTPLUG,
-        OLD_EVENT_STATE_ENABLE, OLD_EVENT_STATE_DISABLE},
-    {HDMITX_HDCP_EVENT, DRM_EVENT_HDMITX_HDCP,
-        OLD_EVENT_STATE_ENABLE, OLD_EVENT_STATE_DISABLE},
-    {VOUT_MODE_EVENT, DRM_EVENT_VOUT1_MODE_CHANGED,
-        OLD_EVENT_STATE_ENABLE, OLD_EVENT_STATE_DISABLE}
-    {VOUT2_MODE_EVENT, DRM_EVENT_VOUT2_MODE_CHANGED,
-        OLD_EVENT_STATE_ENABLE, OLD_EVENT_STATE_DISABLE}
-};
-#endif
+#define HOTPLUG_DEBOUNCE_PROP "vendor.hwc.hotplug-debounce"
+#define HOTPLUG_DEBOUNCE_DEFAULT_MS (100)
+#define HOTPLUG_DEBOUNCE_EVENT (1)
+/*uevent socket, control pipe and wake pipe, then sysfs cache nodes.*/
+#define UEVENT_POLL_FIXED_FDS (3)
 
 HwDisplayEventListener::HwDisplayEventListener()
     :   mUeventMsg(NULL),
         mCtlInFd(-1),
-        mCtlOutFd(-1) {
+        mCtlOutFd(-1),
+        mWakeReadFd(-1),
+        mWakeWriteFd(-1),
+        mReactor(HwcReactor::isEnabled(REACTOR_CLIENT_UEVENT)),
+        mDebounceMs(HOTPLUG_DEBOUNCE_DEFAULT_MS),
+        mHotplugPending(false),
+        mHotplugVal(0),
+        mHotplugEvents(0),
+        mHotplugSuppressed(0),
+        mHotplugHandled(0),
+        mHotplugTime(0),
+        mHotplugMaxTime(0),
+        mUevents(0),
+        mUeventsMatched(0),
+        mThreadStarted(false) {
+    char val[PROP_VALUE_LEN_MAX];
+    if (sys_get_string_prop(HOTPLUG_DEBOUNCE_PROP, val) > 0 && atoi(val) >= 0)
+        mDebounceMs = atoi(val);
+
     /*init uevent socket.*/
     mEventSocket = uevent_open_socket(64*1024, true);
     if (mEventSocket < 0) {
         MESON_LOGE("uevent_init: uevent_open_socket failed\n");
         return;
     }
+    /*not fatal, display events are matched again after receive.*/
+    mParser.attachFilter(mEventSocket);
 
     /*make pipe fd for exit uevent thread.*/
     int ctlPipe[2];
@@ -87,6 +70,20 @@ HwDisplayEventListener::HwDisplayEventListener()
     mCtlInFd = ctlPipe[0];
     mCtlOutFd = ctlPipe[1];
 
+    int wakePipe[2];
+    if (mReactor) {
+        SysfsCache::getInstance().setPollListener([this]() {
+            syncReactorFds();
+        });
+    } else if (pipe2(wakePipe, O_CLOEXEC | O_NONBLOCK) == 0) {
+        mWakeReadFd = wakePipe[0];
+        mWakeWriteFd = wakePipe[1];
+        SysfsCache::getInstance().setPollListener([this]() {
+            char c = 1;
+            write(mWakeWriteFd, &c, 1);
+        });
+    }
+
     mUeventMsg = new char[UEVENT_MAX_LEN];
     memset(mUeventMsg, 0, UEVENT_MAX_LEN);
 
@@ -94,6 +91,16 @@ HwDisplayEventListener::HwDisplayEventListener()
 }
 
 HwDisplayEventListener::~HwDisplayEventListener() {
+    /*stop debounce timer first, it calls back to listener.*/
+    mDebounceThread.reset();
+
+    if (mReactor && mThreadStarted) {
+        HwcReactor::getInstance().removeFd(mEventSocket);
+        for (auto it = mReactorFds.begin(); it != mReactorFds.end(); ++it)
+            HwcReactor::getInstance().removeFd(*it);
+        mReactorFds.clear();
+    }
+
     if (mCtlInFd >= 0) {
         close(mCtlInFd);
         mCtlInFd = -1;
@@ -111,6 +118,13 @@ HwDisplayEventListener::~HwDisplayEventListener() {
         mCtlOutFd = -1;
     }
 
+    SysfsCache::getInstance().setPollListener(NULL);
+    if (mWakeReadFd >= 0) {
+        close(mWakeReadFd);
+        close(mWakeWriteFd);
+        mWakeReadFd = mWakeWriteFd = -1;
+    }
+
     delete mUeventMsg;
 
     mEventHandler.clear();
@@ -118,30 +132,84 @@ HwDisplayEventListener::~HwDisplayEventListener() {
 }
 
 void HwDisplayEventListener::createThread() {
+    /*one listener for all handlers.*/
+    if (mThreadStarted || mEventSocket < 0)
+        return;
+
+    if (mReactor) {
+        if (HwcReactor::getInstance().addFd(mEventSocket, EPOLLIN, this) != 0)
+            return;
+        mThreadStarted = true;
+        syncReactorFds();
+        return;
+    }
+
     int ret = pthread_create(&hw_event_thread, NULL, ueventThread, this);
     if (ret) {
         MESON_LOGE("failed to start uevent thread: %s", strerror(ret));
         return;
     }
+    mThreadStarted = true;
 }
 
-void HwDisplayEventListener::handleUevent() {
-    for (drm_uevent_info_t uevent : mUeventParser) {
-        if (strcmp(mUeventMsg, uevent.head) == 0) {
-            char * msg = mUeventMsg;
-            while (*msg) {
-                MESON_LOGD("received Uevent: %s", msg);
-                if (strstr(msg, uevent.stateEnable)) {
-                    handle(uevent.eventType, 1);
-                    return;
-                } else if (strstr(msg, uevent.stateDisable)) {
-                    handle(uevent.eventType, 0);
-                    return;
-                }
-                msg += strlen(msg) + 1;
-            }
+void HwDisplayEventListener::syncReactorFds() {
+    std::vector<struct pollfd> fds;
+    SysfsCache::getInstance().getPollFds(fds);
+
+    std::vector<int> added, removed;
+    pthread_mutex_lock(&hw_event_mutex);
+    for (auto it = fds.begin(); it != fds.end(); ++it) {
+        if (std::find(mReactorFds.begin(), mReactorFds.end(), it->fd) == mReactorFds.end()) {
+            mReactorFds.push_back(it->fd);
+            added.push_back(it->fd);
+        }
+    }
+    for (auto it = mReactorFds.begin(); it != mReactorFds.end();) {
+        bool polled = false;
+        for (auto fd = fds.begin(); fd != fds.end() && !polled; ++fd)
+            polled = fd->fd == *it;
+        if (polled) {
+            ++ it;
+        } else {
+            removed.push_back(*it);
+            it = mReactorFds.erase(it);
         }
     }
+    pthread_mutex_unlock(&hw_event_mutex);
+
+    /*out of lock, removeFd waits a running handleFd.*/
+    for (auto it = removed.begin(); it != removed.end(); ++it)
+        HwcReactor::getInstance().removeFd(*it);
+    for (auto it = added.begin(); it != added.end(); ++it)
+        HwcReactor::getInstance().addFd(*it, EPOLLPRI, this);
+}
+
+void HwDisplayEventListener::handleFd(int fd, uint32_t events) {
+    if (fd == mEventSocket) {
+        ssize_t len = uevent_kernel_multicast_recv(mEventSocket,
+            mUeventMsg, UEVENT_MAX_LEN - 2);
+        if (len > 0)
+            handleUevent(len);
+        return;
+    }
+
+    /*sysfs notify, node is read again and armed for next one.*/
+    if (events & (EPOLLPRI | EPOLLERR)) {
+        SysfsCache::getInstance().handlePoll(fd);
+        syncReactorFds();
+    }
+}
+
+void HwDisplayEventListener::handleUevent(size_t len) {
+    drm_display_event event;
+    int val;
+    mUevents++;
+    if (mParser.parse(mUeventMsg, len, event, val) != 0)
+        return;
+
+    mUeventsMatched++;
+    MESON_LOGD("received Uevent: %s, value %d", mUeventMsg, val);
+    handle(event, val);
 }
 
 void * HwDisplayEventListener::ueventThread(void * data) {
@@ -150,7 +218,8 @@ void * HwDisplayEventListener::ueventThread(void * data) {
         pthread_mutex_lock(&pThis->hw_event_mutex);
 
         int rtn;
-        struct pollfd fds[2];
+        std::vector<struct pollfd> & fds = pThis->mPollFds;
+        fds.resize(UEVENT_POLL_FIXED_FDS);
 
         fds[0].fd = pThis->mEventSocket;
         fds[0].events = POLLIN;
@@ -158,32 +227,120 @@ void * HwDisplayEventListener::ueventThread(void * data) {
         fds[1].fd = pThis->mCtlOutFd;
         fds[1].events = POLLIN;
         fds[1].revents = 0;
+        fds[2].fd = pThis->mWakeReadFd;
+        fds[2].events = POLLIN;
+        fds[2].revents = 0;
+        SysfsCache::getInstance().getPollFds(fds);
 
-        rtn = poll(fds, 2, -1);
+        rtn = poll(fds.data(), fds.size(), -1);
 
         if (rtn > 0 && fds[0].revents == POLLIN) {
             ssize_t len = uevent_kernel_multicast_recv(pThis->mEventSocket,
                 pThis->mUeventMsg, UEVENT_MAX_LEN - 2);
             if (len > 0)
-                pThis->handleUevent();
+                pThis->handleUevent(len);
         } else if (fds[1].revents) {
             MESON_LOGE("exit display event thread.");
             return NULL;
         }
 
+        if (rtn > 0 && fds[2].revents) {
+            char buf[16];
+            while (read(pThis->mWakeReadFd, buf, sizeof(buf)) > 0)
+                ;
+        }
+        /*sysfs notify, node is read again and armed for next one.*/
+        for (size_t i = UEVENT_POLL_FIXED_FDS; rtn > 0 && i < fds.size(); i++) {
+            if (fds[i].revents & (POLLPRI | POLLERR))
+                SysfsCache::getInstance().handlePoll(fds[i].fd);
+        }
+
         pthread_mutex_unlock(&pThis->hw_event_mutex);
     }
     return NULL;
 }
 
 int32_t HwDisplayEventListener::handle(drm_display_event event, int val) {
+    if (event == DRM_EVENT_HDMITX_HOTPLUG && mDebounceMs > 0) {
+        std::unique_lock<std::mutex> lock(mHotplugMutex);
+        mHotplugEvents++;
+        if (mHotplugPending)
+            mHotplugSuppressed++;
+        mHotplugPending = true;
+        mHotplugVal = val;
+
+        if (!mDebounceThread) {
+            mDebounceThread = std::make_shared<EventThread>(
+                "hwc-hotplug", REACTOR_CLIENT_UEVENT);
+            mDebounceThread->setHandler(this);
+            mDebounceThread->start();
+        }
+        /*restart the window, a queued event is only moved earlier.*/
+        mDebounceThread->removeEvent(HOTPLUG_DEBOUNCE_EVENT);
+        mDebounceThread->sendEventDelayed(HOTPLUG_DEBOUNCE_EVENT, mDebounceMs);
+        return 0;
+    }
+
+    if (event == DRM_EVENT_HDMITX_HOTPLUG) {
+        std::lock_guard<std::mutex> lock(mHotplugMutex);
+        mHotplugEvents++;
+    }
+
+    /*mode change follows hotplug, keep that order.*/
+    flushHotplug();
+    dispatch(event, val);
+    return 0;
+}
+
+void HwDisplayEventListener::handleEvent(int what) {
+    if (what == HOTPLUG_DEBOUNCE_EVENT)
+        flushHotplug();
+}
+
+void HwDisplayEventListener::flushHotplug() {
+    std::unique_lock<std::mutex> lock(mHotplugMutex);
+    if (!mHotplugPending)
+        return;
+    mHotplugPending = false;
+    int val = mHotplugVal;
+    lock.unlock();
+
+    MESON_LOGD("deliver debounced hotplug %d.", val);
+    dispatch(DRM_EVENT_HDMITX_HOTPLUG, val);
+}
+
+void HwDisplayEventListener::dispatch(drm_display_event event, int val) {
+    std::lock_guard<std::mutex> lock(mDispatchMutex);
+    nsecs_t start = systemTime(CLOCK_MONOTONIC);
+
+    /*handlers read the nodes again, drop old values first.*/
+    SysfsCache::getInstance().handleEvent(event);
+
     std::multimap<drm_display_event, HwDisplayEventHandler *>::iterator it;
     for (it = mEventHandler.begin(); it != mEventHandler.end(); it++) {
         if (it->first == event || it->first == DRM_EVENT_ALL)
             it->second->handleEvent(event, val);
     }
 
-    return 0;
+    if (event == DRM_EVENT_HDMITX_HOTPLUG) {
+        nsecs_t cost = systemTime(CLOCK_MONOTONIC) - start;
+        std::lock_guard<std::mutex> statLock(mHotplugMutex);
+        mHotplugHandled++;
+        mHotplugTime += cost;
+        if (cost > mHotplugMaxTime)
+            mHotplugMaxTime = cost;
+    }
+}
+
+void HwDisplayEventListener::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mHotplugMutex);
+    dumpstr.appendFormat("Hotplug: debounce %u ms, %" PRIu64 " events, %" PRIu64
+        " suppressed, %" PRIu64 " handled, avg %.2f ms, max %.2f ms\n",
+        mDebounceMs, mHotplugEvents, mHotplugSuppressed, mHotplugHandled,
+        mHotplugHandled ? mHotplugTime / 1e6 / mHotplugHandled : 0.0,
+        mHotplugMaxTime / 1e6);
+    dumpstr.appendFormat("Uevent: %" PRIu64 " received, %" PRIu64 " display events\n",
+        (uint64_t)mUevents, (uint64_t)mUeventsMatched);
 }
 
 int32_t HwDisplayEventListener::registerHandler(
@@ -195,7 +352,10 @@ int32_t HwDisplayEventListener::registerHandler(
         case DRM_EVENT_VOUT1_MODE_CHANGED:
         case DRM_EVENT_VOUT2_MODE_CHANGED:
         case DRM_EVENT_ALL:
-            mEventHandler.insert(std::make_pair(event, handler));
+            {
+                std::lock_guard<std::mutex> lock(mDispatchMutex);
+                mEventHandler.insert(std::make_pair(event, handler));
+            }
             createThread();
             return 0;
         default:
@@ -6,7 +6,9 @@
  *
  * Description:
  */
+#include <errno.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 
 #include <HwDisplayPlane.h>
 
@@ -20,3 +22,12 @@ HwDisplayPlane::~HwDisplayPlane() {
     close(mDrvFd);
 }
 
+int32_t HwDisplayPlane::postRequest(unsigned long cmd, void * arg) {
+    if (mCommit.get())
+        return mCommit->addPlaneRequest(this, mDrvFd, cmd, arg);
+
+    int32_t ret = ::ioctl(mDrvFd, cmd, arg) != 0 ? -errno : 0;
+    onCommitted(arg, ret);
+    return ret;
+}
+
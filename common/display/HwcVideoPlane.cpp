@@ -8,6 +8,8 @@
  */
 
 #include <MesonLog.h>
+#include <FrameTimeline.h>
+#include <FenceWatcher.h>
 #include "HwcVideoPlane.h"
 #include "AmFramebuffer.h"
 
@@ -51,6 +53,7 @@ bool HwcVideoPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
 int32_t HwcVideoPlane::setPlane(
     std::shared_ptr<DrmFramebuffer> fb __unused,
     uint32_t zorder __unused, int blankOp __unused) {
+    FRAME_TIMELINE_PLANE_STAGE(FRAME_STAGE_SET_PLANE, mId);
     if (mDrvFd < 0) {
         MESON_LOGE("hwcvideo plane fd is not valiable!");
         return -EBADF;
@@ -74,21 +77,22 @@ int32_t HwcVideoPlane::setPlane(
     mPlaneInfo.dst_h         = disFrame.bottom  - disFrame.top;
 
     if (DebugHelper::getInstance().discardInFence()) {
-        fb->getAcquireFence()->waitForever("osd-input");
+        FenceWatcher::getInstance().waitForever(fb->getAcquireFence()->dup(),
+            FenceWatcher::makeTag(FENCE_WATCH_ACQUIRE, mId));
         mPlaneInfo.in_fen_fd = -1;
     } else {
         mPlaneInfo.in_fen_fd     = fb->getAcquireFence()->dup();
     }
-    mPlaneInfo.format        = am_gralloc_get_format(buf);
+    mPlaneInfo.format        = fb->mBufferInfo.format;
     mPlaneInfo.shared_fd     = am_gralloc_get_buffer_fd(buf);
-    mPlaneInfo.byte_stride   = am_gralloc_get_stride_in_byte(buf);
-    mPlaneInfo.pixel_stride  = am_gralloc_get_stride_in_pixel(buf);
+    mPlaneInfo.byte_stride   = fb->mBufferInfo.byteStride;
+    mPlaneInfo.pixel_stride  = fb->mBufferInfo.pixelStride;
     /* osd request plane zorder > 0 */
     mPlaneInfo.zorder        = fb->mZorder + 1;
     mPlaneInfo.blend_mode    = fb->mBlendMode;
     mPlaneInfo.plane_alpha   = fb->mPlaneAlpha;
     mPlaneInfo.op            &= ~(OSD_BLANK_OP_BIT);
-    mPlaneInfo.afbc_inter_format = am_gralloc_get_vpu_afbc_mask(buf);
+    mPlaneInfo.afbc_inter_format = fb->mBufferInfo.afbcMask;
 
     if (ioctl(mDrvFd, FBIOPUT_OSD_SYNC_RENDER_ADD, &mPlaneInfo) != 0) {
         MESON_LOGE("osd plane FBIOPUT_OSD_SYNC_RENDER_ADD return(%d)", errno);
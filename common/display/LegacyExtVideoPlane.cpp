@@ -11,8 +11,10 @@
 #include "AmFramebuffer.h"
 
 #include <misc.h>
+#include <SysfsWriter.h>
 #include <OmxUtil.h>
 #include <MesonLog.h>
+#include <FrameTimeline.h>
 
 #include <sys/ioctl.h>
 #include <math.h>
@@ -84,6 +86,7 @@ bool LegacyExtVideoPlane::shouldUpdateAxis(
 int32_t LegacyExtVideoPlane::setPlane(
     std::shared_ptr<DrmFramebuffer> fb,
     uint32_t zorder, int blankOp) {
+    FRAME_TIMELINE_PLANE_STAGE(FRAME_STAGE_SET_PLANE, mId);
     if (fb) {
         /*this is added to slove this situation:
          *when source has the signal, then playing video in MoivePlayer.
@@ -117,7 +120,8 @@ int32_t LegacyExtVideoPlane::setPlane(
             drm_rect_t * videoAxis = &(fb->mDisplayFrame);
             sprintf(videoAxisStr, "%d %d %d %d", videoAxis->left, videoAxis->top,
                 videoAxis->right - 1, videoAxis->bottom - 1);
-            sysfs_set_string(SYSFS_VIDEO_AXIS_PIP, videoAxisStr);
+            /*player writes it too, compare with the node.*/
+            SysfsWriter::getInstance().write(SYSFS_VIDEO_AXIS_PIP, videoAxisStr, true);
         }
 
         /*set omx pts.*/
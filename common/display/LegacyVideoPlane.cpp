@@ -11,8 +11,10 @@
 #include "AmFramebuffer.h"
 
 #include <misc.h>
+#include <SysfsWriter.h>
 #include <OmxUtil.h>
 #include <MesonLog.h>
+#include <FrameTimeline.h>
 
 #include <sys/ioctl.h>
 #include <math.h>
@@ -92,6 +94,7 @@ bool LegacyVideoPlane::shouldUpdateAxis(
 int32_t LegacyVideoPlane::setPlane(
     std::shared_ptr<DrmFramebuffer> fb,
     uint32_t zorder, int blankOp) {
+    FRAME_TIMELINE_PLANE_STAGE(FRAME_STAGE_SET_PLANE, mId);
     if (fb) {
         /*this is added to slove this situation:
          *when source has the signal, then playing video in MoivePlayer.
@@ -126,7 +129,8 @@ int32_t LegacyVideoPlane::setPlane(
             drm_rect_t * videoAxis = &(fb->mDisplayFrame);
             sprintf(videoValStr, "%d %d %d %d", videoAxis->left, videoAxis->top,
                 videoAxis->right - 1, videoAxis->bottom - 1);
-            sysfs_set_string(SYSFS_VIDEO_AXIS, videoValStr);
+            /*player and systemcontrol write these too, compare with the node.*/
+            SysfsWriter::getInstance().write(SYSFS_VIDEO_AXIS, videoValStr, true);
 
             int rotation = 0;
             switch (mLegacyVideoFb->mTransform) {
@@ -148,7 +152,7 @@ int32_t LegacyVideoPlane::setPlane(
             };
             rotation = (rotation / 90) & 3;
             sprintf(videoValStr, "%d", rotation);
-            sysfs_set_string(SYSFS_PPMGR_ANGLE, videoValStr);
+            SysfsWriter::getInstance().write(SYSFS_PPMGR_ANGLE, videoValStr, true);
         }
 
         /*set omx pts.*/
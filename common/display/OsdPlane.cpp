@@ -10,14 +10,21 @@
 #include "OsdPlane.h"
 #include <MesonLog.h>
 #include <DebugHelper.h>
+#include <FrameTimeline.h>
+#include <FenceWatcher.h>
 
 OsdPlane::OsdPlane(int32_t drvFd, uint32_t id)
     : HwDisplayPlane(drvFd, id),
       mBlank(false),
+      mUpdated(true),
+      mQueued(false),
+      mRepost(false),
       mPossibleCrtcs(0),
       mDrmFb(NULL) {
     snprintf(mName, 64, "OSD-%d", id);
+    memset(&mPlaneInfo, 0, sizeof(mPlaneInfo));
     mPlaneInfo.out_fen_fd = -1;
+    mSkipClean = sys_get_bool_prop("vendor.hwc.osd-skip-clean", true);
     getProperties();
 }
 
@@ -95,7 +102,7 @@ bool OsdPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
     //if cursor fb, check if buffer is cont
     switch (fb->mFbType) {
         case DRM_FB_CURSOR:
-            if (!am_gralloc_is_coherent_buffer(fb->mBufferHandle))
+            if (!fb->mBufferInfo.coherent)
                 return false;
         case DRM_FB_SCANOUT:
             break;
@@ -113,8 +120,8 @@ bool OsdPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
         return false;
     }
 
-    int format = am_gralloc_get_format(fb->mBufferHandle);
-    int afbc = am_gralloc_get_vpu_afbc_mask(fb->mBufferHandle);
+    int format = fb->mBufferInfo.format;
+    int afbc = fb->mBufferInfo.afbcMask;
 
     if (blendMode == DRM_BLEND_MODE_NONE && format == HAL_PIXEL_FORMAT_BGRA_8888) {
         MESON_LOGE("blend mode: %u, Layer format %d not support.", blendMode, format);
@@ -157,10 +164,32 @@ bool OsdPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
     return true;
 }
 
+bool OsdPlane::isPlaneInfoChanged(const osd_plane_info_t & lastInfo) {
+    /*fds are dup for each post, compare without them.*/
+    osd_plane_info_t curInfo = mPlaneInfo, prevInfo = lastInfo;
+    curInfo.shared_fd = curInfo.in_fen_fd = curInfo.out_fen_fd = -1;
+    prevInfo.shared_fd = prevInfo.in_fen_fd = prevInfo.out_fen_fd = -1;
+    return memcmp(&curInfo, &prevInfo, sizeof(curInfo)) != 0;
+}
+
+bool OsdPlane::checkUpdated() {
+    bool updated = mUpdated;
+    mUpdated = false;
+    return updated;
+}
+
 int32_t OsdPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder, int blankOp) {
+    FRAME_TIMELINE_PLANE_STAGE(FRAME_STAGE_SET_PLANE, mId);
     MESON_ASSERT(mDrvFd >= 0, "osd plane fd is not valiable!");
     MESON_ASSERT(zorder > 0, "osd driver request zorder > 0");// driver request zorder > 0
 
+    /*set again before the flip, the new request replaces the queued one.*/
+    if (mQueued) {
+        releaseRequest();
+        mRepost = true;
+    }
+
+    osd_plane_info_t lastInfo = mPlaneInfo;
     memset(&mPlaneInfo, 0, sizeof(mPlaneInfo));
     mPlaneInfo.magic         = OSD_SYNC_REQUEST_RENDER_MAGIC_V2;
     mPlaneInfo.len           = sizeof(osd_plane_info_t);
@@ -193,8 +222,8 @@ int32_t OsdPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder,
         mPlaneInfo.op           |= OSD_BLANK_OP_BIT;
 
         if (fb->mBufferHandle != NULL) {
-            mPlaneInfo.fb_width  = am_gralloc_get_width(fb->mBufferHandle);
-            mPlaneInfo.fb_height = am_gralloc_get_height(fb->mBufferHandle);
+            mPlaneInfo.fb_width  = fb->mBufferInfo.width;
+            mPlaneInfo.fb_height = fb->mBufferInfo.height;
         } else {
             mPlaneInfo.fb_width  = -1;
             mPlaneInfo.fb_height = -1;
@@ -219,11 +248,11 @@ int32_t OsdPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder,
             mPlaneInfo.dim_layer = 0;
             mPlaneInfo.dim_color = 0;
 
-            mPlaneInfo.shared_fd     = ::dup(am_gralloc_get_buffer_fd(buf));
-            mPlaneInfo.format        = am_gralloc_get_format(buf);
-            mPlaneInfo.byte_stride   = am_gralloc_get_stride_in_byte(buf);
-            mPlaneInfo.pixel_stride  = am_gralloc_get_stride_in_pixel(buf);
-            mPlaneInfo.afbc_inter_format = am_gralloc_get_vpu_afbc_mask(buf);
+            mPlaneInfo.shared_fd     = am_gralloc_get_buffer_fd(buf);
+            mPlaneInfo.format        = fb->mBufferInfo.format;
+            mPlaneInfo.byte_stride   = fb->mBufferInfo.byteStride;
+            mPlaneInfo.pixel_stride  = fb->mBufferInfo.pixelStride;
+            mPlaneInfo.afbc_inter_format = fb->mBufferInfo.afbcMask;
             mPlaneInfo.plane_alpha   = (unsigned char)255 * fb->mPlaneAlpha; //kenrel need alpha 0 ~ 255
 
             /*
@@ -236,8 +265,20 @@ int32_t OsdPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder,
             }
         }
 
+        /*same buffer without new content or geometry, driver still scans it out.*/
+        if (mSkipClean && !mRepost && !mBlank && fb == mDrmFb && !fb->mContentUpdated
+            && !isPlaneInfoChanged(lastInfo)) {
+            mPlaneInfo = lastInfo;
+            return 0;
+        }
+
+        /*driver takes the fd, only dup for a posted frame.*/
+        if (mPlaneInfo.shared_fd >= 0)
+            mPlaneInfo.shared_fd = ::dup(mPlaneInfo.shared_fd);
+
         if (DebugHelper::getInstance().discardInFence()) {
-            fb->getAcquireFence()->waitForever("osd-input");
+            FenceWatcher::getInstance().waitForever(fb->getAcquireFence()->dup(),
+                FenceWatcher::makeTag(FENCE_WATCH_ACQUIRE, mId));
             mPlaneInfo.in_fen_fd = -1;
         } else {
             mPlaneInfo.in_fen_fd     = fb->getAcquireFence()->dup();
@@ -246,16 +287,49 @@ int32_t OsdPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder,
         /*For nothing to display, post blank to osd which will signal the last retire fence.*/
 
         //Already set blank, return.
-        if (mBlank == bBlank)
+        if (mBlank == bBlank && !mRepost)
             return 0;
 
         mPlaneInfo.op &= ~(OSD_BLANK_OP_BIT);
     }
     mBlank = bBlank;
+    mUpdated = true;
+
+    /*posted with the page flip of the crtc.*/
+    if (bBlank)
+        mPendingFb.reset();
+    else
+        mPendingFb = fb;
+    mQueued = true;
+    mRepost = false;
+    return postRequest(FBIOPUT_OSD_SYNC_RENDER_ADD, &mPlaneInfo);
+}
+
+void OsdPlane::releaseRequest() {
+    if (mPlaneInfo.shared_fd >= 0) {
+        close(mPlaneInfo.shared_fd);
+        mPlaneInfo.shared_fd = -1;
+    }
+    if (mPlaneInfo.in_fen_fd >= 0) {
+        close(mPlaneInfo.in_fen_fd);
+        mPlaneInfo.in_fen_fd = -1;
+    }
+    mPendingFb.reset();
+    mQueued = false;
+}
+
+void OsdPlane::onAborted(void * arg __unused) {
+    releaseRequest();
+    mRepost = true;
+}
 
-    if (ioctl(mDrvFd, FBIOPUT_OSD_SYNC_RENDER_ADD, &mPlaneInfo) != 0) {
-        MESON_LOGE("osd plane FBIOPUT_OSD_SYNC_RENDER_ADD return(%d)", errno);
-        return -EINVAL;
+void OsdPlane::onCommitted(void * arg __unused, int32_t result) {
+    std::shared_ptr<DrmFramebuffer> fb = mPendingFb;
+    mPendingFb.reset();
+    mQueued = false;
+    if (result != 0) {
+        MESON_LOGE("osd plane FBIOPUT_OSD_SYNC_RENDER_ADD return(%d)", result);
+        return;
     }
 
     if (mDrmFb.get()) {
@@ -266,15 +340,14 @@ int32_t OsdPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder,
             mDrmFb->setReleaseFence(-1);
         } else {
             mDrmFb->setReleaseFence((mPlaneInfo.out_fen_fd >= 0) ? ::dup(mPlaneInfo.out_fen_fd) : -1);
+            if (mPlaneInfo.out_fen_fd >= 0)
+                FenceWatcher::getInstance().watch(::dup(mPlaneInfo.out_fen_fd),
+                    FenceWatcher::makeTag(FENCE_WATCH_RELEASE, mId));
         }
     }
 
     // update drm fb.
-    if (bBlank)
-        mDrmFb.reset();
-    else
-        mDrmFb = fb;
-    return 0;
+    mDrmFb = fb;
 }
 
 void OsdPlane::dump(String8 & dumpstr) {
@@ -28,17 +28,29 @@ public:
     bool isFbSupport(std::shared_ptr<DrmFramebuffer> & fb);
 
     int32_t setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder, int blankOp);
+    void onCommitted(void * arg, int32_t result);
+    void onAborted(void * arg);
+    bool checkUpdated();
 
     void dump(String8 & dumpstr);
 
 protected:
     int32_t getProperties();
+    bool isPlaneInfoChanged(const osd_plane_info_t & lastInfo);
+    /*close fds of the queued request, the driver never got them.*/
+    void releaseRequest();
 
 private:
     bool mBlank;
+    bool mSkipClean;
+    bool mUpdated;
+    bool mQueued;       /*request waits for page flip.*/
+    bool mRepost;       /*last request was dropped, post next state anyway.*/
     uint32_t mPossibleCrtcs;
     osd_plane_info_t mPlaneInfo;
     std::shared_ptr<DrmFramebuffer> mDrmFb;
+    /*fb of the request waiting for page flip.*/
+    std::shared_ptr<DrmFramebuffer> mPendingFb;
 
     char mName[64];
 };
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <MesonLog.h>
+#include <SysfsCache.h>
+#include <systemcontrol.h>
+
+ANDROID_SINGLETON_STATIC_INSTANCE(SysfsCache)
+
+#define SYSFS_CACHE_VALUE_MAX (512)
+
+SysfsCache::SysfsCache() {
+    mCachedReads = mLoads = mEventInvalidates = mNotifies = 0;
+}
+
+SysfsCache::~SysfsCache() {
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->fd >= 0)
+            close(it->fd);
+    }
+    mEntries.clear();
+}
+
+SysfsCache::Entry * SysfsCache::getEntry(const char * path,
+    uint32_t eventMask, bool bySystemControl) {
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->path == path)
+            return &(*it);
+    }
+
+    Entry entry;
+    entry.path = path;
+    entry.eventMask = eventMask;
+    entry.bySystemControl = bySystemControl;
+    entry.fd = -1;
+    entry.pollable = false;
+    entry.valid = false;
+    entry.ret = 0;
+    mEntries.push_back(entry);
+    return &mEntries.back();
+}
+
+/*return true if the node starts waiting for notify.*/
+bool SysfsCache::load(Entry & entry) {
+    mLoads++;
+    entry.valid = false;
+    if (entry.bySystemControl) {
+        entry.ret = sc_read_sysfs(entry.path.c_str(), entry.value);
+        entry.valid = entry.ret == 0;
+        return false;
+    }
+
+    bool opened = false;
+    if (entry.fd < 0) {
+        entry.fd = open(entry.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (entry.fd < 0) {
+            entry.ret = -errno;
+            MESON_LOGE("open %s failed (%d)", entry.path.c_str(), entry.ret);
+            return false;
+        }
+        opened = true;
+    }
+
+    /*reading the node from start also arms it for next notify.*/
+    char buf[SYSFS_CACHE_VALUE_MAX];
+    ssize_t len = pread(entry.fd, buf, sizeof(buf) - 1, 0);
+    if (len < 0) {
+        entry.ret = -errno;
+        MESON_LOGE("read %s failed (%d)", entry.path.c_str(), entry.ret);
+        close(entry.fd);
+        entry.fd = -1;
+        entry.pollable = false;
+        return false;
+    }
+
+    /*same as sysfs_get_string: '\0' to space and '\n' removed.*/
+    int32_t j = 0;
+    for (int32_t i = 0; i < len; i++) {
+        if (buf[i] == 0 && i < len - 1)
+            buf[i] = ' ';
+        if (buf[i] != '\n')
+            buf[j++] = buf[i];
+    }
+    buf[j] = 0;
+
+    entry.value = buf;
+    entry.ret = 0;
+    entry.valid = true;
+    if (opened)
+        entry.pollable = true;
+    return opened;
+}
+
+int32_t SysfsCache::read(const char * path, std::string & val,
+    uint32_t eventMask, bool bySystemControl) {
+    std::function<void()> listener;
+    int32_t ret;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Entry * entry = getEntry(path, eventMask, bySystemControl);
+        if (entry->valid) {
+            mCachedReads++;
+        } else if (load(*entry)) {
+            listener = mPollListener;
+        }
+        val = entry->value;
+        ret = entry->ret;
+    }
+
+    if (listener)
+        listener();
+    return ret;
+}
+
+int32_t SysfsCache::getInt(const char * path, int32_t defVal, uint32_t eventMask) {
+    std::string val;
+    if (read(path, val, eventMask) != 0 || val.empty())
+        return defVal;
+    return atoi(val.c_str());
+}
+
+void SysfsCache::invalidate(const char * path) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->path == path)
+            it->valid = false;
+    }
+}
+
+void SysfsCache::handleEvent(drm_display_event event) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (event == DRM_EVENT_ALL || (it->eventMask & SYSFS_EVENT_MASK(event))) {
+            it->valid = false;
+            mEventInvalidates++;
+        }
+    }
+}
+
+void SysfsCache::getPollFds(std::vector<struct pollfd> & fds) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->pollable && it->fd >= 0) {
+            struct pollfd pfd;
+            pfd.fd = it->fd;
+            pfd.events = POLLPRI;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+    }
+}
+
+void SysfsCache::handlePoll(int32_t fd) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->fd == fd) {
+            mNotifies++;
+            load(*it);
+            /*node not readable any more, stop polling it.*/
+            if (it->ret != 0)
+                it->pollable = false;
+            return;
+        }
+    }
+}
+
+void SysfsCache::setPollListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPollListener = listener;
+}
+
+void SysfsCache::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    dumpstr.appendFormat("Sysfs cache: %" PRIu64 " reads from memory, %" PRIu64
+        " loads, %" PRIu64 " invalidated by uevent, %" PRIu64 " notifies\n",
+        mCachedReads, mLoads, mEventInvalidates, mNotifies);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        dumpstr.appendFormat("    %s: %s%s%s\n", it->path.c_str(),
+            it->valid ? it->value.c_str() : "(invalid)",
+            it->bySystemControl ? " [systemcontrol]" : "",
+            it->pollable ? " [notify]" : "");
+    }
+}
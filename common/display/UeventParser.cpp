@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <string.h>
+#include <sys/socket.h>
+#include <MesonLog.h>
+
+#include "UeventParser.h"
+
+/*bpf jump offsets are 8 bits.*/
+#define FILTER_MAX_JUMP (255)
+
+typedef struct drm_uevent_info {
+    const char * head;
+    drm_display_event eventType;
+    const char * stateEnable;
+    const char * stateDisable;
+}drm_uevent_info_t;
+
+static drm_uevent_info_t mUeventParser[] = {
+    {HDMITX_HOTPLUG_EVENT, DRM_EVENT_HDMITX_HOTPLUG,
+        HDMI_EVENT_STATE_ENABLE, HDMI_EVENT_STATE_DISABLE},
+    {HDMITX_HDCP_EVENT, DRM_EVENT_HDMITX_HDCP,
+        HDMI_EVENT_STATE_ENABLE, HDMI_EVENT_STATE_DISABLE},
+    {VOUT_MODE_EVENT, DRM_EVENT_VOUT1_MODE_CHANGED,
+        VOUT_EVENT_MODESWITCH_COMPLETE, VOUT_EVENT_MODESWITCH_BEGIN},
+    {VOUT2_MODE_EVENT, DRM_EVENT_VOUT2_MODE_CHANGED,
+        VOUT_EVENT_MODESWITCH_COMPLETE, VOUT_EVENT_MODESWITCH_BEGIN}
+};
+
+UeventParser::UeventParser() {
+    for (drm_uevent_info_t uevent : mUeventParser) {
+        mMatchers.push_back({uevent.head, strlen(uevent.head), uevent.eventType,
+            uevent.stateEnable, strlen(uevent.stateEnable),
+            uevent.stateDisable, strlen(uevent.stateDisable)});
+    }
+    compileFilter();
+}
+
+UeventParser::~UeventParser() {
+}
+
+/*
+ * kernel uevents come without netlink header, the message starts with
+ * "action@devpath\0". Each matcher compares its head and the terminating
+ * nul in words, first full match accepts the packet, else drop it.
+ * Loads past the packet end drop it too.
+ */
+void UeventParser::compileFilter() {
+    mFilter.clear();
+    for (auto it = mMatchers.begin(); it != mMatchers.end(); ++it) {
+        const uint8_t * head = (const uint8_t *)it->head;
+        size_t len = it->headLen + 1;
+        size_t start = mFilter.size();
+        std::vector<size_t> fails;
+
+        for (size_t off = 0; off < len;) {
+            size_t size = len - off >= 4 ? 4 : (len - off >= 2 ? 2 : 1);
+            uint32_t word = 0;
+            for (size_t i = 0; i < size; i++)
+                word = (word << 8) | head[off + i];
+
+            uint16_t width = size == 4 ? BPF_W : (size == 2 ? BPF_H : BPF_B);
+            mFilter.push_back(BPF_STMT(BPF_LD | width | BPF_ABS, (uint32_t)off));
+            fails.push_back(mFilter.size());
+            mFilter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, word, 0, 0));
+            off += size;
+        }
+        mFilter.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffffffff));
+
+        /*mismatch goes to next matcher, or to the final drop.*/
+        size_t next = mFilter.size();
+        MESON_ASSERT(next - start <= FILTER_MAX_JUMP, "uevent head too long to filter.");
+        for (auto fail = fails.begin(); fail != fails.end(); ++fail)
+            mFilter[*fail].jf = next - *fail - 1;
+    }
+    mFilter.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+}
+
+int32_t UeventParser::attachFilter(int sock) {
+    struct sock_fprog prog;
+    prog.len = mFilter.size();
+    prog.filter = mFilter.data();
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != 0) {
+        MESON_LOGE("attach uevent filter failed (%d)", errno);
+        return -errno;
+    }
+    return 0;
+}
+
+int32_t UeventParser::parse(const char * msg, size_t len,
+    drm_display_event & event, int & val) {
+    const Matcher * matcher = NULL;
+    for (auto it = mMatchers.begin(); it != mMatchers.end(); ++it) {
+        if (len > it->headLen && msg[it->headLen] == '\0' &&
+            memcmp(msg, it->head, it->headLen) == 0) {
+            matcher = &(*it);
+            break;
+        }
+    }
+    if (!matcher)
+        return -ENOENT;
+
+    /*fields are "KEY=value\0", the last one may miss its nul.*/
+    const char * end = msg + len;
+    const char * field = msg + matcher->headLen + 1;
+    while (field < end) {
+        const char * next = (const char *)memchr(field, '\0', end - field);
+        size_t fieldLen = next ? next - field : end - field;
+
+        if (fieldLen >= matcher->enableLen &&
+            memcmp(field, matcher->stateEnable, matcher->enableLen) == 0) {
+            event = matcher->event;
+            val = 1;
+            return 0;
+        }
+        if (fieldLen >= matcher->disableLen &&
+            memcmp(field, matcher->stateDisable, matcher->disableLen) == 0) {
+            event = matcher->event;
+            val = 0;
+            return 0;
+        }
+        field += fieldLen + 1;
+    }
+    return -ENOENT;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Driver requests of one frame, queued by planes and posted with
+ *     the page flip of the crtc.
+ */
+
+#ifndef HW_DISPLAY_COMMIT_H
+#define HW_DISPLAY_COMMIT_H
+
+#include <vector>
+
+#include <BasicTypes.h>
+
+class HwDisplayPlane;
+class HwDisplayCommit;
+
+typedef struct hw_commit_request {
+    HwDisplayPlane * plane;     /*NULL for the page flip.*/
+    int32_t fd;
+    unsigned long cmd;
+    void * arg;                 /*owned by the plane or crtc, written back by driver.*/
+    int32_t result;
+} hw_commit_request_t;
+
+/*driver calls of display planes and crtc, replaced in tests.*/
+class HwDisplayBackend {
+public:
+    virtual ~HwDisplayBackend() { }
+
+    /*0 or -errno.*/
+    virtual int32_t ioctl(int32_t fd, unsigned long cmd, void * arg) = 0;
+
+    /*
+     * post all requests of a frame in one call and fill their results.
+     * -EOPNOTSUPP falls back to one ioctl per request.
+     */
+    virtual int32_t commit(HwDisplayCommit & commit __unused) { return -EOPNOTSUPP; }
+};
+
+/*amlogic fb driver, one ioctl per plane and the flip.*/
+class FbDisplayBackend : public HwDisplayBackend {
+public:
+    int32_t ioctl(int32_t fd, unsigned long cmd, void * arg);
+};
+
+/*
+ * Used by the thread posting the frame: composition on present or the
+ * commit thread.
+ */
+class HwDisplayCommit {
+public:
+    HwDisplayCommit(std::shared_ptr<HwDisplayBackend> backend);
+    ~HwDisplayCommit();
+
+    void setBackend(std::shared_ptr<HwDisplayBackend> backend) { mBackend = backend; }
+    std::shared_ptr<HwDisplayBackend> & getBackend() { return mBackend; }
+
+    int32_t addPlaneRequest(HwDisplayPlane * plane, int32_t fd, unsigned long cmd, void * arg);
+    /*
+     * post queued plane requests then the flip, planes get their results
+     * by onCommitted. Returns result of the flip.
+     */
+    int32_t submit(int32_t fd, unsigned long cmd, void * arg);
+    /*
+     * drop queued plane requests of a frame which is not flipped, planes
+     * release what the requests hold by onAborted.
+     */
+    void abort();
+
+    /*requests in posting order, the flip is the last one.*/
+    std::vector<hw_commit_request_t> & getRequests() { return mRequests; }
+
+    void dump(String8 & dumpstr);
+
+protected:
+    std::shared_ptr<HwDisplayBackend> mBackend;
+    std::vector<hw_commit_request_t> mRequests;
+
+    /*stats.*/
+    uint64_t mFrames;
+    uint64_t mBatchedFrames;
+    uint64_t mPlaneRequests;
+    uint64_t mFailedRequests;
+    uint64_t mAbortedRequests;
+};
+
+#endif/*HW_DISPLAY_COMMIT_H*/
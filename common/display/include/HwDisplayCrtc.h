@@ -14,6 +14,7 @@
 #include <BasicTypes.h>
 #include <HwDisplayConnector.h>
 #include <HwDisplayPlane.h>
+#include <HwDisplayCommit.h>
 
 class HwDisplayPlane;
 
@@ -55,8 +56,15 @@ public:
     * TODO: need pass it in a general way.
     */
     int32_t setOsdChannels(int32_t channels);
+    /*display frame or osd channels changed since last page flip.*/
+    bool isDisplayFrameUpdated() { return mScaleUpdated; }
 
     int32_t pageFlip(int32_t & out_fence);
+    /*frame will not be flipped, drop plane requests queued for it.*/
+    void abortCommit();
+    /*driver backend of page flip and the planes bound.*/
+    void setBackend(std::shared_ptr<HwDisplayBackend> backend);
+    void dump(String8 & dumpstr);
 
     int32_t readCurDisplayMode(std::string & dispmode);
     int32_t writeCurDisplayMode(std::string & dispmode);
@@ -65,6 +73,7 @@ public:
 
 protected:
     void closeLogoDisplay();
+    void releasePlanes();
     bool updateHdrMetadata(std::map<drm_hdr_meatadata_t, float> & hdrmedata);
 
 protected:
@@ -77,10 +86,13 @@ protected:
 
     drm_mode_info_t mCurModeInfo;
     display_zoom_info_t mScaleInfo;
+    bool mScaleUpdated;
 
     std::map<uint32_t, drm_mode_info_t> mModes;
     std::shared_ptr<HwDisplayConnector>  mConnector;
     std::vector<std::shared_ptr<HwDisplayPlane>> mPlanes;
+    /*requests of bound planes, posted by pageFlip.*/
+    std::shared_ptr<HwDisplayCommit> mCommit;
 
     void * hdrVideoInfo;
     bool mBinded;
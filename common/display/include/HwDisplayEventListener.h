@@ -13,8 +13,15 @@
 
 #include <DrmTypes.h>
 #include <BasicTypes.h>
+#include <HwcReactor.h>
+#include <UeventParser.h>
+#include <EventThread.h>
 #include <utils/threads.h>
+#include <utils/String8.h>
 #include <pthread.h>
+#include <poll.h>
+#include <atomic>
+#include <mutex>
 
 
 class HwDisplayEventHandler {
@@ -28,7 +35,9 @@ public:
 };
 
 class HwDisplayEventListener
-    :   public android::Singleton<HwDisplayEventListener> {
+    :   public android::Singleton<HwDisplayEventListener>,
+        public ReactorHandler,
+        public EventHandler {
 
 public:
     HwDisplayEventListener();
@@ -37,25 +46,66 @@ public:
     int32_t registerHandler(
         drm_display_event event, HwDisplayEventHandler * handler);
 
+    /*uevent socket and sysfs nodes on reactor.*/
+    void handleFd(int fd, uint32_t events);
+    /*debounce window of hotplug passed.*/
+    void handleEvent(int what);
+
+    void dump(String8 & dumpstr);
 
 protected:
     std::multimap<drm_display_event, HwDisplayEventHandler* >
         mEventHandler;
 
     char * mUeventMsg;
+    UeventParser mParser;
     int mEventSocket;
     int mCtlInFd;
     int mCtlOutFd;
+    /*wake uevent thread to poll new sysfs cache nodes.*/
+    int mWakeReadFd;
+    int mWakeWriteFd;
+    std::vector<struct pollfd> mPollFds;
+    /*polled by HwcReactor instead of uevent thread.*/
+    bool mReactor;
+    std::vector<int> mReactorFds;
+
+    /*
+     * hotplug bursts collapse to the last state, delivered when no new one
+     * comes in the window. Other events deliver a pending hotplug first.
+     */
+    uint32_t mDebounceMs;      /*0 to deliver at once.*/
+    std::shared_ptr<EventThread> mDebounceThread;
+    std::mutex mHotplugMutex;
+    bool mHotplugPending;
+    int mHotplugVal;
+
+    /*handlers run one at a time, from uevent and debounce callbacks.*/
+    std::mutex mDispatchMutex;
+
+    /*stats.*/
+    uint64_t mHotplugEvents;
+    uint64_t mHotplugSuppressed;
+    uint64_t mHotplugHandled;
+    nsecs_t mHotplugTime;
+    nsecs_t mHotplugMaxTime;
+    /*only uevent callback counts them, dump reads.*/
+    std::atomic<uint64_t> mUevents;
+    std::atomic<uint64_t> mUeventsMatched;
 
 protected:
     static void * ueventThread(void * data);
-    void handleUevent();
+    void handleUevent(size_t len);
 
 private:
     void createThread();
+    void syncReactorFds();
     int32_t handle(drm_display_event event, int val);
+    void flushHotplug();
+    void dispatch(drm_display_event event, int val);
 
     pthread_t hw_event_thread;
+    bool mThreadStarted;
 
     pthread_mutex_t hw_event_mutex;
 };
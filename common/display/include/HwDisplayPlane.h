@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <DrmFramebuffer.h>
 #include <HwDisplayCrtc.h>
+#include <HwDisplayCommit.h>
 
 class HwDisplayPlane {
 public:
@@ -34,12 +35,27 @@ public:
 
     /*For debug, plane return a invalid type.*/
     virtual void setIdle(bool idle) { mIdle = idle;}
+    /*if new state posted to driver since last check, used to skip page flip.*/
+    virtual bool checkUpdated() { return true; }
     virtual void dump(String8 & dumpstr) = 0;
 
     int32_t getDrvFd() {return mDrvFd;}
     uint32_t getPlaneId() {return mId;}
 
+    /*requests go to the frame commit of the bound crtc.*/
+    void setCommit(std::shared_ptr<HwDisplayCommit> commit) { mCommit = commit; }
+    std::shared_ptr<HwDisplayCommit> & getCommit() { return mCommit; }
+    /*result of a request from postRequest, arg is the queued one.*/
+    virtual void onCommitted(void * arg __unused, int32_t result __unused) { }
+    /*request from postRequest dropped without posting, arg is the queued one.*/
+    virtual void onAborted(void * arg __unused) { }
+
+protected:
+    /*queue driver request to the commit, or post it now without crtc.*/
+    int32_t postRequest(unsigned long cmd, void * arg);
+
 protected:
+    std::shared_ptr<HwDisplayCommit> mCommit;
     int32_t mDrvFd;
     uint32_t mId;
     int32_t mCapability;
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Display sysfs nodes read from memory, read again after a uevent or
+ *     sysfs notify says they changed.
+ */
+
+#ifndef SYSFS_CACHE_H
+#define SYSFS_CACHE_H
+
+#include <functional>
+#include <string>
+#include <poll.h>
+
+#include <BasicTypes.h>
+#include <DrmTypes.h>
+
+#define SYSFS_EVENT_MASK(event) (1 << (event))
+
+class SysfsCache : public Singleton<SysfsCache> {
+public:
+    SysfsCache();
+    ~SysfsCache();
+
+    /*
+     * value of node, read again only after an event in eventMask,
+     * a notify of the node or invalidate(). Nodes hwc can not read are
+     * read by systemcontrol, they are never notified.
+     */
+    int32_t read(const char * path, std::string & val, uint32_t eventMask,
+        bool bySystemControl = false);
+    int32_t getInt(const char * path, int32_t defVal, uint32_t eventMask);
+    /*node written by hwc.*/
+    void invalidate(const char * path);
+
+    /*called by uevent listener before its handlers.*/
+    void handleEvent(drm_display_event event);
+
+    /*nodes waiting for sysfs notify, POLLPRI on them is given to handlePoll.*/
+    void getPollFds(std::vector<struct pollfd> & fds);
+    void handlePoll(int32_t fd);
+    /*called when a node is added to poll.*/
+    void setPollListener(std::function<void()> listener);
+
+    void dump(String8 & dumpstr);
+
+protected:
+    struct Entry {
+        std::string path;
+        uint32_t eventMask;
+        bool bySystemControl;
+        int32_t fd;
+        bool pollable;
+        bool valid;
+        int32_t ret;
+        std::string value;
+    };
+
+    /*called with mMutex held.*/
+    Entry * getEntry(const char * path, uint32_t eventMask, bool bySystemControl);
+    bool load(Entry & entry);
+
+protected:
+    std::mutex mMutex;
+    std::vector<Entry> mEntries;
+    std::function<void()> mPollListener;
+
+    /*stats.*/
+    uint64_t mCachedReads;
+    uint64_t mLoads;
+    uint64_t mEventInvalidates;
+    uint64_t mNotifies;
+};
+
+#endif/*SYSFS_CACHE_H*/
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Match display uevents from a matcher table, in place on the
+ *     received buffer. The same table is compiled to a socket filter,
+ *     so the kernel drops all other uevents before they wake us.
+ */
+
+#ifndef UEVENT_PARSER_H
+#define UEVENT_PARSER_H
+
+#include <vector>
+#include <linux/filter.h>
+
+#include <BasicTypes.h>
+#include <DrmTypes.h>
+
+#define HDMITX_HOTPLUG_EVENT \
+    "change@/devices/virtual/amhdmitx/amhdmitx0/hdmi"
+#define HDMITX_HDCP_EVENT \
+    "change@/devices/virtual/amhdmitx/amhdmitx0/hdcp"
+#define VOUT_MODE_EVENT \
+    "change@/devices/platform/vout/extcon/setmode"
+#define VOUT2_MODE_EVENT \
+    "change@/devices/platform/vout2/extcon/setmode2"
+
+/*switch class before P, extcon after.*/
+#if PLATFORM_SDK_VERSION >= 28
+#define HDMI_EVENT_STATE_ENABLE "STATE=HDMI=1"
+#define HDMI_EVENT_STATE_DISABLE "STATE=HDMI=0"
+#define VOUT_EVENT_MODESWITCH_BEGIN "STATE=ACA=1"
+#define VOUT_EVENT_MODESWITCH_COMPLETE "STATE=ACA=0"
+#else
+#define HDMI_EVENT_STATE_ENABLE "SWITCH_STATE=1"
+#define HDMI_EVENT_STATE_DISABLE "SWITCH_STATE=0"
+#define VOUT_EVENT_MODESWITCH_BEGIN "SWITCH_STATE=0"
+#define VOUT_EVENT_MODESWITCH_COMPLETE "SWITCH_STATE=1"
+#endif
+
+class UeventParser {
+public:
+    UeventParser();
+    ~UeventParser();
+
+    /*attach the compiled filter to a uevent socket, return 0 or -errno.*/
+    int32_t attachFilter(int sock);
+
+    /*
+     * one pass over the msg of len bytes, return 0 and the typed event
+     * if it is a display event with a known state, -ENOENT if not.
+     */
+    int32_t parse(const char * msg, size_t len, drm_display_event & event, int & val);
+
+    const std::vector<struct sock_filter> & getFilter() { return mFilter; }
+
+protected:
+    struct Matcher {
+        const char * head;
+        size_t headLen;
+        drm_display_event event;
+        const char * stateEnable;
+        size_t enableLen;
+        const char * stateDisable;
+        size_t disableLen;
+    };
+
+    void compileFilter();
+
+protected:
+    std::vector<Matcher> mMatchers;
+    std::vector<struct sock_filter> mFilter;
+};
+
+#endif/*UEVENT_PARSER_H*/
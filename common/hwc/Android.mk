@@ -88,6 +88,7 @@ endif
 
 LOCAL_SRC_FILES := \
     HwcVsync.cpp \
+    VsyncModel.cpp \
     HwcConfig.cpp \
     HwcPowerMode.cpp \
     HwcDisplayPipe.cpp \
@@ -12,6 +12,7 @@
 #include <cutils/properties.h>
 #include <systemcontrol.h>
 #include <misc.h>
+#include <CachedProperty.h>
 
 //hdmi only
 #define HWC_PRIMARY_FRAMEBUFFER_WIDTH       1920
@@ -29,12 +30,10 @@
 #define HWC_EXTEND_CONNECTOR_TYPE           "hdmi-only"
 #define HWC_PIPELINE                        "dual"
 
-int32_t HwcConfig::isLcdExist() {
+static CachedProperty sLcdExistProp("sys.lcd.exist");
 
-    char value[PROPERTY_VALUE_MAX];
-    property_get("sys.lcd.exist", value, "0");
-    int32_t exist = atoi(value);
-    return exist;
+int32_t HwcConfig::isLcdExist() {
+    return sLcdExistProp.getInt(0);
 }
 
 int32_t HwcConfig::getFramebufferSize(int disp, uint32_t & width, uint32_t & height) {
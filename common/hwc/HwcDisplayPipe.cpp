@@ -7,6 +7,9 @@
  * Description:
  */
 
+#include <algorithm>
+#include <inttypes.h>
+
 #include "HwcDisplayPipe.h"
 #include "FixedDisplayPipe.h"
 #include "LoopbackDisplayPipe.h"
@@ -25,6 +28,7 @@ HwcDisplayPipe::PipeStat::PipeStat(uint32_t id) {
     cfg.hwcCrtcId = cfg.modeCrtcId = 0;
     cfg.hwcConnectorType = cfg.modeConnectorType = DRM_MODE_CONNECTOR_INVALID;
     cfg.hwcPostprocessorType = INVALID_POST_PROCESSOR;
+    hotplugConnector = NULL;
 }
 
 HwcDisplayPipe::PipeStat::~PipeStat() {
@@ -37,9 +41,28 @@ HwcDisplayPipe::PipeStat::~PipeStat() {
     modeMgr.reset();
     modeCrtc.reset();
     modeConnector.reset();
+    hotplugModes.clear();
+}
+
+static bool modeLess(const drm_mode_info_t & a, const drm_mode_info_t & b) {
+    int ret = strncmp(a.name, b.name, DRM_DISPLAY_MODE_LEN);
+    if (ret != 0)
+        return ret < 0;
+    if (a.refreshRate != b.refreshRate)
+        return a.refreshRate < b.refreshRate;
+    if (a.pixelW != b.pixelW)
+        return a.pixelW < b.pixelW;
+    return a.pixelH < b.pixelH;
+}
+
+static bool modeEqual(const drm_mode_info_t & a, const drm_mode_info_t & b) {
+    return strncmp(a.name, b.name, DRM_DISPLAY_MODE_LEN) == 0 &&
+        a.refreshRate == b.refreshRate && a.pixelW == b.pixelW &&
+        a.pixelH == b.pixelH && a.dpiX == b.dpiX && a.dpiY == b.dpiY;
 }
 
 HwcDisplayPipe::HwcDisplayPipe() {
+    mHotplugNotified = mHotplugUnchanged = 0;
     /*load display resources.*/
     HwDisplayManager::getInstance().getCrtcs(mCrtcs);
     HwDisplayManager::getInstance().getPlanes(mPlanes);
@@ -71,6 +94,7 @@ int32_t HwcDisplayPipe::init(std::map<uint32_t, std::shared_ptr<HwcDisplay>> & h
         stat->hwcVsync = std::make_shared<HwcVsync>();
         /*init display pipe.*/
         updatePipe(stat);
+        updateHotplugConfigs(stat, stat->modeConnector->isConnected());
 
         /* in case of composer servce restart */
         if (sys_get_bool_prop(HWC_BOOTED_PROP, false)) {
@@ -305,6 +329,13 @@ void HwcDisplayPipe::handleEvent(drm_display_event event, int val) {
                 for (auto statIt : mPipeStats) {
                     if (statIt.second->modeConnector->getType() == DRM_MODE_CONNECTOR_HDMI) {
                         statIt.second->modeConnector->update();
+                        /*same sink back again, SF has nothing to reload.*/
+                        if (!updateHotplugConfigs(statIt.second, connected)) {
+                            MESON_LOGD("Hotplug %d with same configs, skip.", val);
+                            mHotplugUnchanged++;
+                            continue;
+                        }
+                        mHotplugNotified++;
                         statIt.second->hwcDisplay->onHotplug(connected);
                     }
                 }
@@ -380,6 +411,36 @@ int32_t HwcDisplayPipe::initDisplayMode(std::shared_ptr<PipeStat> & stat) {
     return 0;
 }
 
+bool HwcDisplayPipe::updateHotplugConfigs(
+    std::shared_ptr<PipeStat> & stat, bool connected) {
+    std::vector<drm_mode_info_t> modes;
+    if (connected) {
+        std::map<uint32_t, drm_mode_info_t> connectorModes;
+        stat->modeConnector->getModes(connectorModes);
+        for (auto it = connectorModes.begin(); it != connectorModes.end(); ++it)
+            modes.push_back(it->second);
+        std::sort(modes.begin(), modes.end(), modeLess);
+    }
+
+    bool changed = stat->hotplugConnector != stat->modeConnector.get() ||
+        modes.size() != stat->hotplugModes.size() ||
+        !std::equal(modes.begin(), modes.end(), stat->hotplugModes.begin(), modeEqual);
+    if (changed) {
+        stat->hotplugConnector = stat->modeConnector.get();
+        stat->hotplugModes.swap(modes);
+    }
+    return changed;
+}
+
+void HwcDisplayPipe::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    dumpstr.appendFormat("DisplayPipe: hotplug %" PRIu64 " notified, %" PRIu64
+        " with same configs\n", mHotplugNotified, mHotplugUnchanged);
+    for (auto it = mPipeStats.begin(); it != mPipeStats.end(); ++it)
+        dumpstr.appendFormat("    display %u: %zu configs on hotplug\n",
+            it->first, it->second->hotplugModes.size());
+}
+
 std::shared_ptr<HwcDisplayPipe> createDisplayPipe(hwc_pipe_policy_t pipet) {
     switch (pipet) {
         case HWC_PIPE_DEFAULT:
@@ -7,7 +7,16 @@
  * Description:
  */
 
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
 #include <MesonLog.h>
+#include <HwcReactor.h>
 #include <HwcVsync.h>
 #include <HwDisplayCrtc.h>
 
@@ -21,6 +30,27 @@ HwcVsync::HwcVsync() {
     mExit = false;
     mObserver = NULL;
 
+    mSoftVsyncTime = mSoftVsyncPeriod = 0;
+    mModeChanged = true;
+    mPredicting = false;
+    mPredictedFrames = mResampledFrames = 0;
+    mLastVsync = mDisabledTime = 0;
+    mHwVsyncs = mPredictedVsyncs = mModeResyncs = mDriftResyncs = mResamples = 0;
+    mErrorSum = mMaxError = 0;
+
+    mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (mTimerFd < 0)
+        MESON_LOGE("vsync timerfd create failed (%d), no predicted vsync.", -errno);
+    mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mWakeFd < 0)
+        MESON_LOGE("vsync eventfd create failed (%d).", -errno);
+
+    mSampling = false;
+    mTimerVsync = 0;
+    mReactor = mTimerFd >= 0 && HwcReactor::isEnabled(REACTOR_CLIENT_VSYNC);
+    if (mReactor && HwcReactor::getInstance().addFd(mTimerFd, EPOLLIN, this) != 0)
+        mReactor = false;
+
     int ret;
     ret = pthread_create(&hw_vsync_thread, NULL, vsyncThread, this);
     if (ret) {
@@ -30,11 +60,20 @@ HwcVsync::HwcVsync() {
 }
 
 HwcVsync::~HwcVsync() {
+    if (mReactor)
+        HwcReactor::getInstance().removeFd(mTimerFd);
+
     std::unique_lock<std::mutex> stateLock(mStatLock);
     mExit = true;
     stateLock.unlock();
     mStateCondition.notify_all();
+    wakeThread();
     pthread_join(hw_vsync_thread, NULL);
+
+    if (mTimerFd >= 0)
+        close(mTimerFd);
+    if (mWakeFd >= 0)
+        close(mWakeFd);
 }
 
 int32_t HwcVsync::setObserver(HwcVsyncObserver * observer) {
@@ -46,8 +85,12 @@ int32_t HwcVsync::setSoftwareMode() {
     std::unique_lock<std::mutex> stateLock(mStatLock);
     mSoftVsync = true;
     mCrtc.reset();
+    mModeChanged = true;
+    if (mReactor)
+        scheduleVsync();
     stateLock.unlock();
     mStateCondition.notify_all();
+    wakeThread();
     return 0;
 }
 
@@ -55,40 +98,77 @@ int32_t HwcVsync::setHwMode(std::shared_ptr<HwDisplayCrtc> & crtc) {
     std::unique_lock<std::mutex> stateLock(mStatLock);
     mCrtc = crtc;
     mSoftVsync = false;
+    mModeChanged = true;
+    if (mReactor)
+        scheduleVsync();
     stateLock.unlock();
     mStateCondition.notify_all();
+    wakeThread();
     return 0;
 }
 
 int32_t HwcVsync::setPeriod(nsecs_t period) {
-    if (mSoftVsync)
-        mPeriod = period;
+    std::unique_lock<std::mutex> stateLock(mStatLock);
+    if (period == mPeriod)
+        return 0;
+    mPeriod = period;
+    /*hw timing changes with the mode, build the model again.*/
+    mModeChanged = true;
+    if (mReactor)
+        scheduleVsync();
+    stateLock.unlock();
+    wakeThread();
     return 0;
 }
 
 int32_t HwcVsync::setEnabled(bool enabled) {
     std::unique_lock<std::mutex> stateLock(mStatLock);
+    if (enabled != mEnabled && mPredicting) {
+        nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        /*model may have drifted while disabled long, check it with hw vsync first.*/
+        if (!enabled)
+            mDisabledTime = now;
+        else if (now - mDisabledTime > VSYNC_RESAMPLE_INTERVAL * mModel.getPeriod())
+            mPredictedFrames = VSYNC_RESAMPLE_INTERVAL;
+    }
     mEnabled = enabled;
+    if (mReactor)
+        scheduleVsync();
     stateLock.unlock();
     mStateCondition.notify_all();
+    wakeThread();
     return 0;
 }
 
+void HwcVsync::wakeThread() {
+    if (mWakeFd < 0 || mReactor)
+        return;
+    uint64_t val = 1;
+    if (write(mWakeFd, &val, sizeof(val)) != sizeof(val) && errno != EAGAIN)
+        MESON_LOGE("wake vsync thread failed (%d)", -errno);
+}
+
 void * HwcVsync::vsyncThread(void * data) {
     HwcVsync* pThis = (HwcVsync*)data;
     MESON_LOGV("HwDisplayVsync: vsyncThread start - (%p).", pThis);
     int print_cnt = 10;
 
+    if (pThis->mReactor) {
+        pThis->sampleLoop();
+        pthread_exit(0);
+        return NULL;
+    }
+
     while (true) {
         {
             std::unique_lock<std::mutex> stateLock(pThis->mStatLock);
-            while (!pThis->mEnabled) {
-                pThis->mStateCondition.wait(stateLock);
+            while (!pThis->mEnabled || pThis->mExit) {
                 if (pThis->mExit) {
                     MESON_LOGD("exit vsync loop");
                     pthread_exit(0);
                     return NULL;
                 }
+                pThis->mStateCondition.wait(stateLock);
             }
         }
 
@@ -97,8 +177,12 @@ void * HwcVsync::vsyncThread(void * data) {
         if (pThis->mSoftVsync) {
             ret = pThis->waitSoftwareVsync(timestamp);
         } else {
-            ret = pThis->mCrtc->waitVBlank(timestamp);
+            ret = pThis->waitHwVsync(timestamp);
         }
+        /*woken by a state change, no vsync.*/
+        if (ret == -EAGAIN)
+            continue;
+
         bool debug = true;
         if (debug) {
             nsecs_t period = timestamp - pThis->mPreTimeStamp;
@@ -111,51 +195,306 @@ void * HwcVsync::vsyncThread(void * data) {
             pThis->mPreTimeStamp = timestamp;
         }
 
-        if ( ret == 0 && pThis->mObserver) {
-            pThis->mObserver->onVsync(timestamp);
-        } else {
-            MESON_LOGE("HwcVsync vsync callback fail (%p)-(%d)-(%p)",
-                pThis, ret, pThis->mObserver);
-        }
+        pThis->deliverVsync(ret, timestamp);
     }
     return NULL;
 }
 
-int32_t HwcVsync::waitSoftwareVsync(nsecs_t& vsync_timestamp) {
-    static nsecs_t vsync_time = 0;
-    static nsecs_t old_vsync_period = 0;
+void HwcVsync::deliverVsync(int32_t ret, nsecs_t timestamp) {
+    if ( ret == 0 && mObserver) {
+        mObserver->onVsync(timestamp);
+    } else {
+        MESON_LOGE("HwcVsync vsync callback fail (%p)-(%d)-(%p)",
+            this, ret, mObserver);
+    }
+}
+
+/*reactor mode, vsync thread only waits hw vsync asked by scheduleVsync.*/
+void HwcVsync::sampleLoop() {
+    while (true) {
+        std::shared_ptr<HwDisplayCrtc> crtc;
+        {
+            std::unique_lock<std::mutex> stateLock(mStatLock);
+            while (!mSampling || mExit) {
+                if (mExit) {
+                    MESON_LOGD("exit vsync loop");
+                    return;
+                }
+                mStateCondition.wait(stateLock);
+            }
+            crtc = mCrtc;
+        }
+
+        nsecs_t timestamp = 0;
+        int32_t ret = crtc ? crtc->waitVBlank(timestamp) : -ENODEV;
+        bool enabled;
+        {
+            std::lock_guard<std::mutex> lock(mStatLock);
+            if (ret == 0)
+                ret = onHwVsync(timestamp);
+            enabled = mEnabled;
+        }
+        if (ret != -EAGAIN && enabled)
+            deliverVsync(ret, timestamp);
+
+        std::lock_guard<std::mutex> lock(mStatLock);
+        mSampling = false;
+        scheduleVsync();
+    }
+}
+
+/*called with mStatLock held, arm timer for next vsync or ask a hw one.*/
+void HwcVsync::scheduleVsync() {
+    /*soft vsync armed but not given, it is computed again.*/
+    if (mTimerVsync > 0 && mTimerVsync == mSoftVsyncTime)
+        mSoftVsyncTime -= mSoftVsyncPeriod;
+
+    nsecs_t next = 0;
+    if (mEnabled && !mExit) {
+        if (mSoftVsync) {
+            next = nextSoftwareVsync();
+        } else if (!mSampling) {
+            next = nextPredictedVsync();
+            if (next == 0) {
+                mSampling = true;
+                mStateCondition.notify_all();
+            }
+        }
+    }
+
+    struct itimerspec timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = next / 1000000000;
+    timer.it_value.tv_nsec = next % 1000000000;
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &timer, NULL) != 0) {
+        MESON_LOGE("arm vsync timer failed (%d)", -errno);
+        next = 0;
+    }
+    mTimerVsync = next;
+}
+
+void HwcVsync::handleFd(int fd, uint32_t events __unused) {
+    uint64_t val;
+    /*timer re-armed after it fired.*/
+    if (read(fd, &val, sizeof(val)) != sizeof(val))
+        return;
+
+    nsecs_t timestamp;
+    {
+        std::lock_guard<std::mutex> lock(mStatLock);
+        timestamp = mTimerVsync;
+        mTimerVsync = 0;
+        if (timestamp == 0)
+            return;
+        if (!mSoftVsync)
+            onPredictedVsync(timestamp);
+    }
+
+    deliverVsync(0, timestamp);
+
+    std::lock_guard<std::mutex> lock(mStatLock);
+    /*observer may have scheduled it already.*/
+    if (mTimerVsync == 0 && !mSampling)
+        scheduleVsync();
+}
+
+int32_t HwcVsync::waitUntil(nsecs_t time) {
+    struct timespec spec;
+    spec.tv_sec  = time / 1000000000;
+    spec.tv_nsec = time % 1000000000;
+
+    if (mTimerFd < 0 || mWakeFd < 0) {
+        int err;
+        do {
+            err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL);
+        } while (err == EINTR);
+        return -err;
+    }
+
+    struct itimerspec timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value = spec;
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &timer, NULL) != 0)
+        return -errno;
+
+    struct pollfd fds[2];
+    fds[0].fd = mTimerFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = mWakeFd;
+    fds[1].events = POLLIN;
+    while (true) {
+        fds[0].revents = fds[1].revents = 0;
+        int ret = poll(fds, 2, -1);
+        if (ret > 0)
+            break;
+        if (ret < 0 && errno != EINTR)
+            return -errno;
+    }
+
+    uint64_t val;
+    if (fds[1].revents & POLLIN) {
+        read(mWakeFd, &val, sizeof(val));
+        return -EAGAIN;
+    }
+    read(mTimerFd, &val, sizeof(val));
+    return 0;
+}
+
+/*called with mStatLock held, 0 if a hw vsync is needed.*/
+nsecs_t HwcVsync::nextPredictedVsync() {
+    if (mModeChanged) {
+        mModeChanged = false;
+        if (mPredicting)
+            mModeResyncs++;
+        mPredicting = false;
+        mModel.reset(mPeriod);
+    }
+    if (!mPredicting || mTimerFd < 0 || mPredictedFrames >= mModel.getPredictFrames(
+        mModel.getPeriod() / VSYNC_PREDICT_ERROR_DIV, VSYNC_RESAMPLE_INTERVAL))
+        return 0;
+
+    nsecs_t now = systemTime(CLOCK_MONOTONIC);
+    /*never give the same vsync twice if the timer fired early.*/
+    nsecs_t after = mLastVsync + mModel.getPeriod() / 2;
+    return mModel.nextVsync(now > after ? now : after);
+}
+
+/*called with mStatLock held.*/
+void HwcVsync::onPredictedVsync(nsecs_t timestamp) {
+    mLastVsync = timestamp;
+    mPredictedFrames++;
+    mPredictedVsyncs++;
+}
+
+/*called with mStatLock held, -EAGAIN if the vsync was given by timer.*/
+int32_t HwcVsync::onHwVsync(nsecs_t timestamp) {
+    mHwVsyncs++;
+    /*timer fired just before the irq of the same vsync.*/
+    bool given = mLastVsync > 0 && timestamp - mLastVsync < mModel.getPeriod() / 2;
+    mLastVsync = timestamp;
+    /*sample of the old mode, model is reset on next wait.*/
+    if (!mModeChanged)
+        addHwSample(timestamp);
+    return given ? -EAGAIN : 0;
+}
+
+int32_t HwcVsync::waitHwVsync(nsecs_t & timestamp) {
+    std::shared_ptr<HwDisplayCrtc> crtc;
+    nsecs_t next = 0;
+    {
+        std::lock_guard<std::mutex> lock(mStatLock);
+        crtc = mCrtc;
+        next = nextPredictedVsync();
+    }
+
+    if (!crtc)
+        return -ENODEV;
+
+    if (next > 0) {
+        int32_t ret = waitUntil(next);
+        if (ret != 0)
+            return ret;
+        std::lock_guard<std::mutex> lock(mStatLock);
+        timestamp = next;
+        onPredictedVsync(next);
+        return 0;
+    }
+
+    int32_t ret = crtc->waitVBlank(timestamp);
+    if (ret != 0)
+        return ret;
+
+    std::lock_guard<std::mutex> lock(mStatLock);
+    return onHwVsync(timestamp);
+}
+
+void HwcVsync::addHwSample(nsecs_t timestamp) {
+    if (!mPredicting) {
+        if (mModel.addSample(timestamp)) {
+            mPredicting = true;
+            mPredictedFrames = mResampledFrames = 0;
+        }
+        return;
+    }
+
+    nsecs_t period = mModel.getPeriod();
+    nsecs_t error = mModel.getError(timestamp);
+    error = error < 0 ? -error : error;
+    /*late timestamps are left to the outlier rejection of the model.*/
+    if (error <= period / VSYNC_OUTLIER_DIV) {
+        mResamples++;
+        mErrorSum += error;
+        if (error > mMaxError)
+            mMaxError = error;
+
+        if (error > period / VSYNC_RESYNC_ERROR_DIV) {
+            MESON_LOGD("vsync model off by %" PRId64 " us, resync.", error / 1000);
+            mDriftResyncs++;
+            mPredicting = false;
+            mModel.reset(mPeriod);
+            mModel.addSample(timestamp);
+            return;
+        }
+    }
+
+    if (!mModel.addSample(timestamp)) {
+        mPredicting = false;
+    } else if (++mResampledFrames >= VSYNC_RESAMPLE_COUNT) {
+        mPredictedFrames = mResampledFrames = 0;
+    }
+}
+
+nsecs_t HwcVsync::nextSoftwareVsync() {
     nsecs_t now = systemTime(CLOCK_MONOTONIC);
 
     mPeriod = (mPeriod == 0) ? 1e9/SF_VSYNC_DFT_PERIOD : mPeriod;
 
     //cal the last vsync time with old period
-    if (mPeriod != old_vsync_period) {
-        if (old_vsync_period > 0) {
-            vsync_time = vsync_time +
-                    ((now - vsync_time) / old_vsync_period) * old_vsync_period;
+    if (mPeriod != mSoftVsyncPeriod) {
+        if (mSoftVsyncPeriod > 0) {
+            mSoftVsyncTime = mSoftVsyncTime +
+                    ((now - mSoftVsyncTime) / mSoftVsyncPeriod) * mSoftVsyncPeriod;
         }
-        old_vsync_period = mPeriod;
+        mSoftVsyncPeriod = mPeriod;
     }
 
     //set to next vsync time
-    vsync_time += mPeriod;
+    mSoftVsyncTime += mPeriod;
 
     // we missed, find where the next vsync should be
-    if (vsync_time - now < 0) {
-        vsync_time = now + (mPeriod -
-                 ((now - vsync_time) % mPeriod));
+    if (mSoftVsyncTime - now < 0) {
+        mSoftVsyncTime = now + (mPeriod -
+                 ((now - mSoftVsyncTime) % mPeriod));
     }
+    return mSoftVsyncTime;
+}
 
-    struct timespec spec;
-    spec.tv_sec  = vsync_time / 1000000000;
-    spec.tv_nsec = vsync_time % 1000000000;
-
-    int err;
-    do {
-        err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL);
-    } while (err<0 && errno == EINTR);
-    vsync_timestamp = vsync_time;
+int32_t HwcVsync::waitSoftwareVsync(nsecs_t& vsync_timestamp) {
+    int32_t err = waitUntil(nextSoftwareVsync());
+    if (err == -EAGAIN) {
+        /*vsync not given, wait for it again.*/
+        mSoftVsyncTime -= mSoftVsyncPeriod;
+        return err;
+    }
+    vsync_timestamp = mSoftVsyncTime;
 
     return err;
 }
 
+void HwcVsync::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mStatLock);
+    dumpstr.appendFormat("Vsync: %s, %s, period %" PRId64 " us%s\n",
+        mSoftVsync ? "software" : (mPredicting ? "hw predicted" : "hw sampling"),
+        mEnabled ? "enabled" : "disabled", mPeriod / 1000, mReactor ? ", on reactor" : "");
+    if (mSoftVsync)
+        return;
+
+    dumpstr.appendFormat("    %" PRIu64 " hw vsync waits, %" PRIu64 " predicted vsyncs, "
+        "resyncs: %" PRIu64 " mode, %" PRIu64 " drift\n",
+        mHwVsyncs, mPredictedVsyncs, mModeResyncs, mDriftResyncs);
+    dumpstr.appendFormat("    model error on resample: avg %" PRId64 " us, max %" PRId64
+        " us (%" PRIu64 " resamples)\n",
+        mResamples ? mErrorSum / (nsecs_t)mResamples / 1000 : 0, mMaxError / 1000,
+        mResamples);
+    mModel.dump(dumpstr);
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <inttypes.h>
+#include <math.h>
+
+#include <MesonLog.h>
+#include <VsyncModel.h>
+
+VsyncModel::VsyncModel() {
+    mAccepted = mOutliers = mRestarts = 0;
+    reset(0);
+}
+
+VsyncModel::~VsyncModel() {
+}
+
+void VsyncModel::reset(nsecs_t period) {
+    mNominalPeriod = period;
+    mHead = mCount = 0;
+    mOutliersInRow = 0;
+    mStable = false;
+    mPeriod = 0;
+    mAnchor = 0;
+    mJitter = 0;
+    mPeriodError = 0;
+}
+
+nsecs_t VsyncModel::getPeriod() {
+    return mPeriod > 0 ? (nsecs_t)llround(mPeriod) : mNominalPeriod;
+}
+
+bool VsyncModel::addSample(nsecs_t timestamp) {
+    if (mCount == 0) {
+        mSamples[mHead] = {0, timestamp};
+        mCount = 1;
+        mAccepted++;
+        return false;
+    }
+
+    Sample & last = mSamples[(mHead + mCount - 1) % VSYNC_MODEL_SAMPLES];
+    double interval = (double)(timestamp - last.timestamp);
+    double period = mPeriod > 0 ? mPeriod : (double)mNominalPeriod;
+    /*no period known yet, take the first interval.*/
+    if (period <= 0)
+        period = interval;
+
+    int64_t k = period > 0 ? llround(interval / period) : 0;
+    double residual = interval - k * period;
+    if (k <= 0 || fabs(residual) > period / VSYNC_OUTLIER_DIV) {
+        mOutliers++;
+        if (++mOutliersInRow >= VSYNC_OUTLIER_RESTART) {
+            /*timing is not the nominal one either, learn it from samples.*/
+            mRestarts++;
+            reset(0);
+            mSamples[mHead] = {0, timestamp};
+            mCount = 1;
+        }
+        return mStable;
+    }
+    mOutliersInRow = 0;
+
+    Sample sample = {last.index + k, timestamp};
+    if (mCount < VSYNC_MODEL_SAMPLES) {
+        mSamples[(mHead + mCount) % VSYNC_MODEL_SAMPLES] = sample;
+        mCount++;
+    } else {
+        mSamples[mHead] = sample;
+        mHead = (mHead + 1) % VSYNC_MODEL_SAMPLES;
+    }
+    mAccepted++;
+
+    fit();
+    return mStable;
+}
+
+void VsyncModel::fit() {
+    if (mCount < 2)
+        return;
+
+    /*relative to the oldest sample to keep precision.*/
+    const Sample & oldest = mSamples[mHead];
+    double meanK = 0, meanT = 0;
+    for (int32_t i = 0; i < mCount; i++) {
+        const Sample & s = mSamples[(mHead + i) % VSYNC_MODEL_SAMPLES];
+        meanK += s.index - oldest.index;
+        meanT += s.timestamp - oldest.timestamp;
+    }
+    meanK /= mCount;
+    meanT /= mCount;
+
+    double skk = 0, skt = 0;
+    for (int32_t i = 0; i < mCount; i++) {
+        const Sample & s = mSamples[(mHead + i) % VSYNC_MODEL_SAMPLES];
+        double dk = s.index - oldest.index - meanK;
+        skk += dk * dk;
+        skt += dk * (s.timestamp - oldest.timestamp - meanT);
+    }
+    if (skk <= 0)
+        return;
+
+    double period = skt / skk;
+    double offset = meanT - period * meanK;
+    double squares = 0;
+    for (int32_t i = 0; i < mCount; i++) {
+        const Sample & s = mSamples[(mHead + i) % VSYNC_MODEL_SAMPLES];
+        double residual = (s.timestamp - oldest.timestamp)
+            - (offset + period * (s.index - oldest.index));
+        squares += residual * residual;
+    }
+
+    mPeriod = period;
+    mAnchor = oldest.timestamp + (nsecs_t)llround(offset);
+    mJitter = (nsecs_t)llround(sqrt(squares / mCount));
+    /*standard error of the fitted period.*/
+    mPeriodError = mCount > 2 ? sqrt(squares / (mCount - 2) / skk) : 0;
+
+    bool nominal = mNominalPeriod == 0 || fabs(period - mNominalPeriod) < mNominalPeriod / 10;
+    if (!nominal && mCount == VSYNC_MODEL_SAMPLES && mJitter < period / VSYNC_STABLE_DIV) {
+        /*a full set of consistent samples, trust hw over the mode.*/
+        MESON_LOGD("vsync period %.1f us, not the nominal %" PRId64 " us.",
+            period / 1000.0, mNominalPeriod / 1000);
+        mNominalPeriod = 0;
+        nominal = true;
+    }
+    mStable = mCount >= VSYNC_MODEL_MIN_SAMPLES
+        && mJitter < period / VSYNC_STABLE_DIV && nominal;
+}
+
+int32_t VsyncModel::getPredictFrames(nsecs_t maxError, int32_t maxFrames) {
+    if (!mStable)
+        return 0;
+    if (mPeriodError * maxFrames <= maxError)
+        return maxFrames;
+    return (int32_t)(maxError / mPeriodError);
+}
+
+nsecs_t VsyncModel::nextVsync(nsecs_t time) {
+    if (mPeriod <= 0)
+        return time + mNominalPeriod;
+
+    int64_t k = (int64_t)floor((time - mAnchor) / mPeriod) + 1;
+    nsecs_t next = mAnchor + (nsecs_t)llround(k * mPeriod);
+    /*rounding may give time itself.*/
+    if (next <= time)
+        next = mAnchor + (nsecs_t)llround((k + 1) * mPeriod);
+    return next;
+}
+
+nsecs_t VsyncModel::getError(nsecs_t timestamp) {
+    if (mPeriod <= 0)
+        return 0;
+
+    int64_t k = llround((timestamp - mAnchor) / mPeriod);
+    return timestamp - (mAnchor + (nsecs_t)llround(k * mPeriod));
+}
+
+void VsyncModel::dump(String8 & dumpstr) {
+    dumpstr.appendFormat("Vsync model: %s, period %.1f us (nominal %" PRId64 " us), "
+        "jitter %" PRId64 " us, %d samples\n",
+        mStable ? "stable" : "sampling", mPeriod / 1000.0, mNominalPeriod / 1000,
+        mJitter / 1000, mCount);
+    dumpstr.appendFormat("    accepted %" PRIu64 ", outliers %" PRIu64 ", restarts %" PRIu64 "\n",
+        mAccepted, mOutliers, mRestarts);
+}
@@ -78,6 +78,8 @@ public:
     virtual int32_t handleRequest(uint32_t flags);
     virtual void handleEvent(drm_display_event event, int val);
 
+    void dump(String8 & dumpstr);
+
 protected:
     class PipeCfg {
     public:
@@ -107,6 +109,10 @@ protected:
         std::shared_ptr<HwcModeMgr> modeMgr;
         std::shared_ptr<HwDisplayCrtc> modeCrtc;
         std::shared_ptr<HwDisplayConnector> modeConnector;
+
+        /*config set SF last saw on hotplug, empty if disconnected.*/
+        HwDisplayConnector * hotplugConnector;
+        std::vector<drm_mode_info_t> hotplugModes;
     };
 
 protected:
@@ -116,6 +122,8 @@ protected:
     virtual drm_connector_type_t getConnetorCfg(uint32_t hwcid);
 
     virtual int32_t initDisplayMode(std::shared_ptr<PipeStat> & stat);
+    /*update cached config set, return true if it changed.*/
+    bool updateHotplugConfigs(std::shared_ptr<PipeStat> & stat, bool connected);
 
     /*load display resource*/
     int32_t getCrtc(
@@ -133,6 +141,10 @@ protected:
     std::map<drm_connector_type_t, std::shared_ptr<HwDisplayConnector>> mConnectors;
     std::map<uint32_t, std::shared_ptr<PipeStat>> mPipeStats;
     std::mutex mMutex;
+
+    /*stats.*/
+    uint64_t mHotplugNotified;
+    uint64_t mHotplugUnchanged;
 };
 
 std::shared_ptr<HwcDisplayPipe> createDisplayPipe(hwc_pipe_policy_t pipet);
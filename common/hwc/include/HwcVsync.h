@@ -17,6 +17,17 @@
 #include <pthread.h>
 
 #include <HwDisplayCrtc.h>
+#include <HwcReactor.h>
+#include <VsyncModel.h>
+
+/*predicted vsyncs between two hardware resamples.*/
+#define VSYNC_RESAMPLE_INTERVAL     120
+/*hardware vsyncs checked on each resample.*/
+#define VSYNC_RESAMPLE_COUNT        3
+/*predicted vsyncs stay within period / DIV of the fit.*/
+#define VSYNC_PREDICT_ERROR_DIV     40
+/*resample error over period / DIV rebuilds the model.*/
+#define VSYNC_RESYNC_ERROR_DIV      20
 
 class HwcVsyncObserver {
 public:
@@ -24,7 +35,16 @@ public:
     virtual void onVsync(int64_t timestamp) = 0;
 };
 
-class HwcVsync {
+/*
+ * Hardware vsync is sampled until the vsync model is stable, then
+ * vsyncs are generated by timer from the model. Hardware vsync is
+ * sampled again every VSYNC_RESAMPLE_INTERVAL vsyncs (sooner while the
+ * fitted period is not precise enough), after the mode changed or
+ * vsync was disabled for long.
+ * With REACTOR_CLIENT_VSYNC, timer vsyncs are given by HwcReactor and
+ * the vsync thread only waits the hw vsyncs.
+ */
+class HwcVsync : public ReactorHandler {
 public:
     HwcVsync();
     ~HwcVsync();
@@ -35,14 +55,33 @@ public:
 
     int32_t setEnabled(bool enabled);
 
-    /*for software vsync.*/
+    /*period of display mode, software vsync runs with it.*/
     int32_t setPeriod(nsecs_t period);
 
-    void dump();
+    void dump(String8 & dumpstr);
+
+    /*vsync timer on reactor.*/
+    void handleFd(int fd, uint32_t events);
 
 protected:
     static void * vsyncThread(void * data);
+    void sampleLoop();
+    void deliverVsync(int32_t ret, nsecs_t timestamp);
+
     int32_t waitSoftwareVsync(nsecs_t& vsync_timestamp);
+    nsecs_t nextSoftwareVsync();
+    int32_t waitHwVsync(nsecs_t & timestamp);
+
+    /*with mStatLock held.*/
+    void scheduleVsync();
+    nsecs_t nextPredictedVsync();
+    void onPredictedVsync(nsecs_t timestamp);
+    int32_t onHwVsync(nsecs_t timestamp);
+    /*update model with a hw vsync, with mStatLock held.*/
+    void addHwSample(nsecs_t timestamp);
+    /*sleep until time, -EAGAIN if woken by a state change.*/
+    int32_t waitUntil(nsecs_t time);
+    void wakeThread();
 
 protected:
     bool mSoftVsync;
@@ -51,12 +90,42 @@ protected:
     nsecs_t mPeriod;
     nsecs_t mPreTimeStamp;
 
+    /*software vsync.*/
+    nsecs_t mSoftVsyncTime;
+    nsecs_t mSoftVsyncPeriod;
+
+    /*hardware vsync model, with mStatLock held.*/
+    VsyncModel mModel;
+    bool mModeChanged;
+    bool mPredicting;
+    int32_t mPredictedFrames;
+    int32_t mResampledFrames;
+    nsecs_t mLastVsync;
+    nsecs_t mDisabledTime;
+
+    int mTimerFd;
+    int mWakeFd;
+
+    /*reactor mode.*/
+    bool mReactor;
+    bool mSampling;             /*hw vsync asked from vsync thread.*/
+    nsecs_t mTimerVsync;        /*vsync the timer is armed to.*/
+
     HwcVsyncObserver * mObserver;
     std::shared_ptr<HwDisplayCrtc> mCrtc;
 
     std::mutex mStatLock;
     std::condition_variable mStateCondition;
     pthread_t hw_vsync_thread;
+
+    /*stats.*/
+    uint64_t mHwVsyncs;
+    uint64_t mPredictedVsyncs;
+    uint64_t mModeResyncs;
+    uint64_t mDriftResyncs;
+    uint64_t mResamples;
+    nsecs_t mErrorSum;
+    nsecs_t mMaxError;
 };
 
 #endif/*HW_DISPLAY_VSYNC_H*/
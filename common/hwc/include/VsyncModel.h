@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Vsync period and phase fitted from hardware vsync timestamps.
+ */
+
+#ifndef VSYNC_MODEL_H
+#define VSYNC_MODEL_H
+
+#include <BasicTypes.h>
+
+#define VSYNC_MODEL_SAMPLES         16
+#define VSYNC_MODEL_MIN_SAMPLES     6
+/*samples off the model by more than period / DIV are outliers.*/
+#define VSYNC_OUTLIER_DIV           5
+/*outliers in a row mean the display timing changed, model restarts.*/
+#define VSYNC_OUTLIER_RESTART       3
+/*stable when rms of fit residuals is below period / DIV.*/
+#define VSYNC_STABLE_DIV            100
+
+/*
+ * Least squares fit of t = anchor + period * index over the last
+ * samples. Index of a sample is its distance in periods to the last
+ * one, so missed vsyncs do not break the fit.
+ */
+class VsyncModel {
+public:
+    VsyncModel();
+    ~VsyncModel();
+
+    /*drop samples, period is the nominal one of the display mode or 0.*/
+    void reset(nsecs_t period);
+    /*return true if the model is stable after the sample.*/
+    bool addSample(nsecs_t timestamp);
+    bool isStable() { return mStable; }
+
+    nsecs_t getPeriod();
+    /*first predicted vsync after time, only valid when stable.*/
+    nsecs_t nextVsync(nsecs_t time);
+    /*distance of timestamp to the nearest predicted vsync.*/
+    nsecs_t getError(nsecs_t timestamp);
+    /*rms of fit residuals, the jitter of hardware timestamps.*/
+    nsecs_t getJitter() { return mJitter; }
+    /*vsyncs predicted before the period error may add up to maxError.*/
+    int32_t getPredictFrames(nsecs_t maxError, int32_t maxFrames);
+
+    void dump(String8 & dumpstr);
+
+protected:
+    void fit();
+
+protected:
+    struct Sample {
+        int64_t index;
+        nsecs_t timestamp;
+    };
+
+    nsecs_t mNominalPeriod;
+    Sample mSamples[VSYNC_MODEL_SAMPLES];
+    int32_t mHead;              /*oldest sample.*/
+    int32_t mCount;
+    int32_t mOutliersInRow;
+
+    bool mStable;
+    double mPeriod;             /*fitted, 0 if less than 2 samples.*/
+    nsecs_t mAnchor;            /*fitted vsync at index of the oldest sample.*/
+    nsecs_t mJitter;
+    double mPeriodError;
+
+    /*stats.*/
+    uint64_t mAccepted;
+    uint64_t mOutliers;
+    uint64_t mRestarts;
+};
+
+#endif/*VSYNC_MODEL_H*/
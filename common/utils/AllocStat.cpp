@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <AllocStat.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#ifdef HWC_ENABLE_ALLOC_STAT
+/*
+ * Replace global operator new, hwcomposer is linked with
+ * -Bsymbolic-functions so only allocations of hwc code come here.
+ */
+static thread_local alloc_stat_t sAllocStat = {0, 0, 0};
+
+static void * countedAlloc(size_t size) {
+    sAllocStat.count++;
+    sAllocStat.bytes += size;
+    return malloc(size == 0 ? 1 : size);
+}
+
+void * operator new(size_t size) {
+    /*built without exceptions, same as bionic on oom.*/
+    void * p = countedAlloc(size);
+    if (p == NULL)
+        abort();
+    return p;
+}
+
+void * operator new[](size_t size) {
+    return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void * p) noexcept {
+    free(p);
+}
+
+void operator delete[](void * p) noexcept {
+    free(p);
+}
+
+void operator delete(void * p, size_t size __attribute__((unused))) noexcept {
+    free(p);
+}
+
+void operator delete[](void * p, size_t size __attribute__((unused))) noexcept {
+    free(p);
+}
+
+bool alloc_stat_get(alloc_stat_t * stat) {
+    *stat = sAllocStat;
+    /*catches malloc of libutils and others, but also of other threads.*/
+    struct mallinfo info = mallinfo();
+    stat->heapInUse = (int64_t)info.uordblks;
+    return true;
+}
+#else
+bool alloc_stat_get(alloc_stat_t * stat) {
+    memset(stat, 0, sizeof(alloc_stat_t));
+    return false;
+}
+#endif
@@ -25,8 +25,15 @@ LOCAL_CFLAGS := $(HWC_C_FLAGS)
 LOCAL_SHARED_LIBRARIES := $(HWC_SHARED_LIBS)
 
 LOCAL_SRC_FILES := \
+    AllocStat.cpp \
     BitsMap.cpp \
+    CachedProperty.cpp \
+    EventQueue.cpp \
+    EventThread.cpp \
+    FrameArena.cpp \
+    HwcReactor.cpp \
     misc.cpp \
+    SysfsWriter.cpp \
     systemcontrol.cpp
 
 LOCAL_C_INCLUDES := \
@@ -34,6 +41,7 @@ LOCAL_C_INCLUDES := \
     system/core/include \
     frameworks/native/include \
     frameworks/native/libs/arect/include \
+    hardware/amlogic/gralloc \
     hardware/amlogic/gralloc/amlogic \
     vendor/amlogic/frameworks/services/systemcontrol \
     $(LOCAL_PATH)/include
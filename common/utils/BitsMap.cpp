@@ -8,73 +8,70 @@
  */
 
 #include <BitsMap.h>
-#include <string.h>
+#include <errno.h>
 #include <MesonLog.h>
 
-#define BYTE_IDX(idx) (idx >> 3)
-#define BIT_OFFSET(idx) (idx & 0x7)
-
+#define WORD_BITS (64)
+#define WORD_IDX(idx) ((idx) >> 6)
+#define BIT_OFFSET(idx) ((idx) & 0x3f)
+#define WORD_NUM(bits) (((bits) + WORD_BITS - 1) >> 6)
 
 BitsMap::BitsMap(int bits) {
-    mLen = BYTE_IDX(bits) + 1;
-    mBits = new char[mLen];
-    memset(mBits, 0, mLen);
+    mBitNum = 0;
+    mZeroHint = 0;
+    resize(bits);
 }
 
 BitsMap::~BitsMap() {
-    delete mBits;
 }
 
 int BitsMap::getZeroBit() {
-    int  i = 0;
-    for (; i < mLen; i++) {
-        if (mBits[i] == 0xFF) {
-            continue;
-        }
-
-        char byteval = mBits[i];
-        int idx = 0;
-
-        if ((byteval & 0xF) == 0xF) {
-            byteval >>= 4;
-            idx += 4;
-        }
-        if ((byteval & 0x3) == 0x3) {
-            byteval >>= 2;
-            idx += 2;
+    int words = (int)mWords.size();
+    for (int i = mZeroHint; i < words; i++) {
+        uint64_t zeros = ~mWords[i];
+        if (zeros != 0) {
+            mZeroHint = i;
+            return i * WORD_BITS + __builtin_ctzll(zeros);
         }
-        if ((byteval & 0x1) == 0x1) {
-            byteval >>= 1;
-            idx += 1;
-        }
-
-#if 0
-        int testidx = 0;
-        byteval = mBits[i];
-        while ((byteval & 0x1) == 0x1) {
-            byteval >>= 1;
-            testidx ++;
-        }
-
-        if (testidx != idx) {
-            MESON_LOGE("error idx %d vs %d", testidx, idx);
-        }
-#endif
-
-        idx += i * 8;
-        return idx;
     }
 
+    mZeroHint = words;
     return -1;
 }
 
 int BitsMap::setBit(int idx) {
-    mBits[BYTE_IDX(idx)] |= 1 << BIT_OFFSET(idx);
+    if (idx < 0 || idx >= mBitNum)
+        return -EINVAL;
+
+    mWords[WORD_IDX(idx)] |= 1ULL << BIT_OFFSET(idx);
     return 0;
 }
 
 int BitsMap::clearBit(int idx) {
-    mBits[BYTE_IDX(idx)] &= ~(1 << BIT_OFFSET(idx));
+    if (idx < 0 || idx >= mBitNum)
+        return -EINVAL;
+
+    mWords[WORD_IDX(idx)] &= ~(1ULL << BIT_OFFSET(idx));
+    if (WORD_IDX(idx) < mZeroHint)
+        mZeroHint = WORD_IDX(idx);
     return 0;
 }
 
+/*padding bits of last word are kept set, never returned as zero bit.*/
+int BitsMap::resize(int bits) {
+    if (bits < mBitNum)
+        return -EINVAL;
+
+    int words = WORD_NUM(bits);
+    int lastWords = (int)mWords.size();
+    mWords.resize(words, 0);
+    for (int i = mBitNum; i < lastWords * WORD_BITS; i++)
+        mWords[WORD_IDX(i)] &= ~(1ULL << BIT_OFFSET(i));
+    for (int i = bits; i < words * WORD_BITS; i++)
+        mWords[WORD_IDX(i)] |= 1ULL << BIT_OFFSET(i);
+
+    if (WORD_IDX(mBitNum) < mZeroHint)
+        mZeroHint = WORD_IDX(mBitNum);
+    mBitNum = bits;
+    return 0;
+}
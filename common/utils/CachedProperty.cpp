@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <atomic>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cutils/properties.h>
+#include <sys/system_properties.h>
+
+#include <CachedProperty.h>
+#include <MesonLog.h>
+
+static std::atomic<uint64_t> sCachedReads(0);
+static std::atomic<uint64_t> sLookups(0);
+
+CachedProperty::CachedProperty(const char * name) {
+    mName = name;
+    mInfo = NULL;
+    mAreaSerial = mSerial = 0;
+    mValid = false;
+    mValue[0] = 0;
+}
+
+CachedProperty::~CachedProperty() {
+}
+
+void CachedProperty::refresh() {
+    /*serial of the whole area changes when any property is set or added.*/
+    uint32_t areaSerial = __system_property_area_serial();
+    if (mValid && areaSerial == mAreaSerial) {
+        sCachedReads++;
+        return;
+    }
+    mAreaSerial = areaSerial;
+
+    if (!mInfo)
+        mInfo = __system_property_find(mName);
+    if (mInfo) {
+        uint32_t serial = __system_property_serial(mInfo);
+        if (mValid && serial == mSerial) {
+            sCachedReads++;
+            return;
+        }
+        mSerial = serial;
+    } else if (mValid) {
+        /*still not set.*/
+        sCachedReads++;
+        return;
+    }
+
+    property_get(mName, mValue, "");
+    mValid = true;
+    sLookups++;
+}
+
+bool CachedProperty::getBool(bool defVal) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    refresh();
+    /*same values as property_get_bool.*/
+    if (!strcmp(mValue, "1") || !strcmp(mValue, "y") || !strcmp(mValue, "yes")
+        || !strcmp(mValue, "on") || !strcmp(mValue, "true"))
+        return true;
+    if (!strcmp(mValue, "0") || !strcmp(mValue, "n") || !strcmp(mValue, "no")
+        || !strcmp(mValue, "off") || !strcmp(mValue, "false"))
+        return false;
+    return defVal;
+}
+
+int32_t CachedProperty::getInt(int32_t defVal) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    refresh();
+    return mValue[0] ? atoi(mValue) : defVal;
+}
+
+int32_t CachedProperty::getString(char * val) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    refresh();
+    strcpy(val, mValue);
+    return strlen(mValue);
+}
+
+void CachedProperty::dumpStats(String8 & dumpstr) {
+    uint64_t cached = sCachedReads;
+    uint64_t lookups = sLookups;
+    dumpstr.appendFormat("Cached properties: %" PRIu64 " reads from memory, %" PRIu64
+        " lookups\n", cached, lookups);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <algorithm>
+
+#include <EventQueue.h>
+
+EventQueue::EventQueue() {
+    mSeq = 0;
+    mCoalesced = 0;
+}
+
+EventQueue::~EventQueue() {
+}
+
+bool EventQueue::later(const Event & a, const Event & b) {
+    if (a.dueTime != b.dueTime)
+        return a.dueTime > b.dueTime;
+    return a.seq > b.seq;
+}
+
+bool EventQueue::push(EventHandler * handler, int what, nsecs_t dueTime) {
+    for (auto it = mHeap.begin(); it != mHeap.end(); ++it) {
+        if (it->handler != handler || it->what != what)
+            continue;
+
+        mCoalesced++;
+        if (it->dueTime <= dueTime)
+            return false;
+        it->dueTime = dueTime;
+        std::make_heap(mHeap.begin(), mHeap.end(), later);
+        return mHeap.front().handler == handler && mHeap.front().what == what;
+    }
+
+    mHeap.push_back({handler, what, dueTime, mSeq++});
+    std::push_heap(mHeap.begin(), mHeap.end(), later);
+    return mHeap.front().seq == mSeq - 1;
+}
+
+void EventQueue::remove(EventHandler * handler, int what) {
+    auto end = std::remove_if(mHeap.begin(), mHeap.end(),
+        [handler, what](const Event & e) { return e.handler == handler && e.what == what; });
+    if (end == mHeap.end())
+        return;
+    mHeap.erase(end, mHeap.end());
+    std::make_heap(mHeap.begin(), mHeap.end(), later);
+}
+
+void EventQueue::removeHandler(EventHandler * handler) {
+    auto end = std::remove_if(mHeap.begin(), mHeap.end(),
+        [handler](const Event & e) { return e.handler == handler; });
+    if (end == mHeap.end())
+        return;
+    mHeap.erase(end, mHeap.end());
+    std::make_heap(mHeap.begin(), mHeap.end(), later);
+}
+
+bool EventQueue::popDue(nsecs_t now, Event & event) {
+    if (mHeap.empty() || mHeap.front().dueTime > now)
+        return false;
+
+    std::pop_heap(mHeap.begin(), mHeap.end(), later);
+    event = mHeap.back();
+    mHeap.pop_back();
+    return true;
+}
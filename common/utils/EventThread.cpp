@@ -8,27 +8,56 @@
  */
 
 #include <EventThread.h>
+#include <HwcReactor.h>
 #include <MesonLog.h>
-#include <chrono>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
-EventThread::EventThread(const char * name) {
+EventThread::EventThread(const char * name, uint32_t reactorClient) {
     MESON_ASSERT(name, "EventThread need a non-NULL name.");
 
     mExit = false;
     mHandler = NULL;
+    mReactor = HwcReactor::isEnabled(reactorClient);
+    mStarted = false;
+    mTimerFd = -1;
+    mWakeFd = -1;
+    mTimerDue = 0;
+    mWaiting = false;
 
     int nameLen = strlen(name) + 1;
     mName = new char [nameLen];
-    memcpy(mName, name, nameLen - 1);
+    memcpy(mName, name, nameLen);
+
+    if (!mReactor) {
+        mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (mTimerFd < 0 || mWakeFd < 0)
+            MESON_LOGE("EventThread %s create fd failed: %s", mName, strerror(errno));
+    }
 }
 
 EventThread::~EventThread() {
-    std::unique_lock<std::mutex> eventLock(mEventMutex);
-    mExit = true;
-    eventLock.unlock();
-    mEventCond.notify_all();
-    pthread_join(mEventThread, NULL);
-    delete mName;
+    if (mReactor) {
+        if (mHandler)
+            HwcReactor::getInstance().removeHandler(mHandler);
+    } else {
+        std::unique_lock<std::mutex> eventLock(mEventMutex);
+        mExit = true;
+        eventLock.unlock();
+
+        uint64_t val = 1;
+        write(mWakeFd, &val, sizeof(val));
+        if (mStarted)
+            pthread_join(mEventThread, NULL);
+        if (mTimerFd >= 0)
+            close(mTimerFd);
+        if (mWakeFd >= 0)
+            close(mWakeFd);
+    }
+    delete [] mName;
 }
 
 void EventThread::setHandler(EventHandler * handler) {
@@ -37,78 +66,131 @@ void EventThread::setHandler(EventHandler * handler) {
 }
 
 void EventThread::start() {
+    if (mReactor)
+        return;
+
     int ret = pthread_create(&mEventThread, NULL, EventThread::threadMain, (void *)this);
     if (ret) {
         MESON_LOGE("failed to start EventThread: %s", strerror(ret));
         return;
     }
+    mStarted = true;
 }
 
 void EventThread::sendEvent(int what) {
-    std::unique_lock<std::mutex> eventLock(mEventMutex);
-    mEvents.push_back({what, 0});
-    eventLock.unlock();
-    mEventCond.notify_one();
+    if (mReactor) {
+        HwcReactor::getInstance().sendEvent(mHandler, what);
+        return;
+    }
+
+    std::lock_guard<std::mutex> eventLock(mEventMutex);
+    queueEvent(what, 0);
 }
 
 void EventThread::sendEventDelayed(int what,  uint32_t delayMs) {
-    std::unique_lock<std::mutex> eventLock(mEventMutex);
     nsecs_t now = systemTime(CLOCK_MONOTONIC);
     nsecs_t delayTime = delayMs;
     delayTime = delayTime * 1000000;
+    if (mReactor) {
+        HwcReactor::getInstance().sendEvent(mHandler, what, now + delayTime);
+        return;
+    }
 
-    //MESON_LOGE("send event delayed %lld + %lld = %lld", now, delayTime,
-      //  now + delayTime);
-    mEvents.push_back({what,  now + delayTime});
-    eventLock.unlock();
-    mEventCond.notify_one();
+    std::lock_guard<std::mutex> eventLock(mEventMutex);
+    queueEvent(what, now + delayTime);
 }
 
 void EventThread::removeEvent(int what) {
-    std::unique_lock<std::mutex> eventLock(mEventMutex);
-    for (auto it = mEvents.begin(); it != mEvents.end();) {
-        if (it->what == what)
-            it = mEvents.erase(it);
-        else
-            ++ it;
+    if (mReactor) {
+        HwcReactor::getInstance().removeEvent(mHandler, what);
+        return;
     }
+
+    /*timer may fire for a removed event, thread just arms it again.*/
+    std::lock_guard<std::mutex> eventLock(mEventMutex);
+    mEvents.remove(mHandler, what);
+}
+
+void EventThread::queueEvent(int what, nsecs_t dueTime) {
+    if (!mEvents.push(mHandler, what, dueTime))
+        return;
+
+    /*a running thread checks the queue before it sleeps again.*/
+    if (!mWaiting)
+        return;
+
+    if (dueTime == 0) {
+        uint64_t val = 1;
+        write(mWakeFd, &val, sizeof(val));
+    } else {
+        armTimer(dueTime);
+    }
+}
+
+void EventThread::armTimer(nsecs_t dueTime) {
+    if (dueTime == mTimerDue)
+        return;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = dueTime / 1000000000;
+    spec.it_value.tv_nsec = dueTime % 1000000000;
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        MESON_LOGE("EventThread %s arm timer failed: %s", mName, strerror(errno));
+        return;
+    }
+    mTimerDue = dueTime;
+}
+
+void EventThread::waitEvents(std::unique_lock<std::mutex> & eventLock) {
+    armTimer(mEvents.empty() ? 0 : mEvents.firstDueTime());
+    mWaiting = true;
     eventLock.unlock();
-    mEventCond.notify_one();
+
+    struct pollfd fds[2] = {
+        {mTimerFd, POLLIN, 0},
+        {mWakeFd, POLLIN, 0},
+    };
+    int ret = poll(fds, 2, -1);
+    if (ret < 0 && errno != EINTR)
+        MESON_LOGE("EventThread %s poll failed: %s", mName, strerror(errno));
+
+    uint64_t val;
+    eventLock.lock();
+    mWaiting = false;
+    if (read(mTimerFd, &val, sizeof(val)) == sizeof(val))
+        mTimerDue = 0;
+    read(mWakeFd, &val, sizeof(val));
 }
 
-void EventThread::processEvents() {
+void EventThread::threadLoop() {
     std::unique_lock<std::mutex> eventLock(mEventMutex);
-    nsecs_t closestDueTime = 0;
-
-    for (auto it = mEvents.begin(); it != mEvents.end();) {
-        bool bHandle = false;
-        if (it->dueTime == 0) {
-            bHandle = true;
-        } else {
-            nsecs_t now = systemTime(CLOCK_MONOTONIC);
-            if (it->dueTime < now) {
-                bHandle = true;
+    EventQueue::Event event;
+
+    while (!mExit) {
+        /*one clock read per wakeup, again only when the next event is not due.*/
+        nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        while (!mExit) {
+            if (!mEvents.popDue(now, event)) {
+                if (mEvents.empty())
+                    break;
+                now = systemTime(CLOCK_MONOTONIC);
+                if (mEvents.firstDueTime() > now)
+                    break;
+                continue;
             }
-        }
 
-        if (bHandle) {
-            mHandler->handleEvent(it->what);
-            it = mEvents.erase(it);
-        } else {
-            if (closestDueTime == 0 || closestDueTime > it->dueTime)
-                closestDueTime = it->dueTime;
-            ++ it;
+            /*handle without lock, handler may send new events or take its own lock.*/
+            eventLock.unlock();
+            mHandler->handleEvent(event.what);
+            eventLock.lock();
         }
-    }
 
-    nsecs_t now = systemTime(CLOCK_MONOTONIC);
-    if (closestDueTime > now) {
-        nsecs_t delayed = closestDueTime - now;
-        //MESON_LOGE("get time %lld sleep %lld to wait", closestDueTime, delayed);
-        mEventCond.wait_for(eventLock,
-            std::chrono::nanoseconds(delayed));
-    } else  {
-        mEventCond.wait(eventLock);
+        /*exit may be set before we get the lock, do not miss it.*/
+        if (mExit)
+            break;
+
+        waitEvents(eventLock);
     }
 }
 
@@ -116,11 +198,8 @@ void * EventThread::threadMain(void * data) {
     MESON_ASSERT(data, "EventThread data should not be NULL.");
     EventThread * pThis = (EventThread *) data;
 
-    while (!pThis->mExit) {
-        pThis->processEvents();
-    }
+    pThis->threadLoop();
 
     pthread_exit(0);
     return NULL;
 }
-
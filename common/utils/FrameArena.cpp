@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <FrameArena.h>
+#include <stdlib.h>
+#include <MesonLog.h>
+
+#define ALIGN_UP(x, a) (((x) + (a) - 1) & ~((size_t)(a) - 1))
+
+FrameArena::FrameArena(size_t size) {
+    mSize = size;
+    mBlock = (uint8_t *)malloc(mSize);
+    mUsed = 0;
+    mFrameUsed = 0;
+    mPeakUsed = 0;
+    mGrowNum = 0;
+    MESON_ASSERT(mBlock != NULL, "FrameArena alloc %zu failed.", mSize);
+}
+
+FrameArena::~FrameArena() {
+    freeExtraBlocks();
+    free(mBlock);
+}
+
+void * FrameArena::alloc(size_t size, size_t align) {
+    size_t offset = ALIGN_UP((size_t)mBlock + mUsed, align) - (size_t)mBlock;
+    mFrameUsed += size + align;
+    if (offset + size <= mSize) {
+        mUsed = offset + size;
+        return mBlock + offset;
+    }
+
+    /*out of block in this frame, keep it on heap till reset.*/
+    void * p = malloc(size);
+    MESON_ASSERT(p != NULL, "FrameArena alloc %zu failed.", size);
+    mExtraBlocks.push_back(p);
+    return p;
+}
+
+void FrameArena::reset() {
+    if (mFrameUsed > mPeakUsed)
+        mPeakUsed = mFrameUsed;
+
+    if (!mExtraBlocks.empty()) {
+        freeExtraBlocks();
+        free(mBlock);
+        mSize = ALIGN_UP(mPeakUsed * 2, 1024);
+        mBlock = (uint8_t *)malloc(mSize);
+        MESON_ASSERT(mBlock != NULL, "FrameArena alloc %zu failed.", mSize);
+        mGrowNum++;
+    }
+
+    mUsed = 0;
+    mFrameUsed = 0;
+}
+
+void FrameArena::freeExtraBlocks() {
+    for (auto it = mExtraBlocks.begin(); it != mExtraBlocks.end(); ++it)
+        free(*it);
+    mExtraBlocks.clear();
+}
+
+void FrameArena::dump(String8 & dumpstr) {
+    dumpstr.appendFormat("FrameArena: used %zu/%zu bytes, peak %zu, grow %u\n",
+        mUsed, mSize, mPeakUsed, mGrowNum);
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <atomic>
+#include <inttypes.h>
+#include <unistd.h>
+#include <cutils/properties.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include <HwcReactor.h>
+#include <MesonLog.h>
+
+ANDROID_SINGLETON_STATIC_INSTANCE(HwcReactor)
+
+#define REACTOR_EPOLL_EVENTS    8
+
+static std::atomic<int64_t> sClients(-1);
+
+static uint64_t getContextSwitches() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+HwcReactor::HwcReactor() {
+    mThreadStarted = false;
+    mExit = false;
+    mEpollFd = mWakeFd = mTimerFd = -1;
+    mTimerDue = 0;
+    mCallee = NULL;
+    mWakeups = mEventDispatches = 0;
+    mLastSwitches = getContextSwitches();
+    mLastDumpTime = systemTime(CLOCK_MONOTONIC);
+}
+
+HwcReactor::~HwcReactor() {
+    if (mThreadStarted) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mExit = true;
+        }
+        uint64_t val = 1;
+        write(mWakeFd, &val, sizeof(val));
+        pthread_join(mThread, NULL);
+    }
+
+    if (mEpollFd >= 0)
+        close(mEpollFd);
+    if (mWakeFd >= 0)
+        close(mWakeFd);
+    if (mTimerFd >= 0)
+        close(mTimerFd);
+}
+
+bool HwcReactor::isEnabled(uint32_t client) {
+    int64_t clients = sClients;
+    if (clients < 0) {
+        clients = (uint32_t)property_get_int32(REACTOR_CLIENTS_PROP, 0);
+        sClients = clients;
+    }
+    return client != 0 && (clients & client) == client;
+}
+
+void HwcReactor::setEnabledClients(uint32_t clients) {
+    sClients = clients;
+}
+
+/*called with lock held.*/
+int32_t HwcReactor::startThread() {
+    if (mThreadStarted)
+        return 0;
+
+    if (mEpollFd < 0) {
+        mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (mEpollFd < 0 || mWakeFd < 0 || mTimerFd < 0) {
+            MESON_LOGE("reactor create fds failed (%d)", errno);
+            return -ENODEV;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = mWakeFd;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &ev) != 0) {
+            MESON_LOGE("reactor add wake fd failed (%d)", errno);
+            return -ENODEV;
+        }
+        ev.data.fd = mTimerFd;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mTimerFd, &ev) != 0) {
+            MESON_LOGE("reactor add timer fd failed (%d)", errno);
+            return -ENODEV;
+        }
+    }
+
+    int ret = pthread_create(&mThread, NULL, HwcReactor::threadMain, (void *)this);
+    if (ret) {
+        MESON_LOGE("failed to start reactor: %s", strerror(ret));
+        return -ret;
+    }
+    mThreadStarted = true;
+    return 0;
+}
+
+bool HwcReactor::isReactorThread() {
+    return mThreadStarted && pthread_equal(pthread_self(), mThread);
+}
+
+/*called with lock held, handlers may not run on the reactor thread.*/
+void HwcReactor::waitCallback(std::unique_lock<std::mutex> & lock, const void * callee) {
+    if (isReactorThread())
+        return;
+    while (mCallee == callee)
+        mCallbackCond.wait(lock);
+}
+
+int32_t HwcReactor::addFd(int fd, uint32_t events, ReactorHandler * handler) {
+    if (fd < 0 || !handler)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    int32_t ret = startThread();
+    if (ret != 0)
+        return ret;
+
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    /*fd number of a closed fd may come back.*/
+    int op = mFds.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(mEpollFd, op, fd, &ev) != 0 &&
+        (op == EPOLL_CTL_ADD || epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) != 0)) {
+        ret = -errno;
+        MESON_LOGE("reactor add fd %d failed (%d)", fd, ret);
+        return ret;
+    }
+
+    FdEntry & entry = mFds[fd];
+    entry.events = events;
+    entry.handler = handler;
+    entry.dispatches = 0;
+    return 0;
+}
+
+int32_t HwcReactor::removeFd(int fd) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto it = mFds.find(fd);
+    if (it == mFds.end())
+        return -ENOENT;
+
+    ReactorHandler * handler = it->second.handler;
+    /*fd may be closed already, it is out of epoll then.*/
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, NULL);
+    mFds.erase(it);
+    waitCallback(lock, handler);
+    return 0;
+}
+
+/*called with lock held.*/
+void HwcReactor::armTimer(nsecs_t dueTime) {
+    if (dueTime == mTimerDue)
+        return;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (dueTime > 0) {
+        spec.it_value.tv_sec = dueTime / 1000000000;
+        spec.it_value.tv_nsec = dueTime % 1000000000;
+    }
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+        MESON_LOGE("reactor arm timer failed (%d)", errno);
+        return;
+    }
+    mTimerDue = dueTime;
+}
+
+void HwcReactor::sendEvent(EventHandler * handler, int what, nsecs_t dueTime) {
+    MESON_ASSERT(handler, "reactor event need a handler.");
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (startThread() != 0)
+        return;
+
+    if (!mEvents.push(handler, what, dueTime))
+        return;
+
+    if (dueTime == 0) {
+        uint64_t val = 1;
+        write(mWakeFd, &val, sizeof(val));
+    } else {
+        /*new first event, arm from here and let reactor sleep on.*/
+        armTimer(dueTime);
+    }
+}
+
+void HwcReactor::removeEvent(EventHandler * handler, int what) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEvents.remove(handler, what);
+    /*a timer left to a removed event only gives a spurious wakeup.*/
+}
+
+void HwcReactor::removeHandler(EventHandler * handler) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mEvents.removeHandler(handler);
+    waitCallback(lock, handler);
+}
+
+void HwcReactor::dispatchFd(int fd, uint32_t events) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto it = mFds.find(fd);
+    if (it == mFds.end())
+        return;
+
+    ReactorHandler * handler = it->second.handler;
+    it->second.dispatches++;
+    mCallee = handler;
+    lock.unlock();
+    handler->handleFd(fd, events);
+    lock.lock();
+    mCallee = NULL;
+    mCallbackCond.notify_all();
+}
+
+void HwcReactor::dispatchEvents() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    nsecs_t now = systemTime(CLOCK_MONOTONIC);
+    EventQueue::Event event;
+    while (mEvents.popDue(now, event)) {
+        mEventDispatches++;
+
+        /*handle without lock, handler may send new events.*/
+        mCallee = event.handler;
+        lock.unlock();
+        event.handler->handleEvent(event.what);
+        lock.lock();
+        mCallee = NULL;
+        mCallbackCond.notify_all();
+
+        /*handlers take time, later events may be due now.*/
+        if (!mEvents.empty() && mEvents.firstDueTime() > now)
+            now = systemTime(CLOCK_MONOTONIC);
+    }
+
+    armTimer(mEvents.empty() ? 0 : mEvents.firstDueTime());
+}
+
+void * HwcReactor::threadMain(void * data) {
+    MESON_ASSERT(data, "HwcReactor data should not be NULL.");
+    HwcReactor * pThis = (HwcReactor *) data;
+    pThis->threadLoop();
+    return NULL;
+}
+
+void HwcReactor::threadLoop() {
+    struct epoll_event events[REACTOR_EPOLL_EVENTS];
+    while (true) {
+        int num = epoll_wait(mEpollFd, events, REACTOR_EPOLL_EVENTS, -1);
+        if (num < 0) {
+            if (errno == EINTR)
+                continue;
+            MESON_LOGE("reactor epoll_wait failed (%d)", errno);
+            break;
+        }
+
+        bool timerFired = false;
+        for (int i = 0; i < num; i++) {
+            int fd = events[i].data.fd;
+            uint64_t val;
+            if (fd == mWakeFd) {
+                read(mWakeFd, &val, sizeof(val));
+            } else if (fd == mTimerFd) {
+                read(mTimerFd, &val, sizeof(val));
+                timerFired = true;
+            } else {
+                dispatchFd(fd, events[i].events);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWakeups++;
+            if (mExit)
+                break;
+            /*fired timer is disarmed.*/
+            if (timerFired)
+                mTimerDue = 0;
+        }
+        dispatchEvents();
+    }
+}
+
+void HwcReactor::dump(String8 & dumpstr) {
+    uint64_t switches = getContextSwitches();
+    nsecs_t now = systemTime(CLOCK_MONOTONIC);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    double seconds = (now - mLastDumpTime) / 1e9;
+    dumpstr.appendFormat("Reactor: clients 0x%" PRIx64 ", %s, %" PRIu64 " wakeups, %" PRIu64
+        " events, %zu pending, %" PRIu64 " coalesced\n", (int64_t)sClients,
+        mThreadStarted ? "running" : "not started", mWakeups, mEventDispatches,
+        mEvents.size(), mEvents.getCoalesced());
+    for (auto it = mFds.begin(); it != mFds.end(); ++it)
+        dumpstr.appendFormat("    fd %d: events 0x%x, %" PRIu64 " dispatches\n",
+            it->first, it->second.events, it->second.dispatches);
+    dumpstr.appendFormat("    process context switches: %.1f/s since last dump\n",
+        seconds > 0 ? (switches - mLastSwitches) / seconds : 0.0);
+    mLastSwitches = switches;
+    mLastDumpTime = now;
+}
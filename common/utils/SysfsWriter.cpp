@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <HwcReactor.h>
+#include <MesonLog.h>
+#include <SysfsWriter.h>
+
+ANDROID_SINGLETON_STATIC_INSTANCE(SysfsWriter)
+
+#define SYSFS_WRITE_EVENT (1)
+#define SYSFS_QUEUE_RESERVED (8)
+#define SYSFS_READ_LEN (64)
+
+SysfsWriter::SysfsWriter() {
+    mFiles.reserve(SYSFS_WRITER_FILES);
+    mQueue.reserve(SYSFS_QUEUE_RESERVED);
+    mPosting.reserve(SYSFS_QUEUE_RESERVED);
+    mSeq = 0;
+    mBusy = false;
+
+    mIssued = mSuppressed = mFailed = mUncached = 0;
+    mForced = mForcedMatched = 0;
+    mAsyncQueued = mAsyncReplaced = 0;
+    mWriteTime = mMaxWriteTime = 0;
+}
+
+SysfsWriter::~SysfsWriter() {
+    /*pending async writes are dropped.*/
+    mThread.reset();
+    for (auto it = mFiles.begin(); it != mFiles.end(); ++it) {
+        if ((*it)->fd >= 0)
+            close((*it)->fd);
+    }
+    mFiles.clear();
+}
+
+SysfsWriter::File * SysfsWriter::getFile(const char * path) {
+    for (auto it = mFiles.begin(); it != mFiles.end(); ++it) {
+        if ((*it)->path == path)
+            return it->get();
+    }
+
+    if (mFiles.size() >= SYSFS_WRITER_FILES)
+        return NULL;
+
+    std::unique_ptr<File> file(new File());
+    file->path = path;
+    file->fd = -1;
+    file->readable = false;
+    file->valid = false;
+    file->writtenSeq = 0;
+    mFiles.push_back(std::move(file));
+    return mFiles.back().get();
+}
+
+int32_t SysfsWriter::writeFile(File * file, const char * val, uint64_t seq, bool force) {
+    /*a newer value of the node is already written.*/
+    if (seq < file->writtenSeq) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mAsyncReplaced++;
+        return 0;
+    }
+    file->writtenSeq = seq;
+
+    if (!force && file->valid && file->value == val) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSuppressed++;
+        return 0;
+    }
+
+    nsecs_t begin = systemTime(CLOCK_MONOTONIC);
+    int32_t ret = 0;
+    if (file->fd < 0) {
+        file->fd = open(file->path.c_str(), O_RDWR | O_CLOEXEC);
+        file->readable = file->fd >= 0;
+        if (file->fd < 0)
+            file->fd = open(file->path.c_str(), O_WRONLY | O_CLOEXEC);
+    }
+
+    /*others may have changed the node, compare with what it holds now.*/
+    if (force && file->fd >= 0 && nodeHolds(file, val)) {
+        file->value = val;
+        file->valid = true;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mForced++;
+        mForcedMatched++;
+        mSuppressed++;
+        return 0;
+    }
+
+    if (file->fd < 0) {
+        ret = -errno;
+    } else if (pwrite(file->fd, val, strlen(val), 0) < 0) {
+        ret = -errno;
+        /*node may be gone with its driver, reopen next time.*/
+        close(file->fd);
+        file->fd = -1;
+    }
+    nsecs_t elapsed = systemTime(CLOCK_MONOTONIC) - begin;
+
+    if (ret == 0) {
+        file->value = val;
+        file->valid = true;
+    } else {
+        file->valid = false;
+        MESON_LOGE("write %s to %s failed (%d)", val, file->path.c_str(), ret);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIssued++;
+    if (force)
+        mForced++;
+    if (ret != 0)
+        mFailed++;
+    mWriteTime += elapsed;
+    if (elapsed > mMaxWriteTime)
+        mMaxWriteTime = elapsed;
+    return ret;
+}
+
+bool SysfsWriter::nodeHolds(File * file, const char * val) {
+    if (!file->readable)
+        return false;
+
+    char buf[SYSFS_READ_LEN];
+    ssize_t len = pread(file->fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return false;
+    while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == ' '))
+        len--;
+
+    /*nodes showing another format than written never match.*/
+    size_t valLen = strlen(val);
+    return (size_t)len == valLen && memcmp(buf, val, valLen) == 0;
+}
+
+int32_t SysfsWriter::writeUncached(const char * path, const char * val) {
+    nsecs_t begin = systemTime(CLOCK_MONOTONIC);
+    int32_t ret = 0;
+    int32_t fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ret = -errno;
+    } else {
+        if (::write(fd, val, strlen(val)) < 0)
+            ret = -errno;
+        close(fd);
+    }
+    nsecs_t elapsed = systemTime(CLOCK_MONOTONIC) - begin;
+    if (ret != 0)
+        MESON_LOGE("write %s to %s failed (%d)", val, path, ret);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIssued++;
+    mUncached++;
+    if (ret != 0)
+        mFailed++;
+    mWriteTime += elapsed;
+    if (elapsed > mMaxWriteTime)
+        mMaxWriteTime = elapsed;
+    return ret;
+}
+
+int32_t SysfsWriter::write(const char * path, const char * val, bool force) {
+    File * file;
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        file = getFile(path);
+        seq = ++mSeq;
+        /*pending async write of the node is older, drop it.*/
+        for (auto it = mQueue.begin(); file && it != mQueue.end();) {
+            if (it->file == file) {
+                it = mQueue.erase(it);
+                mAsyncReplaced++;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (!file)
+        return writeUncached(path, val);
+
+    std::lock_guard<std::mutex> fileLock(file->lock);
+    return writeFile(file, val, seq, force);
+}
+
+void SysfsWriter::writeAsync(const char * path, const char * val) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    File * file = getFile(path);
+    if (!file) {
+        lock.unlock();
+        writeUncached(path, val);
+        return;
+    }
+
+    for (auto it = mQueue.begin(); it != mQueue.end(); ++it) {
+        if (it->file == file) {
+            it->value = val;
+            it->seq = ++mSeq;
+            mAsyncReplaced++;
+            return;
+        }
+    }
+
+    /*skip waking writer thread for unchanged value, unless it is writing the node.*/
+    if (file->lock.try_lock()) {
+        bool unchanged = file->valid && file->value == val;
+        file->lock.unlock();
+        if (unchanged) {
+            mSuppressed++;
+            return;
+        }
+    }
+
+    Request request = {file, val, ++mSeq};
+    mQueue.push_back(request);
+    mAsyncQueued++;
+
+    if (!mThread) {
+        mThread = std::make_shared<EventThread>("hwc-sysfs", REACTOR_CLIENT_SYSFS);
+        mThread->setHandler(this);
+        mThread->start();
+    }
+    lock.unlock();
+    mThread->sendEvent(SYSFS_WRITE_EVENT);
+}
+
+void SysfsWriter::flush() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mQueue.empty() || mBusy)
+        mIdleCond.wait(lock);
+}
+
+void SysfsWriter::handleEvent(int what) {
+    if (what == SYSFS_WRITE_EVENT)
+        processQueue();
+}
+
+void SysfsWriter::processQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mQueue.empty())
+            return;
+        mPosting.swap(mQueue);
+        mBusy = true;
+    }
+
+    for (auto it = mPosting.begin(); it != mPosting.end(); ++it) {
+        std::lock_guard<std::mutex> fileLock(it->file->lock);
+        writeFile(it->file, it->value.c_str(), it->seq, false);
+    }
+    mPosting.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBusy = false;
+    }
+    mIdleCond.notify_all();
+}
+
+void SysfsWriter::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    nsecs_t avgWriteTime = mIssued > 0 ? mWriteTime / (nsecs_t)mIssued : 0;
+    dumpstr.appendFormat("Sysfs writes: %" PRIu64 " issued (%" PRIu64 " failed, %" PRIu64
+        " uncached), %" PRIu64 " suppressed, async %" PRIu64 " queued %" PRIu64 " replaced\n",
+        mIssued, mFailed, mUncached, mSuppressed, mAsyncQueued, mAsyncReplaced);
+    dumpstr.appendFormat("    forced %" PRIu64 " (%" PRIu64 " skipped, node held the value)\n",
+        mForced, mForcedMatched);
+    dumpstr.appendFormat("    %zu files, write time %" PRId64 " us (avg %" PRId64
+        " us, max %" PRId64 " us)\n",
+        mFiles.size(), mWriteTime / 1000, avgWriteTime / 1000, mMaxWriteTime / 1000);
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Count heap allocations of hwc code, enabled by HWC_ENABLE_ALLOC_STAT.
+ *     Operator new is counted per thread for hwc code only, allocations of
+ *     libutils (String8, SharedBuffer) and other libs are seen only in the
+ *     process wide heap usage from mallinfo.
+ */
+
+#ifndef ALLOC_STAT_H
+#define ALLOC_STAT_H
+
+#include <stdint.h>
+
+typedef struct alloc_stat {
+    uint64_t count;
+    uint64_t bytes;
+    int64_t heapInUse;      /*malloc bytes in use by all threads and libs.*/
+} alloc_stat_t;
+
+/*
+ * Allocations by operator new of hwc code on calling thread since it
+ * started, and heap in use of the process. Return false and zero stat
+ * if not built in.
+ */
+bool alloc_stat_get(alloc_stat_t * stat);
+
+#endif/*ALLOC_STAT_H*/
@@ -10,18 +10,29 @@
 #ifndef BITS_MAP_H
 #define BITS_MAP_H
 
+#include <stdint.h>
+#include <vector>
+
+/*bits in 64bit words, zero bit is found by count trailing zeros.*/
 class BitsMap {
 public:
     BitsMap(int bits = 4096);
     ~BitsMap();
 
+    /*lowest zero bit, or -1 when all bits are set.*/
     int getZeroBit();
     int setBit(int idx);
     int clearBit(int idx);
 
+    /*grow to bits, new bits are zero.*/
+    int resize(int bits);
+    int size() { return mBitNum; }
+
 protected:
-    char *mBits;
-    int mLen;
+    std::vector<uint64_t> mWords;
+    int mBitNum;
+    /*words before it have no zero bit.*/
+    int mZeroHint;
 };
 
 
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     System property read from memory, looked up again only when the
+ *     property area serial shows something changed.
+ */
+
+#ifndef CACHED_PROPERTY_H
+#define CACHED_PROPERTY_H
+
+#include <BasicTypes.h>
+#include <misc.h>
+
+struct prop_info;
+
+/*
+ * Declare as static where a property is polled on frame path:
+ *     static CachedProperty sLcdExist("sys.lcd.exist");
+ */
+class CachedProperty {
+public:
+    CachedProperty(const char * name);
+    ~CachedProperty();
+
+    /*same as sys_get_bool_prop.*/
+    bool getBool(bool defVal);
+    int32_t getInt(int32_t defVal);
+    /*same as sys_get_string_prop, val holds PROP_VALUE_LEN_MAX.*/
+    int32_t getString(char * val);
+
+    static void dumpStats(String8 & dumpstr);
+
+protected:
+    /*called with mMutex held.*/
+    void refresh();
+
+protected:
+    const char * mName;
+    std::mutex mMutex;
+    const prop_info * mInfo;    /*NULL until the property is set.*/
+    uint32_t mAreaSerial;
+    uint32_t mSerial;
+    bool mValid;
+    char mValue[PROP_VALUE_LEN_MAX];
+};
+
+#endif/*CACHED_PROPERTY_H*/
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Pending events in a min-heap of due times, shared by EventThread
+ *     and HwcReactor. Not locked, owner locks it.
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <vector>
+
+#include <BasicTypes.h>
+
+class EventHandler;
+
+class EventQueue {
+public:
+    struct Event {
+        EventHandler * handler;
+        int what;
+        nsecs_t dueTime;        /*0 for now.*/
+        uint64_t seq;           /*same due time keeps send order.*/
+    };
+
+    EventQueue();
+    ~EventQueue();
+
+    /*
+     * one pending event per handler and what, a duplicate only moves it
+     * earlier. Return true if it is the first event now.
+     */
+    bool push(EventHandler * handler, int what, nsecs_t dueTime);
+    void remove(EventHandler * handler, int what);
+    void removeHandler(EventHandler * handler);
+
+    bool empty() { return mHeap.empty(); }
+    size_t size() { return mHeap.size(); }
+    /*due time of the first event, only valid if not empty.*/
+    nsecs_t firstDueTime() { return mHeap.front().dueTime; }
+    /*take first event if it is due at now.*/
+    bool popDue(nsecs_t now, Event & event);
+
+    uint64_t getCoalesced() { return mCoalesced; }
+
+protected:
+    /*min-heap with std heap functions.*/
+    static bool later(const Event & a, const Event & b);
+
+protected:
+    std::vector<Event> mHeap;
+    uint64_t mSeq;
+    uint64_t mCoalesced;
+};
+
+#endif/*EVENT_QUEUE_H*/
@@ -11,10 +11,9 @@
 #define EVENT_THREAD_H
 
 #include <mutex>
-#include <condition_variable>
-#include <queue>
 #include <pthread.h>
 #include <BasicTypes.h>
+#include <EventQueue.h>
 
 class EventHandler{
 public:
@@ -22,9 +21,15 @@ public:
     virtual void handleEvent(int what) = 0;
 };
 
+/*
+ * Events are handled on the thread out of lock, in due time order.
+ * A pending event of the same what is not queued again, it is only
+ * moved earlier. Delayed events wait on a monotonic timerfd.
+ */
 class EventThread {
 public:
-    EventThread(const char * name);
+    /*events run on HwcReactor if reactorClient is enabled, no own thread then.*/
+    EventThread(const char * name, uint32_t reactorClient = 0);
     ~EventThread();
 
 public:
@@ -38,21 +43,25 @@ public:
 protected:
     static void * threadMain(void * data);
 
-    void processEvents();
+    void threadLoop();
+    /*called with lock held.*/
+    void queueEvent(int what, nsecs_t dueTime);
+    void armTimer(nsecs_t dueTime);
+    void waitEvents(std::unique_lock<std::mutex> & eventLock);
 
 protected:
-        struct EventPack {
-            int what;
-            nsecs_t dueTime;
-        };
-
         pthread_t mEventThread;
 
-        std::vector<EventPack> mEvents;
+        EventQueue mEvents;
         std::mutex mEventMutex;
-        std::condition_variable mEventCond;
+        int mTimerFd;
+        int mWakeFd;
+        nsecs_t mTimerDue;      /*time timer is armed to, 0 if not armed.*/
+        bool mWaiting;          /*thread sleeps in poll, new first event wakes it.*/
 
         EventHandler * mHandler;
+        bool mReactor;
+        bool mStarted;
         bool mExit;
         char * mName;
 };
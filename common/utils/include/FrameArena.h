@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Bump allocator for containers rebuilt every frame.
+ */
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <BasicTypes.h>
+
+#define FRAME_ARENA_DEFAULT_SIZE (4 * 1024)
+
+/*
+ * Memory is only given back by reset(), which must be called when nothing
+ * allocated from the arena is alive (containers cleared). If a frame runs out
+ * of the block, extra blocks are taken from heap and merged into one bigger
+ * block at next reset, so steady state frames never touch heap.
+ */
+class FrameArena {
+public:
+    FrameArena(size_t size = FRAME_ARENA_DEFAULT_SIZE);
+    ~FrameArena();
+
+    void * alloc(size_t size, size_t align);
+    void reset();
+
+    size_t getUsedSize() { return mUsed; }
+    size_t getBlockSize() { return mSize; }
+    uint32_t getGrowNum() { return mGrowNum; }
+
+    void dump(String8 & dumpstr);
+
+protected:
+    void freeExtraBlocks();
+
+protected:
+    uint8_t * mBlock;
+    size_t mSize;
+    size_t mUsed;
+
+    /*frame usage including extra blocks, the size of next block.*/
+    size_t mFrameUsed;
+    size_t mPeakUsed;
+    std::vector<void *> mExtraBlocks;
+    uint32_t mGrowNum;
+};
+
+/*stl allocator on FrameArena, deallocate does nothing.*/
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator(FrameArena * arena) : mArena(arena) { }
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> & other) : mArena(other.mArena) { }
+
+    T * allocate(size_t n) {
+        return (T *)mArena->alloc(n * sizeof(T), alignof(T));
+    }
+    void deallocate(T * p __attribute__((unused)), size_t n __attribute__((unused))) { }
+
+    template <class U>
+    struct rebind { typedef ArenaAllocator<U> other; };
+
+    template <class U>
+    bool operator == (const ArenaAllocator<U> & other) const {
+        return mArena == other.mArena;
+    }
+    template <class U>
+    bool operator != (const ArenaAllocator<U> & other) const {
+        return mArena != other.mArena;
+    }
+
+    FrameArena * mArena;
+};
+
+#endif/*FRAME_ARENA_H*/
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     One epoll thread shared by fd watchers and timed events, instead of
+ *     a mostly idle thread for each of them.
+ */
+
+#ifndef HWC_REACTOR_H
+#define HWC_REACTOR_H
+
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include <BasicTypes.h>
+#include <EventQueue.h>
+#include <EventThread.h>
+
+/*bitmask of reactor clients, clients not in it keep their own thread.*/
+#define REACTOR_CLIENTS_PROP    "vendor.hwc.reactor"
+
+typedef enum {
+    REACTOR_CLIENT_UEVENT = 1 << 0,     /*display uevent listener.*/
+    REACTOR_CLIENT_VSYNC = 1 << 1,      /*software and predicted vsync.*/
+    REACTOR_CLIENT_IDLE = 1 << 2,       /*display idle timer.*/
+    REACTOR_CLIENT_SYSFS = 1 << 3,      /*async sysfs writes.*/
+} reactor_client_t;
+
+/*called on reactor thread, should not block.*/
+class ReactorHandler {
+public:
+    virtual ~ReactorHandler() { }
+    virtual void handleFd(int fd, uint32_t events) = 0;
+};
+
+class HwcReactor : public Singleton<HwcReactor> {
+public:
+    HwcReactor();
+    ~HwcReactor();
+
+    /*client opted in by REACTOR_CLIENTS_PROP, read once.*/
+    static bool isEnabled(uint32_t client);
+    /*for test and debug, overrides the property.*/
+    static void setEnabledClients(uint32_t clients);
+
+    /*events are EPOLLIN/EPOLLPRI..., fd stays owned by caller.*/
+    int32_t addFd(int fd, uint32_t events, ReactorHandler * handler);
+    /*fd not dispatched after return, running callback of it is waited.*/
+    int32_t removeFd(int fd);
+
+    /*handleEvent(what) on reactor thread at dueTime, 0 for now.*/
+    void sendEvent(EventHandler * handler, int what, nsecs_t dueTime = 0);
+    void removeEvent(EventHandler * handler, int what);
+    /*drop all events of handler, running callback of it is waited.*/
+    void removeHandler(EventHandler * handler);
+
+    bool isReactorThread();
+    void dump(String8 & dumpstr);
+
+protected:
+    struct FdEntry {
+        uint32_t events;
+        ReactorHandler * handler;
+        uint64_t dispatches;
+    };
+
+    /*called with lock held.*/
+    int32_t startThread();
+    void armTimer(nsecs_t dueTime);
+    void waitCallback(std::unique_lock<std::mutex> & lock, const void * callee);
+
+    void dispatchFd(int fd, uint32_t events);
+    void dispatchEvents();
+
+    static void * threadMain(void * data);
+    void threadLoop();
+
+protected:
+    std::mutex mMutex;
+    std::condition_variable mCallbackCond;
+    pthread_t mThread;
+    bool mThreadStarted;
+    bool mExit;
+    int mEpollFd;
+    int mWakeFd;
+    int mTimerFd;
+    nsecs_t mTimerDue;          /*time timer is armed to, 0 if not armed.*/
+
+    std::map<int, FdEntry> mFds;
+    EventQueue mEvents;
+    const void * mCallee;       /*handler running on reactor thread.*/
+
+    /*stats.*/
+    uint64_t mWakeups;
+    uint64_t mEventDispatches;
+    uint64_t mLastSwitches;
+    nsecs_t mLastDumpTime;
+};
+
+#endif/*HWC_REACTOR_H*/
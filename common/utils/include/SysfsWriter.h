@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Sysfs writes with files kept open, unchanged values skipped and
+ *     an async queue for writes not needed by the current frame.
+ */
+
+#ifndef SYSFS_WRITER_H
+#define SYSFS_WRITER_H
+
+#include <condition_variable>
+#include <string>
+
+#include <BasicTypes.h>
+#include <EventThread.h>
+
+/*files kept open, others are opened on each write.*/
+#define SYSFS_WRITER_FILES  32
+
+class SysfsWriter : public Singleton<SysfsWriter>, public EventHandler {
+public:
+    SysfsWriter();
+    ~SysfsWriter();
+
+    /*
+     * write now, skipped if val is the last value written. Set force for
+     * nodes also written by others, the node is read back then and the
+     * write skipped only if it already holds val. Return 0 or -errno.
+     */
+    int32_t write(const char * path, const char * val, bool force = false);
+    /*write on writer thread, replaces a pending write of the same path.*/
+    void writeAsync(const char * path, const char * val);
+    /*wait until queued writes are done.*/
+    void flush();
+
+    void handleEvent(int what);
+
+    void dump(String8 & dumpstr);
+
+protected:
+    struct File {
+        std::string path;
+        int32_t fd;
+        bool readable;          /*fd is opened for read too.*/
+        std::mutex lock;        /*serialize writes of the node.*/
+        std::string value;      /*last value written, if valid.*/
+        bool valid;
+        uint64_t writtenSeq;    /*seq of the last request written.*/
+    };
+
+    struct Request {
+        File * file;
+        std::string value;
+        uint64_t seq;
+    };
+
+    /*File of path, NULL if the table is full. Called with mMutex held.*/
+    File * getFile(const char * path);
+    /*called with file->lock held.*/
+    int32_t writeFile(File * file, const char * val, uint64_t seq, bool force);
+    /*true if node holds val, node text may end with newline. Called with file->lock held.*/
+    bool nodeHolds(File * file, const char * val);
+    int32_t writeUncached(const char * path, const char * val);
+    void processQueue();
+
+protected:
+    std::mutex mMutex;
+    std::condition_variable mIdleCond;
+    std::vector<std::unique_ptr<File>> mFiles;
+    std::vector<Request> mQueue;
+    std::vector<Request> mPosting;  /*writer thread only.*/
+    uint64_t mSeq;
+    bool mBusy;
+
+    std::shared_ptr<EventThread> mThread;
+
+    /*stats, updated with mMutex held.*/
+    uint64_t mIssued;
+    uint64_t mSuppressed;
+    uint64_t mForced;
+    uint64_t mForcedMatched;    /*forced writes skipped, node held the value.*/
+    uint64_t mFailed;
+    uint64_t mUncached;
+    uint64_t mAsyncQueued;
+    uint64_t mAsyncReplaced;
+    nsecs_t mWriteTime;
+    nsecs_t mMaxWriteTime;
+};
+
+#endif/*SYSFS_WRITER_H*/
@@ -33,5 +33,8 @@ int32_t gralloc_unref_dma_buf(native_handle_t * hnd);
 int32_t gralloc_lock_dma_buf(native_handle_t * handle, void** vaddr);
 int32_t gralloc_unlock_dma_buf(native_handle_t * handle);
 
+/*unique id of the buffer allocation, 0 if handle is not from gralloc.*/
+uint64_t gralloc_get_buffer_id(const native_handle_t * hnd);
+
 
 #endif/*MISC_H*/
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <cutils/properties.h>
 #include <am_gralloc_ext.h>
+#include <gralloc_priv.h>
 
 #if PLATFORM_SDK_VERSION >= 28
 #include <ui/Rect.h>
@@ -273,3 +274,11 @@ int32_t gralloc_unlock_dma_buf(native_handle_t * handle) {
 }
 
 #endif
+
+uint64_t gralloc_get_buffer_id(const native_handle_t * hnd) {
+    /*set by gralloc at allocation, every import of the buffer carries it.*/
+    private_handle_t const* buf = private_handle_t::dynamicCast(hnd);
+    if (!buf)
+        return 0;
+    return buf->backing_store_id;
+}
@@ -25,12 +25,17 @@ LOCAL_CFLAGS := $(HWC_C_FLAGS)
 
 LOCAL_SRC_FILES := \
     Composition.cpp \
+    CompositionHelper.cpp \
+    BandwidthModel.cpp \
     CompositionStrategyFactory.cpp \
     composer/ComposerFactory.cpp \
     composer/ClientComposer.cpp \
     composer/DummyComposer.cpp \
+    composer/CpuBlend.cpp \
+    composer/CpuComposer.cpp \
     simplestrategy/SingleplaneComposition/SingleplaneComposition.cpp \
-    simplestrategy/MultiplanesComposition/MultiplanesComposition.cpp
+    simplestrategy/MultiplanesComposition/MultiplanesComposition.cpp \
+    optimalstrategy/CostModelComposition/CostModelComposition.cpp
 
 ifeq ($(TARGET_SUPPORT_GE2D_COMPOSITION),true)
 LOCAL_SRC_FILES += \
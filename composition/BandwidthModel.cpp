@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+#include <BandwidthModel.h>
+#include <MesonLog.h>
+#include <misc.h>
+
+#define DDR_BUDGET_PROP "vendor.hwc.ddr-budget"
+#define DEFAULT_REFRESH_RATE (60.0f)
+
+/*afbc saves about half of the data, plus 16 bytes header per 16x16 block.*/
+#define AFBC_RATIO_NUM  1
+#define AFBC_RATIO_DEN  2
+#define AFBC_BLOCK_PIXELS  256
+#define AFBC_HEADER_BYTES  16
+
+static inline int32_t rectWidth(drm_rect_t & rect) {
+    return rect.right - rect.left;
+}
+
+static inline int32_t rectHeight(drm_rect_t & rect) {
+    return rect.bottom - rect.top;
+}
+
+/*bits per pixel of format.*/
+static uint32_t formatBits(int format) {
+    switch (format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            return 32;
+        case HAL_PIXEL_FORMAT_RGB_888:
+            return 24;
+        case HAL_PIXEL_FORMAT_RGB_565:
+        case HAL_PIXEL_FORMAT_YCBCR_422_SP:
+            return 16;
+        case HAL_PIXEL_FORMAT_YCRCB_420_SP:
+        case HAL_PIXEL_FORMAT_YV12:
+            return 12;
+        default:
+            return 32;
+    }
+}
+
+BandwidthModel::BandwidthModel() {
+    char val[PROP_VALUE_LEN_MAX];
+    mRefreshRate = DEFAULT_REFRESH_RATE;
+#ifdef HWC_DDR_BANDWIDTH_BUDGET
+    mBudget = HWC_DDR_BANDWIDTH_BUDGET;
+#else
+    mBudget = 0;
+#endif
+    if (sys_get_string_prop(DDR_BUDGET_PROP, val) > 0)
+        mBudget = atoi(val);
+}
+
+BandwidthModel::~BandwidthModel() {
+}
+
+void BandwidthModel::setRefreshRate(float refreshRate) {
+    mRefreshRate = refreshRate > 0 ? refreshRate : DEFAULT_REFRESH_RATE;
+}
+
+uint64_t BandwidthModel::estimateFbBytes(
+    std::shared_ptr<DrmFramebuffer> & fb) {
+    int32_t srcW = rectWidth(fb->mSourceCrop);
+    int32_t srcH = rectHeight(fb->mSourceCrop);
+    int32_t dstH = rectHeight(fb->mDisplayFrame);
+    uint32_t bits = 32;
+    bool afbc = false;
+
+    switch (fb->mFbType) {
+        case DRM_FB_SCANOUT:
+        case DRM_FB_CURSOR:
+        case DRM_FB_RENDER:
+            if (fb->mBufferHandle) {
+                bits = formatBits(fb->mBufferInfo.format);
+                afbc = fb->mBufferInfo.afbcMask != 0;
+            }
+            break;
+        case DRM_FB_UNDEFINED:
+        case DRM_FB_COLOR:
+            return 0;
+        default:
+            /*video: decoder output is not visible here, take nv21 at crop or frame size.*/
+            bits = 12;
+            if (srcW <= 0 || srcH <= 0) {
+                srcW = rectWidth(fb->mDisplayFrame);
+                srcH = dstH;
+            }
+            break;
+    }
+
+    if (srcW <= 0 || srcH <= 0)
+        return 0;
+
+    uint64_t pixels = (uint64_t)srcW * srcH;
+    uint64_t bytes = pixels * bits / 8;
+    if (afbc) {
+        bytes = bytes * AFBC_RATIO_NUM / AFBC_RATIO_DEN +
+            pixels / AFBC_BLOCK_PIXELS * AFBC_HEADER_BYTES;
+    }
+    if (dstH > 0 && dstH < srcH)
+        bytes = bytes * srcH / dstH;
+
+    return bytes;
+}
+
+uint64_t BandwidthModel::estimateTargetBytes(drm_rect_t & frame) {
+    int32_t w = rectWidth(frame);
+    int32_t h = rectHeight(frame);
+    if (w <= 0 || h <= 0)
+        return 0;
+    /*client target is rgba8888.*/
+    return (uint64_t)w * h * 4;
+}
+
+uint32_t BandwidthModel::toBandwidth(uint64_t frameBytes) {
+    return (uint32_t)(frameBytes * mRefreshRate / (1024 * 1024));
+}
+
+bool BandwidthModel::exceedBudget(uint64_t frameBytes) {
+    if (mBudget == 0)
+        return false;
+    return toBandwidth(frameBytes) > mBudget;
+}
+
+void BandwidthModel::dump(String8 & dumpstr, uint64_t frameBytes) {
+    dumpstr.appendFormat("DDR Bandwidth (%llu KB/frame, %u MB/s @%.2fHz, budget %u MB/s) \n",
+        (unsigned long long)(frameBytes / 1024), toBandwidth(frameBytes),
+        mRefreshRate, mBudget);
+}
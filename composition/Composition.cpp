@@ -21,6 +21,7 @@ bool isVideoPlaneComposition(int meson_composition_type) {
 bool isComposerComposition(int meson_composition_type) {
     if (meson_composition_type == MESON_COMPOSITION_CLIENT
         || meson_composition_type == MESON_COMPOSITION_GE2D
+        || meson_composition_type == MESON_COMPOSITION_CPU
         || meson_composition_type == MESON_COMPOSITION_DUMMY)
         return true;
     else
@@ -43,6 +44,9 @@ const char* compositionTypeToString(
         case MESON_COMPOSITION_GE2D:
             compStr = "GE2D";
             break;
+        case MESON_COMPOSITION_CPU:
+            compStr = "CPU";
+            break;
         case MESON_COMPOSITION_PLANE_AMVIDEO:
             compStr = "AMVIDEO";
             break;
@@ -66,4 +70,15 @@ const char* compositionTypeToString(
     return compStr;
 }
 
+bool hasSurfaceDamage(hwc_region_t & damage) {
+    if (damage.numRects == 0 || damage.rects == NULL)
+        return true;
+
+    for (size_t i = 0; i < damage.numRects; i++) {
+        const hwc_rect_t & rect = damage.rects[i];
+        if (rect.right > rect.left && rect.bottom > rect.top)
+            return true;
+    }
 
+    return false;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <MesonLog.h>
+#include <CompositionHelper.h>
+
+int32_t compareFbScale(
+    drm_rect_t & aSrc,
+    drm_rect_t & aDst,
+    drm_rect_t & bSrc,
+    drm_rect_t & bDst) {
+    int32_t aDisplayWidth = aDst.right - aDst.left;
+    int32_t aDisplayHeight = aDst.bottom - aDst.top;
+    int32_t aSrcWidth = aSrc.right - aSrc.left;
+    int32_t aSrcHeight = aSrc.bottom - aSrc.top;
+    int32_t bDisplayWidth = bDst.right - bDst.left;
+    int32_t bDisplayHeight = bDst.bottom - bDst.top;
+    int32_t bSrcWidth = bSrc.right - bSrc.left;
+    int32_t bSrcHeight = bSrc.bottom - bSrc.top;
+
+    int widthCompare = aDisplayWidth*bSrcWidth - bDisplayWidth*aSrcWidth;
+    int heighCompare = aDisplayHeight *bSrcHeight - bDisplayHeight * aSrcHeight;
+    if (widthCompare == 0 && heighCompare == 0)
+        return 0;
+    else if (widthCompare > 0 && heighCompare > 0)
+        return 1;
+    else {
+        MESON_LOGW("compareFbScale failed %d ,%d, %d, %d",
+            widthCompare, heighCompare,
+            bDisplayWidth, bDisplayHeight);
+        return -1;
+    }
+}
+
+bool assignVideoPlane(std::shared_ptr<DrmFramebuffer> & fb,
+    std::shared_ptr<HwDisplayPlane> & legacyVideoPlane,
+    std::shared_ptr<HwDisplayPlane> & legacyExtVideoPlane,
+    std::shared_ptr<HwDisplayPlane> & hwcVideoPlane,
+    std::shared_ptr<HwDisplayPlane> & plane, uint32_t & din) {
+    static struct planeComp {
+        drm_fb_type_t srcFb;
+        drm_plane_type_t destPlane;
+        meson_compositon_t destComp;
+    } planeCompPairs [] = {
+        {DRM_FB_VIDEO_OVERLAY, LEGACY_VIDEO_PLANE,
+            MESON_COMPOSITION_PLANE_AMVIDEO},
+        {DRM_FB_VIDEO_OMX_PTS, LEGACY_VIDEO_PLANE,
+            MESON_COMPOSITION_PLANE_AMVIDEO},
+        {DRM_FB_VIDEO_SIDEBAND, LEGACY_VIDEO_PLANE,
+            MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND},
+        {DRM_FB_VIDEO_SIDEBAND_SECOND, LEGACY_EXT_VIDEO_PLANE,
+            MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND},
+        {DRM_FB_VIDEO_OMX_PTS_SECOND, LEGACY_EXT_VIDEO_PLANE,
+            MESON_COMPOSITION_PLANE_AMVIDEO},
+        {DRM_FB_VIDEO_OMX_V4L, HWC_VIDEO_PLANE,
+            MESON_COMPOSITION_PLANE_HWCVIDEO},
+    };
+    static int pairSize = sizeof(planeCompPairs) / sizeof(struct planeComp);
+
+    plane.reset();
+    for (int i = 0; i < pairSize; i++) {
+        if (fb->mFbType != planeCompPairs[i].srcFb)
+            continue;
+
+        meson_compositon_t destComp = planeCompPairs[i].destComp;
+        std::shared_ptr<HwDisplayPlane> * freePlane = NULL;
+        din = VIDEO_PLANE_DIN_ONE;
+        switch (planeCompPairs[i].destPlane) {
+            case LEGACY_VIDEO_PLANE:
+                freePlane = &legacyVideoPlane;
+                break;
+            case LEGACY_EXT_VIDEO_PLANE:
+                if (abs(fb->mDisplayFrame.right - fb->mDisplayFrame.left) <=
+                        PIP_VIDEO_DISPLAYFRAME_SIZE &&
+                    abs(fb->mDisplayFrame.bottom - fb->mDisplayFrame.top) <=
+                        PIP_VIDEO_DISPLAYFRAME_SIZE) {
+                    destComp = MESON_COMPOSITION_DUMMY;
+                } else {
+                    freePlane = &legacyExtVideoPlane;
+                }
+                din = VIDEO_PLANE_DIN_TWO;
+                break;
+            case HWC_VIDEO_PLANE:
+                freePlane = &hwcVideoPlane;
+                din = VIDEO_PLANE_DIN_TWO;
+                break;
+            default:
+                MESON_LOGE("Not supported dest plane: %d", planeCompPairs[i].destPlane);
+                return true;
+        }
+
+        if (freePlane != NULL) {
+            if (freePlane->get()) {
+                plane = *freePlane;
+                freePlane->reset();
+            } else {
+                MESON_LOGE("too many layers need video plane %d, discard.",
+                    planeCompPairs[i].destPlane);
+                destComp = MESON_COMPOSITION_DUMMY;
+            }
+        }
+        fb->mCompositionType = destComp;
+        return true;
+    }
+
+    return false;
+}
+
+uint32_t getVideoPresentZorder(std::shared_ptr<DrmFramebuffer> & fb,
+    std::shared_ptr<HwDisplayPlane> & plane, uint32_t presentZorder,
+    uint32_t maxOsdZorder, bool & topVideo) {
+    uint32_t type = plane->getPlaneType();
+    if (type != LEGACY_VIDEO_PLANE && type != LEGACY_EXT_VIDEO_PLANE)
+        return presentZorder;
+
+    if (fb->mZorder > maxOsdZorder && !topVideo) {
+        topVideo = true;
+        return presentZorder + TOP_VIDEO_FB_BEGIN_ZORDER;
+    }
+    return presentZorder + BOTTOM_VIDEO_FB_BEGIN_ZORDER;
+}
@@ -9,6 +9,7 @@
 #include "CompositionStrategyFactory.h"
 #include "simplestrategy/SingleplaneComposition/SingleplaneComposition.h"
 #include "simplestrategy/MultiplanesComposition/MultiplanesComposition.h"
+#include "optimalstrategy/CostModelComposition/CostModelComposition.h"
 
 #include <MesonLog.h>
 
@@ -25,6 +26,14 @@ std::shared_ptr<ICompositionStrategy> CompositionStrategyFactory::create(
        return std::make_shared<SingleplaneComposition>();
     }
 
+    if (type == COST_MODEL_STRATEGY) {
+        if (flags & MUTLI_OSD_PLANES)
+            return std::make_shared<CostModelComposition>();
+
+        /*nothing to search with one osd plane.*/
+        return std::make_shared<SingleplaneComposition>();
+    }
+
     MESON_LOGE("Strategy: (%d) not supported", type);
     return NULL;
 }
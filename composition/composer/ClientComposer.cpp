@@ -50,7 +50,9 @@ int32_t ClientComposer::getOverlyFbs(
 
 int32_t ClientComposer::setOutput(
     std::shared_ptr<DrmFramebuffer> & fb,
-    hwc_region_t damage __unused) {
+    hwc_region_t damage) {
+    if (fb.get() && hasSurfaceDamage(damage))
+        fb->mContentUpdated = true;
     mClientTarget = fb;
     return 0;
 }
@@ -12,6 +12,7 @@
 #include "ClientComposer.h"
 #include "DummyComposer.h"
 #include "Ge2dComposer.h"
+#include "CpuComposer.h"
 
 int32_t ComposerFactory::create(meson_composer_t type,
     std::shared_ptr<IComposer> & composer) {
@@ -28,6 +29,11 @@ int32_t ComposerFactory::create(meson_composer_t type,
         case MESON_GE2D_COMPOSER:
             composer = std::make_shared<Ge2dComposer>();
             break;
+#endif
+#ifdef HWC_ENABLE_CPU_COMPOSITION
+        case MESON_CPU_COMPOSER:
+            composer = std::make_shared<CpuComposer>();
+            break;
 #endif
         default:
             MESON_LOGE("Can't create Uunkown composer (%d)\n", type);
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Source over blend into premultiplied rgba8888:
+ *     src = premultiplied(src) * planeAlpha, dst = src + dst * (1 - src.a)
+ */
+
+#include <string.h>
+
+#include "CpuBlend.h"
+
+#if defined(CPU_BLEND_NEON)
+#include <arm_neon.h>
+#elif defined(CPU_BLEND_SSE2)
+#include <emmintrin.h>
+#endif
+
+#define CPU_BLEND_CHUNK (64)
+
+/*x * a / 255 with rounding, exact for 8bit values.*/
+static inline uint32_t mul255(uint32_t x, uint32_t a) {
+    uint32_t t = x * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline uint32_t blendPixel(uint32_t d, uint32_t s,
+    uint32_t mode, uint32_t pa) {
+    uint32_t sr = s & 0xff;
+    uint32_t sg = (s >> 8) & 0xff;
+    uint32_t sb = (s >> 16) & 0xff;
+    uint32_t sa = (mode == CPU_BLEND_NONE) ? 255 : (s >> 24);
+
+    if (mode == CPU_BLEND_COVERAGE) {
+        sr = mul255(sr, sa);
+        sg = mul255(sg, sa);
+        sb = mul255(sb, sa);
+    }
+    if (pa != 255) {
+        sr = mul255(sr, pa);
+        sg = mul255(sg, pa);
+        sb = mul255(sb, pa);
+        sa = mul255(sa, pa);
+    }
+
+    uint32_t ia = 255 - sa;
+    uint32_t dr = sr + mul255(d & 0xff, ia);
+    uint32_t dg = sg + mul255((d >> 8) & 0xff, ia);
+    uint32_t db = sb + mul255((d >> 16) & 0xff, ia);
+    uint32_t da = sa + mul255(d >> 24, ia);
+    /*bad premultiplied content may overflow.*/
+    dr = dr > 255 ? 255 : dr;
+    dg = dg > 255 ? 255 : dg;
+    db = db > 255 ? 255 : db;
+    return dr | (dg << 8) | (db << 16) | (da << 24);
+}
+
+static void blendRowScalar(uint32_t * dst, const uint32_t * src, int32_t w,
+    uint32_t mode, uint32_t pa) {
+    for (int32_t x = 0; x < w; x++) {
+        dst[x] = blendPixel(dst[x], src[x], mode, pa);
+    }
+}
+
+#if defined(CPU_BLEND_NEON)
+static inline uint8x8_t mul255Neon(uint8x8_t x, uint8x8_t a) {
+    uint16x8_t t = vmull_u8(x, a);
+    return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+static void blendRowSimd(uint32_t * dst, const uint32_t * src, int32_t w,
+    uint32_t mode, uint32_t pa) {
+    const uint8x8_t paVec = vdup_n_u8(pa);
+    const uint8x8_t c255 = vdup_n_u8(255);
+    int32_t x = 0;
+
+    /*8 pixels, channels deinterleaved by vld4.*/
+    for (; x + 8 <= w; x += 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)(src + x));
+        if (mode == CPU_BLEND_NONE) {
+            s.val[3] = c255;
+        } else if (mode == CPU_BLEND_COVERAGE) {
+            s.val[0] = mul255Neon(s.val[0], s.val[3]);
+            s.val[1] = mul255Neon(s.val[1], s.val[3]);
+            s.val[2] = mul255Neon(s.val[2], s.val[3]);
+        }
+        if (pa != 255) {
+            s.val[0] = mul255Neon(s.val[0], paVec);
+            s.val[1] = mul255Neon(s.val[1], paVec);
+            s.val[2] = mul255Neon(s.val[2], paVec);
+            s.val[3] = mul255Neon(s.val[3], paVec);
+        }
+
+        uint8x8x4_t d = vld4_u8((const uint8_t *)(dst + x));
+        uint8x8_t ia = vsub_u8(c255, s.val[3]);
+        d.val[0] = vqadd_u8(s.val[0], mul255Neon(d.val[0], ia));
+        d.val[1] = vqadd_u8(s.val[1], mul255Neon(d.val[1], ia));
+        d.val[2] = vqadd_u8(s.val[2], mul255Neon(d.val[2], ia));
+        d.val[3] = vqadd_u8(s.val[3], mul255Neon(d.val[3], ia));
+        vst4_u8((uint8_t *)(dst + x), d);
+    }
+
+    blendRowScalar(dst + x, src + x, w - x, mode, pa);
+}
+#elif defined(CPU_BLEND_SSE2)
+static inline __m128i mul255Sse2(__m128i x, __m128i a) {
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/*alpha of each pixel to all its 4 lanes.*/
+static inline __m128i alphaLanesSse2(__m128i x) {
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+static void blendRowSimd(uint32_t * dst, const uint32_t * src, int32_t w,
+    uint32_t mode, uint32_t pa) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+    const __m128i rgbLanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alpha255Lanes = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    const __m128i paVec = _mm_set1_epi16(pa);
+    int32_t x = 0;
+
+    /*4 pixels, 2 pixels in each 16bit lanes register.*/
+    for (; x + 4 <= w; x += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+        if (mode == CPU_BLEND_NONE)
+            s = _mm_or_si128(s, alphaMask);
+
+        /*transparent pixels, nothing to blend.*/
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(s, zero)) == 0xffff)
+            continue;
+        /*opaque pixels, just copy.*/
+        if (pa == 255 && _mm_movemask_epi8(
+            _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask)) == 0xffff) {
+            _mm_storeu_si128((__m128i *)(dst + x), s);
+            continue;
+        }
+
+        __m128i sLo = _mm_unpacklo_epi8(s, zero);
+        __m128i sHi = _mm_unpackhi_epi8(s, zero);
+        if (mode == CPU_BLEND_COVERAGE) {
+            __m128i aLo = _mm_or_si128(
+                _mm_and_si128(alphaLanesSse2(sLo), rgbLanes), alpha255Lanes);
+            __m128i aHi = _mm_or_si128(
+                _mm_and_si128(alphaLanesSse2(sHi), rgbLanes), alpha255Lanes);
+            sLo = mul255Sse2(sLo, aLo);
+            sHi = mul255Sse2(sHi, aHi);
+        }
+        if (pa != 255) {
+            sLo = mul255Sse2(sLo, paVec);
+            sHi = mul255Sse2(sHi, paVec);
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + x));
+        __m128i dLo = mul255Sse2(_mm_unpacklo_epi8(d, zero),
+            _mm_sub_epi16(c255, alphaLanesSse2(sLo)));
+        __m128i dHi = mul255Sse2(_mm_unpackhi_epi8(d, zero),
+            _mm_sub_epi16(c255, alphaLanesSse2(sHi)));
+        d = _mm_adds_epu8(_mm_packus_epi16(sLo, sHi), _mm_packus_epi16(dLo, dHi));
+        _mm_storeu_si128((__m128i *)(dst + x), d);
+    }
+
+    blendRowScalar(dst + x, src + x, w - x, mode, pa);
+}
+#endif
+
+static inline void blendRow(uint32_t * dst, const uint32_t * src, int32_t w,
+    uint32_t mode, uint32_t pa, bool forceScalar) {
+#if defined(CPU_BLEND_NEON) || defined(CPU_BLEND_SSE2)
+    if (!forceScalar) {
+        blendRowSimd(dst, src, w, mode, pa);
+        return;
+    }
+#else
+    (void)forceScalar;
+#endif
+    blendRowScalar(dst, src, w, mode, pa);
+}
+
+static inline uint32_t rgb565ToRgba(uint16_t p) {
+    uint32_t r = (p >> 11) & 0x1f;
+    uint32_t g = (p >> 5) & 0x3f;
+    uint32_t b = p & 0x1f;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return r | (g << 8) | (b << 16) | 0xff000000;
+}
+
+static void blendLayerRow(uint32_t * dst, const cpu_blend_layer_t & layer,
+    int32_t y, bool forceScalar) {
+    int32_t w = layer.dst.right - layer.dst.left;
+    const uint8_t * srcRow = layer.src ?
+        layer.src + (int64_t)(y - layer.dst.top) * layer.srcStride : NULL;
+    uint32_t chunk[CPU_BLEND_CHUNK];
+
+    switch (layer.format) {
+        case CPU_BLEND_RGBA8888:
+            blendRow(dst, (const uint32_t *)srcRow, w,
+                layer.blendMode, layer.planeAlpha, forceScalar);
+            break;
+        case CPU_BLEND_RGBX8888:
+            blendRow(dst, (const uint32_t *)srcRow, w,
+                CPU_BLEND_NONE, layer.planeAlpha, forceScalar);
+            break;
+        case CPU_BLEND_RGB565:
+            for (int32_t x = 0; x < w; x += CPU_BLEND_CHUNK) {
+                int32_t n = (w - x) < CPU_BLEND_CHUNK ? (w - x) : CPU_BLEND_CHUNK;
+                const uint16_t * src = (const uint16_t *)srcRow + x;
+                for (int32_t i = 0; i < n; i++)
+                    chunk[i] = rgb565ToRgba(src[i]);
+                blendRow(dst + x, chunk, n, CPU_BLEND_NONE,
+                    layer.planeAlpha, forceScalar);
+            }
+            break;
+        case CPU_BLEND_COLOR:
+            for (int32_t i = 0; i < CPU_BLEND_CHUNK; i++)
+                chunk[i] = layer.color;
+            for (int32_t x = 0; x < w; x += CPU_BLEND_CHUNK) {
+                int32_t n = (w - x) < CPU_BLEND_CHUNK ? (w - x) : CPU_BLEND_CHUNK;
+                blendRow(dst + x, chunk, n, layer.blendMode,
+                    layer.planeAlpha, forceScalar);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void cpu_blend_band(const cpu_blend_job_t & job, int32_t top, int32_t bottom) {
+    for (int32_t y = top; y < bottom; y++) {
+        uint32_t * row = (uint32_t *)(job.dst + (int64_t)y * job.dstStride);
+
+        for (auto it = job.clearRects.begin(); it != job.clearRects.end(); ++it) {
+            if (y >= it->top && y < it->bottom && it->right > it->left)
+                memset(row + it->left, 0, (it->right - it->left) * sizeof(uint32_t));
+        }
+
+        for (auto it = job.layers.begin(); it != job.layers.end(); ++it) {
+            if (y >= it->dst.top && y < it->dst.bottom)
+                blendLayerRow(row + it->dst.left, *it, y, job.forceScalar);
+        }
+    }
+}
+
+const char * cpu_blend_simd_name() {
+#if defined(CPU_BLEND_NEON)
+    return "neon";
+#elif defined(CPU_BLEND_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+CpuBandPool::CpuBandPool(int32_t workers)
+    : mJob(NULL),
+      mTop(0),
+      mBottom(0),
+      mBandHeight(0),
+      mBandNum(0),
+      mNextBand(0),
+      mDoneBands(0),
+      mGeneration(0),
+      mExit(false) {
+    for (int32_t i = 0; i < workers; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, CpuBandPool::workerMain, (void *)this) == 0)
+            mWorkers.push_back(thread);
+    }
+}
+
+CpuBandPool::~CpuBandPool() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mExit = true;
+    lock.unlock();
+    mStartCond.notify_all();
+
+    for (auto it = mWorkers.begin(); it != mWorkers.end(); ++it)
+        pthread_join(*it, NULL);
+}
+
+void CpuBandPool::run(const cpu_blend_job_t & job, int32_t top, int32_t bottom,
+    int32_t bandHeight) {
+    if (bottom <= top)
+        return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJob = &job;
+    mTop = top;
+    mBottom = bottom;
+    mBandHeight = bandHeight > 0 ? bandHeight : (bottom - top);
+    mBandNum = (bottom - top + mBandHeight - 1) / mBandHeight;
+    mNextBand = 0;
+    mDoneBands = 0;
+    mGeneration++;
+    lock.unlock();
+    mStartCond.notify_all();
+
+    processBands();
+
+    lock.lock();
+    while (mDoneBands < mBandNum)
+        mDoneCond.wait(lock);
+    mJob = NULL;
+}
+
+void CpuBandPool::processBands() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mJob && mNextBand < mBandNum) {
+        const cpu_blend_job_t * job = mJob;
+        int32_t top = mTop + mNextBand * mBandHeight;
+        int32_t bottom = (top + mBandHeight) < mBottom ? (top + mBandHeight) : mBottom;
+        mNextBand++;
+        lock.unlock();
+
+        cpu_blend_band(*job, top, bottom);
+
+        lock.lock();
+        mDoneBands++;
+        if (mDoneBands == mBandNum)
+            mDoneCond.notify_all();
+    }
+}
+
+void * CpuBandPool::workerMain(void * data) {
+    CpuBandPool * pThis = (CpuBandPool *)data;
+    uint32_t generation = 0;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(pThis->mMutex);
+        while (!pThis->mExit && pThis->mGeneration == generation)
+            pThis->mStartCond.wait(lock);
+        if (pThis->mExit)
+            break;
+        generation = pThis->mGeneration;
+        lock.unlock();
+
+        pThis->processBands();
+    }
+
+    return NULL;
+}
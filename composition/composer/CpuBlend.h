@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Blend kernels and band worker pool of cpu composer.
+ */
+
+#ifndef CPU_BLEND_H
+#define CPU_BLEND_H
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <pthread.h>
+
+#include <BasicTypes.h>
+#include <DrmTypes.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CPU_BLEND_NEON
+#elif defined(__SSE2__)
+#define CPU_BLEND_SSE2
+#endif
+
+/*input format, output is always premultiplied rgba8888.*/
+typedef enum {
+    CPU_BLEND_RGBA8888 = 0,
+    CPU_BLEND_RGBX8888,
+    CPU_BLEND_RGB565,
+    CPU_BLEND_COLOR,
+} cpu_blend_format_t;
+
+/*same value as drm_blend_mode_t.*/
+typedef enum {
+    CPU_BLEND_NONE = DRM_BLEND_MODE_NONE,
+    CPU_BLEND_PREMULTIPLIED = DRM_BLEND_MODE_PREMULTIPLIED,
+    CPU_BLEND_COVERAGE = DRM_BLEND_MODE_COVERAGE,
+} cpu_blend_mode_t;
+
+typedef struct cpu_blend_layer {
+    const uint8_t * src;    /*first pixel of source crop, NULL for color.*/
+    int32_t srcStride;      /*in bytes.*/
+    uint32_t format;
+    uint32_t blendMode;
+    uint32_t planeAlpha;    /*0~255.*/
+    uint32_t color;         /*rgba8888 in memory order, for CPU_BLEND_COLOR.*/
+    drm_rect_t dst;         /*in output buffer, same size as source crop.*/
+} cpu_blend_layer_t;
+
+typedef struct cpu_blend_job {
+    uint8_t * dst;
+    int32_t dstStride;      /*in bytes.*/
+    std::vector<drm_rect_t> clearRects;     /*set transparent before blend.*/
+    std::vector<cpu_blend_layer_t> layers;  /*from bottom to top.*/
+    bool forceScalar;       /*for test, skip simd kernels.*/
+} cpu_blend_job_t;
+
+/*blend rows [top, bottom) of job, bands without overlap can run in parallel.*/
+void cpu_blend_band(const cpu_blend_job_t & job, int32_t top, int32_t bottom);
+
+/*simd kernel built in, "scalar" if none.*/
+const char * cpu_blend_simd_name();
+
+/*
+ * Split job into horizontal bands and run them on worker threads,
+ * caller thread takes bands too.
+ */
+class CpuBandPool {
+public:
+    CpuBandPool(int32_t workers);
+    ~CpuBandPool();
+
+    /*return when all bands of rows [top, bottom) are done.*/
+    void run(const cpu_blend_job_t & job, int32_t top, int32_t bottom,
+        int32_t bandHeight);
+
+    int32_t getThreadNum() { return mWorkers.size() + 1; }
+
+protected:
+    static void * workerMain(void * data);
+    void processBands();
+
+protected:
+    std::vector<pthread_t> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mStartCond;
+    std::condition_variable mDoneCond;
+
+    const cpu_blend_job_t * mJob;
+    int32_t mTop;
+    int32_t mBottom;
+    int32_t mBandHeight;
+    int32_t mBandNum;
+    int32_t mNextBand;
+    int32_t mDoneBands;
+    uint32_t mGeneration;
+    bool mExit;
+};
+
+#endif/*CPU_BLEND_H*/
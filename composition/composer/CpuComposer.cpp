@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <unistd.h>
+
+#include <MesonLog.h>
+#include <misc.h>
+
+#include "CpuComposer.h"
+
+#define CPU_COMPOSE_EVENT (1)
+
+static inline int32_t rectWidth(const drm_rect_t & rect) {
+    return rect.right - rect.left;
+}
+
+static inline int32_t rectHeight(const drm_rect_t & rect) {
+    return rect.bottom - rect.top;
+}
+
+static inline bool rectEmpty(const drm_rect_t & rect) {
+    return rect.right <= rect.left || rect.bottom <= rect.top;
+}
+
+static void rectUnion(drm_rect_t & dst, const drm_rect_t & src) {
+    if (rectEmpty(src))
+        return;
+    if (rectEmpty(dst)) {
+        dst = src;
+        return;
+    }
+    dst.left = src.left < dst.left ? src.left : dst.left;
+    dst.top = src.top < dst.top ? src.top : dst.top;
+    dst.right = src.right > dst.right ? src.right : dst.right;
+    dst.bottom = src.bottom > dst.bottom ? src.bottom : dst.bottom;
+}
+
+CpuComposer::CpuComposer() {
+    for (int32_t i = 0; i < CPU_COMPOSER_BUFFER_NUM; i++) {
+        mBuffers[i].handle = NULL;
+        memset(&mBuffers[i].dirty, 0, sizeof(drm_rect_t));
+    }
+    mBufferIdx = 0;
+    mBufferW = mBufferH = 0;
+    memset(&mCanvasCrop, 0, sizeof(mCanvasCrop));
+    memset(&mCanvasFrame, 0, sizeof(mCanvasFrame));
+    mCanvasSeq = 0;
+    mJob.dst = NULL;
+    mJob.dstStride = 0;
+    mJob.forceScalar = false;
+    mTimelineValue = 0;
+    mBusy = false;
+
+    int32_t cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > CPU_COMPOSER_MAX_THREADS)
+        cpus = CPU_COMPOSER_MAX_THREADS;
+    mPool = std::make_shared<CpuBandPool>(cpus > 1 ? cpus - 1 : 0);
+    MESON_LOGD("CpuComposer: %s kernel, %d threads, %s.",
+        cpu_blend_simd_name(), mPool->getThreadNum(),
+        mTimeline.isValid() ? "async" : "sync");
+
+    if (mTimeline.isValid()) {
+        mThread = std::make_shared<EventThread>("hwc-cpu-composer");
+        mThread->setHandler(this);
+        mThread->start();
+    }
+}
+
+CpuComposer::~CpuComposer() {
+    waitIdle();
+    mThread.reset();
+    mInputs.clear();
+    mOutput.reset();
+    freeOutputs();
+    mPool.reset();
+}
+
+bool CpuComposer::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
+    if (fb->mSecure || fb->isRotated())
+        return false;
+
+    switch (fb->mBlendMode) {
+        case DRM_BLEND_MODE_NONE:
+        case DRM_BLEND_MODE_PREMULTIPLIED:
+        case DRM_BLEND_MODE_COVERAGE:
+            break;
+        default:
+            return false;
+    }
+
+    /*no scaler, source crop should be same size as display frame.*/
+    if (rectEmpty(fb->mDisplayFrame))
+        return false;
+    if (fb->mDisplayFrame.left < mCanvasFrame.left ||
+        fb->mDisplayFrame.top < mCanvasFrame.top ||
+        fb->mDisplayFrame.right > mCanvasFrame.right ||
+        fb->mDisplayFrame.bottom > mCanvasFrame.bottom)
+        return false;
+    if (fb->mFbType == DRM_FB_COLOR)
+        return true;
+    if (rectWidth(fb->mSourceCrop) != rectWidth(fb->mDisplayFrame) ||
+        rectHeight(fb->mSourceCrop) != rectHeight(fb->mDisplayFrame))
+        return false;
+
+    if ((fb->mFbType != DRM_FB_SCANOUT && fb->mFbType != DRM_FB_CURSOR) ||
+        fb->mBufferHandle == NULL)
+        return false;
+    if (fb->mBufferInfo.afbcMask != 0)
+        return false;
+
+    switch (fb->mBufferInfo.format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_RGB_565:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool CpuComposer::isFbsSupport(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & fbs,
+    std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs) {
+    /*canvas should be unscaled, or we have to scale layers.*/
+    if (rectEmpty(mCanvasFrame) ||
+        rectWidth(mCanvasCrop) != rectWidth(mCanvasFrame) ||
+        rectHeight(mCanvasCrop) != rectHeight(mCanvasFrame))
+        return false;
+    /*video under composed range need a hole punched, not supported.*/
+    if (overlayfbs.size() > 0)
+        return false;
+    if (fbs.size() == 0 || fbs.size() > CPU_COMPOSER_MAX_INPUTS)
+        return false;
+
+    drm_rect_t bounds = {0, 0, 0, 0};
+    for (auto it = fbs.begin(); it != fbs.end(); ++it) {
+        if (!isFbSupport(*it))
+            return false;
+        rectUnion(bounds, (*it)->mDisplayFrame);
+    }
+
+    return (int64_t)rectWidth(bounds) * rectHeight(bounds) <= CPU_COMPOSER_MAX_PIXELS;
+}
+
+int32_t CpuComposer::prepare() {
+    mInputs.clear();
+    return 0;
+}
+
+int32_t CpuComposer::addInputs(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & fbs,
+    std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs __unused) {
+    mInputs = fbs;
+    return 0;
+}
+
+int32_t CpuComposer::getOverlyFbs(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & overlays __unused) {
+    return 0;
+}
+
+int32_t CpuComposer::setOutput(
+    std::shared_ptr<DrmFramebuffer> & fb,
+    hwc_region_t damage __unused) {
+    if (!fb.get())
+        return -EINVAL;
+
+    if (memcmp(&mCanvasCrop, &fb->mSourceCrop, sizeof(drm_rect_t)) != 0 ||
+        memcmp(&mCanvasFrame, &fb->mDisplayFrame, sizeof(drm_rect_t)) != 0)
+        mCanvasSeq++;
+    mCanvasCrop = fb->mSourceCrop;
+    mCanvasFrame = fb->mDisplayFrame;
+    return 0;
+}
+
+int32_t CpuComposer::allocOutputs() {
+    int32_t w = rectWidth(mCanvasCrop);
+    int32_t h = rectHeight(mCanvasCrop);
+    if (w == mBufferW && h == mBufferH && mBuffers[0].fb.get())
+        return 0;
+
+    /*queued blends still draw into the old buffers.*/
+    waitIdle();
+    freeOutputs();
+    for (int32_t i = 0; i < CPU_COMPOSER_BUFFER_NUM; i++) {
+        native_handle_t * hnd = gralloc_alloc_dma_buf(w, h,
+            HAL_PIXEL_FORMAT_RGBA_8888, true);
+        if (!hnd) {
+            MESON_LOGE("CpuComposer alloc output (%dx%d) failed.", w, h);
+            freeOutputs();
+            return -ENOMEM;
+        }
+
+        OutputBuffer & buf = mBuffers[i];
+        buf.handle = hnd;
+        buf.fb = std::make_shared<DrmFramebuffer>(hnd, -1);
+        buf.fb->mFbType = DRM_FB_SCANOUT;
+        buf.fb->mBlendMode = DRM_BLEND_MODE_PREMULTIPLIED;
+        buf.fb->mPlaneAlpha = 1.0f;
+        buf.fb->mTransform = 0;
+        /*new buffer content is random, clear it all.*/
+        buf.dirty.left = buf.dirty.top = 0;
+        buf.dirty.right = w;
+        buf.dirty.bottom = h;
+    }
+
+    mBufferW = w;
+    mBufferH = h;
+    mBufferIdx = 0;
+    return 0;
+}
+
+void CpuComposer::freeOutputs() {
+    for (int32_t i = 0; i < CPU_COMPOSER_BUFFER_NUM; i++) {
+        OutputBuffer & buf = mBuffers[i];
+        buf.fb.reset();
+        if (buf.handle) {
+            gralloc_free_dma_buf(buf.handle);
+            buf.handle = NULL;
+        }
+        memset(&buf.dirty, 0, sizeof(drm_rect_t));
+    }
+    mBufferW = mBufferH = 0;
+}
+
+int32_t CpuComposer::fillLayer(std::shared_ptr<DrmFramebuffer> & fb,
+    BlendInput & input) {
+    cpu_blend_layer_t & layer = input.layer;
+    layer.blendMode = fb->mBlendMode;
+    layer.planeAlpha = (uint32_t)(fb->mPlaneAlpha * 255.0f + 0.5f);
+    layer.planeAlpha = layer.planeAlpha > 255 ? 255 : layer.planeAlpha;
+    layer.dst.left = fb->mDisplayFrame.left - mCanvasFrame.left;
+    layer.dst.top = fb->mDisplayFrame.top - mCanvasFrame.top;
+    layer.dst.right = fb->mDisplayFrame.right - mCanvasFrame.left;
+    layer.dst.bottom = fb->mDisplayFrame.bottom - mCanvasFrame.top;
+    layer.src = NULL;
+    layer.srcStride = 0;
+    layer.color = 0;
+    input.fb.reset();
+    input.srcOffset = 0;
+
+    if (fb->mFbType == DRM_FB_COLOR) {
+        layer.format = CPU_BLEND_COLOR;
+        /*solid color is not premultiplied.*/
+        if (layer.blendMode != CPU_BLEND_NONE)
+            layer.blendMode = CPU_BLEND_COVERAGE;
+        layer.color = fb->mColor.r | (fb->mColor.g << 8) |
+            (fb->mColor.b << 16) | ((uint32_t)fb->mColor.a << 24);
+        return 0;
+    }
+
+    int32_t bpp;
+    switch (fb->mBufferInfo.format) {
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+            layer.format = CPU_BLEND_RGBX8888;
+            bpp = 4;
+            break;
+        case HAL_PIXEL_FORMAT_RGB_565:
+            layer.format = CPU_BLEND_RGB565;
+            bpp = 2;
+            break;
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        default:
+            layer.format = CPU_BLEND_RGBA8888;
+            bpp = 4;
+            break;
+    }
+
+    /*layer may take a new buffer before the blend runs, keep this one.*/
+    input.fb = std::make_shared<DrmFramebuffer>();
+    input.fb->copyFrom(*fb, true);
+    layer.srcStride = fb->mBufferInfo.byteStride;
+    input.srcOffset = (int64_t)fb->mSourceCrop.top * layer.srcStride +
+        fb->mSourceCrop.left * bpp;
+    return 0;
+}
+
+int32_t CpuComposer::start() {
+    if (mInputs.empty())
+        return 0;
+
+    int32_t ret = allocOutputs();
+    if (ret != 0)
+        return ret;
+
+    OutputBuffer & out = mBuffers[mBufferIdx];
+    mBufferIdx = (mBufferIdx + 1) % CPU_COMPOSER_BUFFER_NUM;
+
+    BlendJob job;
+    job.out = &out;
+    /*display release of this buffer, waited before drawing.*/
+    job.outRelease = std::make_shared<DrmFence>(out.fb->getReleaseFence());
+    out.fb->clearReleaseFence();
+
+    drm_rect_t dirty = {0, 0, 0, 0};
+    job.inputs.resize(mInputs.size());
+    for (size_t i = 0; i < mInputs.size(); i++) {
+        fillLayer(mInputs[i], job.inputs[i]);
+        rectUnion(dirty, job.inputs[i].layer.dst);
+    }
+
+    /*old content out of new dirty area should be cleared too.*/
+    job.clearRects.push_back(out.dirty);
+    job.clearRects.push_back(dirty);
+    drm_rect_t rows = out.dirty;
+    rectUnion(rows, dirty);
+    job.top = rows.top;
+    job.bottom = rows.bottom;
+    out.dirty = dirty;
+
+    int32_t doneFence = -1;
+    if (mThread.get())
+        doneFence = mTimeline.createFence("cpu-composer", mTimelineValue + 1);
+
+    if (doneFence < 0) {
+        /*no timeline, blend here and release inputs at once.*/
+        blend(job);
+        for (auto it = mInputs.begin(); it != mInputs.end(); ++it)
+            (*it)->setReleaseFence(-1);
+        out.fb->setAcquireFence(-1);
+    } else {
+        mTimelineValue++;
+        for (auto it = mInputs.begin(); it != mInputs.end(); ++it)
+            (*it)->setReleaseFence(::dup(doneFence));
+        out.fb->setAcquireFence(doneFence);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.push_back(std::move(job));
+        }
+        mThread->sendEvent(CPU_COMPOSE_EVENT);
+    }
+
+    out.fb->mSourceCrop = mCanvasCrop;
+    out.fb->mDisplayFrame = mCanvasFrame;
+    out.fb->mContentUpdated = true;
+    mOutput = out.fb;
+    return 0;
+}
+
+void CpuComposer::blend(BlendJob & job) {
+    OutputBuffer & out = *job.out;
+    job.outRelease->waitForever("cpu-composer-output");
+
+    mJob.layers.clear();
+    for (auto it = job.inputs.begin(); it != job.inputs.end(); ++it) {
+        cpu_blend_layer_t layer = it->layer;
+        if (it->fb.get()) {
+            /*wait gpu or producer finish writing.*/
+            it->fb->getAcquireFence()->waitForever("cpu-composer-input");
+            void * addr = NULL;
+            if (it->fb->lock(&addr) != 0 || addr == NULL) {
+                MESON_LOGE("CpuComposer lock input failed.");
+                continue;
+            }
+            layer.src = (const uint8_t *)addr + it->srcOffset;
+        }
+        mJob.layers.push_back(layer);
+    }
+
+    void * dst = NULL;
+    if (out.fb->lock(&dst) != 0 || dst == NULL) {
+        MESON_LOGE("CpuComposer lock output failed.");
+    } else {
+        mJob.dst = (uint8_t *)dst;
+        mJob.dstStride = out.fb->mBufferInfo.byteStride;
+        mJob.clearRects = job.clearRects;
+        mPool->run(mJob, job.top, job.bottom, CPU_COMPOSER_BAND_HEIGHT);
+        out.fb->unlock();
+    }
+
+    /*copies unlock and drop their buffers.*/
+    job.inputs.clear();
+    job.outRelease.reset();
+}
+
+void CpuComposer::handleEvent(int what) {
+    if (what == CPU_COMPOSE_EVENT)
+        processQueue();
+}
+
+void CpuComposer::processQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mQueue.empty())
+            return;
+        mPosting.swap(mQueue);
+        mBusy = true;
+    }
+
+    /*queued in start() order, each blend signals its timeline point.*/
+    for (auto it = mPosting.begin(); it != mPosting.end(); ++it) {
+        blend(*it);
+        mTimeline.inc(1);
+    }
+    mPosting.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBusy = false;
+    }
+    mIdleCond.notify_all();
+}
+
+void CpuComposer::waitIdle() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mQueue.empty() || mBusy)
+        mIdleCond.wait(lock);
+}
+
+std::shared_ptr<DrmFramebuffer> CpuComposer::getOutput() {
+    return mOutput;
+}
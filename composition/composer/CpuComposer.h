@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#ifndef CPU_COMPOSER_H
+#define CPU_COMPOSER_H
+
+#include <condition_variable>
+#include <mutex>
+
+#include <IComposer.h>
+#include <EventThread.h>
+#include "CpuBlend.h"
+
+#define CPU_COMPOSER_NAME "CPU"
+
+/*only a few small layers, big ones are cheaper on gpu.*/
+#define CPU_COMPOSER_MAX_INPUTS (4)
+#define CPU_COMPOSER_MAX_PIXELS (1920 * 1080 / 4)
+#define CPU_COMPOSER_MAX_THREADS (4)
+#define CPU_COMPOSER_BAND_HEIGHT (32)
+#define CPU_COMPOSER_BUFFER_NUM (3)
+
+/*
+ * Blend layers into a canvas buffer as big as client target, the canvas
+ * geometry is passed by setOutput() with a framebuffer without buffer.
+ * start() queues the blend to the composer thread, which waits input
+ * acquire and output release fences there. Inputs release fences and
+ * output acquire fence are one sw_sync point, signaled when blend is done.
+ * Without sw_sync the blend is finished in start().
+ */
+class CpuComposer : public IComposer, public EventHandler {
+public:
+    CpuComposer();
+    ~CpuComposer();
+
+    const char* getName() { return CPU_COMPOSER_NAME; }
+    meson_compositon_t getType() { return MESON_COMPOSITION_CPU; }
+
+    bool isFbsSupport(
+        std::vector<std::shared_ptr<DrmFramebuffer>> & fbs,
+        std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs);
+
+    int32_t prepare();
+
+    int32_t addInputs(
+        std::vector<std::shared_ptr<DrmFramebuffer>> & fbs,
+        std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs);
+
+    int32_t getOverlyFbs(std::vector<std::shared_ptr<DrmFramebuffer>> & overlays);
+
+    int32_t setOutput(std::shared_ptr<DrmFramebuffer> & fb,
+        hwc_region_t damage);
+
+    int32_t start();
+
+    std::shared_ptr<DrmFramebuffer> getOutput();
+    uint32_t getStateSeq() { return mCanvasSeq; }
+
+    void handleEvent(int what);
+
+protected:
+    struct OutputBuffer {
+        native_handle_t * handle;
+        std::shared_ptr<DrmFramebuffer> fb;
+        drm_rect_t dirty;   /*drawn area, cleared before next use.*/
+    };
+
+    struct BlendInput {
+        cpu_blend_layer_t layer;
+        std::shared_ptr<DrmFramebuffer> fb;     /*copy holding buffer and fence, NULL for color.*/
+        int64_t srcOffset;                      /*of source crop, in bytes.*/
+    };
+
+    struct BlendJob {
+        std::vector<BlendInput> inputs;
+        std::vector<drm_rect_t> clearRects;
+        OutputBuffer * out;
+        std::shared_ptr<DrmFence> outRelease;
+        int32_t top;
+        int32_t bottom;
+    };
+
+    bool isFbSupport(std::shared_ptr<DrmFramebuffer> & fb);
+    int32_t allocOutputs();
+    void freeOutputs();
+    int32_t fillLayer(std::shared_ptr<DrmFramebuffer> & fb, BlendInput & input);
+    /*run on composer thread, or in start() without timeline.*/
+    void blend(BlendJob & job);
+    void processQueue();
+    /*wait until queued blends are done.*/
+    void waitIdle();
+
+    std::vector<std::shared_ptr<DrmFramebuffer>> mInputs;
+    std::shared_ptr<DrmFramebuffer> mOutput;
+
+    OutputBuffer mBuffers[CPU_COMPOSER_BUFFER_NUM];
+    int32_t mBufferIdx;
+    int32_t mBufferW;
+    int32_t mBufferH;
+
+    drm_rect_t mCanvasCrop;
+    drm_rect_t mCanvasFrame;
+    uint32_t mCanvasSeq;        /*bumped when canvas geometry changes.*/
+
+    std::shared_ptr<CpuBandPool> mPool;
+    cpu_blend_job_t mJob;       /*blending thread only.*/
+
+    DrmTimeLine mTimeline;
+    uint32_t mTimelineValue;    /*point of last queued blend.*/
+    std::shared_ptr<EventThread> mThread;
+
+    std::mutex mMutex;
+    std::condition_variable mIdleCond;
+    std::vector<BlendJob> mQueue;
+    std::vector<BlendJob> mPosting;     /*composer thread only.*/
+    bool mBusy;
+};
+
+#endif/*CPU_COMPOSER_H*/
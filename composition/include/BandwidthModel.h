@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+#ifndef BANDWIDTH_MODEL_H
+#define BANDWIDTH_MODEL_H
+
+#include <BasicTypes.h>
+#include <DrmTypes.h>
+#include <DrmFramebuffer.h>
+
+/*
+ * Estimate DDR read bandwidth of vpu planes for one frame.
+ * bytes = crop pixels * bpp(format) * afbc ratio * vertical downscale ratio,
+ * downscale makes vpu fetch the source in less active lines.
+ * Budget is in MB/s, 0 means no limit.
+ */
+class BandwidthModel {
+public:
+    BandwidthModel();
+    ~BandwidthModel();
+
+    void setRefreshRate(float refreshRate);
+    float getRefreshRate() { return mRefreshRate; }
+    uint32_t getBudget() { return mBudget; }
+    bool hasBudget() { return mBudget > 0; }
+
+    /*bytes per frame of fb scanout by plane.*/
+    uint64_t estimateFbBytes(std::shared_ptr<DrmFramebuffer> & fb);
+    /*bytes per frame of composer output covering the frame.*/
+    uint64_t estimateTargetBytes(drm_rect_t & frame);
+
+    /*bytes per frame to MB/s at current refresh rate.*/
+    uint32_t toBandwidth(uint64_t frameBytes);
+    bool exceedBudget(uint64_t frameBytes);
+
+    void dump(String8 & dumpstr, uint64_t frameBytes);
+
+protected:
+    float mRefreshRate;
+    uint32_t mBudget;
+};
+
+#endif/*BANDWIDTH_MODEL_H*/
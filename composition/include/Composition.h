@@ -11,6 +11,7 @@
 #define COMPOSITION_H
 
 #include <BasicTypes.h>
+#include <hardware/hwcomposer_defs.h>
 
 typedef enum {
     MESON_COMPOSITION_UNDETERMINED = 0,
@@ -27,10 +28,16 @@ typedef enum {
     MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND,
     /*New video plane.*/
     MESON_COMPOSITION_PLANE_HWCVIDEO,
+
+    /*appended, traces keep the values above.*/
+    MESON_COMPOSITION_CPU,
 } meson_compositon_t;
 
 bool isVideoPlaneComposition(int meson_composition_type);
 bool isComposerComposition(int meson_composition_type);
 const char* compositionTypeToString(int meson_composition_type);
 
+/*no rect means full damage, one empty rect means no damage.*/
+bool hasSurfaceDamage(hwc_region_t & damage);
+
 #endif/*COMPOSITION_H*/
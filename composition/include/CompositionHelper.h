@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Plane policy shared by composition strategies.
+ */
+#ifndef COMPOSITION_HELPER_H
+#define COMPOSITION_HELPER_H
+
+#include <BasicTypes.h>
+#include <DrmTypes.h>
+#include <DrmFramebuffer.h>
+#include <HwDisplayPlane.h>
+#include <Composition.h>
+
+#define VIDEO_PLANE_DIN_ONE            3    // video1: video fb input
+#define VIDEO_PLANE_DIN_TWO            4    // video2: video fb input
+#define PIP_VIDEO_DISPLAYFRAME_SIZE    16
+#define OSD_FB_BEGIN_ZORDER            65   // osd zorder: 65 - 128
+#define TOP_VIDEO_FB_BEGIN_ZORDER      129  // top video zorder: 129 - 192
+#define BOTTOM_VIDEO_FB_BEGIN_ZORDER   1    // bottom video zorder: 1 - 64
+
+/*
+ * Compare scale of fb a and b, return 0 if same, 1 if a scales up
+ * more in both directions, else -1.
+ */
+int32_t compareFbScale(drm_rect_t & aSrc, drm_rect_t & aDst,
+    drm_rect_t & bSrc, drm_rect_t & bDst);
+
+/*
+ * Take the video plane of a video fb from the free ones, the taken one
+ * is reset, and set fb composition type. Return false if fb is not video,
+ * plane is NULL if fb is discarded.
+ * Current VIDEO plane support : 1 LegacyVideoPlane + 1 HwcVideoPlane
+ * Future  VIDEO plane support : 2 HwcVideoPlane
+ */
+bool assignVideoPlane(std::shared_ptr<DrmFramebuffer> & fb,
+    std::shared_ptr<HwDisplayPlane> & legacyVideoPlane,
+    std::shared_ptr<HwDisplayPlane> & legacyExtVideoPlane,
+    std::shared_ptr<HwDisplayPlane> & hwcVideoPlane,
+    std::shared_ptr<HwDisplayPlane> & plane, uint32_t & din);
+
+/*
+ * Present zorder of a legacy video plane pair: above the osd planes if
+ * its fb is over maxOsdZorder and no video is on top yet, else below them.
+ * Pairs of other planes keep presentZorder.
+ */
+uint32_t getVideoPresentZorder(std::shared_ptr<DrmFramebuffer> & fb,
+    std::shared_ptr<HwDisplayPlane> & plane, uint32_t presentZorder,
+    uint32_t maxOsdZorder, bool & topVideo);
+
+#endif/*COMPOSITION_HELPER_H*/
@@ -14,6 +14,7 @@
 
 enum {
     SIMPLE_STRATEGY = 0,
+    COST_MODEL_STRATEGY,
 } COMPOSITION_TYPE;
 
 enum {
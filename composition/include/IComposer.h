@@ -49,6 +49,9 @@ public:
     virtual int32_t getOverlyFbs(std::vector<std::shared_ptr<DrmFramebuffer>> & overlays) = 0;
 
     virtual std::shared_ptr<DrmFramebuffer> getOutput();
+
+    /* changes when state read by isFbsSupport() besides fbs changes.*/
+    virtual uint32_t getStateSeq() { return 0; }
 };
 
 #endif/*ICOMPOSER_H*/
@@ -9,7 +9,9 @@
 #ifndef ICOMPOSITION_STRATEGY_H
 #define ICOMPOSITION_STRATEGY_H
 
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <BasicTypes.h>
 #include <DrmFramebuffer.h>
@@ -30,29 +32,44 @@ typedef enum {
 } COMPOSITION_REQUEST;
 
 /*Macros for composition info dump.*/
-#define DUMP_ADD_LINE_DIVIDE() \
-    mDumpStr.append("+------+-------------+----------+--------+--------------+\n");
+#define DUMP_ADD_LINE_DIVIDE(str) \
+    str.append("+------+-------------+----------+--------+--------------+\n");
 
-#define DUMP_APPEND_FB_INFO(fbZ, compType) \
-    mDumpStr.appendFormat("|%6d|%13s|", fbZ, compositionTypeToString(compType));
+#define DUMP_APPEND_FB_INFO(str, fbZ, compType) \
+    str.appendFormat("|%6d|%13s|", fbZ, compositionTypeToString(compType));
 
-#define DUMP_APPEND_EMPTY_FB_INFO() \
-        mDumpStr.appendFormat("|%6s|%13s|", " ", " ");
+#define DUMP_APPEND_EMPTY_FB_INFO(str) \
+        str.appendFormat("|%6s|%13s|", " ", " ");
 
-#define DUMP_APPEND_PLANE_INFO(planeName, planeZ, blankType) \
-    mDumpStr.appendFormat("%10s|%8d|%14s|\n", \
+#define DUMP_APPEND_PLANE_INFO(str, planeName, planeZ, blankType) \
+    str.appendFormat("%10s|%8d|%14s|\n", \
         planeName, planeZ, \
         drmPlaneBlankToString((drm_plane_blank_t)blankType));
 
-#define DUMP_APPEND_EMPTY_PLANE_INFO() \
-    mDumpStr.appendFormat("%10s|%8s|%14s|\n", " ", " ", " ");
+#define DUMP_APPEND_EMPTY_PLANE_INFO(str) \
+    str.appendFormat("%10s|%8s|%14s|\n", " ", " ", " ");
+
+/*commit() only records dump lines, they are formatted in dump().*/
+#define COMPOSITION_DUMP_LINES_MAX (32)
+#define COMPOSITION_DUMP_NAME_LEN (16)
+
+typedef struct composition_dump_line {
+    bool divide;
+    bool hasFb;
+    bool hasPlane;
+    int fbZ;
+    int32_t compType;
+    char planeName[COMPOSITION_DUMP_NAME_LEN];
+    int planeZ;
+    int planeBlank;
+} composition_dump_line_t;
 
 #define HWC_PLANE_FAKE_ZORDER (1)
 
 /*Base compostion strategy class.*/
 class ICompositionStrategy {
 public:
-    ICompositionStrategy() { }
+    ICompositionStrategy() : mDumpLineNum(0), mDumpLineDropped(0) { }
     virtual ~ICompositionStrategy() { }
 
     virtual const char* getName() = 0;
@@ -73,6 +90,12 @@ public:
     /*if have no valid combs, result will < 0.*/
     virtual int decideComposition() = 0;
 
+    /*
+    * called after setup with the inputs of last decided frame, rebuild that
+    * decision without deciding again. < 0 if it cannot be replayed.
+    */
+    virtual int replayComposition() { return -EINVAL; }
+
     /*start composition, should set release fence to each Framebuffer.*/
     virtual int commit() = 0;
 
@@ -80,37 +103,91 @@ public:
         dumpstr.appendFormat("Composition (%s):(0x%x)\n", getName(), mCompositionFlag);
         dumpstr.append("---------------------------------------------------------\n");
         dumpstr.append("| FbZ  |  Comp Type  |  Plane   | PlaneZ |  BlankStat   |\n");
-        dumpstr.append(mDumpStr);
+        for (uint32_t i = 0; i < mDumpLineNum; i++) {
+            composition_dump_line_t & line = mDumpLines[i];
+            if (line.divide)
+                DUMP_ADD_LINE_DIVIDE(dumpstr);
+            if (line.hasFb) {
+                DUMP_APPEND_FB_INFO(dumpstr, line.fbZ, line.compType);
+            } else {
+                DUMP_APPEND_EMPTY_FB_INFO(dumpstr);
+            }
+            if (line.hasPlane) {
+                DUMP_APPEND_PLANE_INFO(dumpstr, line.planeName, line.planeZ, line.planeBlank);
+            } else {
+                DUMP_APPEND_EMPTY_PLANE_INFO(dumpstr);
+            }
+        }
+        if (mDumpLineDropped > 0)
+            dumpstr.appendFormat("(%u lines not recorded)\n", mDumpLineDropped);
         dumpstr.append("---------------------------------------------------------\n");
     }
 
 protected:
     /*common functions for dump.*/
+    inline void clearDump() {
+        mDumpLineNum = 0;
+        mDumpLineDropped = 0;
+    }
     inline void dumpComposedFb(
         std::shared_ptr<DrmFramebuffer> & fb) {
-        DUMP_APPEND_FB_INFO(fb->mZorder, fb->mCompositionType);
-        DUMP_APPEND_EMPTY_PLANE_INFO();
+        composition_dump_line_t * line = addDumpLine(false);
+        if (line)
+            setDumpFb(line, fb);
     }
     inline void dumpFbAndPlane(
         std::shared_ptr<DrmFramebuffer> & fb,
         std::shared_ptr<HwDisplayPlane> & plane,
         int planeZ,
         int planeBlank) {
-        DUMP_ADD_LINE_DIVIDE();
-        DUMP_APPEND_FB_INFO(fb->mZorder, fb->mCompositionType);
-        DUMP_APPEND_PLANE_INFO(plane->getName(), planeZ, planeBlank);
+        composition_dump_line_t * line = addDumpLine(true);
+        if (line) {
+            setDumpFb(line, fb);
+            setDumpPlane(line, plane, planeZ, planeBlank);
+        }
     }
     inline void dumpUnusedPlane(
         std::shared_ptr<HwDisplayPlane> & plane,
         int planeBlank) {
-        DUMP_ADD_LINE_DIVIDE();
-        DUMP_APPEND_EMPTY_FB_INFO();
-        DUMP_APPEND_PLANE_INFO(plane->getName(), -1, planeBlank);
+        composition_dump_line_t * line = addDumpLine(true);
+        if (line)
+            setDumpPlane(line, plane, -1, planeBlank);
+    }
+
+private:
+    inline composition_dump_line_t * addDumpLine(bool divide) {
+        if (mDumpLineNum >= COMPOSITION_DUMP_LINES_MAX) {
+            mDumpLineDropped++;
+            return NULL;
+        }
+        composition_dump_line_t * line = &mDumpLines[mDumpLineNum++];
+        line->divide = divide;
+        line->hasFb = false;
+        line->hasPlane = false;
+        return line;
+    }
+    inline void setDumpFb(composition_dump_line_t * line,
+        std::shared_ptr<DrmFramebuffer> & fb) {
+        line->hasFb = true;
+        line->fbZ = fb->mZorder;
+        line->compType = fb->mCompositionType;
+    }
+    inline void setDumpPlane(composition_dump_line_t * line,
+        std::shared_ptr<HwDisplayPlane> & plane, int planeZ, int planeBlank) {
+        line->hasPlane = true;
+        strncpy(line->planeName, plane->getName(), COMPOSITION_DUMP_NAME_LEN - 1);
+        line->planeName[COMPOSITION_DUMP_NAME_LEN - 1] = 0;
+        line->planeZ = planeZ;
+        line->planeBlank = planeBlank;
     }
 
 protected:
-    String8 mDumpStr;
     uint32_t mCompositionFlag;
+
+private:
+    composition_dump_line_t mDumpLines[COMPOSITION_DUMP_LINES_MAX];
+    uint32_t mDumpLineNum;
+    uint32_t mDumpLineDropped;
 };
 
 #endif/*ICOMPOSITION_STRATEGY_H*/
@@ -0,0 +1,616 @@
+/*
+* Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+*
+* This source code is subject to the terms and conditions defined in the
+* file 'LICENSE' which is part of this source code package.
+*
+* Description:
+*/
+
+#include "CostModelComposition.h"
+#include <DrmTypes.h>
+#include <MesonLog.h>
+#include <misc.h>
+#include <CompositionHelper.h>
+
+#define OSD_PLANE_DIN_ZERO             0    // din0: osd fb input
+
+#define OSD_SCALER_INPUT_MAX_WIDTH (1920)
+#define OSD_SCALER_INPUT_MAX_HEIGH (1080)
+
+/* One composed pixel costs about the DDR traffic of 8 bytes:
+ * read it, blend it, and write it back by GPU.
+ */
+#define COST_GPU_PIXEL_WEIGHT          8
+/* check deadline every N search nodes. */
+#define COST_DEADLINE_CHECK_NODES      16
+
+#define COST_BUDGET_PROP "vendor.hwc.cost-composition.budget"
+
+static inline uint64_t rectArea(drm_rect_t & rect) {
+    int64_t w = rect.right - rect.left;
+    int64_t h = rect.bottom - rect.top;
+    return (w > 0 && h > 0) ? (uint64_t)(w * h) : 0;
+}
+
+CostModelComposition::CostModelComposition()
+    : mFramebuffers(FbMapAllocator(&mArena)),
+      mDisplayPairs(DisplayPairAllocator(&mArena)) {
+    char val[PROP_VALUE_LEN_MAX];
+    mSearchBudget = COST_MODEL_DEFAULT_BUDGET;
+    if (sys_get_string_prop(COST_BUDGET_PROP, val) > 0 && atoi(val) > 0)
+        mSearchBudget = atoi(val);
+
+    mDecideTime = 0;
+    mTimeoutCount = 0;
+    mSearchNodes = 0;
+    mBestCost = 0;
+    mBestScanBytes = 0;
+    memset(&mOsdDisplayFrame, 0, sizeof(mOsdDisplayFrame));
+}
+
+CostModelComposition::~CostModelComposition() {
+}
+
+void CostModelComposition::setSearchBudget(uint32_t budgetUs) {
+    mSearchBudget = budgetUs;
+}
+
+void CostModelComposition::init() {
+    mHideSecureLayer     = false;
+    mForceClientComposer = false;
+    mHaveClient          = false;
+
+    mFramebuffers.clear();
+    mUiFbs.clear();
+    mVideoFbs.clear();
+    mCrtc.reset();
+
+    mDummyComposer.reset();
+    mClientComposer.reset();
+    mOtherComposers.clear();
+
+    mOsdPlanes.clear();
+    mHwcVideoPlane.reset();
+    mLegacyVideoPlane.reset();
+    mLegacyExtVideoPlane.reset();
+    mOtherPlanes.clear();
+
+    mComposer.reset();
+    mComposerFbs.clear();
+    mOverlayFbs.clear();
+    mDisplayPairs.clear();
+    mDisplayRefFb.reset();
+    memset(&mOsdDisplayFrame, 0, sizeof(mOsdDisplayFrame));
+    mMinComposerZorder = INVALID_ZORDER;
+    mMaxComposerZorder = INVALID_ZORDER;
+
+    mDummyFbs.clear();
+    mVideoInputFbs.clear();
+
+    clearDump();
+
+    /* Map and pairs are empty now, give their nodes back. */
+    mArena.reset();
+}
+
+void CostModelComposition::setup(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & layers,
+    std::vector<std::shared_ptr<IComposer>> & composers,
+    std::vector<std::shared_ptr<HwDisplayPlane>> & planes,
+    std::shared_ptr<HwDisplayCrtc> & crtc,
+    uint32_t reqFlag) {
+    init();
+
+    mCompositionFlag = reqFlag;
+    if (reqFlag & COMPOSE_HIDE_SECURE_FB)
+        mHideSecureLayer = true;
+    if (reqFlag & COMPOSE_FORCE_CLIENT)
+        mForceClientComposer = true;
+
+    mCrtc = crtc;
+    drm_mode_info_t mode;
+    if (mCrtc->getMode(mode) == 0)
+        mBandwidthModel.setRefreshRate(mode.refreshRate);
+
+    for (auto it = layers.begin(); it != layers.end(); ++it) {
+        mFramebuffers.insert(make_pair((*it)->mZorder, *it));
+    }
+
+    for (auto it = composers.begin(); it != composers.end(); ++it) {
+        std::shared_ptr<IComposer> composer = *it;
+        switch (composer->getType()) {
+            case MESON_COMPOSITION_DUMMY:
+                if (mDummyComposer == NULL)
+                    mDummyComposer = composer;
+                break;
+            case MESON_COMPOSITION_CLIENT:
+                if (mClientComposer == NULL)
+                    mClientComposer = composer;
+                break;
+            default:
+                mOtherComposers.push_back(composer);
+                break;
+        }
+    }
+
+    for (auto it = planes.begin(); it != planes.end(); ++it) {
+        std::shared_ptr<HwDisplayPlane> plane = *it;
+        switch (plane->getPlaneType()) {
+            case OSD_PLANE:
+                /*primary plane always at din0.*/
+                if (plane->getCapabilities() & PLANE_PRIMARY)
+                    mOsdPlanes.insert(mOsdPlanes.begin(), plane);
+                else
+                    mOsdPlanes.push_back(plane);
+                break;
+            case HWC_VIDEO_PLANE:
+                if (mHwcVideoPlane.get() == NULL)
+                    mHwcVideoPlane = plane;
+                else
+                    mOtherPlanes.push_back(plane);
+                break;
+            case LEGACY_VIDEO_PLANE:
+                if (mLegacyVideoPlane.get() == NULL)
+                    mLegacyVideoPlane = plane;
+                else
+                    mOtherPlanes.push_back(plane);
+                break;
+            case LEGACY_EXT_VIDEO_PLANE:
+                if (mLegacyExtVideoPlane.get() == NULL)
+                    mLegacyExtVideoPlane = plane;
+                else
+                    mOtherPlanes.push_back(plane);
+                break;
+            default:
+                mOtherPlanes.push_back(plane);
+                break;
+        }
+    }
+}
+
+/* Same video plane policy as MultiplanesComposition. */
+int CostModelComposition::handleVideoComposition() {
+    std::shared_ptr<HwDisplayPlane> plane;
+    uint32_t din;
+    for (auto fbIt = mFramebuffers.begin(); fbIt != mFramebuffers.end(); ++fbIt) {
+        std::shared_ptr<DrmFramebuffer> fb = fbIt->second;
+        if (assignVideoPlane(fb, mLegacyVideoPlane, mLegacyExtVideoPlane,
+                mHwcVideoPlane, plane, din) && plane.get())
+            mDisplayPairs.push_back(DisplayPair{din, fb->mZorder, fb, plane});
+    }
+
+    return 0;
+}
+
+int CostModelComposition::applyCompositionFlags() {
+    if (!mHideSecureLayer && !mForceClientComposer)
+        return 0;
+
+    for (auto it = mFramebuffers.begin(); it != mFramebuffers.end(); ++it) {
+        std::shared_ptr<DrmFramebuffer> fb = it->second;
+        if (fb->mCompositionType == MESON_COMPOSITION_UNDETERMINED) {
+            if (mHideSecureLayer && fb->mSecure) {
+                fb->mCompositionType = MESON_COMPOSITION_DUMMY;
+            } else if (mForceClientComposer) {
+                fb->mCompositionType = MESON_COMPOSITION_CLIENT;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Split fbs to ui/video/dummy, and prepare cost of each ui fb. */
+int CostModelComposition::pickoutUiFbs() {
+    int32_t minX = -1, minY = -1, maxX = 0, maxY = 0;
+
+    for (auto it = mFramebuffers.begin(); it != mFramebuffers.end(); ++it) {
+        std::shared_ptr<DrmFramebuffer> fb = it->second;
+        switch (fb->mCompositionType) {
+            case MESON_COMPOSITION_DUMMY:
+                mDummyFbs.push_back(fb);
+                break;
+            case MESON_COMPOSITION_PLANE_AMVIDEO:
+            case MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND:
+            case MESON_COMPOSITION_PLANE_HWCVIDEO:
+                mVideoInputFbs.push_back(fb);
+                break;
+            case MESON_COMPOSITION_CLIENT:
+                mHaveClient = true;
+                /*fall through - client fb is composed as an ui fb.*/
+            case MESON_COMPOSITION_UNDETERMINED:
+                {
+                    UiFbInfo info;
+                    info.fb = fb;
+                    info.mustCompose = (fb->mCompositionType == MESON_COMPOSITION_CLIENT) ||
+                        mOsdPlanes.empty() || !mOsdPlanes[0]->isFbSupport(fb);
+                    info.scaleMatched = false;
+                    info.composePixels = rectArea(fb->mDisplayFrame);
+                    info.scanoutBytes = mBandwidthModel.estimateFbBytes(fb);
+                    info.composeBytes = info.scanoutBytes;
+                    mUiFbs.push_back(info);
+
+                    if (minX == -1 || minX > fb->mDisplayFrame.left)
+                        minX = fb->mDisplayFrame.left;
+                    if (minY == -1 || minY > fb->mDisplayFrame.top)
+                        minY = fb->mDisplayFrame.top;
+                    if (maxX < fb->mDisplayFrame.right)
+                        maxX = fb->mDisplayFrame.right;
+                    if (maxY < fb->mDisplayFrame.bottom)
+                        maxY = fb->mDisplayFrame.bottom;
+                }
+                break;
+            default:
+                MESON_LOGE("Unknown compostition type(%d)", fb->mCompositionType);
+                break;
+        }
+    }
+
+    if (mDummyFbs.size() > 0)
+        mDummyComposer->addInputs(mDummyFbs, mDummyOverlayFbs);
+
+    if (mUiFbs.empty())
+        return 0;
+
+    /* din0 has no scaler, its fb decides the osd scale. */
+    drm_rect_t scaleInput = {0, 0,
+        OSD_SCALER_INPUT_MAX_WIDTH, OSD_SCALER_INPUT_MAX_HEIGH};
+    drm_rect_t scaleOutput = {0, 0, maxX - minX, maxY - minY};
+    for (auto it = mUiFbs.begin(); it != mUiFbs.end(); ++it) {
+        it->scaleMatched = compareFbScale(it->fb->mSourceCrop,
+            it->fb->mDisplayFrame, scaleInput, scaleOutput) >= 0;
+    }
+    mOsdDisplayFrame.crtc_display_x = minX;
+    mOsdDisplayFrame.crtc_display_y = minY;
+
+    /* composer output: written by GPU, read by VPU. */
+    drm_rect_t targetFrame = {minX, minY, maxX, maxY};
+    mTargetPixels = (uint64_t)(maxX - minX) * (maxY - minY);
+    mTargetScanBytes = mBandwidthModel.estimateTargetBytes(targetFrame);
+    mTargetBytes = mTargetScanBytes * 2;
+
+    mVideoBytes = 0;
+    for (auto it = mVideoInputFbs.begin(); it != mVideoInputFbs.end(); ++it) {
+        VideoFbInfo info = {*it, -1, false};
+        mVideoBytes += mBandwidthModel.estimateFbBytes(info.fb);
+        for (uint32_t i = 0; i < mUiFbs.size(); i++) {
+            if (mUiFbs[i].fb->mZorder < info.fb->mZorder)
+                info.lastUiBelow = i;
+            else
+                info.uiAbove = true;
+        }
+        mVideoFbs.push_back(info);
+    }
+
+    return 0;
+}
+
+/* Video is blended at bottom or top of osd, a video between ui fbs needs
+ * all the ui fbs below it composed, with the hole cut by composer.
+ */
+bool CostModelComposition::isAssignmentValid(
+    int32_t composeBegin, int32_t composeEnd, uint64_t scanBytes) {
+    int topVideo = 0;
+
+    if (mBandwidthModel.exceedBudget(scanBytes + mVideoBytes))
+        return false;
+
+    for (auto it = mVideoFbs.begin(); it != mVideoFbs.end(); ++it) {
+        if (it->lastUiBelow < 0)
+            continue;
+
+        if (!it->uiAbove && topVideo == 0) {
+            topVideo++;
+            continue;
+        }
+
+        if (composeBegin != 0 || composeEnd < it->lastUiBelow)
+            return false;
+    }
+
+    if (composeBegin < 0 && pickDirectRefFb(composeBegin, composeEnd) < 0)
+        return false;
+
+    return true;
+}
+
+/* pick the din0 fb when nothing is composed. */
+int32_t CostModelComposition::pickDirectRefFb(
+    int32_t composeBegin, int32_t composeEnd) {
+    int32_t refIdx = -1;
+    for (int32_t i = 0; i < (int32_t)mUiFbs.size(); i++) {
+        if (i >= composeBegin && i <= composeEnd)
+            continue;
+        if (!mUiFbs[i].scaleMatched)
+            continue;
+        if (refIdx < 0 || compareFbScale(mUiFbs[i].fb->mSourceCrop,
+                mUiFbs[i].fb->mDisplayFrame,
+                mUiFbs[refIdx].fb->mSourceCrop,
+                mUiFbs[refIdx].fb->mDisplayFrame) == -1) {
+            refIdx = i;
+        }
+    }
+    return refIdx;
+}
+
+/* Depth first search on ui fbs in zorder.
+ * Each fb is either on its own din, or inside the composed range
+ * [composeBegin, composeEnd], which takes one din for composer output.
+ */
+void CostModelComposition::searchAssignment(uint32_t idx,
+    int32_t composeBegin, int32_t composeEnd,
+    uint32_t directNum, uint64_t cost, uint64_t scanBytes) {
+    if (mSearchTimeout)
+        return;
+
+    mSearchNodes++;
+    if ((mSearchNodes % COST_DEADLINE_CHECK_NODES) == 0 &&
+        systemTime(SYSTEM_TIME_MONOTONIC) > mSearchDeadline) {
+        mSearchTimeout = true;
+        return;
+    }
+
+    if (mBestFound && cost >= mBestCost)
+        return;
+
+    if (idx == mUiFbs.size()) {
+        if (isAssignmentValid(composeBegin, composeEnd, scanBytes)) {
+            mBestBegin = composeBegin;
+            mBestEnd = composeEnd;
+            mBestCost = cost;
+            mBestScanBytes = scanBytes + mVideoBytes;
+            mBestFound = true;
+        }
+        return;
+    }
+
+    UiFbInfo & info = mUiFbs[idx];
+    bool composing = composeBegin >= 0 && composeEnd == (int32_t)idx - 1;
+    uint32_t usedDins = directNum + (composeBegin >= 0 ? 1 : 0);
+
+    /*put fb on its own din.*/
+    if (!info.mustCompose && usedDins < mOsdPlanes.size()) {
+        searchAssignment(idx + 1, composeBegin, composeEnd,
+            directNum + 1, cost + info.scanoutBytes, scanBytes + info.scanoutBytes);
+    }
+
+    /*compose fb, the composed range must be continuous.*/
+    uint64_t composeCost = info.composePixels * COST_GPU_PIXEL_WEIGHT + info.composeBytes;
+    if (composing) {
+        searchAssignment(idx + 1, composeBegin, idx,
+            directNum, cost + composeCost, scanBytes);
+    } else if (composeBegin < 0 && usedDins < mOsdPlanes.size()) {
+        searchAssignment(idx + 1, idx, idx, directNum,
+            cost + composeCost + mTargetBytes, scanBytes + mTargetScanBytes);
+    }
+}
+
+int CostModelComposition::applyAssignment() {
+    if (!mBestFound) {
+        /*no valid assignment in budget, compose all ui fbs.*/
+        mBestBegin = 0;
+        mBestEnd = mUiFbs.size() - 1;
+        mBestScanBytes = mTargetScanBytes + mVideoBytes;
+    }
+
+    if (mBestBegin >= 0) {
+        for (int32_t i = mBestBegin; i <= mBestEnd; i++) {
+            mComposerFbs.push_back(mUiFbs[i].fb);
+        }
+        mMinComposerZorder = mUiFbs[mBestBegin].fb->mZorder;
+        mMaxComposerZorder = mUiFbs[mBestEnd].fb->mZorder;
+        /*composed output is the base fb on din0.*/
+        mDisplayRefFb = mUiFbs[mBestEnd].fb;
+
+        /*video inside ui fbs is put to bottom, composer cut hole for it.*/
+        int topVideo = 0;
+        for (auto it = mVideoFbs.begin(); it != mVideoFbs.end(); ++it) {
+            if (it->lastUiBelow < 0)
+                continue;
+            if (!it->uiAbove && topVideo == 0) {
+                topVideo++;
+                continue;
+            }
+            if (it->fb->mZorder > mMaxComposerZorder)
+                mMaxComposerZorder = it->fb->mZorder;
+        }
+        for (auto it = mVideoFbs.begin(); it != mVideoFbs.end(); ++it) {
+            if (it->fb->mZorder >= mMinComposerZorder &&
+                it->fb->mZorder <= mMaxComposerZorder)
+                mOverlayFbs.push_back(it->fb);
+        }
+    } else {
+        int32_t refIdx = pickDirectRefFb(mBestBegin, mBestEnd);
+        MESON_ASSERT(refIdx >= 0, "no valid base fb.");
+        mDisplayRefFb = mUiFbs[refIdx].fb;
+    }
+
+    selectComposer();
+
+    /*din0 first, then other dins in zorder.*/
+    uint32_t din = OSD_PLANE_DIN_ZERO;
+    mDisplayPairs.push_back(DisplayPair{din, mDisplayRefFb->mZorder,
+        mDisplayRefFb, mOsdPlanes[din]});
+    din++;
+    for (int32_t i = 0; i < (int32_t)mUiFbs.size(); i++) {
+        std::shared_ptr<DrmFramebuffer> fb = mUiFbs[i].fb;
+        if (mBestBegin >= 0 && i >= mBestBegin && i <= mBestEnd)
+            continue;
+        if (fb == mDisplayRefFb) {
+            fb->mCompositionType = MESON_COMPOSITION_PLANE_OSD;
+            continue;
+        }
+        fb->mCompositionType = MESON_COMPOSITION_PLANE_OSD;
+        mDisplayPairs.push_back(DisplayPair{din, fb->mZorder, fb, mOsdPlanes[din]});
+        din++;
+    }
+
+    mOsdPlanes.erase(mOsdPlanes.begin(), mOsdPlanes.begin() + din);
+    return 0;
+}
+
+int CostModelComposition::selectComposer() {
+    if (mComposerFbs.size() == 0)
+        return 0;
+
+    bool haveClient = false;
+    for (auto it = mComposerFbs.begin(); it != mComposerFbs.end(); ++it) {
+        if ((*it)->mCompositionType == MESON_COMPOSITION_CLIENT)
+            haveClient = true;
+    }
+
+    if (!haveClient) {
+        for (auto it = mOtherComposers.begin(); it != mOtherComposers.end(); ++it) {
+            if ((*it)->isFbsSupport(mComposerFbs, mOverlayFbs)) {
+                mComposer = *it;
+                break;
+            }
+        }
+    }
+    if (mComposer.get() == NULL)
+        mComposer = mClientComposer;
+
+    for (auto it = mComposerFbs.begin(); it != mComposerFbs.end(); ++it) {
+        (*it)->mCompositionType = mComposer->getType();
+    }
+    return 0;
+}
+
+int CostModelComposition::decideComposition() {
+    if (mFramebuffers.empty()) {
+        MESON_LOGV("No layers to compose, exit.");
+        if (mClientComposer != NULL)
+            mClientComposer->prepare();
+        return 0;
+    }
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    handleVideoComposition();
+    applyCompositionFlags();
+    pickoutUiFbs();
+
+    if (!mUiFbs.empty() && mOsdPlanes.empty()) {
+        MESON_LOGE("No osd plane for %d ui fbs.", (int)mUiFbs.size());
+    } else if (!mUiFbs.empty()) {
+        mBestFound = false;
+        mBestBegin = mBestEnd = -1;
+        mBestCost = 0;
+        mBestScanBytes = 0;
+        mSearchNodes = 0;
+        mSearchTimeout = false;
+        mSearchDeadline = start + (nsecs_t)mSearchBudget * 1000;
+
+        if (mUiFbs.size() <= COST_MODEL_MAX_UI_FBS)
+            searchAssignment(0, -1, -1, 0, 0, 0);
+        if (mSearchTimeout)
+            mTimeoutCount++;
+
+        applyAssignment();
+    }
+
+    if (mComposer.get()) {
+        mComposer->prepare();
+        mComposer->addInputs(mComposerFbs, mOverlayFbs);
+    }
+
+    mDecideTime = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    return 0;
+}
+
+int CostModelComposition::commit() {
+    std::shared_ptr<DrmFramebuffer> composerOutput;
+    if (mComposer.get()) {
+        mComposer->start();
+        composerOutput = mComposer->getOutput();
+    }
+
+    uint32_t maxOsdZorder = 0;
+    for (auto it = mDisplayPairs.begin(); it != mDisplayPairs.end(); ++it) {
+        if (it->plane->getPlaneType() == OSD_PLANE) {
+            if (it->fb == mDisplayRefFb && mComposerFbs.size() > 0)
+                it->presentZorder = mMaxComposerZorder;
+            if (maxOsdZorder < it->presentZorder)
+                maxOsdZorder = it->presentZorder;
+        }
+    }
+
+    bool topVideo = false;
+    for (auto it = mDisplayPairs.begin(); it != mDisplayPairs.end(); ++it) {
+        std::shared_ptr<DrmFramebuffer> fb = it->fb;
+        std::shared_ptr<HwDisplayPlane> plane = it->plane;
+        uint32_t presentZorder = it->presentZorder;
+        int blankFlag = (mHideSecureLayer && fb->mSecure) ?
+            BLANK_FOR_SECURE_CONTENT : UNBLANK;
+
+        if (plane->getPlaneType() == OSD_PLANE) {
+            presentZorder += OSD_FB_BEGIN_ZORDER;
+        } else {
+            presentZorder = getVideoPresentZorder(fb, plane, presentZorder,
+                maxOsdZorder, topVideo);
+        }
+
+        if (composerOutput.get() && fb == mDisplayRefFb && mComposerFbs.size() > 0) {
+            bool bDumpPlane = true;
+            for (auto fbIt = mComposerFbs.begin(); fbIt != mComposerFbs.end(); ++fbIt) {
+                if (bDumpPlane) {
+                    dumpFbAndPlane(*fbIt, plane, presentZorder, blankFlag);
+                    bDumpPlane = false;
+                } else {
+                    dumpComposedFb(*fbIt);
+                }
+            }
+            fb = composerOutput;
+        } else {
+            dumpFbAndPlane(fb, plane, presentZorder, blankFlag);
+        }
+
+        plane->setPlane(fb, presentZorder, blankFlag);
+    }
+
+    /* Blank un-used plane. */
+    if (mLegacyVideoPlane.get())
+        mOtherPlanes.push_back(mLegacyVideoPlane);
+    if (mLegacyExtVideoPlane.get())
+        mOtherPlanes.push_back(mLegacyExtVideoPlane);
+    if (mHwcVideoPlane.get())
+        mOtherPlanes.push_back(mHwcVideoPlane);
+    for (auto it = mOsdPlanes.begin(); it != mOsdPlanes.end(); ++it) {
+        mOtherPlanes.push_back(*it);
+    }
+    for (auto it = mOtherPlanes.begin(); it != mOtherPlanes.end(); ++it) {
+        (*it)->setPlane(NULL, HWC_PLANE_FAKE_ZORDER, BLANK_FOR_NO_CONTENT);
+        dumpUnusedPlane(*it, BLANK_FOR_NO_CONTENT);
+    }
+
+    /*set crtc info, osd always output one channel.*/
+    mCrtc->setOsdChannels(1);
+    if (mDisplayRefFb.get()) {
+        std::shared_ptr<DrmFramebuffer> refFb = mDisplayRefFb;
+        if (mComposerFbs.size() > 0 && composerOutput.get()) {
+            refFb = composerOutput;
+            mOsdDisplayFrame.crtc_display_x = refFb->mDisplayFrame.left;
+            mOsdDisplayFrame.crtc_display_y = refFb->mDisplayFrame.top;
+        }
+        mOsdDisplayFrame.framebuffer_w = refFb->mSourceCrop.right - refFb->mSourceCrop.left;
+        mOsdDisplayFrame.framebuffer_h = refFb->mSourceCrop.bottom - refFb->mSourceCrop.top;
+        mOsdDisplayFrame.crtc_display_w = refFb->mDisplayFrame.right - refFb->mDisplayFrame.left;
+        mOsdDisplayFrame.crtc_display_h = refFb->mDisplayFrame.bottom - refFb->mDisplayFrame.top;
+    }
+    mCrtc->setDisplayFrame(mOsdDisplayFrame);
+    return 0;
+}
+
+void CostModelComposition::dump(String8 & dumpstr) {
+    ICompositionStrategy::dump(dumpstr);
+    dumpstr.appendFormat("BaseScaleInfo (%dx%d->%dx%d, %dx%d) \n",
+        mOsdDisplayFrame.framebuffer_w, mOsdDisplayFrame.framebuffer_h,
+        mOsdDisplayFrame.crtc_display_x, mOsdDisplayFrame.crtc_display_y,
+        mOsdDisplayFrame.crtc_display_w, mOsdDisplayFrame.crtc_display_h);
+    dumpstr.appendFormat("CostModel (cost %llu, nodes %u, decide %lld us, budget %u us, timeout %u) \n",
+        (unsigned long long)mBestCost, mSearchNodes, (long long)(mDecideTime / 1000),
+        mSearchBudget, mTimeoutCount);
+    mBandwidthModel.dump(dumpstr, mBestScanBytes);
+    mArena.dump(dumpstr);
+}
@@ -0,0 +1,157 @@
+/*
+* Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+*
+* This source code is subject to the terms and conditions defined in the
+* file 'LICENSE' which is part of this source code package.
+*
+* Description:
+*/
+
+#ifndef COST_MODEL_COMPOSITION_H
+#define COST_MODEL_COMPOSITION_H
+
+#include <FrameArena.h>
+#include "ICompositionStrategy.h"
+#include "BandwidthModel.h"
+
+/*
+CostModelComposition works on the same VPU topology as MultiplanesComposition:
+    din0 (no scaler, sets osd base scale), din1/din2 (freescale) -> OSD blend,
+    video1/video2 on legacy/hwc video planes, bottom or top of OSD.
+
+Instead of growing the client range greedily, it searches all fb->din
+assignments of the ui fbs (a ui fb is either scanout on its own din or
+composed into one contiguous composer output), and picks the one with the
+lowest estimated cost:
+    cost = composed pixels * COST_GPU_PIXEL_WEIGHT + DDR bytes per frame.
+Assignments whose planes scanout is over the DDR budget are not valid.
+The search is a depth first search pruned by the best cost found, and is
+stopped when the decide time budget is used up.
+*/
+
+#define COST_MODEL_MAX_UI_FBS       16   // bigger stack is composed by composer.
+#define COST_MODEL_DEFAULT_BUDGET   300  // decide budget in us.
+
+class CostModelComposition : public ICompositionStrategy {
+public:
+    CostModelComposition();
+    ~CostModelComposition();
+
+    const char* getName() {return "CostModelComposition";}
+
+    void setup(std::vector<std::shared_ptr<DrmFramebuffer>> & layers,
+        std::vector<std::shared_ptr<IComposer>> & composers,
+        std::vector<std::shared_ptr<HwDisplayPlane>> & planes,
+        std::shared_ptr<HwDisplayCrtc> & crtc,
+        uint32_t flags);
+
+    int decideComposition();
+    int commit();
+    void dump(String8 & dumpstr);
+
+    /*max time of one decide, in us.*/
+    void setSearchBudget(uint32_t budgetUs);
+
+protected:
+    void init();
+    int handleVideoComposition();
+    int applyCompositionFlags();
+    int pickoutUiFbs();
+
+    void searchAssignment(uint32_t idx, int32_t composeBegin,
+        int32_t composeEnd, uint32_t directNum, uint64_t cost, uint64_t scanBytes);
+    bool isAssignmentValid(int32_t composeBegin, int32_t composeEnd, uint64_t scanBytes);
+    int32_t pickDirectRefFb(int32_t composeBegin, int32_t composeEnd);
+    int applyAssignment();
+    int selectComposer();
+
+protected:
+    struct DisplayPair {
+        uint32_t din;
+        uint32_t presentZorder;
+        std::shared_ptr<DrmFramebuffer> fb;
+        std::shared_ptr<HwDisplayPlane> plane;
+    };
+
+    struct UiFbInfo {
+        std::shared_ptr<DrmFramebuffer> fb;
+        bool mustCompose;           // client or not supported by osd plane.
+        bool scaleMatched;          // can be the din0 base fb.
+        uint64_t composePixels;
+        uint64_t composeBytes;      // GPU read of this fb.
+        uint64_t scanoutBytes;      // VPU read of this fb.
+    };
+
+    struct VideoFbInfo {
+        std::shared_ptr<DrmFramebuffer> fb;
+        int32_t lastUiBelow;        // index of top ui fb under video, -1 if none.
+        bool uiAbove;
+    };
+
+    /* Input Flags from SF */
+    bool mHideSecureLayer;
+    bool mForceClientComposer;
+
+    /* Nodes of map and pairs are rebuilt every frame, keep them in arena. */
+    typedef ArenaAllocator<std::pair<const uint32_t, std::shared_ptr<DrmFramebuffer>>> FbMapAllocator;
+    typedef ArenaAllocator<DisplayPair> DisplayPairAllocator;
+    FrameArena mArena;
+
+    /* Input Fbs from SF, min zorder at begin. */
+    std::map<uint32_t, std::shared_ptr<DrmFramebuffer>, std::less<uint32_t>,
+        FbMapAllocator> mFramebuffers;
+    std::vector<UiFbInfo> mUiFbs;
+    std::vector<VideoFbInfo> mVideoFbs;
+
+    /* Scratch lists, members to keep their capacity between frames. */
+    std::vector<std::shared_ptr<DrmFramebuffer>> mDummyFbs;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mDummyOverlayFbs;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mVideoInputFbs;
+
+    std::shared_ptr<HwDisplayCrtc> mCrtc;
+
+    /* Composer */
+    std::shared_ptr<IComposer> mDummyComposer;
+    std::shared_ptr<IComposer> mClientComposer;
+    std::vector<std::shared_ptr<IComposer>> mOtherComposers;
+
+    /* Planes */
+    std::vector<std::shared_ptr<HwDisplayPlane>> mOsdPlanes;
+    std::shared_ptr<HwDisplayPlane> mHwcVideoPlane;
+    std::shared_ptr<HwDisplayPlane> mLegacyVideoPlane;
+    std::shared_ptr<HwDisplayPlane> mLegacyExtVideoPlane;
+    std::vector<std::shared_ptr<HwDisplayPlane>> mOtherPlanes;
+
+    /* Search state */
+    BandwidthModel mBandwidthModel;
+    uint64_t mVideoBytes;
+    uint64_t mTargetScanBytes;
+    uint64_t mTargetBytes;
+    uint64_t mTargetPixels;
+    int32_t mBestBegin;
+    int32_t mBestEnd;
+    uint64_t mBestCost;
+    uint64_t mBestScanBytes;
+    bool mBestFound;
+    nsecs_t mSearchDeadline;
+    bool mSearchTimeout;
+    uint32_t mSearchNodes;
+
+    /* Result */
+    std::shared_ptr<IComposer> mComposer;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mComposerFbs;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mOverlayFbs;
+    std::list<DisplayPair, DisplayPairAllocator> mDisplayPairs;
+    std::shared_ptr<DrmFramebuffer> mDisplayRefFb;
+    display_zoom_info_t mOsdDisplayFrame;
+    uint32_t mMinComposerZorder;
+    uint32_t mMaxComposerZorder;
+    bool mHaveClient;
+
+    /* Statistics */
+    uint32_t mSearchBudget;
+    nsecs_t mDecideTime;
+    uint32_t mTimeoutCount;
+};
+
+#endif/*COST_MODEL_COMPOSITION_H*/
@@ -10,18 +10,13 @@
 #include "MultiplanesComposition.h"
 #include <DrmTypes.h>
 #include <MesonLog.h>
+#include <CompositionHelper.h>
 
 #define LEGACY_VIDEO_MODE_SWITCH       0    // Only use in current device (Only one legacy video plane)
 #define OSD_OUTPUT_ONE_CHANNEL         1
 #define OSD_PLANE_DIN_ZERO             0    // din0: osd fb input
 #define OSD_PLANE_DIN_ONE              1    // din1: osd fb input
 #define OSD_PLANE_DIN_TWO              2    // din2: osd fb input
-#define VIDEO_PLANE_DIN_ONE            3    // video1: video fb input
-#define VIDEO_PLANE_DIN_TWO            4    // video2: video fb input
-#define OSD_FB_BEGIN_ZORDER            65   // osd zorder: 65 - 128
-#define TOP_VIDEO_FB_BEGIN_ZORDER      129  // top video zorder: 129 - 192
-#define BOTTOM_VIDEO_FB_BEGIN_ZORDER   1    // bottom video zorder: 1 - 64
-#define PIP_VIDEO_DISPLAYFRAME_SIZE    16
 
 
 #define OSD_SCALER_INPUT_MAX_WIDTH (1920)
@@ -31,9 +26,31 @@
 #define IS_FB_COMPOSED(fb) \
     (fb->mZorder >= mMinComposerZorder && fb->mZorder <= mMaxComposerZorder)
 
+/* FNV-1a, used to build the signature of layer stack. */
+#define PLAN_HASH_SEED      (14695981039346656037ULL)
+#define PLAN_HASH_PRIME     (1099511628211ULL)
+
+template <typename T>
+static inline void planHash(uint64_t & hash, const T & val) {
+    const uint8_t * data = (const uint8_t *)&val;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        hash ^= data[i];
+        hash *= PLAN_HASH_PRIME;
+    }
+}
 
 /* Constructor function */
-MultiplanesComposition::MultiplanesComposition() {}
+MultiplanesComposition::MultiplanesComposition()
+    : mFramebuffers(FbMapAllocator(&mArena)),
+      mDisplayPairs(DisplayPairAllocator(&mArena)) {
+    mPlan.valid = false;
+    mPlan.signature = 0;
+    mPlanSignature = 0;
+    mPlanCacheHits = 0;
+    mPlanCacheMisses = 0;
+    mFrameBytes = 0;
+    mDemotedFbs = 0;
+}
 
 /* Deconstructor function */
 MultiplanesComposition::~MultiplanesComposition() {}
@@ -77,84 +94,35 @@ void MultiplanesComposition::init() {
     mMinVideoZorder    = INVALID_ZORDER;
     mMaxVideoZorder    = INVALID_ZORDER;
 
-    mDumpStr.clear();
+    mFrameBytes = 0;
+    mDemotedFbs = 0;
+
+    /* Plan cache keeps mPlan, only drop references of last frame. */
+    mPlanSignature = 0;
+    mPlanFbs.clear();
+    mPlanComposers.clear();
+    mPlanPlanes.clear();
+
+    mDummyFbs.clear();
+    mUiFbs.clear();
+
+    clearDump();
+
+    /* Map and pairs are empty now, give their nodes back. */
+    mArena.reset();
 }
 
-/* Handle VIDEO Fbs and set VideoFbs2Plane pairs.
- * Current VIDEO plane support : 1 LegacyVideoPlane + 1 HwcVideoPlane
- * Future  VIDEO plane support : 2 HwcVideoPlane
- */
+/* Handle VIDEO Fbs and set VideoFbs2Plane pairs. */
 int MultiplanesComposition::handleVideoComposition() {
-    meson_compositon_t destComp;
-    static struct planeComp {
-        drm_fb_type_t srcFb;
-        drm_plane_type_t destPlane;
-        meson_compositon_t destComp;
-    } planeCompPairs [] = {
-        {DRM_FB_VIDEO_OVERLAY, LEGACY_VIDEO_PLANE,
-            MESON_COMPOSITION_PLANE_AMVIDEO},
-        {DRM_FB_VIDEO_OMX_PTS, LEGACY_VIDEO_PLANE,
-            MESON_COMPOSITION_PLANE_AMVIDEO},
-        {DRM_FB_VIDEO_SIDEBAND, LEGACY_VIDEO_PLANE,
-            MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND},
-        {DRM_FB_VIDEO_SIDEBAND_SECOND, LEGACY_EXT_VIDEO_PLANE,
-            MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND},
-        {DRM_FB_VIDEO_OMX_PTS_SECOND, LEGACY_EXT_VIDEO_PLANE,
-            MESON_COMPOSITION_PLANE_AMVIDEO},
-        {DRM_FB_VIDEO_OMX_V4L, HWC_VIDEO_PLANE,
-            MESON_COMPOSITION_PLANE_HWCVIDEO},
-    };
-    static int pairSize = sizeof(planeCompPairs) / sizeof(struct planeComp);
-
     std::shared_ptr<DrmFramebuffer> fb;
+    std::shared_ptr<HwDisplayPlane> plane;
+    uint32_t din;
     auto fbIt = mFramebuffers.begin();
     for (; fbIt != mFramebuffers.end(); ++fbIt) {
         fb = fbIt->second;
-        for (int i = 0; i < pairSize; i++) {
-            if (fb->mFbType == planeCompPairs[i].srcFb) {
-                uint32_t presentZorder = fb->mZorder;
-                destComp = planeCompPairs[i].destComp;
-                if (planeCompPairs[i].destPlane == LEGACY_VIDEO_PLANE) {
-                    if (mLegacyVideoPlane.get()) {
-                        mDisplayPairs.push_back(DisplayPair{VIDEO_PLANE_DIN_ONE, presentZorder, fb, mLegacyVideoPlane});
-                        mLegacyVideoPlane.reset();
-                    } else {
-                        MESON_LOGE("too many layers need LEGACY_VIDEO_PLANE, discard.");
-                        destComp = MESON_COMPOSITION_DUMMY;
-                    }
-                    fb->mCompositionType = destComp;
-                    break;
-                } else if (planeCompPairs[i].destPlane == LEGACY_EXT_VIDEO_PLANE) {
-                    int32_t width = 0, height = 0;
-                    width = abs(fb->mDisplayFrame.right - fb->mDisplayFrame.left);
-                    height = abs(fb->mDisplayFrame.bottom - fb->mDisplayFrame.top);
-                    if (width <= PIP_VIDEO_DISPLAYFRAME_SIZE && height <= PIP_VIDEO_DISPLAYFRAME_SIZE) {
-                        destComp = MESON_COMPOSITION_DUMMY;
-                    } else if (mLegacyExtVideoPlane.get()) {
-                        mDisplayPairs.push_back(DisplayPair{VIDEO_PLANE_DIN_TWO, presentZorder, fb, mLegacyExtVideoPlane});
-                        mLegacyExtVideoPlane.reset();
-                    } else {
-                        MESON_LOGE("too many layers need LEGACY_EXT_VIDEO_PLANE, discard.");
-                        destComp = MESON_COMPOSITION_DUMMY;
-                    }
-                    fb->mCompositionType = destComp;
-                    break;
-                } else if (planeCompPairs[i].destPlane == HWC_VIDEO_PLANE) {
-                    if (mHwcVideoPlane.get()) {
-                        mDisplayPairs.push_back(DisplayPair{VIDEO_PLANE_DIN_TWO, presentZorder, fb, mHwcVideoPlane});
-                        mHwcVideoPlane.reset();
-                    } else {
-                        MESON_LOGE("too many layers need HWC_VIDEO_PLANE, discard.");
-                        destComp = MESON_COMPOSITION_DUMMY;
-                    }
-                    fb->mCompositionType = destComp;
-                    break;
-                } else {
-                    MESON_LOGE("Not supported dest plane: %d", planeCompPairs[i].destPlane);
-                    break;
-                }
-            }
-        }
+        if (assignVideoPlane(fb, mLegacyVideoPlane, mLegacyExtVideoPlane,
+                mHwcVideoPlane, plane, din) && plane.get())
+            mDisplayPairs.push_back(DisplayPair{din, fb->mZorder, fb, plane});
     }
 
     return 0;
@@ -185,7 +153,6 @@ int MultiplanesComposition::applyCompositionFlags() {
 /* Delete dummy and video Fbs, then pickout OSD Fbs. */
 int MultiplanesComposition::pickoutOsdFbs() {
     std::shared_ptr<DrmFramebuffer> fb;
-    std::vector<std::shared_ptr<DrmFramebuffer>> dummyFbs;
     bool bRemove = false;
     bool bClientLayer = false;
     auto fbIt = mFramebuffers.begin();
@@ -195,7 +162,7 @@ int MultiplanesComposition::pickoutOsdFbs() {
         bClientLayer = false;
         switch (fb->mCompositionType) {
             case MESON_COMPOSITION_DUMMY:
-                dummyFbs.push_back(fb);
+                mDummyFbs.push_back(fb);
                 bRemove = true;
                 break;
 
@@ -242,10 +209,8 @@ int MultiplanesComposition::pickoutOsdFbs() {
             ++ fbIt;
     }
 
-    if (dummyFbs.size() > 0) {
-        std::vector<std::shared_ptr<DrmFramebuffer>> dummyOverlayFbs;
-        mDummyComposer->addInputs(dummyFbs, dummyOverlayFbs);
-    }
+    if (mDummyFbs.size() > 0)
+        mDummyComposer->addInputs(mDummyFbs, mDummyOverlayFbs);
 
 /* Only support one legacy video in current times. */
 #if LEGACY_VIDEO_MODE_SWITCH
@@ -413,34 +378,6 @@ int MultiplanesComposition::confirmComposerRange() {
     return 0;
 }
 
-int32_t compareFbScale(
-    drm_rect_t & aSrc,
-    drm_rect_t & aDst,
-    drm_rect_t & bSrc,
-    drm_rect_t & bDst) {
-    int32_t aDisplayWidth = aDst.right - aDst.left;
-    int32_t aDisplayHeight = aDst.bottom - aDst.top;
-    int32_t aSrcWidth = aSrc.right - aSrc.left;
-    int32_t aSrcHeight = aSrc.bottom - aSrc.top;
-    int32_t bDisplayWidth = bDst.right - bDst.left;
-    int32_t bDisplayHeight = bDst.bottom - bDst.top;
-    int32_t bSrcWidth = bSrc.right - bSrc.left;
-    int32_t bSrcHeight = bSrc.bottom - bSrc.top;
-
-    int widthCompare = aDisplayWidth*bSrcWidth - bDisplayWidth*aSrcWidth;
-    int heighCompare = aDisplayHeight *bSrcHeight - bDisplayHeight * aSrcHeight;
-    if (widthCompare == 0 && heighCompare == 0)
-        return 0;
-    else if (widthCompare > 0 && heighCompare > 0)
-        return 1;
-    else {
-        MESON_LOGW("compareFbScale failed %d ,%d, %d, %d",
-            widthCompare, heighCompare,
-            bDisplayWidth, bDisplayHeight);
-        return -1;
-    }
-}
-
 /* Set DisplayPairs between UI(OSD) Fbs with plane. */
 int MultiplanesComposition::setOsdFbs2PlanePairs() {
     if (mFramebuffers.size() == 0)
@@ -655,7 +592,7 @@ void MultiplanesComposition::handleVPULimit(bool video) {
 }
 
 void MultiplanesComposition::handleDispayLayerZorder() {
-    int topVideoNum = 0;
+    bool topVideo = false;
     uint32_t maxOsdZorder = INVALID_ZORDER;
     for (auto it = mDisplayPairs.begin(); it != mDisplayPairs.end(); ++it) {
         std::shared_ptr<DrmFramebuffer> fb = it->fb;
@@ -672,16 +609,8 @@ void MultiplanesComposition::handleDispayLayerZorder() {
     }
 
     for (auto it = mDisplayPairs.begin(); it != mDisplayPairs.end(); ++it) {
-        std::shared_ptr<DrmFramebuffer> fb = it->fb;
-        std::shared_ptr<HwDisplayPlane> plane = it->plane;
-        if (LEGACY_VIDEO_PLANE == plane->getPlaneType() || LEGACY_EXT_VIDEO_PLANE == plane->getPlaneType()) {
-            if (fb->mZorder > maxOsdZorder && topVideoNum != 1) {
-                it->presentZorder = it->presentZorder + TOP_VIDEO_FB_BEGIN_ZORDER; // top video zorder: 129 - 192
-                topVideoNum++;
-            } else {
-                it->presentZorder = it->presentZorder + BOTTOM_VIDEO_FB_BEGIN_ZORDER; // bottom video zorder: 1 - 64
-            }
-        }
+        it->presentZorder = getVideoPresentZorder(it->fb, it->plane,
+            it->presentZorder, maxOsdZorder, topVideo);
     }
 }
 
@@ -811,6 +740,301 @@ zorder: 8 -- osd ---------                      | 8 -- osd ---------
     return 0;
 }
 
+/* Demote the ui fbs with biggest bandwidth to composer,
+ * until planes scanout fit in the ddr budget.
+ */
+int MultiplanesComposition::applyBandwidthLimit() {
+    if (!mBandwidthModel.hasBudget())
+        return 0;
+
+    mUiFbs.clear();
+    drm_rect_t uiFrame = {0, 0, 0, 0};
+    uint64_t frameBytes = 0;
+    bool haveClient = false;
+    bool haveUi = false;
+
+    for (auto fbIt = mFramebuffers.begin(); fbIt != mFramebuffers.end(); ++fbIt) {
+        std::shared_ptr<DrmFramebuffer> fb = fbIt->second;
+        switch (fb->mCompositionType) {
+            case MESON_COMPOSITION_PLANE_AMVIDEO:
+            case MESON_COMPOSITION_PLANE_AMVIDEO_SIDEBAND:
+            case MESON_COMPOSITION_PLANE_HWCVIDEO:
+                frameBytes += mBandwidthModel.estimateFbBytes(fb);
+                continue;
+            case MESON_COMPOSITION_CLIENT:
+                haveClient = true;
+                break;
+            case MESON_COMPOSITION_UNDETERMINED:
+                {
+                    uint64_t bytes = mBandwidthModel.estimateFbBytes(fb);
+                    mUiFbs.push_back(std::make_pair(bytes, fb));
+                    frameBytes += bytes;
+                }
+                break;
+            default:
+                continue;
+        }
+
+        if (!haveUi) {
+            uiFrame = fb->mDisplayFrame;
+            haveUi = true;
+        } else {
+            uiFrame.left = std::min(uiFrame.left, fb->mDisplayFrame.left);
+            uiFrame.top = std::min(uiFrame.top, fb->mDisplayFrame.top);
+            uiFrame.right = std::max(uiFrame.right, fb->mDisplayFrame.right);
+            uiFrame.bottom = std::max(uiFrame.bottom, fb->mDisplayFrame.bottom);
+        }
+    }
+
+    uint64_t targetBytes = mBandwidthModel.estimateTargetBytes(uiFrame);
+    if (haveClient)
+        frameBytes += targetBytes;
+
+    while (mBandwidthModel.exceedBudget(frameBytes) && !mUiFbs.empty()) {
+        auto maxIt = mUiFbs.begin();
+        for (auto it = mUiFbs.begin(); it != mUiFbs.end(); ++it) {
+            if (it->first > maxIt->first)
+                maxIt = it;
+        }
+
+        maxIt->second->mCompositionType = MESON_COMPOSITION_CLIENT;
+        frameBytes -= maxIt->first;
+        if (!haveClient) {
+            frameBytes += targetBytes;
+            haveClient = true;
+        }
+        mUiFbs.erase(maxIt);
+        mDemotedFbs++;
+    }
+
+    if (mBandwidthModel.exceedBudget(frameBytes)) {
+        MESON_LOGV("bandwidth %u MB/s still over budget.",
+            mBandwidthModel.toBandwidth(frameBytes));
+    }
+
+    return 0;
+}
+
+/* Bytes read by vpu for current display pairs. */
+uint64_t MultiplanesComposition::estimateFrameBytes() {
+    uint64_t frameBytes = 0;
+    for (auto it = mDisplayPairs.begin(); it != mDisplayPairs.end(); ++it) {
+        if (mComposer.get() && it->fb->mCompositionType == mComposer->getType()) {
+            frameBytes += mBandwidthModel.estimateTargetBytes(it->fb->mDisplayFrame);
+        } else {
+            frameBytes += mBandwidthModel.estimateFbBytes(it->fb);
+        }
+    }
+    return frameBytes;
+}
+
+/* Signature of everything the strategy reads from fbs, planes and composers.
+ * Same signature means decideComposition() will get the same result.
+ */
+uint64_t MultiplanesComposition::computePlanSignature(
+    std::vector<std::shared_ptr<IComposer>> & composers,
+    std::vector<std::shared_ptr<HwDisplayPlane>> & planes) {
+    uint64_t hash = PLAN_HASH_SEED;
+    uint32_t fbNum = mFramebuffers.size();
+
+    planHash(hash, mCompositionFlag);
+    planHash(hash, fbNum);
+    if (mBandwidthModel.hasBudget()) {
+        float refreshRate = mBandwidthModel.getRefreshRate();
+        planHash(hash, refreshRate);
+    }
+    for (auto fbIt = mFramebuffers.begin(); fbIt != mFramebuffers.end(); ++fbIt) {
+        std::shared_ptr<DrmFramebuffer> fb = fbIt->second;
+        planHash(hash, fb->mZorder);
+        planHash(hash, fb->mFbType);
+        planHash(hash, fb->mCompositionType);
+        planHash(hash, fb->mSecure);
+        planHash(hash, fb->mBlendMode);
+        planHash(hash, fb->mTransform);
+        planHash(hash, fb->mSourceCrop);
+        planHash(hash, fb->mDisplayFrame);
+        planHash(hash, fb->mPlaneAlpha);
+        planHash(hash, fb->mDataspace);
+        bool hdrMeta = !fb->mHdrMetaData.empty();
+        planHash(hash, hdrMeta);
+        if (fb->mBufferHandle) {
+            int format = fb->mBufferInfo.format;
+            int afbc = fb->mBufferInfo.afbcMask;
+            planHash(hash, format);
+            planHash(hash, afbc);
+            if (fb->mFbType == DRM_FB_CURSOR) {
+                bool coherent = fb->mBufferInfo.coherent;
+                planHash(hash, coherent);
+            }
+        }
+    }
+
+    /* planes and composers are kept by display, compare by object
+     * and the state strategy reads from them.
+     */
+    for (auto it = composers.begin(); it != composers.end(); ++it) {
+        IComposer * composer = it->get();
+        uint32_t stateSeq = composer->getStateSeq();
+        planHash(hash, composer);
+        planHash(hash, stateSeq);
+    }
+    for (auto it = planes.begin(); it != planes.end(); ++it) {
+        HwDisplayPlane * plane = it->get();
+        /* idle or hidden plane reports INVALID_PLANE. */
+        uint32_t type = plane->getPlaneType();
+        uint32_t caps = plane->getCapabilities();
+        planHash(hash, plane);
+        planHash(hash, type);
+        planHash(hash, caps);
+    }
+
+    return hash;
+}
+
+int32_t MultiplanesComposition::indexOfPlanFb(
+    std::shared_ptr<DrmFramebuffer> & fb) {
+    for (uint32_t i = 0; i < mPlanFbs.size(); i++) {
+        if (mPlanFbs[i] == fb)
+            return i;
+    }
+    return -1;
+}
+
+int32_t MultiplanesComposition::indexOfPlanPlane(
+    std::shared_ptr<HwDisplayPlane> & plane) {
+    for (uint32_t i = 0; i < mPlanPlanes.size(); i++) {
+        if (mPlanPlanes[i] == plane)
+            return i;
+    }
+    return -1;
+}
+
+/* Save result of decideComposition() as indexes of fbs/planes/composers. */
+void MultiplanesComposition::recordCompositionPlan() {
+    mPlan.valid = false;
+    mPlan.signature = mPlanSignature;
+    mPlan.compositionTypes.clear();
+    mPlan.displayPairs.clear();
+    mPlan.composerFbs.clear();
+    mPlan.overlayFbs.clear();
+    mPlan.freeOsdPlanes.clear();
+
+    for (auto it = mPlanFbs.begin(); it != mPlanFbs.end(); ++it) {
+        mPlan.compositionTypes.push_back((*it)->mCompositionType);
+    }
+
+    for (auto it = mDisplayPairs.begin(); it != mDisplayPairs.end(); ++it) {
+        PlanPair pair = {it->din, it->presentZorder,
+            indexOfPlanFb(it->fb), indexOfPlanPlane(it->plane)};
+        if (pair.fbIdx < 0 || pair.planeIdx < 0)
+            return;
+        mPlan.displayPairs.push_back(pair);
+    }
+
+    for (auto it = mComposerFbs.begin(); it != mComposerFbs.end(); ++it) {
+        int32_t idx = indexOfPlanFb(*it);
+        if (idx < 0)
+            return;
+        mPlan.composerFbs.push_back(idx);
+    }
+
+    for (auto it = mOverlayFbs.begin(); it != mOverlayFbs.end(); ++it) {
+        int32_t idx = indexOfPlanFb(*it);
+        if (idx < 0)
+            return;
+        mPlan.overlayFbs.push_back(idx);
+    }
+
+    for (auto it = mOsdPlanes.begin(); it != mOsdPlanes.end(); ++it) {
+        int32_t idx = indexOfPlanPlane(*it);
+        if (idx < 0)
+            return;
+        mPlan.freeOsdPlanes.push_back(idx);
+    }
+
+    mPlan.composerIdx = -1;
+    if (mComposer.get()) {
+        for (uint32_t i = 0; i < mPlanComposers.size(); i++) {
+            if (mPlanComposers[i] == mComposer) {
+                mPlan.composerIdx = i;
+                break;
+            }
+        }
+        if (mPlan.composerIdx < 0)
+            return;
+    }
+
+    mPlan.displayRefFbIdx = -1;
+    if (mDisplayRefFb.get()) {
+        mPlan.displayRefFbIdx = indexOfPlanFb(mDisplayRefFb);
+        if (mPlan.displayRefFbIdx < 0)
+            return;
+    }
+
+    mPlan.freeLegacyVideoPlane = mLegacyVideoPlane.get() != NULL;
+    mPlan.freeLegacyExtVideoPlane = mLegacyExtVideoPlane.get() != NULL;
+    mPlan.freeHwcVideoPlane = mHwcVideoPlane.get() != NULL;
+    mPlan.haveClient = mHaveClient;
+    mPlan.insideVideoFbsFlag = mInsideVideoFbsFlag;
+    mPlan.minComposerZorder = mMinComposerZorder;
+    mPlan.maxComposerZorder = mMaxComposerZorder;
+    mPlan.minVideoZorder = mMinVideoZorder;
+    mPlan.maxVideoZorder = mMaxVideoZorder;
+    mPlan.osdDisplayFrame = mOsdDisplayFrame;
+    mPlan.valid = true;
+}
+
+/* Rebuild the decision of last frame, return false if plan is not usable. */
+bool MultiplanesComposition::replayCompositionPlan() {
+    if (!mPlan.valid || mPlan.signature != mPlanSignature ||
+        mPlan.compositionTypes.size() != mPlanFbs.size())
+        return false;
+
+    for (uint32_t i = 0; i < mPlanFbs.size(); i++) {
+        mPlanFbs[i]->mCompositionType = mPlan.compositionTypes[i];
+        if (mPlanFbs[i]->mCompositionType == MESON_COMPOSITION_DUMMY)
+            mDummyFbs.push_back(mPlanFbs[i]);
+    }
+    if (mDummyFbs.size() > 0)
+        mDummyComposer->addInputs(mDummyFbs, mDummyOverlayFbs);
+
+    for (auto it = mPlan.displayPairs.begin(); it != mPlan.displayPairs.end(); ++it) {
+        mDisplayPairs.push_back(DisplayPair{it->din, it->presentZorder,
+            mPlanFbs[it->fbIdx], mPlanPlanes[it->planeIdx]});
+    }
+    for (auto it = mPlan.composerFbs.begin(); it != mPlan.composerFbs.end(); ++it) {
+        mComposerFbs.push_back(mPlanFbs[*it]);
+    }
+    for (auto it = mPlan.overlayFbs.begin(); it != mPlan.overlayFbs.end(); ++it) {
+        mOverlayFbs.push_back(mPlanFbs[*it]);
+    }
+
+    mOsdPlanes.clear();
+    for (auto it = mPlan.freeOsdPlanes.begin(); it != mPlan.freeOsdPlanes.end(); ++it) {
+        mOsdPlanes.push_back(mPlanPlanes[*it]);
+    }
+    if (!mPlan.freeLegacyVideoPlane)
+        mLegacyVideoPlane.reset();
+    if (!mPlan.freeLegacyExtVideoPlane)
+        mLegacyExtVideoPlane.reset();
+    if (!mPlan.freeHwcVideoPlane)
+        mHwcVideoPlane.reset();
+
+    if (mPlan.composerIdx >= 0)
+        mComposer = mPlanComposers[mPlan.composerIdx];
+    if (mPlan.displayRefFbIdx >= 0)
+        mDisplayRefFb = mPlanFbs[mPlan.displayRefFbIdx];
+
+    mHaveClient = mPlan.haveClient;
+    mInsideVideoFbsFlag = mPlan.insideVideoFbsFlag;
+    mMinComposerZorder = mPlan.minComposerZorder;
+    mMaxComposerZorder = mPlan.maxComposerZorder;
+    mMinVideoZorder = mPlan.minVideoZorder;
+    mMaxVideoZorder = mPlan.maxVideoZorder;
+    mOsdDisplayFrame = mPlan.osdDisplayFrame;
+    return true;
+}
+
 /* The public setup interface.
  * layers: UI(include OSD and VIDEO) layer from SurfaceFlinger.
  * composers: Composer style.
@@ -840,6 +1064,9 @@ void MultiplanesComposition::setup(
     }
 
     mCrtc = crtc;
+    drm_mode_info_t mode;
+    if (mCrtc->getMode(mode) == 0)
+        mBandwidthModel.setRefreshRate(mode.refreshRate);
 
     /* add layers */
     auto layerIt = layers.begin();
@@ -912,6 +1139,14 @@ void MultiplanesComposition::setup(
                 break;
         }
     }
+
+    /* keep inputs for plan cache. */
+    for (auto fbIt = mFramebuffers.begin(); fbIt != mFramebuffers.end(); ++fbIt) {
+        mPlanFbs.push_back(fbIt->second);
+    }
+    mPlanComposers = composers;
+    mPlanPlanes = planes;
+    mPlanSignature = computePlanSignature(composers, planes);
 }
 
 /* Decide to choose whcih Fbs and how to build OsdFbs2Plane pairs. */
@@ -925,31 +1160,57 @@ int MultiplanesComposition::decideComposition() {
         return ret;
     }
 
-    /* handle VIDEO Fbs. */
-    handleVideoComposition();
+    if (replayCompositionPlan()) {
+        mPlanCacheHits++;
+    } else {
+        mPlanCacheMisses++;
 
-    /* handle HDR mode, hide secure layer, and force client. */
-    applyCompositionFlags();
+        /* handle VIDEO Fbs. */
+        handleVideoComposition();
 
-    /* Remove dummy and video Fbs for later osd composition.
-     * Pickout OSD Fbs.
-     * Save client flag.
-     */
-    pickoutOsdFbs();
+        /* handle HDR mode, hide secure layer, and force client. */
+        applyCompositionFlags();
 
-    if (!mInsideVideoFbsFlag) {
-        handleOsdComposition();
-    } else {
-        handleOsdCompostionWithVideo();
+        /* move fbs to composer if planes are over ddr budget. */
+        applyBandwidthLimit();
+
+        /* Remove dummy and video Fbs for later osd composition.
+         * Pickout OSD Fbs.
+         * Save client flag.
+         */
+        pickoutOsdFbs();
+
+        if (!mInsideVideoFbsFlag) {
+            handleOsdComposition();
+        } else {
+            handleOsdCompostionWithVideo();
+        }
+
+        recordCompositionPlan();
     }
 
+    prepareComposer();
+    return ret;
+}
+
+/* Present without validate, only the accepted plan is used. */
+int MultiplanesComposition::replayComposition() {
+    if (mFramebuffers.empty() || !replayCompositionPlan())
+        return -EINVAL;
+
+    mPlanCacheHits++;
+    prepareComposer();
+    return 0;
+}
+
+void MultiplanesComposition::prepareComposer() {
+    mFrameBytes = estimateFrameBytes();
+
     /* record overlayFbs and start to compose */
     if (mComposer.get()) {
         mComposer->prepare();
         mComposer->addInputs(mComposerFbs, mOverlayFbs);
     }
-
-    return ret;
 }
 
 /* Commit DisplayPair to display. */
@@ -1050,4 +1311,9 @@ void MultiplanesComposition::dump(String8 & dumpstr) {
         mOsdDisplayFrame.framebuffer_w, mOsdDisplayFrame.framebuffer_h,
         mOsdDisplayFrame.crtc_display_x, mOsdDisplayFrame.crtc_display_y,
         mOsdDisplayFrame.crtc_display_w, mOsdDisplayFrame.crtc_display_h);
+    dumpstr.appendFormat("PlanCache (hit %u, miss %u) \n",
+        mPlanCacheHits, mPlanCacheMisses);
+    mBandwidthModel.dump(dumpstr, mFrameBytes);
+    dumpstr.appendFormat("Bandwidth demoted fbs: %u \n", mDemotedFbs);
+    mArena.dump(dumpstr);
 }
@@ -11,7 +11,9 @@
 #define MULTIPLANES_COMPOSITION_H
 
 #include <functional>
+#include <FrameArena.h>
 #include "ICompositionStrategy.h"
+#include "BandwidthModel.h"
 
 
 /*
@@ -65,6 +67,7 @@ public:
         uint32_t flags);
 
     int decideComposition();
+    int replayComposition();
     int commit();
     void dump(String8 & dumpstr);
 
@@ -84,7 +87,18 @@ protected:
     void handleDispayLayerZorder();
     int handleOsdComposition();
     int handleOsdCompostionWithVideo();
+    int applyBandwidthLimit();
+    uint64_t estimateFrameBytes();
 
+    /* Composition plan cache. */
+    uint64_t computePlanSignature(
+        std::vector<std::shared_ptr<IComposer>> & composers,
+        std::vector<std::shared_ptr<HwDisplayPlane>> & planes);
+    void recordCompositionPlan();
+    bool replayCompositionPlan();
+    void prepareComposer();
+    int32_t indexOfPlanFb(std::shared_ptr<DrmFramebuffer> & fb);
+    int32_t indexOfPlanPlane(std::shared_ptr<HwDisplayPlane> & plane);
 
 protected:
     struct DisplayPair {
@@ -99,8 +113,14 @@ protected:
     bool mHideSecureLayer;
     bool mForceClientComposer;
 
+    /* Nodes of map and pairs are rebuilt every frame, keep them in arena. */
+    typedef ArenaAllocator<std::pair<const uint32_t, std::shared_ptr<DrmFramebuffer>>> FbMapAllocator;
+    typedef ArenaAllocator<DisplayPair> DisplayPairAllocator;
+    FrameArena mArena;
+
     /* Input Fbs from SF, min zorder at begin, max zorder at end. */
-    std::map<uint32_t, std::shared_ptr<DrmFramebuffer>, std::less<uint32_t>> mFramebuffers;
+    std::map<uint32_t, std::shared_ptr<DrmFramebuffer>, std::less<uint32_t>,
+        FbMapAllocator> mFramebuffers;
 
     /*reffb is the fb used to setup the osddisplayframe.*/
     std::shared_ptr<DrmFramebuffer> mDisplayRefFb;
@@ -124,7 +144,12 @@ protected:
     std::shared_ptr<IComposer> mComposer;                       // Handle composer Fbs
     std::vector<std::shared_ptr<DrmFramebuffer>> mOverlayFbs;
     std::vector<std::shared_ptr<DrmFramebuffer>> mComposerFbs;  // Save Fbs that should be composered
-    std::list<DisplayPair> mDisplayPairs;
+    std::list<DisplayPair, DisplayPairAllocator> mDisplayPairs;
+
+    /* Scratch lists, members to keep their capacity between frames. */
+    std::vector<std::shared_ptr<DrmFramebuffer>> mDummyFbs;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mDummyOverlayFbs;
+    std::vector<std::pair<uint64_t, std::shared_ptr<DrmFramebuffer>>> mUiFbs;
 
     bool mHaveClient;
     bool mInsideVideoFbsFlag;      // Has VIDEO between different OSD ui layers.
@@ -132,6 +157,49 @@ protected:
     uint32_t mMaxComposerZorder;
     uint32_t mMinVideoZorder;
     uint32_t mMaxVideoZorder;
+
+    /* DDR bandwidth of planes */
+    BandwidthModel mBandwidthModel;
+    uint64_t mFrameBytes;
+    uint32_t mDemotedFbs;
+
+    /* Plan cache: decision of last frame, replayed if signature matches. */
+    struct PlanPair {
+        uint32_t din;
+        uint32_t presentZorder;
+        int32_t fbIdx;
+        int32_t planeIdx;
+    };
+
+    struct CompositionPlan {
+        bool valid;
+        uint64_t signature;
+        std::vector<int32_t> compositionTypes;  // per fb, in zorder
+        std::vector<PlanPair> displayPairs;
+        std::vector<int32_t> composerFbs;
+        std::vector<int32_t> overlayFbs;
+        std::vector<int32_t> freeOsdPlanes;
+        int32_t composerIdx;
+        int32_t displayRefFbIdx;
+        bool freeLegacyVideoPlane;
+        bool freeLegacyExtVideoPlane;
+        bool freeHwcVideoPlane;
+        bool haveClient;
+        bool insideVideoFbsFlag;
+        uint32_t minComposerZorder;
+        uint32_t maxComposerZorder;
+        uint32_t minVideoZorder;
+        uint32_t maxVideoZorder;
+        display_zoom_info_t osdDisplayFrame;
+    };
+
+    CompositionPlan mPlan;
+    uint64_t mPlanSignature;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mPlanFbs;
+    std::vector<std::shared_ptr<IComposer>> mPlanComposers;
+    std::vector<std::shared_ptr<HwDisplayPlane>> mPlanPlanes;
+    uint32_t mPlanCacheHits;
+    uint32_t mPlanCacheMisses;
 };
 
 
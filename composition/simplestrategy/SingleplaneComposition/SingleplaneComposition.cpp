@@ -12,7 +12,8 @@
 #include <MesonLog.h>
 
 /*---------------------  SingleplaneComposition  ---------------------*/
-SingleplaneComposition::SingleplaneComposition() {
+SingleplaneComposition::SingleplaneComposition()
+    : mDisplayPairs(DisplayPairAllocator(&mArena)) {
 }
 
 SingleplaneComposition::~SingleplaneComposition() {
@@ -41,8 +42,12 @@ void SingleplaneComposition::cleanup() {
     mOverlayFbs.clear();
     mComposer.reset();
     mDisplayPairs.clear();
+    mDummyFbs.clear();
 
-    mDumpStr.clear();
+    clearDump();
+
+    /*pairs are empty now, give their nodes back.*/
+    mArena.reset();
 }
 
 void SingleplaneComposition::setup(
@@ -223,8 +228,6 @@ bool SingleplaneComposition::isFbScanable(
 }
 
 int SingleplaneComposition::buildOsdComposition() {
-    std::vector<std::shared_ptr<DrmFramebuffer>> dummyFbs;
-    std::vector<std::shared_ptr<DrmFramebuffer>> dummyOverlayFbs;
     std::shared_ptr<DrmFramebuffer> fb;
     std::shared_ptr<DrmFramebuffer> videoFb;
     uint32_t  minZ = INVALID_ZORDER, maxZ = INVALID_ZORDER;
@@ -240,7 +243,7 @@ int SingleplaneComposition::buildOsdComposition() {
         fb = *it;
         switch (fb->mCompositionType) {
             case MESON_COMPOSITION_DUMMY:
-                dummyFbs.push_back(fb);
+                mDummyFbs.push_back(fb);
                 bRemove = true;
                 break;
             case MESON_COMPOSITION_PLANE_CURSOR:
@@ -274,8 +277,8 @@ int SingleplaneComposition::buildOsdComposition() {
             ++ it;
     }
 
-    if (dummyFbs.size() > 0)
-        mDummyComposer->addInputs(dummyFbs, dummyOverlayFbs);
+    if (mDummyFbs.size() > 0)
+        mDummyComposer->addInputs(mDummyFbs, mDummyOverlayFbs);
 
     /*
     * Check if video fb is between other UI fbs.
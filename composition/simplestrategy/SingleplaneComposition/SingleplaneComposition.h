@@ -11,6 +11,7 @@
 #define SINGLEPLANE_COMPOSITION_H
 
 #include <BasicTypes.h>
+#include <FrameArena.h>
 #include <HwDisplayPlane.h>
 #include <ICompositionStrategy.h>
 
@@ -76,10 +77,16 @@ protected:
     /*input fbs*/
     std::vector<std::shared_ptr<DrmFramebuffer>> mFramebuffers;
 
-    /*members used for composition*/
+    /*members used for composition, pairs are rebuilt every frame in arena.*/
+    typedef ArenaAllocator<DisplayPair> DisplayPairAllocator;
+    FrameArena mArena;
     std::vector<std::shared_ptr<DrmFramebuffer>> mOverlayFbs;
     std::shared_ptr<IComposer> mComposer;
-    std::list<DisplayPair> mDisplayPairs;
+    std::list<DisplayPair, DisplayPairAllocator> mDisplayPairs;
+
+    /*scratch lists, members to keep their capacity between frames.*/
+    std::vector<std::shared_ptr<DrmFramebuffer>> mDummyFbs;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mDummyOverlayFbs;
 };
 
 #endif/*SINGLEPLANE_COMPOSITION_H*/
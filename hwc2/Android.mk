@@ -38,10 +38,18 @@ ifeq ($(HWC_SUPPORT_MODES_LIST), true)
 LOCAL_CFLAGS += -DHWC_SUPPORT_MODES_LIST
 endif
 
+# bind operator new of hwc code to the counting one.
+ifeq ($(HWC_ENABLE_ALLOC_STAT), true)
+LOCAL_LDFLAGS += -Wl,-Bsymbolic-functions
+endif
+
 LOCAL_SRC_FILES := \
     Hwc2Base.cpp \
+    Hwc2CommitThread.cpp \
     Hwc2Display.cpp \
     Hwc2Layer.cpp \
+    Hwc2LayerList.cpp \
+    Hwc2LayerTable.cpp \
     Hwc2Module.cpp \
     HwcModeMgr.cpp \
     FixedSizeModeMgr.cpp \
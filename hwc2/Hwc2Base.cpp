@@ -26,6 +26,7 @@ hwc2_composition_t mesonComp2Hwc2Comp(Hwc2Layer * layer) {
         case MESON_COMPOSITION_PLANE_HWCVIDEO:
         case MESON_COMPOSITION_PLANE_OSD:
         case MESON_COMPOSITION_GE2D:
+        case MESON_COMPOSITION_CPU:
         default:
             if (layer->mFbType == DRM_FB_COLOR)
                 hwcCompostion = HWC2_COMPOSITION_SOLID_COLOR;
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <DebugHelper.h>
+#include <MesonLog.h>
+
+#include "Hwc2CommitThread.h"
+
+#define COMMIT_FRAME_EVENT (1)
+#define FRAME_TIMELINE_COMMIT_PATH "/data/vendor/hwc/timeline_commit_crtc%d.bin"
+
+DeferredPlane::DeferredPlane(std::shared_ptr<HwDisplayPlane> & plane,
+    Hwc2CommitThread * thread)
+    : HwDisplayPlane(::dup(plane->getDrvFd()), plane->getPlaneId()) {
+    mPlane = plane;
+    mThread = thread;
+    mIdle = false;
+
+    /*commit thread is not started, real plane is free to probe.*/
+    mPlane->setIdle(true);
+    mIdleType = mPlane->getPlaneType();
+    mPlane->setIdle(false);
+    mType = mPlane->getPlaneType();
+}
+
+DeferredPlane::~DeferredPlane() {
+    mPlane.reset();
+}
+
+/*driver errors of the real plane are only logged on commit thread.*/
+int32_t DeferredPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb,
+    uint32_t zorder, int blankOp) {
+    mThread->recordPlane(mPlane, fb, zorder, blankOp, mIdle);
+    return 0;
+}
+
+Hwc2CommitThread::Hwc2CommitThread(std::shared_ptr<HwDisplayCrtc> & crtc,
+    std::vector<std::shared_ptr<HwDisplayPlane>> & planes) {
+    mCrtc = crtc;
+    for (auto it = planes.begin(); it != planes.end(); ++it)
+        mDeferredPlanes.push_back(std::make_shared<DeferredPlane>(*it, this));
+    mPlaneCommits.reserve(planes.size());
+
+    mProcessorFlags = 0;
+    mFrameSeq = 0;
+    mBusy = false;
+    mLastDriverFence = DrmFence::NO_FENCE;
+
+    mQueuedFrames = mSignaledFrames = mReusedFrames = mBlockedFrames = 0;
+    mMaxBlockTime = mMaxCommitTime = 0;
+
+    mThread = std::make_shared<EventThread>("hwc-commit");
+    mThread->setHandler(this);
+    mThread->start();
+}
+
+Hwc2CommitThread::~Hwc2CommitThread() {
+    waitIdle();
+    mThread.reset();
+    /*pending present fences are signaled when the timeline is closed.*/
+    FenceWatcher::getInstance().cancel(this);
+    mDeferredPlanes.clear();
+    mSnapshots.clear();
+}
+
+void Hwc2CommitThread::recordPlane(std::shared_ptr<HwDisplayPlane> & plane,
+    std::shared_ptr<DrmFramebuffer> & fb, uint32_t zorder, int blankOp, bool idle) {
+    PlaneCommit commit;
+    commit.plane = plane;
+    commit.zorder = zorder;
+    commit.blankOp = blankOp;
+    commit.idle = idle;
+
+    /*source fb may be changed by surfaceflinger before it is posted.*/
+    if (fb.get()) {
+        FbSnapshot & snapshot = mSnapshots[fb.get()];
+        bool refBuffer = !snapshot.fb || snapshot.srcHandle != fb->mBufferHandle
+            || fb->mContentUpdated;
+        if (!snapshot.fb)
+            snapshot.fb = std::make_shared<DrmFramebuffer>();
+        snapshot.fb->copyFrom(*fb, refBuffer);
+        snapshot.srcHandle = fb->mBufferHandle;
+        snapshot.frameSeq = mFrameSeq + 1;
+        commit.fb = snapshot.fb;
+    }
+
+    mPlaneCommits.push_back(commit);
+}
+
+void Hwc2CommitThread::waitIdle() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (!mBusy)
+        return;
+
+    nsecs_t begin = systemTime(CLOCK_MONOTONIC);
+    while (mBusy)
+        mIdleCond.wait(lock);
+
+    nsecs_t blockTime = systemTime(CLOCK_MONOTONIC) - begin;
+    mBlockedFrames++;
+    if (blockTime > mMaxBlockTime)
+        mMaxBlockTime = blockTime;
+}
+
+int32_t Hwc2CommitThread::queueFrame(std::shared_ptr<HwcPostProcessor> & processor,
+    int32_t processorFlags) {
+    mFrameSeq++;
+    /*drop snapshots of fbs not in this frame.*/
+    for (auto it = mSnapshots.begin(); it != mSnapshots.end();) {
+        if (it->second.frameSeq != mFrameSeq)
+            it = mSnapshots.erase(it);
+        else
+            ++it;
+    }
+
+    int32_t presentFence = mTimeline.createFence("hwc-present", mFrameSeq);
+    mPostProcessor = processor;
+    mProcessorFlags = processorFlags;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBusy = true;
+        mQueuedFrames++;
+    }
+    mThread->sendEvent(COMMIT_FRAME_EVENT);
+    return presentFence;
+}
+
+void Hwc2CommitThread::dropFrame() {
+    mPlaneCommits.clear();
+}
+
+void Hwc2CommitThread::handleEvent(int what) {
+    if (what == COMMIT_FRAME_EVENT)
+        commitFrame();
+}
+
+void Hwc2CommitThread::commitFrame() {
+    nsecs_t begin = systemTime(CLOCK_MONOTONIC);
+    FRAME_TIMELINE_BIND(&mFrameTimeline);
+    FenceWatchScope fenceScope(mCrtc->getId(), mFrameSeq);
+
+    int32_t driverFence = -1;
+    {
+        FRAME_TIMELINE_STAGE(FRAME_STAGE_PRESENT);
+        /*osd planes skip clean fbs, check all of them.*/
+        bool planeUpdated = false;
+        {
+            FRAME_TIMELINE_STAGE(FRAME_STAGE_COMMIT);
+            for (auto it = mPlaneCommits.begin(); it != mPlaneCommits.end(); ++it) {
+                it->plane->setIdle(it->idle);
+                if (it->plane->setPlane(it->fb, it->zorder, it->blankOp) != 0)
+                    MESON_LOGE("async commit plane %s failed.", it->plane->getName());
+                if (it->plane->getPlaneType() == OSD_PLANE && it->plane->checkUpdated())
+                    planeUpdated = true;
+            }
+        }
+
+        if (!planeUpdated && !mCrtc->isDisplayFrameUpdated()) {
+            /*nothing posted, screen keeps the last frame.*/
+            driverFence = mLastDriverFence->dup();
+            mReusedFrames++;
+        } else if (mCrtc->pageFlip(driverFence) == 0) {
+            mLastDriverFence = driverFence >= 0 ?
+                std::make_shared<DrmFence>(::dup(driverFence)) : DrmFence::NO_FENCE;
+        } else {
+            MESON_LOGE("async commit page flip failed.");
+            driverFence = -1;
+        }
+
+        if (mPostProcessor != NULL) {
+            FRAME_TIMELINE_STAGE(FRAME_STAGE_POST_PROCESS);
+            int32_t displayFence = ::dup(driverFence);
+            mPostProcessor->present(mProcessorFlags, displayFence);
+        }
+        FRAME_TIMELINE_END_FRAME(driverFence);
+    }
+    signalFrame(driverFence);
+
+    mPlaneCommits.clear();
+    mPostProcessor.reset();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    nsecs_t commitTime = systemTime(CLOCK_MONOTONIC) - begin;
+    if (commitTime > mMaxCommitTime)
+        mMaxCommitTime = commitTime;
+    mBusy = false;
+    mIdleCond.notify_all();
+}
+
+/*present fence of the frame signals with the driver fence, fd is taken.*/
+void Hwc2CommitThread::signalFrame(int32_t driverFence) {
+    if (driverFence >= 0) {
+        fence_watch_tag_t tag = FenceWatcher::makeTag(FENCE_WATCH_PRESENT);
+        if (FenceWatcher::getInstance().watch(::dup(driverFence), tag, this) == 0) {
+            close(driverFence);
+            return;
+        }
+        /*watcher is full, frames must still signal in order.*/
+        FenceWatcher::getInstance().waitForever(driverFence, tag);
+    }
+
+    mTimeline.inc(1);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSignaledFrames++;
+}
+
+void Hwc2CommitThread::onFenceSignaled(const fence_watch_tag_t & tag __unused,
+    nsecs_t submitTime __unused, nsecs_t signalTime __unused) {
+    /*driver fences signal in order, so do the timeline points.*/
+    mTimeline.inc(1);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSignaledFrames++;
+}
+
+void Hwc2CommitThread::dump(String8 & dumpstr) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        dumpstr.appendFormat("Async present: queued %" PRIu64 ", signaled %" PRIu64
+            ", reused %" PRIu64 ", blocked %" PRIu64 " (max %.2f ms), max commit %.2f ms\n",
+            mQueuedFrames, mSignaledFrames, mReusedFrames, mBlockedFrames,
+            mMaxBlockTime / 1000000.0, mMaxCommitTime / 1000000.0);
+    }
+#ifdef HWC_ENABLE_FRAME_TIMELINE
+    dumpstr.append("Commit thread:\n");
+    mFrameTimeline.dump(dumpstr);
+    if (DebugHelper::getInstance().saveTimeline()) {
+        char path[128];
+        snprintf(path, sizeof(path), FRAME_TIMELINE_COMMIT_PATH, mCrtc->getId());
+        if (mFrameTimeline.save(path, mCrtc->getId()) == 0)
+            dumpstr.appendFormat("Commit timeline saved to %s\n", path);
+    }
+#endif
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Post planes and page flip of a display on its own thread, present
+ *     returns a fence of a sw_sync timeline which follows the driver fences.
+ */
+
+#ifndef HWC2_COMMIT_THREAD_H
+#define HWC2_COMMIT_THREAD_H
+
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+#include <DrmSync.h>
+#include <DrmFramebuffer.h>
+#include <HwDisplayCrtc.h>
+#include <HwDisplayPlane.h>
+#include <HwcPostProcessor.h>
+#include <EventThread.h>
+#include <FenceWatcher.h>
+#include <FrameTimeline.h>
+
+#define ASYNC_PRESENT_PROP "vendor.hwc.async-present"
+
+class Hwc2CommitThread;
+
+/*
+ * Plane handed to composition strategy in async mode, setPlane is
+ * recorded with a snapshot of fb and posted later on commit thread.
+ */
+class DeferredPlane : public HwDisplayPlane {
+public:
+    DeferredPlane(std::shared_ptr<HwDisplayPlane> & plane, Hwc2CommitThread * thread);
+    ~DeferredPlane();
+
+    const char * getName() { return mPlane->getName(); }
+    /*idle state is recorded here, real plane gets it on commit thread.*/
+    uint32_t getPlaneType() { return mIdle ? mIdleType : mType; }
+    uint32_t getCapabilities() { return mPlane->getCapabilities(); }
+    int32_t getFixedZorder() { return mPlane->getFixedZorder(); }
+    uint32_t getPossibleCrtcs() { return mPlane->getPossibleCrtcs(); }
+    bool isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
+        return mPlane->isFbSupport(fb);
+    }
+
+    int32_t setPlane(std::shared_ptr<DrmFramebuffer> fb, uint32_t zorder, int blankOp);
+    void setIdle(bool idle) { mIdle = idle; }
+    void dump(String8 & dumpstr) { mPlane->dump(dumpstr); }
+
+protected:
+    std::shared_ptr<HwDisplayPlane> mPlane;
+    Hwc2CommitThread * mThread;
+    uint32_t mType;
+    uint32_t mIdleType;     /*type real plane reports when idle.*/
+};
+
+class Hwc2CommitThread : public EventHandler, public FenceListener {
+public:
+    Hwc2CommitThread(std::shared_ptr<HwDisplayCrtc> & crtc,
+        std::vector<std::shared_ptr<HwDisplayPlane>> & planes);
+    ~Hwc2CommitThread();
+
+    /*sw_sync is not available on all kernels.*/
+    bool isValid() { return mTimeline.isValid(); }
+
+    /*planes for composition strategy, they record instead of posting.*/
+    std::vector<std::shared_ptr<HwDisplayPlane>> & getPlanes() { return mDeferredPlanes; }
+    void recordPlane(std::shared_ptr<HwDisplayPlane> & plane,
+        std::shared_ptr<DrmFramebuffer> & fb, uint32_t zorder, int blankOp, bool idle);
+
+    /*last queued frame is posted, planes and crtc can be touched.*/
+    void waitIdle();
+    /*post recorded planes on commit thread, return present fence of the frame.*/
+    int32_t queueFrame(std::shared_ptr<HwcPostProcessor> & processor,
+        int32_t processorFlags);
+    void dropFrame();
+
+    void handleEvent(int what);
+    void onFenceSignaled(const fence_watch_tag_t & tag,
+        nsecs_t submitTime, nsecs_t signalTime);
+
+    void dump(String8 & dumpstr);
+
+protected:
+    void commitFrame();
+    void signalFrame(int32_t driverFence);
+
+protected:
+    struct PlaneCommit {
+        std::shared_ptr<HwDisplayPlane> plane;
+        std::shared_ptr<DrmFramebuffer> fb;
+        uint32_t zorder;
+        int blankOp;
+        bool idle;
+    };
+
+    /*snapshots reused for same source fb, plane can still skip a clean fb.*/
+    struct FbSnapshot {
+        std::shared_ptr<DrmFramebuffer> fb;
+        const native_handle_t * srcHandle;
+        uint32_t frameSeq;
+    };
+
+    std::shared_ptr<HwDisplayCrtc> mCrtc;
+    std::vector<std::shared_ptr<HwDisplayPlane>> mDeferredPlanes;
+    std::shared_ptr<EventThread> mThread;
+    DrmTimeLine mTimeline;
+
+    /*frame recorded by present thread, posted by commit thread.*/
+    std::vector<PlaneCommit> mPlaneCommits;
+    std::unordered_map<DrmFramebuffer *, FbSnapshot> mSnapshots;
+    std::shared_ptr<HwcPostProcessor> mPostProcessor;
+    int32_t mProcessorFlags;
+    uint32_t mFrameSeq;
+
+    std::mutex mMutex;
+    std::condition_variable mIdleCond;
+    bool mBusy;
+
+    /*commit thread only.*/
+    std::shared_ptr<DrmFence> mLastDriverFence;
+#ifdef HWC_ENABLE_FRAME_TIMELINE
+    FrameTimeline mFrameTimeline;
+#endif
+
+    /*stats.*/
+    uint64_t mQueuedFrames;
+    uint64_t mSignaledFrames;
+    uint64_t mReusedFrames;
+    uint64_t mBlockedFrames;
+    nsecs_t mMaxBlockTime;
+    nsecs_t mMaxCommitTime;
+};
+
+#endif/*HWC2_COMMIT_THREAD_H*/
@@ -21,7 +21,14 @@
 #include <ComposerFactory.h>
 #include <CompositionStrategyFactory.h>
 #include <EventThread.h>
+#include <HwcReactor.h>
+#include <FenceWatcher.h>
+#include <DrmBufferRegistry.h>
 #include <systemcontrol.h>
+#include <misc.h>
+
+#define IDLE_TIMEOUT_PROP "vendor.hwc.idle-timeout"
+#define IDLE_TIMEOUT_EVENT (1)
 
 Hwc2Display::Hwc2Display(std::shared_ptr<Hwc2DisplayObserver> observer) {
     mObserver = observer;
@@ -30,13 +37,31 @@ Hwc2Display::Hwc2Display(std::shared_ptr<Hwc2DisplayObserver> observer) {
     mSignalHpd = false;
     mValidateDisplay = false;
     mVsyncState = false;
+    mClientTargetHnd = NULL;
+    mLastPresentFence = DrmFence::NO_FENCE;
+    mReusedPresentFrames = 0;
+    mIdleTimeout = 0;
+    mIdleState = IDLE_NONE;
+    mIdleEnterCount = mIdleExitCount = 0;
+    mAcceptedComposition = false;
+    mCompositionFlags = 0;
+    mPresentFrames = mSkipValidateFrames = 0;
     memset(&mHdrCaps, 0, sizeof(mHdrCaps));
     memset(mColorMatrix, 0, sizeof(float) * 16);
     memset(&mCalibrateCoordinates, 0, sizeof(int) * 4);
+    memset(&mAdjustedCalibrateInfo, 0, sizeof(mAdjustedCalibrateInfo));
+    memset(&mFrameAlloc, 0, sizeof(mFrameAlloc));
+    memset(&mLastFrameAlloc, 0, sizeof(mLastFrameAlloc));
+    mMaxFrameAllocs = mAllocStatFrames = mAllocFreeFrames = 0;
+    mMaxFrameHeapGrowth = 0;
 }
 
 Hwc2Display::~Hwc2Display() {
-    mLayers.clear();
+    /*stop idle timer first, it calls back to display.*/
+    mIdleThread.reset();
+    mCommitThread.reset();
+    mLayerList.clear();
+    mLayerTable.clear();
     mPlanes.clear();
     mComposers.clear();
 
@@ -61,6 +86,7 @@ int32_t Hwc2Display::setModeMgr(std::shared_ptr<HwcModeMgr> & mgr) {
 
     if (mModeMgr->getDisplayMode(mDisplayMode) == 0) {
         mPowerMode->setConnectorStatus(true);
+        updateFenceVsyncPeriod();
     }
     MESON_LOG_FUN_LEAVE();
     return 0;
@@ -81,8 +107,13 @@ int32_t Hwc2Display::initialize() {
     ComposerFactory::create(MESON_GE2D_COMPOSER, composer);
     mComposers.emplace(MESON_GE2D_COMPOSER, std::move(composer));
 #endif
+#if defined(HWC_ENABLE_CPU_COMPOSITION)
+    ComposerFactory::create(MESON_CPU_COMPOSER, composer);
+    mComposers.emplace(MESON_CPU_COMPOSER, std::move(composer));
+    mCpuComposerCanvas = std::make_shared<DrmFramebuffer>();
+#endif
 
-    initLayerIdGenerator();
+    initIdleDetector();
 
     MESON_LOG_FUN_LEAVE();
     return 0;
@@ -95,10 +126,20 @@ int32_t Hwc2Display::setDisplayResource(
     MESON_LOG_FUN_ENTER();
     std::lock_guard<std::mutex> lock(mMutex);
 
+    /*last frame posted before planes change.*/
+    mCommitThread.reset();
     mCrtc = crtc;
     mPlanes = planes;
     mConnector = connector;
 
+    if (sys_get_bool_prop(ASYNC_PRESENT_PROP, false)) {
+        mCommitThread = std::make_shared<Hwc2CommitThread>(mCrtc, mPlanes);
+        if (!mCommitThread->isValid()) {
+            MESON_LOGE("No sw_sync timeline, async present disabled.");
+            mCommitThread.reset();
+        }
+    }
+
     /*update composition strategy.*/
     uint32_t strategyFlags = 0;
     int osdPlanes = 0;
@@ -111,8 +152,12 @@ int32_t Hwc2Display::setDisplayResource(
             }
         }
     }
+    /*cost model strategy can be selected for A/B test.*/
+    uint32_t strategyType = SIMPLE_STRATEGY;
+    if (sys_get_bool_prop("vendor.hwc.cost-composition", false))
+        strategyType = COST_MODEL_STRATEGY;
     auto newCompositionStrategy =
-        CompositionStrategyFactory::create(SIMPLE_STRATEGY, strategyFlags);
+        CompositionStrategyFactory::create(strategyType, strategyFlags);
     if (newCompositionStrategy != mCompositionStrategy) {
         MESON_LOGD("Update composition %s -> %s",
             mCompositionStrategy != NULL ? mCompositionStrategy->getName() : "NULL",
@@ -124,6 +169,7 @@ int32_t Hwc2Display::setDisplayResource(
 #ifdef HWC_HDR_METADATA_SUPPORT
     mCrtc->getHdrMetadataKeys(mHdrKeys);
 #endif
+    updateFenceVsyncPeriod();
 
     MESON_LOG_FUN_LEAVE();
     return 0;
@@ -164,6 +210,8 @@ int32_t Hwc2Display::setVsync(std::shared_ptr<HwcVsync> vsync) {
 int32_t Hwc2Display::blankDisplay() {
     MESON_LOGD("blank all display planes");
     std::lock_guard<std::mutex> lock(mMutex);
+    if (mCommitThread.get())
+        mCommitThread->waitIdle();
 
     for (auto it = mPlanes.begin(); it != mPlanes.end(); ++ it) {
         (*it)->setPlane(NULL, HWC_PLANE_FAKE_ZORDER, BLANK_FOR_NO_CONTENT);
@@ -278,6 +326,7 @@ void Hwc2Display::cleanupBeforeDestroy() {
 void Hwc2Display::onUpdate(bool bHdcp) {
     std::lock_guard<std::mutex> lock(mMutex);
     MESON_LOGD("On update: [%s]", bHdcp == true ? "HDCP verify success" : "HDCP verify fail");
+    mAcceptedComposition = false;
 
     if (bHdcp) {
         if (mObserver != NULL) {
@@ -301,6 +350,7 @@ void Hwc2Display::onModeChanged(int stage) {
     {
         std::lock_guard<std::mutex> lock(mMutex);
         MESON_LOGD("On mode change state: [%s]", stage == 1 ? "Complete" : "Begin to change");
+        mAcceptedComposition = false;
         if (stage == 1) {
             if (mObserver != NULL) {
                 /*plug in and set displaymode ok, update inforamtion.*/
@@ -315,6 +365,7 @@ void Hwc2Display::onModeChanged(int stage) {
                 if (mModeMgr->getDisplayMode(mDisplayMode) == 0) {
                     MESON_LOGD("Hwc2Display::onModeChanged getDisplayMode [%s]", mDisplayMode.name);
                     mPowerMode->setConnectorStatus(true);
+                    updateFenceVsyncPeriod();
                     if (mSignalHpd) {
                         bSendPlugIn = true;
                         mSignalHpd = false;
@@ -347,66 +398,52 @@ void Hwc2Display::onModeChanged(int stage) {
     mObserver->refresh();
 }
 
-/*
-LayerId is 16bits.
-Higher 8 Bits: now is 256 layer slot, the higher 8 bits is the slot index.
-Lower 8 Bits: a sequence no, used to distinguish layers have same slot index (
-which may happended a layer destoryed and at the same time a new layer created.)
-*/
-#define MAX_HWC_LAYERS (256)
-#define LAYER_SLOT_BITS (8)
-
-void Hwc2Display::initLayerIdGenerator() {
-    mLayersBitmap = std::make_shared<BitsMap>(MAX_HWC_LAYERS);
-    mLayerSeq = 0;
-}
-
-hwc2_layer_t Hwc2Display::createLayerId() {
-    hwc2_layer_t layerId = 0;
-    int idx = mLayersBitmap->getZeroBit();
-    mLayersBitmap->setBit(idx);
-
-    mLayerSeq++;
-    mLayerSeq %= MAX_HWC_LAYERS;
-
-    layerId = ((idx & (MAX_HWC_LAYERS - 1)) << LAYER_SLOT_BITS) |mLayerSeq;
-    return layerId;
-}
-
-void Hwc2Display::destroyLayerId(hwc2_layer_t id) {
-    int slotIdx = id >> LAYER_SLOT_BITS;
-    mLayersBitmap->clearBit(slotIdx);
-}
-
 hwc2_error_t Hwc2Display::createLayer(hwc2_layer_t * outLayer) {
     std::lock_guard<std::mutex> lock(mMutex);
 
-    std::shared_ptr<Hwc2Layer> layer = std::make_shared<Hwc2Layer>();
-    uint32_t idx = createLayerId();
-    *outLayer = idx;
-    layer->setUniqueId(*outLayer);
-    mLayers.emplace(*outLayer, layer);
+    std::shared_ptr<Hwc2Layer> layer = mLayerTable.createLayer();
+    if (layer.get() == NULL)
+        return HWC2_ERROR_NO_RESOURCES;
+    *outLayer = layer->getUniqueId();
+    mLayerList.addLayer(layer);
+    mAcceptedComposition = false;
 
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Display::destroyLayer(hwc2_layer_t  inLayer) {
     std::lock_guard<std::mutex> lock(mMutex);
+    if (mLayerTable.destroyLayer(inLayer) != 0)
+        return HWC2_ERROR_BAD_LAYER;
     DebugHelper::getInstance().removeDebugLayer((int)inLayer);
 
-    mLayers.erase(inLayer);
-    destroyLayerId(inLayer);
+    mLayerList.removeLayer(inLayer);
+    mAcceptedComposition = false;
     return HWC2_ERROR_NONE;
 }
 
-hwc2_error_t Hwc2Display::setCursorPosition(hwc2_layer_t layer __unused,
-    int32_t x __unused, int32_t y __unused) {
-    MESON_LOG_EMPTY_FUN();
-    return HWC2_ERROR_NONE;
+/*layer list is sorted again when the new zorder is latched.*/
+hwc2_error_t Hwc2Display::setLayerZorder(hwc2_layer_t inLayer, uint32_t z) {
+    std::shared_ptr<Hwc2Layer> layer = getLayerById(inLayer);
+    if (layer.get() == NULL)
+        return HWC2_ERROR_BAD_LAYER;
+
+    return layer->setZorder(z);
+}
+
+hwc2_error_t Hwc2Display::setCursorPosition(hwc2_layer_t inLayer,
+    int32_t x, int32_t y) {
+    std::shared_ptr<Hwc2Layer> layer = getLayerById(inLayer);
+    if (layer.get() == NULL)
+        return HWC2_ERROR_BAD_LAYER;
+
+    return layer->setCursorPosition(x, y);
 }
 
 hwc2_error_t Hwc2Display::setColorTransform(const float* matrix,
     android_color_transform_t hint) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mAcceptedComposition = false;
 
     if (hint == HAL_COLOR_TRANSFORM_IDENTITY) {
         mForceClientComposer = false;
@@ -423,48 +460,60 @@ hwc2_error_t Hwc2Display::setPowerMode(hwc2_power_mode_t mode __unused) {
     return HWC2_ERROR_NONE;
 }
 
+/*called by layer setters without display lock.*/
 std::shared_ptr<Hwc2Layer> Hwc2Display::getLayerById(hwc2_layer_t id) {
-    std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>>::iterator it =
-        mLayers.find(id);
-
-    if (it != mLayers.end())
-        return it->second;
+    return mLayerTable.getLayer(id);
+}
 
-    return NULL;
+/*states set since last latch become the layers' states of this frame.*/
+void Hwc2Display::latchLayerStates() {
+    /*buffers imported by the latch age with frames of this display.*/
+    BufferRegistryScope registryScope(mCrtc.get() ? mCrtc->getId() : -1);
+    std::vector<std::shared_ptr<Hwc2Layer>> & layers = mLayerList.getUnsortedLayers();
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        if ((*it)->latchPendingState() & LAYER_CHANGE_ZORDER)
+            mLayerList.invalidateOrder();
+    }
 }
 
 hwc2_error_t Hwc2Display::collectLayersForPresent() {
     /*
     * 1) add reference to Layers to keep it alive during display.
     * 2) for special layer, update its composition type.
-    * 3) sort Layers by zorder for composition.
+    * 3) layer list is kept in zorder, no need to sort.
     */
-    mPresentLayers.reserve(10);
+    std::vector<std::shared_ptr<Hwc2Layer>> & layers = mLayerList.getLayers();
+    mPresentLayers.reserve(layers.size());
 
     /*Check if layer list is changed or not*/
     bool bUpdateLayerList = false;
-    for (auto it = mLayers.begin(); it != mLayers.end(); it++) {
-        std::shared_ptr<Hwc2Layer> layer = it->second;
-        if (layer->isUpdateZorder() == true) {
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        if ((*it)->isUpdateZorder() == true) {
             bUpdateLayerList = true;
             break;
         }
     }
 
-    for (auto it = mLayers.begin(); it != mLayers.end(); it++) {
-        std::shared_ptr<Hwc2Layer> layer = it->second;
-        std::shared_ptr<DrmFramebuffer> buffer = layer;
+    bool bHeadless = HwcConfig::isHeadlessMode();
+    /*copied only when debug commands hid layers, member keeps capacity.*/
+    mHideLayers.clear();
+    if (DebugHelper::getInstance().debugHideLayers())
+        DebugHelper::getInstance().getHideLayers(mHideLayers);
+
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        Hwc2Layer * layer = it->get();
         if (bUpdateLayerList == true && layer->isUpdateZorder() == false) {
             continue;
         }
-        mPresentLayers.push_back(buffer);
+        mPresentLayers.push_back(*it);
 
-        if (isLayerHideForDebug(it->first)) {
+        if (!mHideLayers.empty() &&
+            isLayerHideForDebug(layer->getUniqueId(), mHideLayers)) {
             layer->mCompositionType = MESON_COMPOSITION_DUMMY;
             continue;
         }
 
-        if (HwcConfig::isHeadlessMode()) {
+        if (bHeadless) {
             layer->mCompositionType = MESON_COMPOSITION_DUMMY;
         } else {
             if (layer->mHwcCompositionType == HWC2_COMPOSITION_CLIENT) {
@@ -483,22 +532,11 @@ hwc2_error_t Hwc2Display::collectLayersForPresent() {
         }
     }
 
-    if (mPresentLayers.size() > 1) {
-        /* Sort mComposeLayers by zorder. */
-        struct {
-            bool operator() (std::shared_ptr<DrmFramebuffer> a,
-                std::shared_ptr<DrmFramebuffer> b) {
-                return a->mZorder > b->mZorder;
-            }
-        } zorderCompare;
-        std::sort(mPresentLayers.begin(), mPresentLayers.end(), zorderCompare);
-    }
-
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Display::collectPlanesForPresent() {
-    mPresentPlanes = mPlanes;
+    mPresentPlanes = mCommitThread.get() ? mCommitThread->getPlanes() : mPlanes;
     for (auto  it = mPresentPlanes.begin(); it != mPresentPlanes.end(); it++) {
         std::shared_ptr<HwDisplayPlane> plane = *it;
         if (isPlaneHideForDebug(plane->getPlaneId())) {
@@ -525,6 +563,10 @@ hwc2_error_t Hwc2Display::collectCompositionStgForPresent() {
 }
 
 hwc2_error_t Hwc2Display::setCalibrateInfo(int32_t caliX,int32_t caliY,int32_t caliW,int32_t caliH){
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCalibrateCoordinates[0] != caliX || mCalibrateCoordinates[1] != caliY ||
+        mCalibrateCoordinates[2] != caliW || mCalibrateCoordinates[3] != caliH)
+        mAcceptedComposition = false;
 
     mCalibrateCoordinates[0] = caliX;
     mCalibrateCoordinates[1] = caliY;
@@ -580,9 +622,16 @@ int32_t Hwc2Display::adjustDisplayFrame() {
         bNoScale = true;
     }
 
+    /*only new display frames need adjust, unless calibration changed.*/
+    bool bAllLayers = memcmp(&mAdjustedCalibrateInfo, &mCalibrateInfo,
+        sizeof(display_zoom_info_t)) != 0;
+    mAdjustedCalibrateInfo = mCalibrateInfo;
+
     Hwc2Layer * layer;
     for (auto it = mPresentLayers.begin() ; it != mPresentLayers.end(); it++) {
         layer = (Hwc2Layer*)(it->get());
+        if (!bAllLayers && !(layer->getChangedFlags() & LAYER_CHANGE_GEOMETRY))
+            continue;
         if (bNoScale) {
             layer->mDisplayFrame = layer->mBackupDisplayFrame;
         } else {
@@ -604,9 +653,8 @@ int32_t Hwc2Display::adjustDisplayFrame() {
     return 0;
 }
 
-hwc2_error_t Hwc2Display::validateDisplay(uint32_t* outNumTypes,
-    uint32_t* outNumRequests) {
-    std::lock_guard<std::mutex> lock(mMutex);
+/*collect layers and decide composition, used by validate and present.*/
+hwc2_error_t Hwc2Display::prepareComposition() {
     /*clear data used in composition.*/
     mPresentLayers.clear();
     mPresentComposers.clear();
@@ -659,18 +707,57 @@ hwc2_error_t Hwc2Display::validateDisplay(uint32_t* outNumTypes,
     }
     /*do composition*/
     if (!mSkipComposition) {
+        /*strategy reads planes and crtc the commit thread may still post.*/
+        if (mCommitThread.get())
+            mCommitThread->waitIdle();
         mPowerMode->setScreenStatus(mPresentLayers.size() > 0 ? false : true);
         /*update calibrate info.*/
         loadCalibrateInfo();
         /*update displayframe before do composition.*/
         if (mPresentLayers.size() > 0)
             adjustDisplayFrame();
+#if defined(HWC_ENABLE_CPU_COMPOSITION)
+        updateCpuComposerCanvas();
+#endif
+        updateIdleState(compositionFlags);
+        captureCompositionTrace(compositionFlags);
+        mCompositionFlags = compositionFlags;
         /*setup composition strategy.*/
         mPresentCompositionStg->setup(mPresentLayers,
             mPresentComposers, mPresentPlanes, mCrtc, compositionFlags);
-        if (mPresentCompositionStg->decideComposition() < 0) {
+        int32_t decided;
+        {
+            FRAME_TIMELINE_STAGE(FRAME_STAGE_DECIDE);
+            decided = mPresentCompositionStg->decideComposition();
+        }
+        if (decided < 0) {
             return HWC2_ERROR_NO_RESOURCES;
         }
+    }
+
+    return HWC2_ERROR_NONE;
+}
+
+hwc2_error_t Hwc2Display::validateDisplay(uint32_t* outNumTypes,
+    uint32_t* outNumRequests) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    AllocStatScope allocStat(this);
+    FRAME_TIMELINE_BIND(&mTimeline);
+    FRAME_TIMELINE_STAGE(FRAME_STAGE_VALIDATE);
+    mAcceptedComposition = false;
+
+    latchLayerStates();
+    hwc2_error_t ret = prepareComposition();
+    if (ret != HWC2_ERROR_NONE) {
+        return ret;
+    }
+    /*last frame's layers are replaced by this one now.*/
+    mLayerTable.trimFreeLayers();
+
+    if (!mSkipComposition) {
+        /*changes of composed layers are handled.*/
+        for (auto it = mPresentLayers.begin(); it != mPresentLayers.end(); it++)
+            ((Hwc2Layer*)(it->get()))->clearChangedFlags();
 
         /*collect changed dispplay, layer, compostiion.*/
         ret = collectCompositionRequest(outNumTypes, outNumRequests);
@@ -730,10 +817,10 @@ hwc2_error_t Hwc2Display::collectCompositionRequest(
     /*collcet client clear layer.*/
     std::shared_ptr<IComposer> clientComposer =
         mComposers.find(MESON_CLIENT_COMPOSER)->second;
-    std::vector<std::shared_ptr<DrmFramebuffer>> overlayLayers;
-    if (0 == clientComposer->getOverlyFbs(overlayLayers) ) {
-        auto it = overlayLayers.begin();
-        for (; it != overlayLayers.end(); ++it) {
+    mClientOverlayFbs.clear();
+    if (0 == clientComposer->getOverlyFbs(mClientOverlayFbs) ) {
+        auto it = mClientOverlayFbs.begin();
+        for (; it != mClientOverlayFbs.end(); ++it) {
             layer = (Hwc2Layer*)(it->get());
             mOverlayLayers.push_back(layer->getUniqueId());
         }
@@ -768,7 +855,7 @@ hwc2_error_t Hwc2Display::getChangedCompositionTypes(
     *outNumElements = mChangedLayers.size();
     if (outLayers && outTypes) {
         for (uint32_t i = 0; i < mChangedLayers.size(); i++) {
-            std::shared_ptr<Hwc2Layer> layer = mLayers.find(mChangedLayers[i])->second;
+            std::shared_ptr<Hwc2Layer> layer = mLayerTable.getLayer(mChangedLayers[i]);
             outTypes[i] = mesonComp2Hwc2Comp(layer.get());
             outLayers[i] = mChangedLayers[i];
         }
@@ -785,27 +872,100 @@ hwc2_error_t Hwc2Display::acceptDisplayChanges() {
     }
 
     /* set updateZorder flag to false */
-    for (auto it = mLayers.begin(); it != mLayers.end(); it++) {
-        std::shared_ptr<Hwc2Layer> layer = it->second;
-        layer->updateZorder(false);
+    std::vector<std::shared_ptr<Hwc2Layer>> & layers = mLayerList.getLayers();
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        (*it)->updateZorder(false);
     }
 
     return HWC2_ERROR_NONE;
 }
 
+/*
+ * Surfaceflinger may present without validate, it is safe only when nothing
+ * that influences composition changed since last accepted composition.
+ */
+bool Hwc2Display::canSkipValidate() {
+    if (!mAcceptedComposition || mIdleState != IDLE_NONE)
+        return false;
+
+    if (DebugHelper::getInstance().debugHideLayers() ||
+        DebugHelper::getInstance().debugHidePlanes())
+        return false;
+
+    /*hdr metadata is applied in present.*/
+    std::vector<std::shared_ptr<Hwc2Layer>> & layers = mLayerList.getLayers();
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        if (((*it)->getChangedFlags() & ~LAYER_CHANGE_METADATA) != LAYER_CHANGE_NONE)
+            return false;
+    }
+
+    /*client target is not updated without validate.*/
+    for (auto it = mPresentLayers.begin(); it != mPresentLayers.end(); it++) {
+        if ((*it)->mCompositionType == MESON_COMPOSITION_CLIENT)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Strategy commit() consumes the decided state. Layers, planes and flags
+ * are the ones of the accepted frame, so the strategy only replays its
+ * plan on them with the new buffers.
+ */
+bool Hwc2Display::revalidateComposition() {
+    if (mSkipComposition || mPresentCompositionStg.get() == NULL)
+        return false;
+
+    /*strategy reads planes and crtc the commit thread may still post.*/
+    if (mCommitThread.get())
+        mCommitThread->waitIdle();
+    mPresentCompositionStg->setup(mPresentLayers,
+        mPresentComposers, mPresentPlanes, mCrtc, mCompositionFlags);
+    if (mPresentCompositionStg->replayComposition() < 0)
+        return false;
+
+    if (mPowerMode->getScreenStatus()) {
+        mProcessorFlags |= PRESENT_BLANK;
+    }
+    return true;
+}
+
 hwc2_error_t Hwc2Display::presentDisplay(int32_t* outPresentFence) {
     std::lock_guard<std::mutex> lock(mMutex);
+    AllocStatScope allocStat(this);
+    FRAME_TIMELINE_BIND(&mTimeline);
+    FRAME_TIMELINE_STAGE(FRAME_STAGE_PRESENT);
+    /*present runs every frame, validate is skipped for some.*/
+    DrmBufferRegistry::getInstance().trim(mCrtc->getId());
 
     if (mSkipComposition) {
         *outPresentFence = -1;
     } else {
         if (mValidateDisplay == false) {
-            return HWC2_ERROR_NOT_VALIDATED;
+            latchLayerStates();
+            if (!canSkipValidate() || !revalidateComposition())
+                return HWC2_ERROR_NOT_VALIDATED;
+            mSkipValidateFrames++;
         }
         mValidateDisplay = false;
+        mPresentFrames++;
+        FenceWatchScope fenceScope(mCrtc->getId(), (uint32_t)mPresentFrames);
         int32_t outFence = -1;
+        /*planes and crtc are free after last frame posted.*/
+        if (mCommitThread.get())
+            mCommitThread->waitIdle();
         /*Start to compose, set up plane info.*/
-        if (mPresentCompositionStg->commit() != 0) {
+        int32_t committed;
+        {
+            FRAME_TIMELINE_STAGE(FRAME_STAGE_COMMIT);
+            committed = mPresentCompositionStg->commit();
+        }
+        if (committed != 0) {
+            if (mCommitThread.get())
+                mCommitThread->dropFrame();
+            /*planes set before the failed one queued requests with dup fds.*/
+            mCrtc->abortCommit();
             return HWC2_ERROR_NOT_VALIDATED;
         }
 
@@ -819,17 +979,56 @@ hwc2_error_t Hwc2Display::presentDisplay(int32_t* outPresentFence) {
         }
         #endif
 
-        /* Page flip */
-        if (mCrtc->pageFlip(outFence) < 0) {
-            return HWC2_ERROR_UNSUPPORTED;
-        }
-        if (mPostProcessor != NULL) {
-            int32_t displayFence = ::dup(outFence);
-            mPostProcessor->present(mProcessorFlags, displayFence);
+        if (mCommitThread.get()) {
+            /*recorded planes posted on commit thread, fence follows the flip.*/
+            outFence = mCommitThread->queueFrame(mPostProcessor, mProcessorFlags);
             mProcessorFlags = 0;
+            /*last buffers of the layers are released once this frame is shown.*/
+            for (auto it = mPresentLayers.begin(); it != mPresentLayers.end(); it++)
+                (*it)->setReleaseFence(outFence >= 0 ? ::dup(outFence) : -1);
+        } else {
+            /*osd planes skip clean fbs, check all of them.*/
+            bool planeUpdated = false;
+            for (auto it = mPresentPlanes.begin(); it != mPresentPlanes.end(); it++) {
+                if ((*it)->getPlaneType() == OSD_PLANE && (*it)->checkUpdated())
+                    planeUpdated = true;
+            }
+
+            if (!planeUpdated && !mCrtc->isDisplayFrameUpdated()) {
+                /*nothing posted, screen keeps the last frame.*/
+                outFence = mLastPresentFence->dup();
+                mReusedPresentFrames++;
+            } else {
+                /* Page flip */
+                if (mCrtc->pageFlip(outFence) < 0) {
+                    return HWC2_ERROR_UNSUPPORTED;
+                }
+                mLastPresentFence = outFence >= 0 ?
+                    std::make_shared<DrmFence>(::dup(outFence)) : DrmFence::NO_FENCE;
+                if (outFence >= 0)
+                    FenceWatcher::getInstance().watch(::dup(outFence),
+                        FenceWatcher::makeTag(FENCE_WATCH_PRESENT));
+            }
+            if (mPostProcessor != NULL) {
+                FRAME_TIMELINE_STAGE(FRAME_STAGE_POST_PROCESS);
+                int32_t displayFence = ::dup(outFence);
+                mPostProcessor->present(mProcessorFlags, displayFence);
+                mProcessorFlags = 0;
+            }
         }
 
         *outPresentFence = outFence;
+        FRAME_TIMELINE_END_FRAME(outFence);
+        mClientOverlayFbs.clear();
+
+        /*content posted, following frames only repost on new updates.*/
+        for (auto it = mPresentLayers.begin(); it != mPresentLayers.end(); it++)
+            (*it)->mContentUpdated = false;
+        if (mClientTarget.get())
+            mClientTarget->mContentUpdated = false;
+
+        mAcceptedComposition = true;
+        armIdleTimer();
     }
 
     /*dump debug informations.*/
@@ -880,9 +1079,17 @@ hwc2_error_t Hwc2Display::getReleaseFences(uint32_t* outNumElements,
 hwc2_error_t Hwc2Display::setClientTarget(buffer_handle_t target,
     int32_t acquireFence, int32_t dataspace, hwc_region_t damage) {
     std::lock_guard<std::mutex> lock(mMutex);
-    /*create DrmFramebuffer for client target.*/
-    std::shared_ptr<DrmFramebuffer> clientFb =  std::make_shared<DrmFramebuffer>(
-        target, acquireFence);
+    BufferRegistryScope registryScope(mCrtc->getId());
+    /*create DrmFramebuffer for client target, reuse last one if it is unchanged.*/
+    std::shared_ptr<DrmFramebuffer> clientFb;
+    if (mClientTarget.get() && target == mClientTargetHnd && acquireFence < 0
+        && !hasSurfaceDamage(damage)) {
+        clientFb = mClientTarget;
+    } else {
+        clientFb = std::make_shared<DrmFramebuffer>(target, acquireFence);
+        mClientTarget = clientFb;
+        mClientTargetHnd = target;
+    }
     clientFb->mFbType = DRM_FB_SCANOUT;
     clientFb->mBlendMode = DRM_BLEND_MODE_PREMULTIPLIED;
     clientFb->mPlaneAlpha = 1.0f;
@@ -966,14 +1173,40 @@ hwc2_error_t Hwc2Display::setActiveConfig(
     }
 }
 
-bool Hwc2Display::isLayerHideForDebug(hwc2_layer_t id) {
-    std::vector<int> hideLayers;
-    DebugHelper::getInstance().getHideLayers(hideLayers);
-    if (hideLayers.empty())
-        return false;
+Hwc2Display::AllocStatScope::AllocStatScope(Hwc2Display * display) {
+    mDisplay = display;
+    mEnabled = alloc_stat_get(&mBegin);
+    mPresentFrames = display->mPresentFrames;
+}
 
+Hwc2Display::AllocStatScope::~AllocStatScope() {
+    alloc_stat_t end;
+    if (!mEnabled || !alloc_stat_get(&end))
+        return;
+
+    alloc_stat_t & frame = mDisplay->mFrameAlloc;
+    frame.count += end.count - mBegin.count;
+    frame.bytes += end.bytes - mBegin.bytes;
+    frame.heapInUse += end.heapInUse - mBegin.heapInUse;
+    if (mDisplay->mPresentFrames == mPresentFrames)
+        return;
+
+    /*frame presented, close it.*/
+    mDisplay->mLastFrameAlloc = frame;
+    if (frame.count > mDisplay->mMaxFrameAllocs)
+        mDisplay->mMaxFrameAllocs = frame.count;
+    if (frame.heapInUse > mDisplay->mMaxFrameHeapGrowth)
+        mDisplay->mMaxFrameHeapGrowth = frame.heapInUse;
+    if (frame.count == 0)
+        mDisplay->mAllocFreeFrames++;
+    mDisplay->mAllocStatFrames++;
+    memset(&frame, 0, sizeof(frame));
+}
+
+bool Hwc2Display::isLayerHideForDebug(hwc2_layer_t id,
+    std::vector<int> & hideLayers) {
     for (auto it = hideLayers.begin(); it < hideLayers.end(); it++) {
-        if (*it == (int)id)
+        if (*it == (int)(id & LAYER_SLOT_MASK))
             return true;
     }
 
@@ -995,6 +1228,28 @@ bool Hwc2Display::isPlaneHideForDebug(int id) {
     return false;
 }
 
+void Hwc2Display::captureCompositionTrace(uint32_t compositionFlags) {
+    uint32_t maxFrames = DebugHelper::getInstance().captureTraceFrames();
+    if (maxFrames == 0) {
+        mTraceWriter.reset();
+        return;
+    }
+
+    if (!mTraceWriter) {
+        char path[128];
+        snprintf(path, sizeof(path), COMPOSITION_TRACE_PATH, mCrtc->getId());
+        mTraceWriter = std::make_shared<CompositionTraceWriter>();
+        mTraceWriter->open(path, mCrtc->getId());
+    }
+
+    /*keep the writer after max frames, or it will restart a new trace.*/
+    if (mTraceWriter->isOpened() && mTraceWriter->getFrameCount() < maxFrames) {
+        mTraceWriter->writeFrame(compositionFlags, mDisplayMode, mPresentLayers);
+        if (mTraceWriter->getFrameCount() == maxFrames)
+            mTraceWriter->close();
+    }
+}
+
 void Hwc2Display::dumpPresentLayers(String8 & dumpstr) {
     dumpstr.append("----------------------------------------------------------"
         "-------------------------------\n");
@@ -1073,6 +1328,37 @@ void Hwc2Display::dump(String8 & dumpstr) {
         mCalibrateInfo.framebuffer_w, mCalibrateInfo.framebuffer_h,
         mCalibrateInfo.crtc_display_x, mCalibrateInfo.crtc_display_y,
         mCalibrateInfo.crtc_display_w, mCalibrateInfo.crtc_display_h);
+    mLayerTable.dump(dumpstr);
+    if (mCrtc)
+        mCrtc->dump(dumpstr);
+    if (mVsync)
+        mVsync->dump(dumpstr);
+    dumpstr.appendFormat("Reused present fence: %u frames\n", mReusedPresentFrames);
+    dumpstr.appendFormat("Skip validate: %" PRIu64 "/%" PRIu64 " frames (%.1f%%)\n",
+        mSkipValidateFrames, mPresentFrames,
+        mPresentFrames > 0 ? mSkipValidateFrames * 100.0 / mPresentFrames : 0.0);
+    dumpstr.appendFormat("Idle: timeout %u ms, state %d, enter %u, exit %u\n",
+        mIdleTimeout, (int32_t)mIdleState, mIdleEnterCount, mIdleExitCount);
+    if (mCommitThread.get())
+        mCommitThread->dump(dumpstr);
+#ifdef HWC_ENABLE_FRAME_TIMELINE
+    mTimeline.dump(dumpstr);
+    if (DebugHelper::getInstance().saveTimeline() && mCrtc.get()) {
+        char path[128];
+        snprintf(path, sizeof(path), FRAME_TIMELINE_PATH, mCrtc->getId());
+        if (mTimeline.save(path, mCrtc->getId()) == 0)
+            dumpstr.appendFormat("Frame timeline saved to %s\n", path);
+    }
+#endif
+    if (mAllocStatFrames > 0) {
+        dumpstr.appendFormat("Heap allocs per frame: last %" PRIu64 " (%" PRIu64
+            " bytes), max %" PRIu64 ", zero-alloc %" PRIu64 "/%" PRIu64 " frames\n",
+            mLastFrameAlloc.count, mLastFrameAlloc.bytes, mMaxFrameAllocs,
+            mAllocFreeFrames, mAllocStatFrames);
+        dumpstr.appendFormat("    counts operator new of hwc code only, process heap"
+            " growth (all threads, libutils included): last %" PRId64 " bytes, max %"
+            PRId64 " bytes\n", mLastFrameAlloc.heapInUse, mMaxFrameHeapGrowth);
+    }
 
     /* HDR info */
     dumpstr.append("HDR Capabilities:\n");
@@ -1117,3 +1403,84 @@ void Hwc2Display::dump(String8 & dumpstr) {
     dumpHwDisplayPlane(dumpstr);
 }
 
+void Hwc2Display::initIdleDetector() {
+    char val[PROP_VALUE_LEN_MAX];
+    if (sys_get_string_prop(IDLE_TIMEOUT_PROP, val) > 0 && atoi(val) > 0)
+        mIdleTimeout = atoi(val);
+
+    if (mIdleTimeout > 0 && !mIdleThread) {
+        mIdleThread = std::make_shared<EventThread>("hwc-idle", REACTOR_CLIENT_IDLE);
+        mIdleThread->setHandler(this);
+        mIdleThread->start();
+    }
+}
+
+void Hwc2Display::updateFenceVsyncPeriod() {
+    if (mCrtc.get() && mDisplayMode.refreshRate > 0)
+        FenceWatcher::getInstance().setVsyncPeriod(mCrtc->getId(),
+            (nsecs_t)(1e9 / mDisplayMode.refreshRate));
+}
+
+void Hwc2Display::armIdleTimer() {
+    if (!mIdleThread)
+        return;
+
+    mIdleThread->removeEvent(IDLE_TIMEOUT_EVENT);
+    if (mIdleState == IDLE_NONE && !mPowerMode->getScreenStatus())
+        mIdleThread->sendEventDelayed(IDLE_TIMEOUT_EVENT, mIdleTimeout);
+}
+
+/*
+ * Surfaceflinger only validates again for the idle refresh or new content,
+ * so the refresh frame is forced to client and any later frame exits idle.
+ */
+void Hwc2Display::updateIdleState(uint32_t & compositionFlags) {
+    if (mIdleState == IDLE_PENDING) {
+        compositionFlags |= COMPOSE_FORCE_CLIENT;
+        mIdleState = IDLE_ACTIVE;
+        mIdleEnterCount++;
+        MESON_LOGD("%s enter idle, flatten %zu layers.", getName(), mPresentLayers.size());
+    } else if (mIdleState == IDLE_ACTIVE) {
+        mIdleState = IDLE_NONE;
+        mIdleExitCount++;
+        MESON_LOGD("%s exit idle.", getName());
+    }
+}
+
+void Hwc2Display::handleEvent(int what) {
+    if (what != IDLE_TIMEOUT_EVENT)
+        return;
+
+    /*present arms the timer under mMutex, do not take it here.*/
+    int32_t state = IDLE_NONE;
+    if (mPowerMode->getScreenStatus() ||
+        !mIdleState.compare_exchange_strong(state, IDLE_PENDING))
+        return;
+
+    /*surfaceflinger will call validate.*/
+    if (mObserver != NULL)
+        mObserver->refresh();
+}
+
+#if defined(HWC_ENABLE_CPU_COMPOSITION)
+/*cpu composer draws to a canvas placed as client target.*/
+void Hwc2Display::updateCpuComposerCanvas() {
+    auto it = mComposers.find(MESON_CPU_COMPOSER);
+    if (it == mComposers.end() || !mCpuComposerCanvas)
+        return;
+
+    mCpuComposerCanvas->mSourceCrop.left = 0;
+    mCpuComposerCanvas->mSourceCrop.top = 0;
+    mCpuComposerCanvas->mSourceCrop.right = mCalibrateInfo.framebuffer_w;
+    mCpuComposerCanvas->mSourceCrop.bottom = mCalibrateInfo.framebuffer_h;
+    mCpuComposerCanvas->mDisplayFrame.left = mCalibrateInfo.crtc_display_x;
+    mCpuComposerCanvas->mDisplayFrame.top = mCalibrateInfo.crtc_display_y;
+    mCpuComposerCanvas->mDisplayFrame.right = mCalibrateInfo.crtc_display_x +
+        mCalibrateInfo.crtc_display_w;
+    mCpuComposerCanvas->mDisplayFrame.bottom = mCalibrateInfo.crtc_display_y +
+        mCalibrateInfo.crtc_display_h;
+
+    hwc_region_t damage = {0, NULL};
+    it->second->setOutput(mCpuComposerCanvas, damage);
+}
+#endif
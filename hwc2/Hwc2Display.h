@@ -10,11 +10,12 @@
 #ifndef HWC2_DISPLAY_H
 #define HWC2_DISPLAY_H
 
+#include <atomic>
 #include <map>
 #include <unordered_map>
 #include <hardware/hwcomposer2.h>
 
-#include <BitsMap.h>
+#include <AllocStat.h>
 #include <HwcDisplay.h>
 #include <HwcPowerMode.h>
 #include <HwcVsync.h>
@@ -23,8 +24,13 @@
 #include <IComposer.h>
 #include <ICompositionStrategy.h>
 #include <EventThread.h>
+#include <CompositionTrace.h>
+#include <FrameTimeline.h>
 
+#include "Hwc2CommitThread.h"
 #include "Hwc2Layer.h"
+#include "Hwc2LayerList.h"
+#include "Hwc2LayerTable.h"
 #include "MesonHwc2Defs.h"
 #include "HwcModeMgr.h"
 
@@ -38,7 +44,7 @@ public:
 };
 
 class Hwc2Display
-    : public HwcDisplay, public HwcVsyncObserver {
+    : public HwcDisplay, public HwcVsyncObserver, public EventHandler {
 public:
     Hwc2Display(std::shared_ptr<Hwc2DisplayObserver> observer);
     virtual ~Hwc2Display();
@@ -62,6 +68,7 @@ public:
     virtual std::shared_ptr<Hwc2Layer> getLayerById(hwc2_layer_t id);
     virtual hwc2_error_t createLayer(hwc2_layer_t * outLayer);
     virtual hwc2_error_t destroyLayer(hwc2_layer_t  inLayer);
+    virtual hwc2_error_t setLayerZorder(hwc2_layer_t layer, uint32_t z);
     virtual hwc2_error_t setCursorPosition(hwc2_layer_t layer,
         int32_t x, int32_t y);
 
@@ -74,6 +81,7 @@ public:
         uint32_t* outNumRequests);
     virtual hwc2_error_t presentDisplay(int32_t* outPresentFence);
     virtual hwc2_error_t acceptDisplayChanges();
+    bool isValidated() { return mValidateDisplay; }
     virtual hwc2_error_t getChangedCompositionTypes(
         uint32_t* outNumElements, hwc2_layer_t* outLayers,
         int32_t*  outTypes);
@@ -115,6 +123,10 @@ public:
     virtual void getDispMode(drm_mode_info_t & dispMode);
     virtual void cleanupBeforeDestroy();
 
+/*EventHandler interface*/
+public:
+    virtual void handleEvent(int what);
+
 protected:
     /* For compose. */
     hwc2_error_t collectLayersForPresent();
@@ -123,24 +135,39 @@ protected:
     hwc2_error_t collectCompositionStgForPresent();
     hwc2_error_t collectCompositionRequest(
             uint32_t* outNumTypes, uint32_t* outNumRequests);
+    hwc2_error_t prepareComposition();
+
+    /*present without validate.*/
+    bool canSkipValidate();
+    bool revalidateComposition();
 
     /*for calibrate display frame.*/
     int32_t loadCalibrateInfo();
     int32_t adjustDisplayFrame();
 
     /*Layer id sequence no.*/
-    void initLayerIdGenerator();
-    hwc2_layer_t createLayerId();
-    void destroyLayerId(hwc2_layer_t id);
+    void latchLayerStates();
 
     /*For debug*/
     void dumpPresentLayers(String8 & dumpstr);
-    bool isLayerHideForDebug(hwc2_layer_t id);
+    bool isLayerHideForDebug(hwc2_layer_t id, std::vector<int> & hideLayers);
     bool isPlaneHideForDebug(int id);
     void dumpHwDisplayPlane(String8 &dumpstr);
+    void captureCompositionTrace(uint32_t compositionFlags);
+
+    /*idle screen flattened to one plane by client composer.*/
+    void initIdleDetector();
+    void updateIdleState(uint32_t & compositionFlags);
+    void armIdleTimer();
+    /*present fences later than one vsync are counted as missed.*/
+    void updateFenceVsyncPeriod();
+#if defined(HWC_ENABLE_CPU_COMPOSITION)
+    void updateCpuComposerCanvas();
+#endif
 
 protected:
-    std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>> mLayers;
+    Hwc2LayerTable mLayerTable;
+    Hwc2LayerList mLayerList;
     std::shared_ptr<Hwc2DisplayObserver> mObserver;
     drm_hdr_capabilities_t mHdrCaps;
 
@@ -158,10 +185,6 @@ protected:
     std::shared_ptr<HwcModeMgr> mModeMgr;
     std::shared_ptr<HwcVsync> mVsync;
 
-    /*layer id generate*/
-    std::shared_ptr<BitsMap> mLayersBitmap;
-    int32_t mLayerSeq;
-
     /* members used in present.*/
     std::vector<std::shared_ptr<DrmFramebuffer>> mPresentLayers;
     std::vector<std::shared_ptr<IComposer>> mPresentComposers;
@@ -170,6 +193,10 @@ protected:
 
     std::vector<hwc2_layer_t> mChangedLayers;
     std::vector<hwc2_layer_t> mOverlayLayers;
+    /*client overlay fbs, kept as member to reuse its capacity.*/
+    std::vector<std::shared_ptr<DrmFramebuffer>> mClientOverlayFbs;
+    /*layer ids hidden by debug commands, kept as member like above.*/
+    std::vector<int> mHideLayers;
 
     /*all go to client composer*/
     bool mForceClientComposer;
@@ -182,11 +209,71 @@ protected:
 
     drm_mode_info_t mDisplayMode;
     display_zoom_info_t mCalibrateInfo;
+    /*calibration used by last adjustDisplayFrame.*/
+    display_zoom_info_t mAdjustedCalibrateInfo;
     int mCalibrateCoordinates[4];
 
     std::shared_ptr<HwcPostProcessor> mPostProcessor;
     int32_t mProcessorFlags;
 
+    /*async present, planes posted on commit thread.*/
+    std::shared_ptr<Hwc2CommitThread> mCommitThread;
+
+    /*capture layer stacks for offline replay.*/
+    std::shared_ptr<CompositionTraceWriter> mTraceWriter;
+#ifdef HWC_ENABLE_FRAME_TIMELINE
+    FrameTimeline mTimeline;
+#endif
+
+    /*reuse client target and present fence when nothing changed.*/
+    std::shared_ptr<DrmFramebuffer> mClientTarget;
+    buffer_handle_t mClientTargetHnd;
+    std::shared_ptr<DrmFence> mLastPresentFence;
+    uint32_t mReusedPresentFrames;
+
+    /*layers and display unchanged since last presented composition.*/
+    bool mAcceptedComposition;
+    uint32_t mCompositionFlags;     /*flags of last decided composition.*/
+    uint64_t mPresentFrames;
+    uint64_t mSkipValidateFrames;
+
+    /*
+    * Heap allocations of validate and present calls, added to current
+    * frame and closed when a frame is presented in the scope.
+    */
+    class AllocStatScope {
+    public:
+        AllocStatScope(Hwc2Display * display);
+        ~AllocStatScope();
+    protected:
+        Hwc2Display * mDisplay;
+        bool mEnabled;
+        alloc_stat_t mBegin;
+        uint64_t mPresentFrames;
+    };
+    alloc_stat_t mFrameAlloc;       /*heapInUse is the growth in the frame.*/
+    alloc_stat_t mLastFrameAlloc;
+    uint64_t mMaxFrameAllocs;
+    int64_t mMaxFrameHeapGrowth;
+    uint64_t mAllocStatFrames;
+    uint64_t mAllocFreeFrames;
+
+    /*idle detector, ui flattened after mIdleTimeout ms without update.*/
+    enum {
+        IDLE_NONE = 0,
+        IDLE_PENDING,
+        IDLE_ACTIVE,
+    };
+    std::shared_ptr<EventThread> mIdleThread;
+    uint32_t mIdleTimeout;
+    std::atomic<int32_t> mIdleState;     /*timer callback is off mMutex.*/
+    uint32_t mIdleEnterCount;
+    uint32_t mIdleExitCount;
+
+#if defined(HWC_ENABLE_CPU_COMPOSITION)
+    std::shared_ptr<DrmFramebuffer> mCpuComposerCanvas;
+#endif
+
 #ifdef HWC_HDR_METADATA_SUPPORT
     std::vector<drm_hdr_meatadata_t> mHdrKeys;
 #endif
@@ -8,19 +8,53 @@
  */
 
 #include <MesonLog.h>
+#include <inttypes.h>
 #include <math.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include "Hwc2Layer.h"
 #include "Hwc2Base.h"
 
 
 Hwc2Layer::Hwc2Layer() : DrmFramebuffer(){
+    memset(&mPending, 0, sizeof(mPending));
+    mPending.acquireFence = -1;
+    resetLayerState();
+}
+
+void Hwc2Layer::resetLayerState() {
     mDataSpace    = HAL_DATASPACE_UNKNOWN;
+    mHwcCompositionType = HWC2_COMPOSITION_INVALID;
     mUpdateZorder = false;
+    mLastBufferHnd = NULL;
+    mChangedFlags = LAYER_CHANGE_ALL;
+    mId = 0;
+    memset(&mColor, 0, sizeof(mColor));
+    memset(&mVisibleRegion, 0, sizeof(mVisibleRegion));
+    memset(&mDamageRegion, 0, sizeof(mDamageRegion));
+    memset(&mBackupDisplayFrame, 0, sizeof(mBackupDisplayFrame));
+}
+
+void Hwc2Layer::recycle() {
+    {
+        std::lock_guard<std::mutex> lock(mPendingMutex);
+        if ((mPending.fields & LAYER_PENDING_BUFFER) && mPending.acquireFence >= 0)
+            close(mPending.acquireFence);
+        memset(&mPending, 0, sizeof(mPending));
+        mPending.acquireFence = -1;
+#ifdef HWC_HDR_METADATA_SUPPORT
+        mPendingHdrMetaData.clear();
+#endif
+    }
+
+    reset();
+    resetLayerState();
 }
 
 Hwc2Layer::~Hwc2Layer() {
+    if ((mPending.fields & LAYER_PENDING_BUFFER) && mPending.acquireFence >= 0)
+        close(mPending.acquireFence);
 }
 
 hwc2_error_t Hwc2Layer::handleDimLayer(buffer_handle_t buffer) {
@@ -30,7 +64,7 @@ hwc2_error_t Hwc2Layer::handleDimLayer(buffer_handle_t buffer) {
         return HWC2_ERROR_NONE;
     }
 
-    int bufFormat = am_gralloc_get_format(buffer);
+    int bufFormat = mBufferInfo.format;
 
     /* Number of pixel components in memory
      * (i.e. R.G.B.A | R.G.B)
@@ -98,20 +132,31 @@ hwc2_error_t Hwc2Layer::handleDimLayer(buffer_handle_t buffer) {
     return HWC2_ERROR_NONE;
 }
 
-hwc2_error_t Hwc2Layer::setBuffer(buffer_handle_t buffer, int32_t acquireFence) {
+hwc2_error_t Hwc2Layer::applyBuffer(buffer_handle_t buffer, int32_t acquireFence) {
     /*
-    * SurfaceFlinger will call setCompostionType() first,then setBuffer().
+    * Composition type is latched before buffer.
     * So it is safe to calc drm_fb_type_t mFbType here.
     */
+    /*sf passes the same handle without fence when buffer is not changed.*/
+    if (buffer != mLastBufferHnd || acquireFence >= 0)
+        mContentUpdated = true;
+    mLastBufferHnd = buffer;
+
+    drm_fb_type_t lastType = mFbType;
+    bool lastSecure = mSecure;
+    drm_buffer_info_t lastInfo = mBufferInfo;
+
     clearBufferInfo();
     setBufferInfo(buffer, acquireFence);
+    if (!isSameBufferLayout(lastInfo, mBufferInfo))
+        mChangedFlags |= LAYER_CHANGE_BUFFER;
 
     /*set mFbType by usage of GraphicBuffer.*/
     if (mHwcCompositionType == HWC2_COMPOSITION_CURSOR) {
         mFbType = DRM_FB_CURSOR;
     /*} else if (am_gralloc_is_omx_v4l_buffer(buffer)) {
         mFbType = DRM_FB_VIDEO_OMX_V4L;*/
-    } else if (am_gralloc_is_omx_metadata_buffer(buffer)) {
+    } else if (mBufferInfo.omxMetadata) {
         int tunnel = 0;
         int ret = am_gralloc_get_omx_metadata_tunnel(buffer, &tunnel);
         if (ret != 0)
@@ -120,22 +165,27 @@ hwc2_error_t Hwc2Layer::setBuffer(buffer_handle_t buffer, int32_t acquireFence)
             mFbType = DRM_FB_VIDEO_OMX_PTS;
         else
             mFbType = DRM_FB_VIDEO_OMX_PTS_SECOND;
-    } else if (am_gralloc_is_overlay_buffer(buffer)) {
+    } else if (mBufferInfo.overlay) {
         mFbType = DRM_FB_VIDEO_OVERLAY;
-    } else if (am_gralloc_get_width(buffer) <= 1 && am_gralloc_get_height(buffer) <= 1) {
+    } else if (mBufferInfo.width <= 1 && mBufferInfo.height <= 1) {
         //For the buffer which size is 1x1, we treat it as a dim layer.
         handleDimLayer(buffer);
-    } else if (am_gralloc_is_coherent_buffer(buffer)) {
+    } else if (mBufferInfo.coherent) {
         mFbType = DRM_FB_SCANOUT;
     } else {
         mFbType = DRM_FB_RENDER;
     }
 
-    mSecure = am_gralloc_is_secure_buffer(mBufferHandle);
+    mSecure = mBufferInfo.secure;
+    if (mFbType != lastType || mSecure != lastSecure)
+        mChangedFlags |= LAYER_CHANGE_BUFFER;
     return HWC2_ERROR_NONE;
 }
 
-hwc2_error_t Hwc2Layer::setSidebandStream(const native_handle_t* stream) {
+hwc2_error_t Hwc2Layer::applySidebandStream(const native_handle_t* stream) {
+    mContentUpdated = true;
+    mChangedFlags |= LAYER_CHANGE_BUFFER;
+    mLastBufferHnd = NULL;
     clearBufferInfo();
     setBufferInfo(stream, -1);
 
@@ -152,7 +202,13 @@ hwc2_error_t Hwc2Layer::setSidebandStream(const native_handle_t* stream) {
 
 }
 
-hwc2_error_t Hwc2Layer::setColor(hwc_color_t color) {
+hwc2_error_t Hwc2Layer::applyColor(hwc_color_t color) {
+    if (mFbType != DRM_FB_COLOR || mColor.r != color.r || mColor.g != color.g ||
+        mColor.b != color.b || mColor.a != color.a)
+        mContentUpdated = true;
+    if (mFbType != DRM_FB_COLOR)
+        mChangedFlags |= LAYER_CHANGE_BUFFER;
+    mLastBufferHnd = NULL;
     clearBufferInfo();
 
     mColor.r = color.r;
@@ -164,15 +220,24 @@ hwc2_error_t Hwc2Layer::setColor(hwc_color_t color) {
     return HWC2_ERROR_NONE;
 }
 
-hwc2_error_t Hwc2Layer::setSourceCrop(hwc_frect_t crop) {
+void Hwc2Layer::applySourceCrop(hwc_frect_t crop) {
+    drm_rect_t lastCrop = mSourceCrop;
     mSourceCrop.left = (int) ceilf(crop.left);
     mSourceCrop.top = (int) ceilf(crop.top);
     mSourceCrop.right = (int) floorf(crop.right);
     mSourceCrop.bottom = (int) floorf(crop.bottom);
-    return HWC2_ERROR_NONE;
+    if (memcmp(&lastCrop, &mSourceCrop, sizeof(drm_rect_t)))
+        mChangedFlags |= LAYER_CHANGE_GEOMETRY;
 }
 
-hwc2_error_t Hwc2Layer::setDisplayFrame(hwc_rect_t frame) {
+void Hwc2Layer::applyDisplayFrame(hwc_rect_t frame) {
+    /*mDisplayFrame is adjusted by display, keep it for the same frame.*/
+    if (mBackupDisplayFrame.left == frame.left && mBackupDisplayFrame.top == frame.top &&
+        mBackupDisplayFrame.right == frame.right && mBackupDisplayFrame.bottom == frame.bottom &&
+        !(mChangedFlags & LAYER_CHANGE_GEOMETRY))
+        return;
+    mChangedFlags |= LAYER_CHANGE_GEOMETRY;
+
     mDisplayFrame.left = frame.left;
     mDisplayFrame.top = frame.top;
     mDisplayFrame.right = frame.right;
@@ -183,47 +248,135 @@ hwc2_error_t Hwc2Layer::setDisplayFrame(hwc_rect_t frame) {
     mBackupDisplayFrame.top = frame.top;
     mBackupDisplayFrame.right = frame.right;
     mBackupDisplayFrame.bottom = frame.bottom;
+}
+
+/*cursor moves without resize, position is the top left of display frame.*/
+void Hwc2Layer::applyCursorPosition(int32_t x, int32_t y) {
+    if (mHwcCompositionType != HWC2_COMPOSITION_CURSOR)
+        return;
+
+    hwc_rect_t frame;
+    frame.left = x;
+    frame.top = y;
+    frame.right = x + mBackupDisplayFrame.right - mBackupDisplayFrame.left;
+    frame.bottom = y + mBackupDisplayFrame.bottom - mBackupDisplayFrame.top;
+    applyDisplayFrame(frame);
+}
+
+hwc2_error_t Hwc2Layer::setBuffer(buffer_handle_t buffer, int32_t acquireFence) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    /*buffer replaced before latched is never shown.*/
+    if ((mPending.fields & LAYER_PENDING_BUFFER) && mPending.acquireFence >= 0)
+        close(mPending.acquireFence);
+    mPending.fields &= ~LAYER_PENDING_CONTENT;
+    mPending.fields |= LAYER_PENDING_BUFFER;
+    mPending.buffer = buffer;
+    mPending.acquireFence = acquireFence;
+    return HWC2_ERROR_NONE;
+}
+
+hwc2_error_t Hwc2Layer::setSidebandStream(const native_handle_t* stream) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    if ((mPending.fields & LAYER_PENDING_BUFFER) && mPending.acquireFence >= 0)
+        close(mPending.acquireFence);
+    mPending.fields &= ~LAYER_PENDING_CONTENT;
+    mPending.fields |= LAYER_PENDING_SIDEBAND;
+    mPending.sidebandStream = stream;
+    return HWC2_ERROR_NONE;
+}
+
+hwc2_error_t Hwc2Layer::setColor(hwc_color_t color) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    if ((mPending.fields & LAYER_PENDING_BUFFER) && mPending.acquireFence >= 0)
+        close(mPending.acquireFence);
+    mPending.fields &= ~LAYER_PENDING_CONTENT;
+    mPending.fields |= LAYER_PENDING_COLOR;
+    mPending.color = color;
+    return HWC2_ERROR_NONE;
+}
+
+hwc2_error_t Hwc2Layer::setSourceCrop(hwc_frect_t crop) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_SOURCE_CROP;
+    mPending.sourceCrop = crop;
+    return HWC2_ERROR_NONE;
+}
+
+hwc2_error_t Hwc2Layer::setDisplayFrame(hwc_rect_t frame) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    /*a new frame overrides cursor moves before it.*/
+    mPending.fields &= ~LAYER_PENDING_CURSOR;
+    mPending.fields |= LAYER_PENDING_DISPLAY_FRAME;
+    mPending.displayFrame = frame;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setBlendMode(hwc2_blend_mode_t mode) {
-    mBlendMode = (drm_blend_mode_t)mode;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_BLEND_MODE;
+    mPending.blendMode = mode;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setPlaneAlpha(float alpha) {
-    mPlaneAlpha = alpha;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_PLANE_ALPHA;
+    mPending.planeAlpha = alpha;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setTransform(hwc_transform_t transform) {
-    mTransform = (int32_t)transform;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_TRANSFORM;
+    mPending.transform = transform;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setVisibleRegion(hwc_region_t visible) {
-    mVisibleRegion = visible;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_VISIBLE_REGION;
+    mPending.visibleRegion = visible;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setSurfaceDamage(hwc_region_t damage) {
-    mDamageRegion = damage;
+    /*rects are only valid in this call, check them now.*/
+    bool damaged = hasSurfaceDamage(damage);
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    if (!(mPending.fields & LAYER_PENDING_DAMAGE))
+        mPending.damaged = false;
+    mPending.fields |= LAYER_PENDING_DAMAGE;
+    mPending.damageRegion = damage;
+    mPending.damaged |= damaged;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setCompositionType(hwc2_composition_t type){
-    mHwcCompositionType = type;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_COMPOSITION;
+    mPending.compositionType = type;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setDataspace(android_dataspace_t dataspace) {
-    mDataSpace = dataspace;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_DATASPACE;
+    mPending.dataspace = dataspace;
     return HWC2_ERROR_NONE;
 }
 
 hwc2_error_t Hwc2Layer::setZorder(uint32_t z) {
-    mZorder = z;
-    updateZorder(true);
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_ZORDER;
+    mPending.zorder = z;
+    return HWC2_ERROR_NONE;
+}
+
+hwc2_error_t Hwc2Layer::setCursorPosition(int32_t x, int32_t y) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_CURSOR;
+    mPending.cursorX = x;
+    mPending.cursorY = y;
     return HWC2_ERROR_NONE;
 }
 
@@ -231,14 +384,118 @@ hwc2_error_t Hwc2Layer::setZorder(uint32_t z) {
 int32_t Hwc2Layer::setPerFrameMetadata(
     uint32_t numElements, const int32_t* /*hw2_per_frame_metadata_key_t*/ keys,
     const float* metadata) {
-    mHdrMetaData.clear();
+    std::map<drm_hdr_meatadata_t, float> hdrMetaData;
     for (uint32_t i = 0; i < numElements; i++) {
-        mHdrMetaData.insert({static_cast<drm_hdr_meatadata_t>(keys[i]),metadata[i]});
+        hdrMetaData.insert({static_cast<drm_hdr_meatadata_t>(keys[i]),metadata[i]});
     }
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPending.fields |= LAYER_PENDING_METADATA;
+    mPendingHdrMetaData.swap(hdrMetaData);
     return HWC2_ERROR_NONE;
 }
 #endif
 
+uint32_t Hwc2Layer::latchPendingState() {
+    PendingState state;
+#ifdef HWC_HDR_METADATA_SUPPORT
+    std::map<drm_hdr_meatadata_t, float> hdrMetaData;
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mPendingMutex);
+        if (mPending.fields == 0)
+            return LAYER_CHANGE_NONE;
+        state = mPending;
+        mPending.fields = 0;
+#ifdef HWC_HDR_METADATA_SUPPORT
+        if (state.fields & LAYER_PENDING_METADATA)
+            hdrMetaData.swap(mPendingHdrMetaData);
+#endif
+    }
+
+    uint32_t lastFlags = mChangedFlags;
+    applyPendingState(state);
+#ifdef HWC_HDR_METADATA_SUPPORT
+    if ((state.fields & LAYER_PENDING_METADATA) && hdrMetaData != mHdrMetaData) {
+        mHdrMetaData.swap(hdrMetaData);
+        mChangedFlags |= LAYER_CHANGE_METADATA;
+    }
+#endif
+    return mChangedFlags & ~lastFlags;
+}
+
+/*composition type goes first, buffer type of cursor depends on it.*/
+void Hwc2Layer::applyPendingState(PendingState & state) {
+    if (state.fields & LAYER_PENDING_COMPOSITION) {
+        if (mHwcCompositionType != state.compositionType)
+            mChangedFlags |= LAYER_CHANGE_COMPOSITION;
+        mHwcCompositionType = state.compositionType;
+    }
+
+    if (state.fields & LAYER_PENDING_BUFFER) {
+        if (applyBuffer(state.buffer, state.acquireFence) != HWC2_ERROR_NONE)
+            MESON_LOGE("layer %" PRIu64 " apply buffer failed.", mId);
+    } else if (state.fields & LAYER_PENDING_SIDEBAND) {
+        applySidebandStream(state.sidebandStream);
+    } else if (state.fields & LAYER_PENDING_COLOR) {
+        applyColor(state.color);
+    }
+
+    if (state.fields & LAYER_PENDING_SOURCE_CROP)
+        applySourceCrop(state.sourceCrop);
+    if (state.fields & LAYER_PENDING_DISPLAY_FRAME)
+        applyDisplayFrame(state.displayFrame);
+    if (state.fields & LAYER_PENDING_CURSOR)
+        applyCursorPosition(state.cursorX, state.cursorY);
+
+    if (state.fields & LAYER_PENDING_BLEND_MODE) {
+        if (mBlendMode != (drm_blend_mode_t)state.blendMode)
+            mChangedFlags |= LAYER_CHANGE_BLEND;
+        mBlendMode = (drm_blend_mode_t)state.blendMode;
+    }
+    if (state.fields & LAYER_PENDING_PLANE_ALPHA) {
+        if (mPlaneAlpha != state.planeAlpha)
+            mChangedFlags |= LAYER_CHANGE_BLEND;
+        mPlaneAlpha = state.planeAlpha;
+    }
+    if (state.fields & LAYER_PENDING_TRANSFORM) {
+        if (mTransform != (int32_t)state.transform)
+            mChangedFlags |= LAYER_CHANGE_GEOMETRY;
+        mTransform = (int32_t)state.transform;
+    }
+
+    if (state.fields & LAYER_PENDING_VISIBLE_REGION)
+        mVisibleRegion = state.visibleRegion;
+    if (state.fields & LAYER_PENDING_DAMAGE) {
+        mDamageRegion = state.damageRegion;
+        if (state.damaged)
+            mContentUpdated = true;
+    }
+
+    if (state.fields & LAYER_PENDING_DATASPACE) {
+        if (mDataSpace != state.dataspace)
+            mChangedFlags |= LAYER_CHANGE_DATASPACE;
+        mDataSpace = state.dataspace;
+    }
+    if (state.fields & LAYER_PENDING_ZORDER) {
+        if (mZorder != state.zorder)
+            mChangedFlags |= LAYER_CHANGE_ZORDER;
+        mZorder = state.zorder;
+        updateZorder(true);
+    }
+}
+
+
+bool Hwc2Layer::isSameBufferLayout(
+    const drm_buffer_info_t & a, const drm_buffer_info_t & b) {
+    /*same buffer back from the swapchain.*/
+    if (a.id != 0 && a.id == b.id)
+        return true;
+
+    return a.format == b.format &&
+        a.width == b.width &&
+        a.height == b.height &&
+        a.afbcMask == b.afbcMask;
+}
 
 int32_t Hwc2Layer::commitCompType(
     hwc2_composition_t hwcComp) {
@@ -10,12 +10,51 @@
 #ifndef HWC2_LAYER_H
 #define HWC2_LAYER_H
 
+#include <mutex>
 #include <hardware/hwcomposer2.h>
 
 #include <BasicTypes.h>
 #include <DrmFramebuffer.h>
 
+/*layer changes which may make the accepted composition invalid.*/
+typedef enum {
+    LAYER_CHANGE_NONE = 0,
+    LAYER_CHANGE_BUFFER = 1 << 0,       /*fb type, format, size or secure.*/
+    LAYER_CHANGE_GEOMETRY = 1 << 1,     /*source crop, display frame, transform.*/
+    LAYER_CHANGE_BLEND = 1 << 2,        /*blend mode, plane alpha.*/
+    LAYER_CHANGE_COMPOSITION = 1 << 3,  /*requested composition type.*/
+    LAYER_CHANGE_DATASPACE = 1 << 4,
+    LAYER_CHANGE_ZORDER = 1 << 5,
+    LAYER_CHANGE_METADATA = 1 << 6,     /*hdr metadata, applied in present.*/
+    LAYER_CHANGE_ALL = (1 << 7) - 1,
+} hwc2_layer_change_t;
+
+/*layer states set by hwc2 api but not latched yet.*/
+typedef enum {
+    LAYER_PENDING_BUFFER = 1 << 0,
+    LAYER_PENDING_SIDEBAND = 1 << 1,
+    LAYER_PENDING_COLOR = 1 << 2,
+    LAYER_PENDING_SOURCE_CROP = 1 << 3,
+    LAYER_PENDING_DISPLAY_FRAME = 1 << 4,
+    LAYER_PENDING_BLEND_MODE = 1 << 5,
+    LAYER_PENDING_PLANE_ALPHA = 1 << 6,
+    LAYER_PENDING_TRANSFORM = 1 << 7,
+    LAYER_PENDING_VISIBLE_REGION = 1 << 8,
+    LAYER_PENDING_DAMAGE = 1 << 9,
+    LAYER_PENDING_COMPOSITION = 1 << 10,
+    LAYER_PENDING_DATASPACE = 1 << 11,
+    LAYER_PENDING_ZORDER = 1 << 12,
+    LAYER_PENDING_METADATA = 1 << 13,
+    LAYER_PENDING_CURSOR = 1 << 14,
+    LAYER_PENDING_CONTENT = LAYER_PENDING_BUFFER | LAYER_PENDING_SIDEBAND |
+        LAYER_PENDING_COLOR,
+} hwc2_layer_pending_t;
 
+/*
+ * Hwc2.0 api only writes pending states under the layer's own lock, they
+ * are applied to the layer when display latches it in validate, or in
+ * present without validate. Display lock is never taken by setters.
+ */
 class Hwc2Layer : public DrmFramebuffer {
 /*Interfaces for hwc2.0 api.*/
 public:
@@ -34,6 +73,7 @@ public:
     hwc2_error_t setCompositionType(hwc2_composition_t type);
     hwc2_error_t setDataspace(android_dataspace_t dataspace);
     hwc2_error_t setZorder(uint32_t z);
+    hwc2_error_t setCursorPosition(int32_t x, int32_t y);
 #ifdef HWC_HDR_METADATA_SUPPORT
     int32_t setPerFrameMetadata(
             uint32_t numElements, const int32_t* /*hw2_per_frame_metadata_key_t*/ keys,
@@ -47,6 +87,9 @@ public:
 
     bool isSecure() { return mSecure;}
 
+    /*back to a just created layer, buffer and fences are released.*/
+    void recycle();
+
     void setUniqueId(hwc2_layer_t id);
     hwc2_layer_t getUniqueId();
 
@@ -55,6 +98,16 @@ public:
     bool isUpdateZorder() { return mUpdateZorder;}
     void updateZorder(bool update);
 
+    /*
+     * apply pending states, called with display locked.
+     * Return the change flags raised by this latch.
+     */
+    uint32_t latchPendingState();
+
+    /*changes since layer was last composed, cleared by display validate.*/
+    uint32_t getChangedFlags() { return mChangedFlags; }
+    void clearChangedFlags() { mChangedFlags = LAYER_CHANGE_NONE; }
+
 public:
     android_dataspace_t mDataSpace;
     hwc2_composition_t mHwcCompositionType;
@@ -64,10 +117,51 @@ public:
     drm_rect_t mBackupDisplayFrame;
 
 protected:
+    /*copied out of the lock, so plain data only.*/
+    struct PendingState {
+        uint32_t fields;
+        buffer_handle_t buffer;
+        int32_t acquireFence;
+        const native_handle_t * sidebandStream;
+        hwc_color_t color;
+        hwc_frect_t sourceCrop;
+        hwc_rect_t displayFrame;
+        hwc2_blend_mode_t blendMode;
+        float planeAlpha;
+        hwc_transform_t transform;
+        hwc_region_t visibleRegion;
+        hwc_region_t damageRegion;
+        bool damaged;
+        hwc2_composition_t compositionType;
+        android_dataspace_t dataspace;
+        uint32_t zorder;
+        int32_t cursorX;
+        int32_t cursorY;
+    };
+
+    hwc2_error_t applyBuffer(buffer_handle_t buffer, int32_t acquireFence);
+    hwc2_error_t applySidebandStream(const native_handle_t* stream);
+    hwc2_error_t applyColor(hwc_color_t color);
+    void applySourceCrop(hwc_frect_t crop);
+    void applyDisplayFrame(hwc_rect_t frame);
+    void applyCursorPosition(int32_t x, int32_t y);
+    void applyPendingState(PendingState & state);
+    void resetLayerState();
+
     hwc2_error_t handleDimLayer(buffer_handle_t buffer);
+    bool isSameBufferLayout(const drm_buffer_info_t & a, const drm_buffer_info_t & b);
 
 protected:
+    std::mutex mPendingMutex;
+    PendingState mPending;
+#ifdef HWC_HDR_METADATA_SUPPORT
+    std::map<drm_hdr_meatadata_t, float> mPendingHdrMetaData;
+#endif
+
     bool mUpdateZorder;
+    /*handle passed by last setBuffer, only to compare.*/
+    buffer_handle_t mLastBufferHnd;
+    uint32_t mChangedFlags;
 
 };
 
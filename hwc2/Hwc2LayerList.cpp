@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <algorithm>
+
+#include "Hwc2LayerList.h"
+
+Hwc2LayerList::Hwc2LayerList() {
+    mOrderChanged = false;
+}
+
+Hwc2LayerList::~Hwc2LayerList() {
+    mLayers.clear();
+}
+
+void Hwc2LayerList::addLayer(const std::shared_ptr<Hwc2Layer> & layer) {
+    mLayers.push_back(layer);
+    mOrderChanged = true;
+}
+
+void Hwc2LayerList::removeLayer(hwc2_layer_t id) {
+    for (auto it = mLayers.begin(); it != mLayers.end(); it++) {
+        if ((*it)->getUniqueId() == id) {
+            /*erase keeps the others in order.*/
+            mLayers.erase(it);
+            return;
+        }
+    }
+}
+
+void Hwc2LayerList::clear() {
+    mLayers.clear();
+    mOrderChanged = false;
+}
+
+std::vector<std::shared_ptr<Hwc2Layer>> & Hwc2LayerList::getLayers() {
+    if (mOrderChanged) {
+        struct {
+            bool operator() (const std::shared_ptr<Hwc2Layer> & a,
+                const std::shared_ptr<Hwc2Layer> & b) {
+                return a->mZorder > b->mZorder;
+            }
+        } zorderCompare;
+        std::stable_sort(mLayers.begin(), mLayers.end(), zorderCompare);
+        mOrderChanged = false;
+    }
+
+    return mLayers;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#ifndef HWC2_LAYER_LIST_H
+#define HWC2_LAYER_LIST_H
+
+#include <vector>
+
+#include <BasicTypes.h>
+#include "Hwc2Layer.h"
+
+/*
+ * Layers of a display kept from top to bottom zorder, only sorted again
+ * after a layer is added, removed or its zorder is changed.
+ */
+class Hwc2LayerList {
+public:
+    Hwc2LayerList();
+    ~Hwc2LayerList();
+
+    void addLayer(const std::shared_ptr<Hwc2Layer> & layer);
+    void removeLayer(hwc2_layer_t id);
+    void clear();
+
+    /*zorder of a layer changed, sort before next use.*/
+    void invalidateOrder() { mOrderChanged = true; }
+
+    std::vector<std::shared_ptr<Hwc2Layer>> & getLayers();
+    /*for passes not caring about order, never sorts.*/
+    std::vector<std::shared_ptr<Hwc2Layer>> & getUnsortedLayers() { return mLayers; }
+    size_t size() { return mLayers.size(); }
+
+protected:
+    std::vector<std::shared_ptr<Hwc2Layer>> mLayers;
+    bool mOrderChanged;
+};
+
+#endif/*HWC2_LAYER_LIST_H*/
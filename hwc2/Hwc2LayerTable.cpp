@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#include <inttypes.h>
+
+#include <MesonLog.h>
+
+#include "Hwc2LayerTable.h"
+
+Hwc2LayerTable::Hwc2LayerTable()
+    : mUsedSlots(LAYER_SLOT_CHUNK) {
+    mSlots.resize(LAYER_SLOT_CHUNK);
+    for (auto it = mSlots.begin(); it != mSlots.end(); it++)
+        it->generation = 0;
+    mFreeLayers.reserve(LAYER_POOL_MAX);
+    mLayerNum = 0;
+    mCreatedNum = mReusedNum = mStaleLookups = 0;
+}
+
+Hwc2LayerTable::~Hwc2LayerTable() {
+    clear();
+}
+
+int32_t Hwc2LayerTable::getSlot(hwc2_layer_t id) {
+    uint64_t idx = id & LAYER_SLOT_MASK;
+    if (idx >= mSlots.size())
+        return -1;
+
+    LayerSlot & slot = mSlots[idx];
+    if (slot.layer.get() == NULL || slot.generation != (id >> LAYER_GEN_SHIFT))
+        return -1;
+    return (int32_t)idx;
+}
+
+/*reuse a pooled layer if composition dropped its references.*/
+std::shared_ptr<Hwc2Layer> Hwc2LayerTable::allocLayer() {
+    for (size_t i = 0; i < mFreeLayers.size(); i++) {
+        if (mFreeLayers[i].layer.use_count() == 1) {
+            std::shared_ptr<Hwc2Layer> layer = mFreeLayers[i].layer;
+            if (!mFreeLayers[i].recycled)
+                layer->recycle();
+            mFreeLayers[i] = mFreeLayers.back();
+            mFreeLayers.pop_back();
+            mReusedNum++;
+            return layer;
+        }
+    }
+
+    mCreatedNum++;
+    return std::make_shared<Hwc2Layer>();
+}
+
+std::shared_ptr<Hwc2Layer> Hwc2LayerTable::createLayer() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    int idx = mUsedSlots.getZeroBit();
+    if (idx < 0) {
+        if (mSlots.size() >= LAYER_SLOT_MAX) {
+            MESON_LOGE("no slot for new layer, %u layers.", mLayerNum);
+            return NULL;
+        }
+        size_t slots = mSlots.size() + LAYER_SLOT_CHUNK;
+        mSlots.resize(slots);
+        for (size_t i = slots - LAYER_SLOT_CHUNK; i < slots; i++)
+            mSlots[i].generation = 0;
+        mUsedSlots.resize((int)slots);
+        idx = mUsedSlots.getZeroBit();
+    }
+
+    LayerSlot & slot = mSlots[idx];
+    /*generation 0 is skipped, so no layer gets id 0.*/
+    slot.generation++;
+    if (slot.generation == 0)
+        slot.generation = 1;
+    slot.layer = allocLayer();
+    slot.layer->setUniqueId(((hwc2_layer_t)slot.generation << LAYER_GEN_SHIFT) | idx);
+    mUsedSlots.setBit(idx);
+    mLayerNum++;
+    return slot.layer;
+}
+
+int32_t Hwc2LayerTable::destroyLayer(hwc2_layer_t id) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    int32_t idx = getSlot(id);
+    if (idx < 0) {
+        mStaleLookups++;
+        return -EINVAL;
+    }
+
+    LayerSlot & slot = mSlots[idx];
+    if (mFreeLayers.size() < LAYER_POOL_MAX) {
+        FreeLayer freeLayer = {slot.layer, false};
+        mFreeLayers.push_back(freeLayer);
+    }
+    slot.layer.reset();
+    mUsedSlots.clearBit(idx);
+    mLayerNum--;
+    return 0;
+}
+
+std::shared_ptr<Hwc2Layer> Hwc2LayerTable::getLayer(hwc2_layer_t id) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    int32_t idx = getSlot(id);
+    if (idx < 0) {
+        mStaleLookups++;
+        return NULL;
+    }
+    return mSlots[idx].layer;
+}
+
+void Hwc2LayerTable::trimFreeLayers() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mFreeLayers.begin(); it != mFreeLayers.end(); it++) {
+        if (!it->recycled && it->layer.use_count() == 1) {
+            it->layer->recycle();
+            it->recycled = true;
+        }
+    }
+}
+
+void Hwc2LayerTable::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (size_t i = 0; i < mSlots.size(); i++) {
+        if (mSlots[i].layer.get()) {
+            mSlots[i].layer.reset();
+            mUsedSlots.clearBit((int)i);
+        }
+    }
+    mFreeLayers.clear();
+    mLayerNum = 0;
+}
+
+uint32_t Hwc2LayerTable::size() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLayerNum;
+}
+
+void Hwc2LayerTable::dump(String8 & dumpstr) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    dumpstr.appendFormat("Layers: %u in %zu slots, created %" PRIu64 ", reused %" PRIu64
+        ", pooled %zu, bad ids %" PRIu64 "\n", mLayerNum, mSlots.size(),
+        mCreatedNum, mReusedNum, mFreeLayers.size(), mStaleLookups);
+}
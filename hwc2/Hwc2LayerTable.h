@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Layers of a display indexed by layer id.
+ */
+
+#ifndef HWC2_LAYER_TABLE_H
+#define HWC2_LAYER_TABLE_H
+
+#include <mutex>
+#include <vector>
+
+#include <BasicTypes.h>
+#include <BitsMap.h>
+#include "Hwc2Layer.h"
+
+/*
+ * Layer id is generation of the slot << LAYER_GEN_SHIFT | slot index.
+ * Generation changes each time the slot is reused, so ids of destroyed
+ * layers are rejected, it takes 2^32 reuses of a slot to wrap. Debug
+ * commands take an int layer id, they name the layer by its slot.
+ */
+#define LAYER_GEN_SHIFT     (32)
+#define LAYER_SLOT_MASK     ((1ULL << LAYER_GEN_SHIFT) - 1)
+#define LAYER_SLOT_CHUNK    (64)        /*slots grow by chunks.*/
+#define LAYER_SLOT_MAX      (1 << 16)
+#define LAYER_POOL_MAX      (32)        /*destroyed layers kept for reuse.*/
+
+/*
+ * Lookups come from layer setters without display lock, all calls are
+ * guarded by the table's own lock.
+ */
+class Hwc2LayerTable {
+public:
+    Hwc2LayerTable();
+    ~Hwc2LayerTable();
+
+    /*layer with its unique id set, NULL when no slot left.*/
+    std::shared_ptr<Hwc2Layer> createLayer();
+    int32_t destroyLayer(hwc2_layer_t id);
+    /*NULL for unknown id or id of a destroyed layer.*/
+    std::shared_ptr<Hwc2Layer> getLayer(hwc2_layer_t id);
+
+    /*
+     * release buffers of pooled layers nobody else holds, called after
+     * composition dropped last frame's layers.
+     */
+    void trimFreeLayers();
+
+    void clear();
+    uint32_t size();
+    void dump(String8 & dumpstr);
+
+protected:
+    /*slot of a valid id, or -1. Called with mMutex held.*/
+    int32_t getSlot(hwc2_layer_t id);
+    std::shared_ptr<Hwc2Layer> allocLayer();
+
+protected:
+    struct LayerSlot {
+        std::shared_ptr<Hwc2Layer> layer;
+        uint32_t generation;
+    };
+
+    std::mutex mMutex;
+    std::vector<LayerSlot> mSlots;
+    BitsMap mUsedSlots;
+    uint32_t mLayerNum;
+
+    /*destroyed layers, reused when nobody else holds them.*/
+    struct FreeLayer {
+        std::shared_ptr<Hwc2Layer> layer;
+        bool recycled;
+    };
+    std::vector<FreeLayer> mFreeLayers;
+
+    /*stats.*/
+    uint64_t mCreatedNum;
+    uint64_t mReusedNum;
+    uint64_t mStaleLookups;
+};
+
+#endif/*HWC2_LAYER_TABLE_H*/
@@ -15,6 +15,12 @@
 #include <BasicTypes.h>
 #include <MesonLog.h>
 #include <DebugHelper.h>
+#include <FenceWatcher.h>
+#include <DrmBufferRegistry.h>
+#include <SysfsWriter.h>
+#include <SysfsCache.h>
+#include <CachedProperty.h>
+#include <HwcReactor.h>
 #include <HwcConfig.h>
 #include <HwcVsync.h>
 #include <HwcDisplayPipe.h>
@@ -26,6 +32,8 @@
 #include "VirtualDisplay.h"
 
 #define GET_REQUEST_FROM_PROP 1
+/*let surfaceflinger present without validate when layers are unchanged.*/
+#define SKIP_VALIDATE_PROP "vendor.hwc.skip-validate"
 
 #define CHECK_DISPLAY_VALID(display)    \
     if (isDisplayValid(display) == false) { \
@@ -58,6 +66,9 @@
 #ifdef GET_REQUEST_FROM_PROP
 static bool m3DMode = false;
 static bool mKeyStoneMode = false;
+/*polled by every validate.*/
+static CachedProperty sPostProcessorProp("vendor.hwc.postprocessor");
+static CachedProperty sKeystoneProp("persist.vendor.hwc.keystone");
 #endif
 /************************************************************
 *                        Hal Interface
@@ -86,6 +97,15 @@ void MesonHwc2::dump(uint32_t* outSize, char* outBuffer) {
     for (it = mDisplays.begin(); it != mDisplays.end(); it++) {
         it->second->dump(dumpstr);
     }
+    FenceWatcher::getInstance().dump(dumpstr);
+    DrmBufferRegistry::getInstance().dump(dumpstr);
+    SysfsWriter::getInstance().dump(dumpstr);
+    SysfsCache::getInstance().dump(dumpstr);
+    CachedProperty::dumpStats(dumpstr);
+    HwcReactor::getInstance().dump(dumpstr);
+    HwDisplayEventListener::getInstance().dump(dumpstr);
+    if (mDisplayPipe)
+        mDisplayPipe->dump(dumpstr);
 
     DebugHelper::getInstance().dump(dumpstr);
     dumpstr.append("\n");
@@ -95,10 +115,18 @@ void MesonHwc2::dump(uint32_t* outSize, char* outBuffer) {
 
 void MesonHwc2::getCapabilities(uint32_t* outCount,
     int32_t* outCapabilities) {
-    *outCount = 1;
+    uint32_t count = 0;
+    int32_t capabilities[2];
+    capabilities[count++] = HWC2_CAPABILITY_SIDEBAND_STREAM;
+#if PLATFORM_SDK_VERSION >= 27
+    if (sys_get_bool_prop(SKIP_VALIDATE_PROP, false))
+        capabilities[count++] = HWC2_CAPABILITY_SKIP_VALIDATE;
+#endif
+
+    *outCount = count;
     if (outCapabilities) {
-        *outCount = 1;
-        outCapabilities[0] = HWC2_CAPABILITY_SIDEBAND_STREAM;
+        for (uint32_t i = 0; i < count; i++)
+            outCapabilities[i] = capabilities[i];
     }
 }
 
@@ -376,6 +404,14 @@ int32_t MesonHwc2::validateDisplay(hwc2_display_t display,
 int32_t MesonHwc2::presentDisplay(hwc2_display_t display,
     int32_t* outPresentFence) {
     GET_HWC_DISPLAY(display);
+    /*validate skipped, handle what it polls every frame.*/
+    if (!hwcDisplay->isValidated()) {
+        uint32_t request = getDisplayRequest();
+        setCalibrateInfo(display);
+        if (request != 0) {
+            handleDisplayRequest(request);
+        }
+    }
     return hwcDisplay->presentDisplay(outPresentFence);
 }
 
@@ -483,8 +519,7 @@ int32_t MesonHwc2::setLayerVisibleRegion(hwc2_display_t display,
 int32_t  MesonHwc2::setLayerZorder(hwc2_display_t display,
     hwc2_layer_t layer, uint32_t z) {
     GET_HWC_DISPLAY(display);
-    GET_HWC_LAYER(hwcDisplay, layer);
-    return hwcLayer->setZorder(z);
+    return hwcDisplay->setLayerZorder(layer, z);
 }
 
 #ifdef HWC_HDR_METADATA_SUPPORT
@@ -565,7 +600,7 @@ uint32_t MesonHwc2::getDisplayRequest() {
 
         if (HwcConfig::alwaysVdinLoopback()) {
             /*get 3dmode status*/
-            bVal = !sys_get_bool_prop("vendor.hwc.postprocessor", true);
+            bVal = !sPostProcessorProp.getBool(true);
             if (m3DMode != bVal) {
                 mDisplayRequests |= bVal ? rPostProcessorStop : rPostProcessorStart;
                 m3DMode = bVal;
@@ -576,8 +611,7 @@ uint32_t MesonHwc2::getDisplayRequest() {
             if (!m3DMode) {
                 /*get keystone status*/
                 bVal = false;
-                if (sys_get_string_prop("persist.vendor.hwc.keystone", val) > 0 &&
-                    strcmp(val, "0") != 0) {
+                if (sKeystoneProp.getString(val) > 0 && strcmp(val, "0") != 0) {
                     bVal = true;
                 }
                 if (mKeyStoneMode != bVal) {
@@ -587,8 +621,7 @@ uint32_t MesonHwc2::getDisplayRequest() {
             }
         } else {
             bVal = false;
-            if (sys_get_string_prop("persist.vendor.hwc.keystone", val) > 0 &&
-                strcmp(val, "0") != 0) {
+            if (sKeystoneProp.getString(val) > 0 && strcmp(val, "0") != 0) {
                 bVal = true;
             }
             if (mKeyStoneMode != bVal) {
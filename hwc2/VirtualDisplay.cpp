@@ -81,10 +81,11 @@ hwc2_error_t VirtualDisplay::setOutputBuffer(
 hwc2_error_t VirtualDisplay::validateDisplay(uint32_t* outNumTypes,
     uint32_t* outNumRequests) {
     mChangedLayers.clear();
+    latchLayerStates();
 
-    std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>>::iterator it;
-    for (it = mLayers.begin(); it != mLayers.end(); it++) {
-        std::shared_ptr<Hwc2Layer> layer = it->second;
+    std::vector<std::shared_ptr<Hwc2Layer>> & layers = mLayerList.getUnsortedLayers();
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        std::shared_ptr<Hwc2Layer> layer = *it;
         if (layer->mHwcCompositionType != HWC2_COMPOSITION_CLIENT) {
             layer->mCompositionType = MESON_COMPOSITION_CLIENT;
             mChangedLayers.push_back(layer->getUniqueId());
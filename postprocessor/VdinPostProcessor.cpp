@@ -8,6 +8,7 @@
  */
 
 #include <misc.h>
+#include <CachedProperty.h>
 #include <DrmTypes.h>
 #include <BasicTypes.h>
 #include <MesonLog.h>
@@ -31,6 +32,7 @@ VdinPostProcessor::VdinPostProcessor() {
 }
 
 VdinPostProcessor::~VdinPostProcessor() {
+    FenceWatcher::getInstance().cancel(this);
     mPlanes.clear();
 }
 
@@ -85,32 +87,33 @@ int32_t VdinPostProcessor::postVout(std::shared_ptr<DrmFramebuffer> fb) {
     }
 
     static int32_t fencefd = -1;
-    static nsecs_t post_start;
 
     fencefd = -1;
     mVout->setOsdChannels(1);
-    post_start = systemTime(CLOCK_MONOTONIC);
     if (mVout->pageFlip(fencefd) < 0) {
         MESON_LOGE("VdinPostProcessor, page flip failed.");
         return -EIO;
     }
 
     if (fencefd >= 0) {
-#if POST_FRAME_DEBUG
-        DrmFence fence(fencefd);
-        fence.waitForever("vout2");
-        float post_time = (float)(systemTime(CLOCK_MONOTONIC) - post_start)/ 1000000.0;
-        if (post_time >= 18.0f)
-            MESON_LOGE("last present fence timeout  (%d)(%f)!", fencefd, post_time);
-#else
-        close(fencefd);
-#endif
+        /*signal time checked on fence watcher, not blocking next capture.*/
+        fence_watch_tag_t tag = {mVout->getId(), -1, 0, FENCE_WATCH_PRESENT};
+        FenceWatcher::getInstance().watch(fencefd, tag, this);
         fencefd = -1;
     }
 
     return 0;
 }
 
+void VdinPostProcessor::onFenceSignaled(const fence_watch_tag_t & tag __unused,
+    nsecs_t submitTime __unused, nsecs_t signalTime __unused) {
+#if POST_FRAME_DEBUG
+    float post_time = (float)(signalTime - submitTime) / 1000000.0;
+    if (post_time >= 18.0f)
+        MESON_LOGE("last present fence timeout  (%d)(%f)!", tag.display, post_time);
+#endif
+}
+
 int32_t VdinPostProcessor::startVdin() {
     int w = 0, h = 0, format = 0;
     Vdin::getInstance().getStreamInfo(w, h, format);
@@ -314,7 +317,8 @@ int32_t VdinPostProcessor::process() {
     mProcessMode = PROCESS_ALWAYS;
 #endif
 #ifdef POST_FRAME_DEBUG
-    bool debug_cap_always = sys_get_bool_prop("vendor.hwc.cap-always", false);
+    static CachedProperty capAlwaysProp("vendor.hwc.cap-always");
+    bool debug_cap_always = capAlwaysProp.getBool(false);
     if (debug_cap_always == true) {
         mProcessMode = PROCESS_ALWAYS;
     } else if (mProcessMode == PROCESS_ALWAYS) {
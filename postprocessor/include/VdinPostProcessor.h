@@ -20,6 +20,7 @@
 #include <HwDisplayPlane.h>
 #include <HwcPostProcessor.h>
 #include <FbProcessor.h>
+#include <FenceWatcher.h>
 #include <BasicTypes.h>
 
 /*
@@ -27,7 +28,8 @@ read back data from vdin, do processor, and repost to another
 vout.
 */
 class VdinPostProcessor
-    :   public HwcPostProcessor {
+    :   public HwcPostProcessor,
+        public FenceListener {
 public:
     VdinPostProcessor();
     ~VdinPostProcessor();
@@ -43,6 +45,10 @@ public:
 
     int32_t present(int flags, int32_t fence);
 
+    /*vout present fence signaled, on fence watcher thread.*/
+    void onFenceSignaled(const fence_watch_tag_t & tag,
+        nsecs_t submitTime, nsecs_t signalTime);
+
 protected:
     static void * threadMain(void * data);
 
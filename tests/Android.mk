@@ -26,3 +26,310 @@ LOCAL_SRC_FILES := \
 LOCAL_MODULE := vdin1test
 include $(BUILD_EXECUTABLE)
 
+
+# replay composition trace on host.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	replay/CompositionReplay.cpp \
+	replay/ReplayMock.cpp \
+	../common/base/DrmTypes.cpp \
+	../common/base/DrmSync.cpp \
+	../common/base/DrmFramebuffer.cpp \
+	../common/base/DrmBufferRegistry.cpp \
+	../common/debug/CompositionTrace.cpp \
+	../common/display/HwDisplayPlane.cpp \
+	../common/display/HwDisplayCommit.cpp \
+	../composition/Composition.cpp \
+	../composition/CompositionHelper.cpp \
+	../composition/BandwidthModel.cpp \
+	../composition/CompositionStrategyFactory.cpp \
+	../composition/simplestrategy/SingleplaneComposition/SingleplaneComposition.cpp \
+	../composition/simplestrategy/MultiplanesComposition/MultiplanesComposition.cpp \
+	../composition/optimalstrategy/CostModelComposition/CostModelComposition.cpp \
+	../common/utils/FrameArena.cpp
+
+LOCAL_C_INCLUDES := \
+	hardware/libhardware/include \
+	hardware/amlogic/gralloc/amlogic \
+	system/core/libsync/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../common/debug/include \
+	$(LOCAL_PATH)/../common/display \
+	$(LOCAL_PATH)/../common/display/include \
+	$(LOCAL_PATH)/../composition \
+	$(LOCAL_PATH)/../composition/include
+
+LOCAL_MODULE := hwc_composition_replay
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# cpu composer blend kernels check and benchmark on host.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+
+LOCAL_SRC_FILES := \
+	blend/CpuBlendBench.cpp \
+	../composition/composer/CpuBlend.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	system/core/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../composition/composer
+
+LOCAL_MODULE := hwc_cpu_blend_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# layer pass of validate benchmark on host, display runs without device.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	layers/LayerListBench.cpp \
+	stubs/BenchStubs.cpp \
+	stubs/DisplayStubs.cpp \
+	../hwc2/Hwc2Display.cpp \
+	../hwc2/Hwc2Base.cpp \
+	../hwc2/Hwc2CommitThread.cpp \
+	../hwc2/Hwc2Layer.cpp \
+	../hwc2/Hwc2LayerList.cpp \
+	../hwc2/Hwc2LayerTable.cpp \
+	../common/utils/BitsMap.cpp \
+	../common/utils/AllocStat.cpp \
+	../common/utils/EventThread.cpp \
+	../common/utils/EventQueue.cpp \
+	../common/utils/HwcReactor.cpp \
+	../common/debug/DebugHelper.cpp \
+	../common/debug/CompositionTrace.cpp \
+	../common/debug/FrameTimeline.cpp \
+	../common/base/DrmTypes.cpp \
+	../common/base/DrmSync.cpp \
+	../common/base/DrmFramebuffer.cpp \
+	../common/base/DrmBufferRegistry.cpp \
+	../common/base/FenceWatcher.cpp \
+	../common/hwc/HwcPowerMode.cpp \
+	../common/hwc/HwcVsync.cpp \
+	../common/hwc/VsyncModel.cpp \
+	../common/display/HwDisplayCommit.cpp \
+	../common/display/HwDisplayPlane.cpp \
+	../composition/Composition.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	hardware/libhardware/include \
+	hardware/amlogic/gralloc/amlogic \
+	system/core/libsync/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../common/debug/include \
+	$(LOCAL_PATH)/../common/display/include \
+	$(LOCAL_PATH)/../common/hwc/include \
+	$(LOCAL_PATH)/../composition/include \
+	$(LOCAL_PATH)/../postprocessor/include \
+	$(LOCAL_PATH)/../hwc2
+
+LOCAL_MODULE := hwc_layer_list_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# layer setters against validate/present stress benchmark on host.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	layers/LayerStateBench.cpp \
+	stubs/BenchStubs.cpp \
+	../hwc2/Hwc2Layer.cpp \
+	../common/base/DrmSync.cpp \
+	../common/base/DrmFramebuffer.cpp \
+	../common/base/DrmBufferRegistry.cpp \
+	../composition/Composition.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	hardware/libhardware/include \
+	hardware/amlogic/gralloc/amlogic \
+	system/core/libsync/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../composition/include \
+	$(LOCAL_PATH)/../hwc2
+
+LOCAL_MODULE := hwc_layer_state_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# layer id create/destroy/lookup benchmark on host.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	layers/LayerTableBench.cpp \
+	stubs/BenchStubs.cpp \
+	../hwc2/Hwc2Layer.cpp \
+	../hwc2/Hwc2LayerTable.cpp \
+	../common/utils/BitsMap.cpp \
+	../common/base/DrmSync.cpp \
+	../common/base/DrmFramebuffer.cpp \
+	../common/base/DrmBufferRegistry.cpp \
+	../composition/Composition.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	hardware/libhardware/include \
+	hardware/amlogic/gralloc/amlogic \
+	system/core/libsync/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../composition/include \
+	$(LOCAL_PATH)/../hwc2
+
+LOCAL_MODULE := hwc_layer_table_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# osd plane requests through the display commit, order check and benchmark on host.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	display/CommitBench.cpp \
+	stubs/BenchStubs.cpp \
+	../common/display/OsdPlane.cpp \
+	../common/display/HwDisplayPlane.cpp \
+	../common/display/HwDisplayCommit.cpp \
+	../common/base/DrmSync.cpp \
+	../common/base/DrmFramebuffer.cpp \
+	../common/base/DrmBufferRegistry.cpp \
+	../common/base/FenceWatcher.cpp \
+	../common/debug/DebugHelper.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	hardware/libhardware/include \
+	hardware/amlogic/gralloc/amlogic \
+	system/core/libsync/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../common/debug/include \
+	$(LOCAL_PATH)/../common/display \
+	$(LOCAL_PATH)/../common/display/include
+
+LOCAL_MODULE := hwc_display_commit_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# sysfs writer value/order check and benchmark on host.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	utils/SysfsWriterBench.cpp \
+	../common/utils/SysfsWriter.cpp \
+	../common/utils/EventQueue.cpp \
+	../common/utils/EventThread.cpp \
+	../common/utils/HwcReactor.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../common/utils/include
+
+LOCAL_MODULE := hwc_sysfs_writer_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# vsync model convergence/prediction check on simulated hw vsync.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	vsync/VsyncModelBench.cpp \
+	../common/hwc/VsyncModel.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/hwc/include
+
+LOCAL_MODULE := hwc_vsync_model_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# reactor dispatch check, context switches of own threads vs reactor.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	utils/ReactorBench.cpp \
+	../common/utils/HwcReactor.cpp \
+	../common/utils/EventQueue.cpp \
+	../common/utils/EventThread.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../common/utils/include
+
+LOCAL_MODULE := hwc_reactor_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# event thread delivery latency/jitter under load, against the old loop.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	utils/EventThreadBench.cpp \
+	../common/utils/EventQueue.cpp \
+	../common/utils/EventThread.cpp \
+	../common/utils/HwcReactor.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../common/utils/include
+
+LOCAL_MODULE := hwc_event_thread_bench
+include $(BUILD_HOST_EXECUTABLE)
+
+
+# uevent storm replay, cpu of old parser vs socket filter and one pass parser.
+include $(CLEAR_VARS)
+LOCAL_CPPFLAGS := $(HWC_CPP_FLAGS)
+LOCAL_CFLAGS := $(HWC_C_FLAGS)
+LOCAL_SHARED_LIBRARIES := liblog libcutils libutils
+
+LOCAL_SRC_FILES := \
+	display/UeventReplayBench.cpp \
+	../common/display/UeventParser.cpp
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include \
+	$(LOCAL_PATH)/../common/utils/include \
+	$(LOCAL_PATH)/../common/base/include \
+	$(LOCAL_PATH)/../common/display/include
+
+LOCAL_MODULE := hwc_uevent_replay_bench
+include $(BUILD_HOST_EXECUTABLE)
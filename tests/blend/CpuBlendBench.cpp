@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Check simd blend kernels against scalar ones and measure cpu composer
+ *     blend time of a typical small layers stack on host.
+ */
+#include <BenchUtils.h>
+#include <CpuBlend.h>
+
+#define BENCH_CANVAS_W 1920
+#define BENCH_CANVAS_H 1080
+#define BENCH_BAND_HEIGHT 32
+
+typedef struct bench_surface {
+    std::vector<uint8_t> pixels;
+    int32_t stride;
+} bench_surface_t;
+
+static void fillSurface(bench_surface_t & surface, int32_t w, int32_t h,
+    int32_t bpp, uint32_t seed, bool premultiplied) {
+    surface.stride = w * bpp;
+    surface.pixels.resize(surface.stride * h);
+    uint8_t * p = surface.pixels.data();
+    for (size_t i = 0; i < surface.pixels.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        p[i] = seed >> 16;
+    }
+    /*keep rgb <= alpha for premultiplied content.*/
+    if (premultiplied && bpp == 4) {
+        for (size_t i = 0; i < surface.pixels.size(); i += 4) {
+            for (int32_t c = 0; c < 3; c++)
+                p[i + c] = p[i + c] > p[i + 3] ? p[i + 3] : p[i + c];
+        }
+    }
+}
+
+static cpu_blend_layer_t makeLayer(bench_surface_t * surface, uint32_t format,
+    uint32_t blendMode, uint32_t planeAlpha, int32_t x, int32_t y, int32_t w, int32_t h) {
+    cpu_blend_layer_t layer;
+    memset(&layer, 0, sizeof(layer));
+    layer.src = surface ? surface->pixels.data() : NULL;
+    layer.srcStride = surface ? surface->stride : 0;
+    layer.format = format;
+    layer.blendMode = blendMode;
+    layer.planeAlpha = planeAlpha;
+    layer.color = 0x80202020;
+    layer.dst.left = x;
+    layer.dst.top = y;
+    layer.dst.right = x + w;
+    layer.dst.bottom = y + h;
+    return layer;
+}
+
+static size_t countMismatch(std::vector<uint8_t> & a, std::vector<uint8_t> & b) {
+    size_t mismatch = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i])
+            mismatch++;
+    }
+    return mismatch;
+}
+
+static void runJob(CpuBandPool & pool, cpu_blend_job_t & job, std::vector<uint8_t> & dst) {
+    job.dst = dst.data();
+    pool.run(job, 0, BENCH_CANVAS_H, BENCH_BAND_HEIGHT);
+}
+
+static double measure(CpuBandPool & pool, cpu_blend_job_t & job,
+    std::vector<uint8_t> & dst, int32_t loops) {
+    int64_t start = nowNs();
+    for (int32_t i = 0; i < loops; i++)
+        runJob(pool, job, dst);
+    return (nowNs() - start) / 1000.0 / loops;
+}
+
+int main(int argc, char ** argv) {
+    int32_t loops = 200;
+    int32_t threads = 4;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('l', "loops", &loops, 1),
+        BENCH_INT_OPTION('t', "threads", &threads, 1),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    /*status bar, toast, 565 icon and a dim layer.*/
+    bench_surface_t statusBar, toast, icon;
+    fillSurface(statusBar, BENCH_CANVAS_W, 64, 4, 1, true);
+    fillSurface(toast, 640, 160, 4, 2, false);
+    fillSurface(icon, 256, 256, 2, 3, false);
+
+    cpu_blend_job_t job;
+    job.dstStride = BENCH_CANVAS_W * 4;
+    job.forceScalar = false;
+    job.layers.push_back(makeLayer(NULL, CPU_BLEND_COLOR, CPU_BLEND_COVERAGE,
+        255, 560, 340, 800, 400));
+    job.layers.push_back(makeLayer(&icon, CPU_BLEND_RGB565, CPU_BLEND_NONE,
+        204, 832, 412, 256, 256));
+    job.layers.push_back(makeLayer(&toast, CPU_BLEND_RGBA8888, CPU_BLEND_COVERAGE,
+        230, 640, 880, 640, 160));
+    job.layers.push_back(makeLayer(&statusBar, CPU_BLEND_RGBA8888, CPU_BLEND_PREMULTIPLIED,
+        255, 0, 0, BENCH_CANVAS_W, 64));
+
+    /*clear what the layers cover, as composer clears its dirty area.*/
+    uint64_t pixels = 0;
+    for (auto it = job.layers.begin(); it != job.layers.end(); ++it) {
+        job.clearRects.push_back(it->dst);
+        pixels += (uint64_t)(it->dst.right - it->dst.left) * (it->dst.bottom - it->dst.top);
+    }
+
+    /*simd result should be same as scalar.*/
+    std::vector<uint8_t> ref(job.dstStride * BENCH_CANVAS_H);
+    std::vector<uint8_t> out(job.dstStride * BENCH_CANVAS_H);
+    CpuBandPool single(0);
+    job.forceScalar = true;
+    runJob(single, job, ref);
+    job.forceScalar = false;
+    runJob(single, job, out);
+    int32_t errors = 0;
+    size_t mismatch = countMismatch(ref, out);
+    printf("kernel %s: %zu bytes mismatch with scalar.\n", cpu_blend_simd_name(), mismatch);
+    BENCH_CHECK(errors, mismatch == 0, "simd blend differs from scalar.");
+
+    printf("blend %llu pixels of %zu layers, %d loops.\n",
+        (unsigned long long)pixels, job.layers.size(), loops);
+    job.forceScalar = true;
+    printf("scalar 1 thread: %8.1f us/frame\n", measure(single, job, out, loops));
+    job.forceScalar = false;
+    printf("%-6s 1 thread: %8.1f us/frame\n", cpu_blend_simd_name(),
+        measure(single, job, out, loops));
+
+    CpuBandPool pool(threads - 1);
+    printf("%-6s %d threads: %7.1f us/frame\n", cpu_blend_simd_name(),
+        pool.getThreadNum(), measure(pool, job, out, loops));
+    size_t bandMismatch = countMismatch(ref, out);
+    printf("%zu bytes mismatch with %d threads.\n", bandMismatch, pool.getThreadNum());
+    BENCH_CHECK(errors, bandMismatch == 0, "blend in bands differs from scalar.");
+
+    return finishBench(errors);
+}
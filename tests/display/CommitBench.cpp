@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Post frames of osd planes through the display commit with a fake
+ *     driver backend. Checks each frame posts every updated plane once,
+ *     in setPlane order and before the flip, and compares driver calls
+ *     of the legacy sequence with a batched backend. Checks a dropped
+ *     frame posts nothing and its planes repost the next frame.
+ */
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+
+#include <BenchUtils.h>
+#include <HwDisplayCommit.h>
+#include <HwDisplayPlane.h>
+#include <OsdPlane.h>
+
+#define BENCH_PLANES 3
+
+/*driver of the bench, records calls of each frame.*/
+class FakeBackend : public HwDisplayBackend {
+public:
+    FakeBackend(bool batch, int64_t callNs, int64_t requestNs)
+        : mBatch(batch), mCallNs(callNs), mRequestNs(requestNs) {
+        mIoctls = mCommits = 0;
+    }
+
+    int32_t ioctl(int32_t fd, unsigned long cmd, void * arg) {
+        mIoctls++;
+        spinNs(mCallNs);
+        post(fd, cmd, arg);
+        return 0;
+    }
+
+    int32_t commit(HwDisplayCommit & commit) {
+        if (!mBatch)
+            return -EOPNOTSUPP;
+
+        mCommits++;
+        spinNs(mCallNs);
+        std::vector<hw_commit_request_t> & requests = commit.getRequests();
+        for (auto it = requests.begin(); it != requests.end(); ++it) {
+            spinNs(mRequestNs);
+            post(it->fd, it->cmd, it->arg);
+            it->result = 0;
+        }
+        return 0;
+    }
+
+    std::vector<int32_t> mPosted;   /*fds of this frame in posting order.*/
+    uint64_t mIoctls;
+    uint64_t mCommits;
+
+protected:
+    void post(int32_t fd, unsigned long cmd, void * arg) {
+        if (cmd == FBIOPUT_OSD_SYNC_RENDER_ADD)
+            ((osd_plane_info_t *)arg)->out_fen_fd = -1;
+        else if (cmd == FBIOPUT_OSD_DO_HWC)
+            ((osd_page_flip_info_t *)arg)->out_fen_fd = -1;
+        mPosted.push_back(fd);
+    }
+
+    bool mBatch;
+    int64_t mCallNs;
+    int64_t mRequestNs;
+};
+
+typedef struct bench_result {
+    double frameUs;
+    double callsPerFrame;
+    double requestsPerFrame;
+} bench_result_t;
+
+/*return error count.*/
+static int32_t runBench(bool batch, int32_t frames, int32_t callNs,
+    bench_result_t & result) {
+    std::shared_ptr<FakeBackend> backend =
+        std::make_shared<FakeBackend>(batch, callNs, callNs / 8);
+    std::shared_ptr<HwDisplayCommit> commit = std::make_shared<HwDisplayCommit>(backend);
+    int32_t crtcFd = open("/dev/null", O_RDWR);
+
+    std::vector<std::shared_ptr<OsdPlane>> planes;
+    std::vector<std::shared_ptr<DrmFramebuffer>> fbs;
+    std::map<int32_t, int32_t> planeOfFd;
+    for (int32_t i = 0; i < BENCH_PLANES; i++) {
+        std::shared_ptr<OsdPlane> plane =
+            std::make_shared<OsdPlane>(open("/dev/null", O_RDWR), i);
+        plane->setCommit(commit);
+        planeOfFd[plane->getDrvFd()] = i;
+        planes.push_back(plane);
+
+        std::shared_ptr<DrmFramebuffer> fb = std::make_shared<DrmFramebuffer>();
+        fb->mFbType = DRM_FB_SCANOUT;
+        fb->mBlendMode = DRM_BLEND_MODE_PREMULTIPLIED;
+        fb->mDisplayFrame.right = fb->mSourceCrop.right = 1920;
+        fb->mDisplayFrame.bottom = fb->mSourceCrop.bottom = 1080;
+        fbs.push_back(fb);
+    }
+
+    int32_t errors = 0;
+    uint64_t requests = 0;
+    int64_t start = nowNs();
+    for (int32_t f = 0; f < frames; f++) {
+        backend->mPosted.clear();
+        /*osd0 changes every frame, osd1 every other frame, osd2 blanks now and then.*/
+        fbs[0]->mContentUpdated = true;
+        fbs[1]->mContentUpdated = (f % 2) == 0;
+        fbs[2]->mContentUpdated = (f % 3) == 0;
+        std::vector<int32_t> setOrder;
+        for (int32_t i = BENCH_PLANES - 1; i >= 0; i--) {
+            bool blank = i == 2 && (f % 4) == 3;
+            planes[i]->setPlane(blank ? NULL : fbs[i], i + 1, blank ? BLANK_FOR_NO_CONTENT : UNBLANK);
+            setOrder.push_back(i);
+        }
+
+        std::vector<int32_t> updated;
+        for (auto it = setOrder.begin(); it != setOrder.end(); ++it) {
+            if (planes[*it]->checkUpdated())
+                updated.push_back(*it);
+        }
+
+        osd_page_flip_info_t flipInfo;
+        memset(&flipInfo, 0, sizeof(flipInfo));
+        int32_t ret = commit->submit(crtcFd, FBIOPUT_OSD_DO_HWC, &flipInfo);
+        BENCH_CHECK(errors, ret == 0, "frame %d: flip return %d.", f, ret);
+
+        std::vector<int32_t> & posted = backend->mPosted;
+        bool flipLast = !posted.empty() && posted.back() == crtcFd;
+        BENCH_CHECK(errors, flipLast, "frame %d: flip is not posted last.", f);
+        if (!flipLast)
+            continue;
+        std::vector<int32_t> postedPlanes;
+        for (size_t i = 0; i + 1 < posted.size(); i++)
+            postedPlanes.push_back(planeOfFd[posted[i]]);
+        BENCH_CHECK(errors, postedPlanes == updated,
+            "frame %d: %zu planes posted, %zu updated.", f, postedPlanes.size(), updated.size());
+        requests += posted.size();
+    }
+    int64_t elapsed = nowNs() - start;
+
+    result.frameUs = elapsed / 1000.0 / frames;
+    result.callsPerFrame = (double)(backend->mIoctls + backend->mCommits) / frames;
+    result.requestsPerFrame = (double)requests / frames;
+
+    String8 dumpstr;
+    commit->dump(dumpstr);
+    printf("%s: %s", batch ? "batch " : "legacy", dumpstr.string());
+
+    planes.clear();
+    close(crtcFd);
+    return errors;
+}
+
+/*frame dropped before the flip, planes post their state again next frame.*/
+static int32_t checkAbort() {
+    std::shared_ptr<FakeBackend> backend = std::make_shared<FakeBackend>(false, 0, 0);
+    std::shared_ptr<HwDisplayCommit> commit = std::make_shared<HwDisplayCommit>(backend);
+    int32_t crtcFd = open("/dev/null", O_RDWR);
+    std::shared_ptr<OsdPlane> plane = std::make_shared<OsdPlane>(open("/dev/null", O_RDWR), 0);
+    plane->setCommit(commit);
+    std::shared_ptr<DrmFramebuffer> fb = std::make_shared<DrmFramebuffer>();
+    fb->mFbType = DRM_FB_SCANOUT;
+    fb->mDisplayFrame.right = fb->mSourceCrop.right = 1920;
+    fb->mDisplayFrame.bottom = fb->mSourceCrop.bottom = 1080;
+
+    int32_t errors = 0;
+    osd_page_flip_info_t flipInfo;
+    memset(&flipInfo, 0, sizeof(flipInfo));
+    fb->mContentUpdated = true;
+    plane->setPlane(fb, 1, UNBLANK);
+    commit->submit(crtcFd, FBIOPUT_OSD_DO_HWC, &flipInfo);
+
+    /*set twice and dropped, nothing reaches the driver.*/
+    backend->mPosted.clear();
+    plane->setPlane(fb, 1, UNBLANK);
+    plane->setPlane(fb, 1, UNBLANK);
+    commit->abort();
+    BENCH_CHECK(errors, backend->mPosted.empty(), "aborted frame posted %zu requests.",
+        backend->mPosted.size());
+
+    /*same clean fb, but the driver never got the dropped state.*/
+    fb->mContentUpdated = false;
+    plane->setPlane(fb, 1, UNBLANK);
+    commit->submit(crtcFd, FBIOPUT_OSD_DO_HWC, &flipInfo);
+    BENCH_CHECK(errors, backend->mPosted.size() == 2,
+        "frame after abort posted %zu requests, expect 2.", backend->mPosted.size());
+
+    /*posted now, clean fb is skipped again.*/
+    backend->mPosted.clear();
+    plane->setPlane(fb, 1, UNBLANK);
+    commit->submit(crtcFd, FBIOPUT_OSD_DO_HWC, &flipInfo);
+    BENCH_CHECK(errors, backend->mPosted.size() == 1,
+        "clean frame posted %zu requests, expect 1.", backend->mPosted.size());
+
+    close(crtcFd);
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    int32_t frames = 20000;
+    int32_t callNs = 2000;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('f', "frames", &frames, 1),
+        BENCH_INT_OPTION('c', "driver call ns", &callNs, 0),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    int32_t errors = checkAbort();
+    bench_result_t legacy, batch;
+    errors += runBench(false, frames, callNs, legacy);
+    errors += runBench(true, frames, callNs, batch);
+
+    printf("%d frames, %d osd planes, driver call %d ns\n",
+        frames, BENCH_PLANES, callNs);
+    printf("%8s %12s %14s %16s\n", "mode", "frame(us)", "calls/frame", "requests/frame");
+    printf("%8s %12.2f %14.2f %16.2f\n", "legacy",
+        legacy.frameUs, legacy.callsPerFrame, legacy.requestsPerFrame);
+    printf("%8s %12.2f %14.2f %16.2f\n", "batch",
+        batch.frameUs, batch.callsPerFrame, batch.requestsPerFrame);
+
+    return finishBench(errors);
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Replay a uevent storm through a datagram socket and compare the
+ *     receiver cpu time of the old strcmp/strstr parser on every uevent
+ *     with the socket filter plus one pass parser.
+ *     A capture file (-f) has one uevent per paragraph: the first line is
+ *     "action@devpath", then one KEY=value per line, blank line ends it.
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+
+#include <BenchUtils.h>
+#include <UeventParser.h>
+
+#define BENCH_MSG_MAX           4096
+#define BENCH_STORM_UEVENTS     50000
+#define BENCH_DISPLAY_INTERVAL  500     /*one display uevent per interval.*/
+
+/*passes the filter, no display state, ends a replay.*/
+static const char sEndUevent[] = HDMITX_HOTPLUG_EVENT "\0BENCH_END=1";
+
+struct ParsedEvent {
+    drm_display_event event;
+    int val;
+};
+
+/*old HwDisplayEventListener matching, on a nul terminated buffer.*/
+typedef struct drm_uevent_info {
+    const char * head;
+    drm_display_event eventType;
+    const char * stateEnable;
+    const char * stateDisable;
+}drm_uevent_info_t;
+
+static drm_uevent_info_t sLegacyParser[] = {
+    {HDMITX_HOTPLUG_EVENT, DRM_EVENT_HDMITX_HOTPLUG,
+        HDMI_EVENT_STATE_ENABLE, HDMI_EVENT_STATE_DISABLE},
+    {HDMITX_HDCP_EVENT, DRM_EVENT_HDMITX_HDCP,
+        HDMI_EVENT_STATE_ENABLE, HDMI_EVENT_STATE_DISABLE},
+    {VOUT_MODE_EVENT, DRM_EVENT_VOUT1_MODE_CHANGED,
+        VOUT_EVENT_MODESWITCH_COMPLETE, VOUT_EVENT_MODESWITCH_BEGIN},
+    {VOUT2_MODE_EVENT, DRM_EVENT_VOUT2_MODE_CHANGED,
+        VOUT_EVENT_MODESWITCH_COMPLETE, VOUT_EVENT_MODESWITCH_BEGIN}
+};
+
+static bool legacyParse(char * ueventMsg, ParsedEvent & parsed) {
+    for (drm_uevent_info_t uevent : sLegacyParser) {
+        if (strcmp(ueventMsg, uevent.head) == 0) {
+            char * msg = ueventMsg;
+            while (*msg) {
+                if (strstr(msg, uevent.stateEnable)) {
+                    parsed = {uevent.eventType, 1};
+                    return true;
+                } else if (strstr(msg, uevent.stateDisable)) {
+                    parsed = {uevent.eventType, 0};
+                    return true;
+                }
+                msg += strlen(msg) + 1;
+            }
+        }
+    }
+    return false;
+}
+
+static std::string makeUevent(const std::vector<std::string> & fields, uint32_t seq) {
+    std::string msg;
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        msg += *it;
+        msg.push_back('\0');
+    }
+    msg += "SEQNUM=" + std::to_string(seq);
+    msg.push_back('\0');
+    return msg;
+}
+
+/*system noise of a busy box: battery, thermal, storage, input and usb.*/
+static void buildStorm(std::vector<std::string> & storm) {
+    std::vector<std::vector<std::string>> noise = {
+        {"change@/devices/platform/battery/power_supply/battery", "ACTION=change",
+            "DEVPATH=/devices/platform/battery/power_supply/battery",
+            "SUBSYSTEM=power_supply", "POWER_SUPPLY_NAME=battery",
+            "POWER_SUPPLY_STATUS=Charging", "POWER_SUPPLY_HEALTH=Good",
+            "POWER_SUPPLY_PRESENT=1", "POWER_SUPPLY_CAPACITY=87",
+            "POWER_SUPPLY_TEMP=312", "POWER_SUPPLY_VOLTAGE_NOW=4123000"},
+        {"change@/devices/virtual/thermal/thermal_zone0", "ACTION=change",
+            "DEVPATH=/devices/virtual/thermal/thermal_zone0", "SUBSYSTEM=thermal",
+            "NAME=soc_thermal", "TEMP=61000", "TRIP=1"},
+        {"change@/devices/virtual/block/loop3", "ACTION=change",
+            "DEVPATH=/devices/virtual/block/loop3", "SUBSYSTEM=block",
+            "MAJOR=7", "MINOR=24", "DEVNAME=loop3", "DEVTYPE=disk", "DISK_MEDIA_CHANGE=1"},
+        {"add@/devices/platform/ff500000.dwc3/xhci-hcd.0.auto/usb1/1-1/1-1:1.0/input/input9",
+            "ACTION=add",
+            "DEVPATH=/devices/platform/ff500000.dwc3/xhci-hcd.0.auto/usb1/1-1/1-1:1.0/input/input9",
+            "SUBSYSTEM=input", "PRODUCT=3/46d/c52b/111", "NAME=\"Logitech USB Receiver\"",
+            "PHYS=\"usb-xhci-hcd.0.auto-1/input0\"", "EV=120013", "KEY=1000000000007",
+            "MSC=10", "LED=1f"},
+        {"change@/devices/virtual/amhdmitx/amhdmitx0/hdmi_audio", "ACTION=change",
+            "DEVPATH=/devices/virtual/amhdmitx/amhdmitx0/hdmi_audio",
+            "SUBSYSTEM=amhdmitx", HDMI_EVENT_STATE_ENABLE},
+    };
+    std::vector<std::vector<std::string>> display = {
+        {"change@/devices/virtual/amhdmitx/amhdmitx0/hdmi", "ACTION=change",
+            "DEVPATH=/devices/virtual/amhdmitx/amhdmitx0/hdmi", "SUBSYSTEM=amhdmitx",
+            HDMI_EVENT_STATE_DISABLE},
+        {"change@/devices/virtual/amhdmitx/amhdmitx0/hdmi", "ACTION=change",
+            "DEVPATH=/devices/virtual/amhdmitx/amhdmitx0/hdmi", "SUBSYSTEM=amhdmitx",
+            HDMI_EVENT_STATE_ENABLE},
+        {"change@/devices/platform/vout/extcon/setmode", "ACTION=change",
+            "DEVPATH=/devices/platform/vout/extcon/setmode", "SUBSYSTEM=extcon",
+            "NAME=setmode", VOUT_EVENT_MODESWITCH_BEGIN},
+        {"change@/devices/platform/vout/extcon/setmode", "ACTION=change",
+            "DEVPATH=/devices/platform/vout/extcon/setmode", "SUBSYSTEM=extcon",
+            "NAME=setmode", VOUT_EVENT_MODESWITCH_COMPLETE},
+        {"change@/devices/virtual/amhdmitx/amhdmitx0/hdcp", "ACTION=change",
+            "DEVPATH=/devices/virtual/amhdmitx/amhdmitx0/hdcp", "SUBSYSTEM=amhdmitx",
+            HDMI_EVENT_STATE_ENABLE},
+        {"change@/devices/platform/vout2/extcon/setmode2", "ACTION=change",
+            "DEVPATH=/devices/platform/vout2/extcon/setmode2", "SUBSYSTEM=extcon",
+            "NAME=setmode2", VOUT_EVENT_MODESWITCH_COMPLETE},
+    };
+
+    uint32_t seq = 1000;
+    for (uint32_t i = 0; i < BENCH_STORM_UEVENTS; i++) {
+        if (i % BENCH_DISPLAY_INTERVAL == BENCH_DISPLAY_INTERVAL - 1)
+            storm.push_back(makeUevent(display[(i / BENCH_DISPLAY_INTERVAL) % display.size()], seq++));
+        else
+            storm.push_back(makeUevent(noise[i % noise.size()], seq++));
+    }
+}
+
+static int32_t loadStorm(const char * path, std::vector<std::string> & storm) {
+    FILE * fp = fopen(path, "r");
+    if (!fp) {
+        printf("open %s failed.\n", path);
+        return -ENOENT;
+    }
+
+    char line[BENCH_MSG_MAX];
+    std::string msg;
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strcspn(line, "\r\n");
+        if (len == 0) {
+            if (!msg.empty())
+                storm.push_back(msg);
+            msg.clear();
+            continue;
+        }
+        msg.append(line, len);
+        msg.push_back('\0');
+    }
+    if (!msg.empty())
+        storm.push_back(msg);
+    fclose(fp);
+    return 0;
+}
+
+static nsecs_t threadCpuTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (nsecs_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct ReplayResult {
+    uint64_t received;
+    nsecs_t cpuTime;
+    std::vector<ParsedEvent> events;
+};
+
+struct Receiver {
+    int sock;
+    bool filtered;
+    UeventParser * parser;
+    ReplayResult result;
+};
+
+static void * receiverThread(void * data) {
+    Receiver * recv = (Receiver *)data;
+    char msg[BENCH_MSG_MAX + 2];
+    nsecs_t start = threadCpuTime();
+
+    while (true) {
+        ssize_t len = ::recv(recv->sock, msg, BENCH_MSG_MAX, 0);
+        if (len <= 0)
+            break;
+        if (len == sizeof(sEndUevent) && memcmp(msg, sEndUevent, len) == 0)
+            break;
+        recv->result.received++;
+
+        ParsedEvent parsed;
+        if (recv->filtered) {
+            if (recv->parser->parse(msg, len, parsed.event, parsed.val) == 0)
+                recv->result.events.push_back(parsed);
+        } else {
+            msg[len] = msg[len + 1] = '\0';
+            if (legacyParse(msg, parsed))
+                recv->result.events.push_back(parsed);
+        }
+    }
+
+    recv->result.cpuTime = threadCpuTime() - start;
+    return NULL;
+}
+
+static int32_t replay(const std::vector<std::string> & storm, bool filtered,
+    UeventParser & parser, ReplayResult & result) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) != 0)
+        return -errno;
+    if (filtered && parser.attachFilter(fds[0]) != 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -EINVAL;
+    }
+
+    Receiver recv = {fds[0], filtered, &parser, {0, 0, {}}};
+    pthread_t thread;
+    pthread_create(&thread, NULL, receiverThread, &recv);
+    for (auto it = storm.begin(); it != storm.end(); ++it)
+        send(fds[1], it->data(), it->size(), 0);
+    send(fds[1], sEndUevent, sizeof(sEndUevent), 0);
+    pthread_join(thread, NULL);
+
+    close(fds[0]);
+    close(fds[1]);
+    result = recv.result;
+    return 0;
+}
+
+/*return error count.*/
+static int32_t checkParser(UeventParser & parser) {
+    int32_t errors = 0;
+    drm_display_event event;
+    int val;
+
+    /*last field without nul, as recv may cut it.*/
+    const char hotplug[] = HDMITX_HOTPLUG_EVENT "\0ACTION=change\0" HDMI_EVENT_STATE_ENABLE;
+    BENCH_CHECK(errors, parser.parse(hotplug, sizeof(hotplug) - 1, event, val) == 0 &&
+        event == DRM_EVENT_HDMITX_HOTPLUG && val == 1,
+        "hotplug without last nul not parsed.");
+    /*state cut by length is not a state.*/
+    BENCH_CHECK(errors, parser.parse(hotplug, sizeof(hotplug) - 2, event, val) != 0,
+        "truncated state parsed.");
+    /*devpath only sharing the head.*/
+    const char audio[] = HDMITX_HOTPLUG_EVENT "_audio\0" HDMI_EVENT_STATE_ENABLE;
+    BENCH_CHECK(errors, parser.parse(audio, sizeof(audio), event, val) != 0,
+        "hdmi_audio matched hdmi.");
+    /*extcon state with more cables.*/
+    const char vout[] = VOUT_MODE_EVENT "\0" VOUT_EVENT_MODESWITCH_COMPLETE "\nUSB=0";
+    BENCH_CHECK(errors, parser.parse(vout, sizeof(vout), event, val) == 0 &&
+        event == DRM_EVENT_VOUT1_MODE_CHANGED && val == 1,
+        "vout mode complete not parsed.");
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    const char * capture = NULL;
+    bench_option_t options[] = {
+        BENCH_STR_OPTION('f', "uevent capture", &capture),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    std::vector<std::string> storm;
+    if (capture) {
+        if (loadStorm(capture, storm) != 0)
+            return -ENOENT;
+    } else {
+        buildStorm(storm);
+    }
+
+    UeventParser parser;
+    int32_t errors = checkParser(parser);
+
+    size_t expectEvents = 0;
+    for (auto it = storm.begin(); it != storm.end(); ++it) {
+        std::vector<char> msg(it->begin(), it->end());
+        msg.push_back('\0');
+        msg.push_back('\0');
+        ParsedEvent parsed;
+        if (legacyParse(msg.data(), parsed))
+            expectEvents++;
+    }
+
+    ReplayResult legacy, filtered;
+    if (replay(storm, false, parser, legacy) != 0 ||
+        replay(storm, true, parser, filtered) != 0) {
+        printf("replay failed, socket filter not supported?\n");
+        return -EINVAL;
+    }
+
+    printf("%zu uevents, %zu display events, filter %zu instructions\n",
+        storm.size(), expectEvents, parser.getFilter().size());
+    printf("%10s %10s %10s %14s %14s\n", "mode", "received", "events", "cpu us",
+        "ns/uevent");
+    printf("%10s %10" PRIu64 " %10zu %14.1f %14.1f\n", "legacy", legacy.received,
+        legacy.events.size(), legacy.cpuTime / 1e3, (double)legacy.cpuTime / storm.size());
+    printf("%10s %10" PRIu64 " %10zu %14.1f %14.1f\n", "filtered", filtered.received,
+        filtered.events.size(), filtered.cpuTime / 1e3,
+        (double)filtered.cpuTime / storm.size());
+
+    /*same typed events in same order.*/
+    bool same = legacy.events.size() == filtered.events.size();
+    for (size_t i = 0; same && i < legacy.events.size(); i++)
+        same = legacy.events[i].event == filtered.events[i].event &&
+            legacy.events[i].val == filtered.events[i].val;
+    BENCH_CHECK(errors, same, "filtered events differ from legacy.");
+
+    return finishBench(errors);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Scaffold shared by the host benches: clock, busy wait, options and
+ *     the error count of the checks. Each bench is one executable, the
+ *     helpers are static.
+ */
+
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+#endif
+
+static inline int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*burn cpu, stands for work done under a lock or in the driver.*/
+static inline void spinNs(int64_t ns) {
+    int64_t end = nowNs() + ns;
+    while (nowNs() < end)
+        ;
+}
+
+static inline uint32_t nextRand(uint32_t & seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/*one letter option with a value, int or string.*/
+typedef struct bench_option {
+    char flag;
+    const char * help;      /*value name in usage.*/
+    int32_t * value;        /*NULL for a string option.*/
+    int32_t min;            /*smaller values keep the default.*/
+    const char ** str;
+} bench_option_t;
+
+#define BENCH_INT_OPTION(flag, help, value, min) {flag, help, value, min, NULL}
+#define BENCH_STR_OPTION(flag, help, str) {flag, help, NULL, 0, str}
+
+/*
+ * parse options of a bench, -h or a bad option prints usage.
+ * return 1 to run the bench, otherwise main returns the value.
+ */
+static inline int32_t parseBenchOptions(int argc, char ** argv,
+    const bench_option_t * options, size_t num) {
+    char optstring[64] = "h";
+    size_t len = 1;
+    for (size_t i = 0; i < num && len + 3 < sizeof(optstring); i++) {
+        optstring[len++] = options[i].flag;
+        optstring[len++] = ':';
+    }
+    optstring[len] = '\0';
+
+    int opt;
+    while ((opt = getopt(argc, argv, optstring)) != -1) {
+        const bench_option_t * option = NULL;
+        for (size_t i = 0; i < num; i++) {
+            if (options[i].flag == opt)
+                option = &options[i];
+        }
+
+        if (!option) {
+            printf("Usage: %s", argv[0]);
+            for (size_t i = 0; i < num; i++)
+                printf(" [-%c %s]", options[i].flag, options[i].help);
+            printf("\n");
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+
+        if (option->value) {
+            int32_t val = atoi(optarg);
+            if (val >= option->min)
+                *option->value = val;
+        } else {
+            *option->str = optarg;
+        }
+    }
+    return 1;
+}
+
+/*count a failed check, errors is the counter of the caller.*/
+#define BENCH_CHECK(errors, cond, fmt, ...) do {    \
+        if (!(cond)) {                              \
+            printf(fmt "\n", ##__VA_ARGS__);        \
+            (errors)++;                             \
+        }                                           \
+    } while (0)
+
+/*exit code of main, failed checks are summed up once.*/
+static inline int finishBench(int32_t errors) {
+    if (errors) {
+        printf("FAILED: %d errors.\n", errors);
+        return -1;
+    }
+    return 0;
+}
+
+#endif/*BENCH_UTILS_H*/
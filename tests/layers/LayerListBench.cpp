@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Measure cpu time of the layer pass in validate, the old unordered_map
+ *     walk with full sort against Hwc2Display's pass on the zorder kept
+ *     layer list with dirty bits. The display runs without crtc.
+ */
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include <BenchUtils.h>
+#include <Composition.h>
+#include <Hwc2Display.h>
+#include <Hwc2Layer.h>
+
+#define BENCH_FB_W 1920
+#define BENCH_FB_H 1080
+
+/*debug hide list of the legacy pass, copied out per call as DebugHelper does.*/
+static std::vector<int> sHideLayers;
+static void getHideLayers(std::vector<int> & layers) { layers = sHideLayers; }
+
+static void adjustFrame(Hwc2Layer * layer, display_zoom_info_t & info) {
+    layer->mDisplayFrame.left = (int32_t)ceilf(layer->mBackupDisplayFrame.left *
+        info.crtc_display_w / info.framebuffer_w) + info.crtc_display_x;
+    layer->mDisplayFrame.top = (int32_t)ceilf(layer->mBackupDisplayFrame.top *
+        info.crtc_display_h / info.framebuffer_h) + info.crtc_display_y;
+    layer->mDisplayFrame.right = (int32_t)ceilf(layer->mBackupDisplayFrame.right *
+        info.crtc_display_w / info.framebuffer_w) + info.crtc_display_x;
+    layer->mDisplayFrame.bottom = (int32_t)ceilf(layer->mBackupDisplayFrame.bottom *
+        info.crtc_display_h / info.framebuffer_h) + info.crtc_display_y;
+}
+
+static bool isHideLayer(hwc2_layer_t id, std::vector<int> & hideLayers) {
+    for (auto it = hideLayers.begin(); it != hideLayers.end(); it++) {
+        if (*it == (int)id)
+            return true;
+    }
+    return false;
+}
+
+static void setCompositionType(Hwc2Layer * layer, bool hide) {
+    if (hide)
+        layer->mCompositionType = MESON_COMPOSITION_DUMMY;
+    else if (layer->mHwcCompositionType == HWC2_COMPOSITION_CLIENT)
+        layer->mCompositionType = MESON_COMPOSITION_CLIENT;
+    else
+        layer->mCompositionType = MESON_COMPOSITION_UNDETERMINED;
+}
+
+/*layer pass of validate before the layer list.*/
+static void legacyValidate(
+    std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>> & layers,
+    std::vector<std::shared_ptr<DrmFramebuffer>> & presentLayers,
+    display_zoom_info_t & info) {
+    presentLayers.clear();
+    presentLayers.reserve(10);
+
+    bool bUpdateLayerList = false;
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        std::shared_ptr<Hwc2Layer> layer = it->second;
+        if (layer->isUpdateZorder() == true) {
+            bUpdateLayerList = true;
+            break;
+        }
+    }
+
+    for (auto it = layers.begin(); it != layers.end(); it++) {
+        std::shared_ptr<Hwc2Layer> layer = it->second;
+        std::shared_ptr<DrmFramebuffer> buffer = layer;
+        if (bUpdateLayerList == true && layer->isUpdateZorder() == false)
+            continue;
+        presentLayers.push_back(buffer);
+
+        std::vector<int> hideLayers;
+        getHideLayers(hideLayers);
+        setCompositionType(layer.get(), isHideLayer(it->first, hideLayers));
+    }
+
+    if (presentLayers.size() > 1) {
+        struct {
+            bool operator() (std::shared_ptr<DrmFramebuffer> a,
+                std::shared_ptr<DrmFramebuffer> b) {
+                return a->mZorder > b->mZorder;
+            }
+        } zorderCompare;
+        std::sort(presentLayers.begin(), presentLayers.end(), zorderCompare);
+    }
+
+    for (auto it = presentLayers.begin(); it != presentLayers.end(); it++)
+        adjustFrame((Hwc2Layer*)(it->get()), info);
+}
+
+/*display without crtc, validate's layer pass is called alone.*/
+class BenchDisplay : public Hwc2Display {
+public:
+    BenchDisplay(display_zoom_info_t & info) : Hwc2Display(NULL) {
+        mCalibrateInfo = info;
+    }
+
+    std::shared_ptr<Hwc2Layer> addLayer() {
+        hwc2_layer_t id;
+        if (createLayer(&id) != HWC2_ERROR_NONE)
+            return NULL;
+        return getLayerById(id);
+    }
+
+    /*layer steps of prepareComposition and validateDisplay.*/
+    void layerPass() {
+        mPresentLayers.clear();
+        collectLayersForPresent();
+        adjustDisplayFrame();
+        for (auto it = mPresentLayers.begin(); it != mPresentLayers.end(); it++)
+            ((Hwc2Layer*)(it->get()))->clearChangedFlags();
+    }
+
+    std::vector<std::shared_ptr<DrmFramebuffer>> & getPresentLayers() {
+        return mPresentLayers;
+    }
+};
+
+/*surfaceflinger side of a frame, one layer moves and the others are resent.*/
+static void updateLayers(std::vector<std::shared_ptr<Hwc2Layer>> & layers,
+    int32_t frame) {
+    for (size_t i = 0; i < layers.size(); i++) {
+        hwc_rect_t rect;
+        int32_t offset = (i == (size_t)frame % layers.size()) ? frame % 64 : 0;
+        rect.left = (int32_t)(i * 8) + offset;
+        rect.top = (int32_t)(i * 4);
+        rect.right = rect.left + BENCH_FB_W / 2;
+        rect.bottom = rect.top + BENCH_FB_H / 2;
+        layers[i]->setDisplayFrame(rect);
+        layers[i]->latchPendingState();
+    }
+}
+
+/*same layers for both passes, display creates and ids them.*/
+static void createLayers(int32_t num,
+    std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>> & map,
+    BenchDisplay & display, std::vector<std::shared_ptr<Hwc2Layer>> & layers) {
+    for (int32_t i = 0; i < num; i++) {
+        std::shared_ptr<Hwc2Layer> layer = display.addLayer();
+        if (layer.get() == NULL)
+            return;
+        hwc_color_t color = {0x10, 0x20, 0x30, 0xff};
+        layer->setColor(color);
+        layer->setCompositionType(HWC2_COMPOSITION_DEVICE);
+        /*created in random zorder.*/
+        layer->setZorder((uint32_t)((i * 37) % num));
+        layer->latchPendingState();
+        layer->updateZorder(false);
+        map.emplace(layer->getUniqueId(), layer);
+        layers.push_back(layer);
+    }
+}
+
+int main(int argc, char ** argv) {
+    int32_t loops = 20000;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('l', "loops", &loops, 1),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    display_zoom_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.framebuffer_w = BENCH_FB_W;
+    info.framebuffer_h = BENCH_FB_H;
+    info.crtc_display_w = 3840;
+    info.crtc_display_h = 2160;
+
+    int32_t layerNums[] = {8, 32, 128};
+    int32_t errors = 0;
+    printf("%8s %14s %14s %8s\n", "layers", "legacy(ns)", "list(ns)", "speedup");
+    for (size_t n = 0; n < ARRAY_SIZE(layerNums); n++) {
+        std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>> map;
+        BenchDisplay display(info);
+        std::vector<std::shared_ptr<Hwc2Layer>> layers;
+        std::vector<std::shared_ptr<DrmFramebuffer>> legacyPresent;
+        createLayers(layerNums[n], map, display, layers);
+        BENCH_CHECK(errors, layers.size() == (size_t)layerNums[n],
+            "layers %d: created %zu.", layerNums[n], layers.size());
+
+        int64_t legacyNs = 0, listNs = 0;
+        for (int32_t i = 0; i < loops; i++) {
+            updateLayers(layers, i);
+            int64_t start = nowNs();
+            legacyValidate(map, legacyPresent, info);
+            legacyNs += nowNs() - start;
+
+            start = nowNs();
+            display.layerPass();
+            listNs += nowNs() - start;
+        }
+        std::vector<std::shared_ptr<DrmFramebuffer>> & listPresent =
+            display.getPresentLayers();
+
+        /*both passes should give same layers in same order.*/
+        size_t same = 0;
+        while (same < legacyPresent.size() && same < listPresent.size() &&
+            legacyPresent[same]->mZorder == listPresent[same]->mZorder)
+            same++;
+        BENCH_CHECK(errors, same == legacyPresent.size() && same == listPresent.size(),
+            "layers %d: order mismatch at %zu.", layerNums[n], same);
+
+        printf("%8d %14.1f %14.1f %7.2fx\n", layerNums[n],
+            (double)legacyNs / loops, (double)listNs / loops,
+            listNs > 0 ? (double)legacyNs / listNs : 0.0);
+    }
+
+    return finishBench(errors);
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Stress layer setters from several threads against a validate/present
+ *     loop. Setters serialized by the display lock are measured against
+ *     setters writing pending states, and committed states are checked to
+ *     stay the same from validate to present.
+ */
+#include <inttypes.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <BenchUtils.h>
+#include <Composition.h>
+#include <Hwc2Layer.h>
+
+#define FRAME_SIZE 64
+
+typedef enum {
+    MODE_DISPLAY_LOCK = 0,  /*setters write layers with display lock held.*/
+    MODE_PENDING,           /*setters write pending states, validate latches.*/
+} bench_mode_t;
+
+typedef struct bench_config {
+    int32_t threads;
+    int32_t layers;
+    int32_t durationMs;
+    int32_t validateUs;
+    int32_t presentUs;
+    int32_t periodUs;
+} bench_config_t;
+
+typedef struct bench_result {
+    std::vector<int64_t> waits;     /*ns of each setter call.*/
+    uint64_t frames;
+    int64_t latchNs;
+    uint64_t changedFrames;         /*committed state changed in a frame.*/
+    uint64_t tornFrames;            /*display frame not set by one call.*/
+} bench_result_t;
+
+/*one surfaceflinger side call on a random layer.*/
+static void callSetter(Hwc2Layer * layer, uint32_t rand) {
+    int32_t v = (int32_t)(rand >> 8) & 0x3ff;
+    switch (rand % 6) {
+        case 0:
+        case 1: {
+            hwc_rect_t frame = {v, v, v + FRAME_SIZE, v + FRAME_SIZE};
+            layer->setDisplayFrame(frame);
+            break;
+        }
+        case 2: {
+            hwc_frect_t crop = {0.0f, 0.0f, (float)v + 1, (float)v + 1};
+            layer->setSourceCrop(crop);
+            break;
+        }
+        case 3:
+            layer->setPlaneAlpha((v & 0xff) / 255.0f);
+            break;
+        case 4: {
+            hwc_color_t color = {(uint8_t)v, 0x20, 0x30, 0xff};
+            layer->setColor(color);
+            break;
+        }
+        default:
+            layer->setTransform((hwc_transform_t)(v & 0x3));
+            break;
+    }
+}
+
+static void setterLoop(bench_mode_t mode, std::vector<std::shared_ptr<Hwc2Layer>> & layers,
+    std::mutex & displayMutex, std::atomic<bool> & stop, uint32_t seed,
+    std::vector<int64_t> & waits) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint32_t rand = nextRand(seed);
+        Hwc2Layer * layer = layers[rand % layers.size()].get();
+        rand = nextRand(seed);
+
+        int64_t begin = nowNs();
+        if (mode == MODE_DISPLAY_LOCK) {
+            std::lock_guard<std::mutex> lock(displayMutex);
+            callSetter(layer, rand);
+            layer->latchPendingState();
+        } else {
+            callSetter(layer, rand);
+        }
+        waits.push_back(nowNs() - begin);
+
+        /*sf sends a frame of calls, then waits for next vsync.*/
+        if ((rand & 0x3f) == 0)
+            usleep(200);
+    }
+}
+
+static void displayLoop(bench_mode_t mode, bench_config_t & config,
+    std::vector<std::shared_ptr<Hwc2Layer>> & layers, std::mutex & displayMutex,
+    std::atomic<bool> & stop, bench_result_t & result) {
+    std::vector<drm_rect_t> frames(layers.size());
+    std::vector<float> alphas(layers.size());
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        int64_t frameBegin = nowNs();
+        {
+            /*validate.*/
+            std::lock_guard<std::mutex> lock(displayMutex);
+            if (mode == MODE_PENDING) {
+                int64_t begin = nowNs();
+                for (auto it = layers.begin(); it != layers.end(); it++)
+                    (*it)->latchPendingState();
+                result.latchNs += nowNs() - begin;
+            }
+            for (size_t i = 0; i < layers.size(); i++) {
+                drm_rect_t & frame = layers[i]->mBackupDisplayFrame;
+                if (frame.right - frame.left != FRAME_SIZE || frame.top != frame.left)
+                    result.tornFrames++;
+                frames[i] = frame;
+                alphas[i] = layers[i]->mPlaneAlpha;
+                layers[i]->clearChangedFlags();
+            }
+            /*composition work holding the display lock.*/
+            spinNs(config.validateUs * 1000LL);
+        }
+
+        {
+            /*present, layers must be what validate decided on.*/
+            std::lock_guard<std::mutex> lock(displayMutex);
+            for (size_t i = 0; i < layers.size(); i++) {
+                if (memcmp(&frames[i], &layers[i]->mBackupDisplayFrame, sizeof(drm_rect_t)) ||
+                    alphas[i] != layers[i]->mPlaneAlpha) {
+                    result.changedFrames++;
+                    break;
+                }
+            }
+            spinNs(config.presentUs * 1000LL);
+        }
+        result.frames++;
+
+        int64_t left = config.periodUs * 1000LL - (nowNs() - frameBegin);
+        if (left > 0)
+            usleep(left / 1000);
+    }
+}
+
+static void runBench(bench_mode_t mode, bench_config_t & config, bench_result_t & result) {
+    std::vector<std::shared_ptr<Hwc2Layer>> layers;
+    for (int32_t i = 0; i < config.layers; i++) {
+        std::shared_ptr<Hwc2Layer> layer = std::make_shared<Hwc2Layer>();
+        hwc_rect_t frame = {0, 0, FRAME_SIZE, FRAME_SIZE};
+        hwc_color_t color = {0x10, 0x20, 0x30, 0xff};
+        layer->setUniqueId(i);
+        layer->setCompositionType(HWC2_COMPOSITION_DEVICE);
+        layer->setColor(color);
+        layer->setDisplayFrame(frame);
+        layer->setZorder(i);
+        layer->latchPendingState();
+        layers.push_back(layer);
+    }
+
+    std::mutex displayMutex;
+    std::atomic<bool> stop(false);
+    std::vector<std::vector<int64_t>> waits(config.threads);
+    std::vector<std::thread> setters;
+    for (int32_t i = 0; i < config.threads; i++) {
+        waits[i].reserve(1 << 20);
+        setters.push_back(std::thread(setterLoop, mode, std::ref(layers),
+            std::ref(displayMutex), std::ref(stop), 0x9e3779b9u * (i + 1),
+            std::ref(waits[i])));
+    }
+    std::thread display(displayLoop, mode, std::ref(config), std::ref(layers),
+        std::ref(displayMutex), std::ref(stop), std::ref(result));
+
+    usleep(config.durationMs * 1000);
+    stop = true;
+    for (auto it = setters.begin(); it != setters.end(); it++)
+        it->join();
+    display.join();
+
+    for (auto it = waits.begin(); it != waits.end(); it++)
+        result.waits.insert(result.waits.end(), it->begin(), it->end());
+    std::sort(result.waits.begin(), result.waits.end());
+}
+
+static void printResult(const char * name, bench_result_t & result) {
+    std::vector<int64_t> & waits = result.waits;
+    if (waits.empty()) {
+        printf("%-12s no setter calls.\n", name);
+        return;
+    }
+
+    int64_t total = 0;
+    for (auto it = waits.begin(); it != waits.end(); it++)
+        total += *it;
+    printf("%-12s %10zu %9.1f %9.1f %9.1f %10.1f %10.1f %7" PRIu64 " %8.2f %8" PRIu64 "\n",
+        name, waits.size(), (double)total / waits.size(),
+        (double)waits[waits.size() / 2], (double)waits[waits.size() * 99 / 100],
+        waits.back() / 1000.0, total / 1000000.0, result.frames,
+        result.frames ? result.latchNs / 1000.0 / result.frames : 0.0,
+        result.changedFrames);
+}
+
+int main(int argc, char ** argv) {
+    bench_config_t config = {3, 16, 2000, 400, 300, 4000};
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('t', "setter threads", &config.threads, 1),
+        BENCH_INT_OPTION('l', "layers", &config.layers, 1),
+        BENCH_INT_OPTION('d', "duration ms", &config.durationMs, 1),
+        BENCH_INT_OPTION('v', "validate us", &config.validateUs, 0),
+        BENCH_INT_OPTION('p', "present us", &config.presentUs, 0),
+        BENCH_INT_OPTION('f', "frame period us", &config.periodUs, 1),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    printf("%d setter threads, %d layers, validate %d us, present %d us, period %d us\n",
+        config.threads, config.layers, config.validateUs, config.presentUs, config.periodUs);
+    printf("%-12s %10s %9s %9s %9s %10s %10s %7s %8s %8s\n", "mode", "calls",
+        "avg(ns)", "p50(ns)", "p99(ns)", "max(us)", "wait(ms)", "frames",
+        "latch(us)", "changed");
+
+    bench_result_t lockResult = {};
+    runBench(MODE_DISPLAY_LOCK, config, lockResult);
+    printResult("display-lock", lockResult);
+
+    bench_result_t pendingResult = {};
+    runBench(MODE_PENDING, config, pendingResult);
+    printResult("pending", pendingResult);
+
+    /*latched states must not change under composition, nor be torn.*/
+    int32_t errors = 0;
+    BENCH_CHECK(errors, pendingResult.changedFrames == 0,
+        "pending: %" PRIu64 " frames changed from validate to present.",
+        pendingResult.changedFrames);
+    BENCH_CHECK(errors, lockResult.tornFrames == 0,
+        "display-lock: %" PRIu64 " frames torn.", lockResult.tornFrames);
+    BENCH_CHECK(errors, pendingResult.tornFrames == 0,
+        "pending: %" PRIu64 " frames torn.", pendingResult.tornFrames);
+
+    return finishBench(errors);
+}
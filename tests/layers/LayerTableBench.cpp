@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Measure layer create/destroy churn and id lookup, the old byte map
+ *     ids with unordered_map against the layer table, and check ids of
+ *     destroyed layers are rejected.
+ */
+#include <inttypes.h>
+#include <unordered_map>
+#include <vector>
+
+#include <BenchUtils.h>
+#include <Hwc2Layer.h>
+#include <Hwc2LayerTable.h>
+
+#define LEGACY_MAX_LAYERS (256)
+#define LEGACY_SLOT_BITS (8)
+
+/*layer ids before the layer table: byte scan of 256 slots and a hash map.*/
+class LegacyLayers {
+public:
+    LegacyLayers() {
+        memset(mBits, 0, sizeof(mBits));
+        mLayerSeq = 0;
+    }
+
+    int getZeroBit() {
+        for (int i = 0; i < LEGACY_MAX_LAYERS / 8; i++) {
+            if (mBits[i] == 0xFF)
+                continue;
+            uint8_t byteval = mBits[i];
+            int idx = 0;
+            if ((byteval & 0xF) == 0xF) {
+                byteval >>= 4;
+                idx += 4;
+            }
+            if ((byteval & 0x3) == 0x3) {
+                byteval >>= 2;
+                idx += 2;
+            }
+            if ((byteval & 0x1) == 0x1) {
+                byteval >>= 1;
+                idx += 1;
+            }
+            return idx + i * 8;
+        }
+        return -1;
+    }
+
+    hwc2_layer_t createLayer() {
+        int idx = getZeroBit();
+        if (idx < 0)
+            return 0;
+        mBits[idx >> 3] |= 1 << (idx & 0x7);
+        mLayerSeq = (mLayerSeq + 1) % LEGACY_MAX_LAYERS;
+        hwc2_layer_t id = ((hwc2_layer_t)idx << LEGACY_SLOT_BITS) | mLayerSeq;
+        std::shared_ptr<Hwc2Layer> layer = std::make_shared<Hwc2Layer>();
+        layer->setUniqueId(id);
+        mLayers.emplace(id, layer);
+        return id;
+    }
+
+    void destroyLayer(hwc2_layer_t id) {
+        mLayers.erase(id);
+        int idx = (int)(id >> LEGACY_SLOT_BITS);
+        mBits[idx >> 3] &= ~(1 << (idx & 0x7));
+    }
+
+    std::shared_ptr<Hwc2Layer> getLayer(hwc2_layer_t id) {
+        auto it = mLayers.find(id);
+        if (it != mLayers.end())
+            return it->second;
+        return NULL;
+    }
+
+protected:
+    uint8_t mBits[LEGACY_MAX_LAYERS / 8];
+    int mLayerSeq;
+    std::unordered_map<hwc2_layer_t, std::shared_ptr<Hwc2Layer>> mLayers;
+};
+
+typedef struct bench_result {
+    double churnNs;     /*one destroy and one create.*/
+    double lookupNs;
+} bench_result_t;
+
+static void benchLegacy(int32_t num, int32_t loops, bench_result_t & result) {
+    LegacyLayers legacy;
+    std::vector<hwc2_layer_t> ids;
+    for (int32_t i = 0; i < num; i++)
+        ids.push_back(legacy.createLayer());
+
+    uint32_t seed = 0x12345678;
+    int64_t start = nowNs();
+    for (int32_t i = 0; i < loops; i++) {
+        uint32_t pos = nextRand(seed) % num;
+        legacy.destroyLayer(ids[pos]);
+        ids[pos] = legacy.createLayer();
+    }
+    result.churnNs = (double)(nowNs() - start) / loops;
+
+    uint64_t found = 0;
+    start = nowNs();
+    for (int32_t i = 0; i < loops * 4; i++)
+        found += legacy.getLayer(ids[nextRand(seed) % num]).get() != NULL;
+    result.lookupNs = (double)(nowNs() - start) / (loops * 4);
+    if (found != (uint64_t)loops * 4)
+        printf("legacy %d: %" PRIu64 " lookups failed.\n", num, loops * 4 - found);
+}
+
+/*return error count, live ids must resolve and destroyed ids must not.*/
+static int32_t benchTable(int32_t num, int32_t loops, bench_result_t & result) {
+    Hwc2LayerTable table;
+    std::vector<hwc2_layer_t> ids;
+    std::vector<hwc2_layer_t> staleIds;
+    int32_t errors = 0;
+    for (int32_t i = 0; i < num; i++) {
+        std::shared_ptr<Hwc2Layer> layer = table.createLayer();
+        if (layer.get() == NULL) {
+            printf("table %d: create layer %d failed.\n", num, i);
+            return 1;
+        }
+        ids.push_back(layer->getUniqueId());
+    }
+
+    uint32_t seed = 0x12345678;
+    int64_t start = nowNs();
+    for (int32_t i = 0; i < loops; i++) {
+        uint32_t pos = nextRand(seed) % num;
+        table.destroyLayer(ids[pos]);
+        if ((i & 0xff) == 0)
+            staleIds.push_back(ids[pos]);
+        ids[pos] = table.createLayer()->getUniqueId();
+        /*validate of a frame.*/
+        if ((i & 0xf) == 0)
+            table.trimFreeLayers();
+    }
+    result.churnNs = (double)(nowNs() - start) / loops;
+
+    uint64_t found = 0;
+    start = nowNs();
+    for (int32_t i = 0; i < loops * 4; i++)
+        found += table.getLayer(ids[nextRand(seed) % num]).get() != NULL;
+    result.lookupNs = (double)(nowNs() - start) / (loops * 4);
+    BENCH_CHECK(errors, found == (uint64_t)loops * 4,
+        "table %d: %" PRIu64 " lookups failed.", num, loops * 4 - found);
+
+    for (auto it = ids.begin(); it != ids.end(); it++) {
+        std::shared_ptr<Hwc2Layer> layer = table.getLayer(*it);
+        BENCH_CHECK(errors, layer.get() != NULL && layer->getUniqueId() == *it &&
+            (*it >> LAYER_GEN_SHIFT) != 0, "table %d: bad layer for id %" PRIu64 ".",
+            num, *it);
+    }
+
+    /*generations do not wrap in the bench, no stale id may match.*/
+    uint32_t staleHits = 0;
+    for (auto it = staleIds.begin(); it != staleIds.end(); it++) {
+        std::shared_ptr<Hwc2Layer> layer = table.getLayer(*it);
+        if (layer.get() != NULL && layer->getUniqueId() != *it)
+            errors++;
+        else if (layer.get() != NULL)
+            staleHits++;
+    }
+    BENCH_CHECK(errors, staleHits == 0,
+        "table %d: %u/%zu destroyed ids still resolve.", num, staleHits, staleIds.size());
+    BENCH_CHECK(errors, table.size() == (uint32_t)num, "table %d: size %u.", num, table.size());
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    int32_t loops = 200000;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('l', "loops", &loops, 1),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    int32_t layerNums[] = {16, 128, 255, 1024, 8192};
+    int32_t errors = 0;
+    printf("%8s %18s %18s %18s %18s\n", "layers", "legacy churn(ns)",
+        "table churn(ns)", "legacy lookup(ns)", "table lookup(ns)");
+    for (size_t n = 0; n < ARRAY_SIZE(layerNums); n++) {
+        int32_t num = layerNums[n];
+        bench_result_t legacy = {0, 0}, table = {0, 0};
+        errors += benchTable(num, loops, table);
+        if (num < LEGACY_MAX_LAYERS) {
+            benchLegacy(num, loops, legacy);
+            printf("%8d %18.1f %18.1f %18.1f %18.1f\n", num, legacy.churnNs,
+                table.churnNs, legacy.lookupNs, table.lookupNs);
+        } else {
+            printf("%8d %18s %18.1f %18s %18.1f\n", num, "n/a",
+                table.churnNs, "n/a", table.lookupNs);
+        }
+    }
+
+    return finishBench(errors);
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Replay composition trace captured by "--capture-trace" through
+ *     composition strategy on host, report decide/commit latency and
+ *     client composed pixels.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <string>
+
+#include <Composition.h>
+#include <CompositionStrategyFactory.h>
+#include <ICompositionStrategy.h>
+
+#include "ReplayMock.h"
+
+#define REPLAY_LEGACY_VIDEO_PLANE_ID     16
+#define REPLAY_LEGACY_EXT_VIDEO_PLANE_ID 17
+#define REPLAY_HWC_VIDEO_PLANE_ID        18
+
+typedef struct replay_frame_stat {
+    uint32_t frameSeq;
+    uint32_t layerNum;
+    uint32_t clientLayers;
+    uint64_t clientPixels;
+    nsecs_t decideTime;
+    nsecs_t commitTime;
+} replay_frame_stat_t;
+
+static void usage(const char * name) {
+    printf("Usage: %s [options] trace_file\n"
+        "\t-s simple|cost : composition strategy, default simple.\n"
+        "\t-o num : osd plane number 1~3, default 3.\n"
+        "\t-l loops : replay the trace loops times, default 1.\n"
+        "\t-p prop=value : set property seen by hwc, can repeat.\n"
+        "\t-v : print stat of each frame.\n", name);
+}
+
+static uint64_t rectArea(drm_rect_t & rect) {
+    int32_t w = rect.right - rect.left;
+    int32_t h = rect.bottom - rect.top;
+    return (w > 0 && h > 0) ? (uint64_t)w * h : 0;
+}
+
+static nsecs_t percentile(std::vector<nsecs_t> & sorted, uint32_t p) {
+    if (sorted.empty())
+        return 0;
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+static void printLatency(const char * name, std::vector<nsecs_t> & times) {
+    std::sort(times.begin(), times.end());
+    printf("%-8s latency(us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", name,
+        percentile(times, 50) / 1000.0, percentile(times, 90) / 1000.0,
+        percentile(times, 99) / 1000.0, percentile(times, 100) / 1000.0);
+}
+
+static void createPlanes(uint32_t osdNum,
+    std::vector<std::shared_ptr<HwDisplayPlane>> & planes) {
+    for (uint32_t i = 0; i < osdNum; i++) {
+        uint32_t cap = PLANE_SUPPORT_AFBC;
+        if (i == 0)
+            cap |= PLANE_PRIMARY;
+        else
+            cap |= PLANE_SUPPORT_FREE_SCALE;
+        if (osdNum > 1)
+            cap |= PLANE_SUPPORT_ZORDER;
+        planes.push_back(std::make_shared<MockPlane>(i, OSD_PLANE, cap));
+    }
+
+    planes.push_back(std::make_shared<MockPlane>(
+        REPLAY_LEGACY_VIDEO_PLANE_ID, LEGACY_VIDEO_PLANE, 0));
+    planes.push_back(std::make_shared<MockPlane>(
+        REPLAY_LEGACY_EXT_VIDEO_PLANE_ID, LEGACY_EXT_VIDEO_PLANE, 0));
+    planes.push_back(std::make_shared<MockPlane>(
+        REPLAY_HWC_VIDEO_PLANE_ID, HWC_VIDEO_PLANE, 0));
+}
+
+int main(int argc, char ** argv) {
+    uint32_t strategyType = SIMPLE_STRATEGY;
+    uint32_t osdNum = 3;
+    uint32_t loops = 1;
+    bool verbose = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:o:l:p:vh")) != -1) {
+        switch (opt) {
+            case 's':
+                if (strcmp(optarg, "cost") == 0) {
+                    strategyType = COST_MODEL_STRATEGY;
+                } else if (strcmp(optarg, "simple") != 0) {
+                    usage(argv[0]);
+                    return -EINVAL;
+                }
+                break;
+            case 'o':
+                osdNum = atoi(optarg);
+                if (osdNum < 1 || osdNum > 3) {
+                    usage(argv[0]);
+                    return -EINVAL;
+                }
+                break;
+            case 'l':
+                loops = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'p': {
+                std::string prop(optarg);
+                size_t pos = prop.find('=');
+                if (pos == std::string::npos) {
+                    usage(argv[0]);
+                    return -EINVAL;
+                }
+                setReplayProp(prop.substr(0, pos).c_str(), prop.substr(pos + 1).c_str());
+                break;
+            }
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return -EINVAL;
+    }
+
+    /*load whole trace, file io should not be in the measured loop.*/
+    CompositionTraceReader reader;
+    if (reader.open(argv[optind]) < 0) {
+        fprintf(stderr, "Cannot open trace %s\n", argv[optind]);
+        return -EINVAL;
+    }
+    std::vector<trace_frame_t> frames;
+    trace_frame_t frame;
+    int32_t ret;
+    while ((ret = reader.readFrame(frame)) == 0)
+        frames.push_back(frame);
+    if (ret != -ENODATA)
+        fprintf(stderr, "Trace truncated at frame %zu (%d)\n", frames.size(), ret);
+    if (frames.empty()) {
+        fprintf(stderr, "No frame in trace.\n");
+        return -ENODATA;
+    }
+
+    std::vector<std::shared_ptr<HwDisplayPlane>> planes;
+    createPlanes(osdNum, planes);
+
+    std::shared_ptr<MockComposer> clientComposer =
+        std::make_shared<MockComposer>(MESON_COMPOSITION_CLIENT);
+    std::vector<std::shared_ptr<IComposer>> composers;
+    composers.push_back(clientComposer);
+    composers.push_back(std::make_shared<MockComposer>(MESON_COMPOSITION_DUMMY));
+
+    std::shared_ptr<HwDisplayCrtc> crtc = createReplayCrtc(CRTC_VOUT1);
+    std::shared_ptr<ICompositionStrategy> strategy =
+        CompositionStrategyFactory::create(strategyType,
+            osdNum > 1 ? MUTLI_OSD_PLANES : 0);
+    printf("Replay %zu frames x %u loops with %s, %u osd planes.\n",
+        frames.size(), loops, strategy->getName(), osdNum);
+
+    std::vector<replay_frame_stat_t> stats;
+    drm_mode_info_t mode;
+    memset(&mode, 0, sizeof(mode));
+
+    for (uint32_t loop = 0; loop < loops; loop++) {
+        for (auto it = frames.begin(); it != frames.end(); ++it) {
+            trace_frame_header_t & header = it->header;
+            if (header.displayWidth != mode.pixelW ||
+                header.displayHeight != mode.pixelH ||
+                header.refreshRate != mode.refreshRate) {
+                snprintf(mode.name, DRM_DISPLAY_MODE_LEN, "%ux%u@%.2f",
+                    header.displayWidth, header.displayHeight, header.refreshRate);
+                mode.pixelW = header.displayWidth;
+                mode.pixelH = header.displayHeight;
+                mode.refreshRate = header.refreshRate;
+                crtc->setMode(mode);
+                clientComposer->setTargetSize(mode.pixelW, mode.pixelH);
+            }
+
+            std::vector<std::shared_ptr<DrmFramebuffer>> fbs;
+            for (auto layerIt = it->layers.begin(); layerIt != it->layers.end(); ++layerIt)
+                fbs.push_back(createReplayFb(*layerIt));
+            for (auto composerIt = composers.begin(); composerIt != composers.end(); ++composerIt)
+                (*composerIt)->prepare();
+
+            replay_frame_stat_t stat;
+            memset(&stat, 0, sizeof(stat));
+            stat.frameSeq = header.frameSeq;
+            stat.layerNum = fbs.size();
+
+            nsecs_t start = systemTime(CLOCK_MONOTONIC);
+            strategy->setup(fbs, composers, planes, crtc, header.compositionFlags);
+            if (strategy->decideComposition() < 0)
+                fprintf(stderr, "frame %u decide failed.\n", header.frameSeq);
+            nsecs_t decided = systemTime(CLOCK_MONOTONIC);
+
+            for (auto fbIt = fbs.begin(); fbIt != fbs.end(); ++fbIt) {
+                if ((*fbIt)->mCompositionType == MESON_COMPOSITION_CLIENT) {
+                    stat.clientLayers++;
+                    stat.clientPixels += rectArea((*fbIt)->mDisplayFrame);
+                }
+            }
+
+            nsecs_t commitStart = systemTime(CLOCK_MONOTONIC);
+            strategy->commit();
+            nsecs_t committed = systemTime(CLOCK_MONOTONIC);
+
+            stat.decideTime = decided - start;
+            stat.commitTime = committed - commitStart;
+            stats.push_back(stat);
+
+            if (verbose) {
+                printf("frame %6u: layers %2u, client layers %2u, client pixels %9llu,"
+                    " decide %7.1f us, commit %7.1f us\n",
+                    stat.frameSeq, stat.layerNum, stat.clientLayers,
+                    (unsigned long long)stat.clientPixels,
+                    stat.decideTime / 1000.0, stat.commitTime / 1000.0);
+            }
+        }
+    }
+
+    std::vector<nsecs_t> decideTimes, commitTimes;
+    uint64_t totalClientPixels = 0, maxClientPixels = 0;
+    uint32_t clientFrames = 0;
+    for (auto it = stats.begin(); it != stats.end(); ++it) {
+        decideTimes.push_back(it->decideTime);
+        commitTimes.push_back(it->commitTime);
+        totalClientPixels += it->clientPixels;
+        if (it->clientPixels > maxClientPixels)
+            maxClientPixels = it->clientPixels;
+        if (it->clientLayers > 0)
+            clientFrames++;
+    }
+
+    printLatency("decide", decideTimes);
+    printLatency("commit", commitTimes);
+    printf("client composed: %u/%zu frames, avg %llu pixels/frame, max %llu pixels\n",
+        clientFrames, stats.size(),
+        (unsigned long long)(totalClientPixels / stats.size()),
+        (unsigned long long)maxClientPixels);
+
+    if (verbose) {
+        String8 dumpstr;
+        strategy->dump(dumpstr);
+        printf("%s\n", dumpstr.string());
+    }
+    return 0;
+}
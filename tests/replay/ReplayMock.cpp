@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+#include <stdio.h>
+#include <string>
+
+#include <MesonLog.h>
+#include <misc.h>
+#include <sync/sync.h>
+
+#include "AmFramebuffer.h"
+#include "ReplayMock.h"
+
+/*ints of fake gralloc handle.*/
+enum {
+    REPLAY_HND_FORMAT = 0,
+    REPLAY_HND_AFBC,
+    REPLAY_HND_WIDTH,
+    REPLAY_HND_HEIGHT,
+    REPLAY_HND_COHERENT,
+    REPLAY_HND_SECURE,
+    REPLAY_HND_INTS
+};
+
+static std::map<std::string, std::string> sReplayProps;
+
+static inline int replayHandleInt(const native_handle_t * hnd, int idx) {
+    if (!hnd || hnd->numInts <= idx)
+        return 0;
+    return hnd->data[hnd->numFds + idx];
+}
+
+/*MockPlane*/
+MockPlane::MockPlane(uint32_t id, uint32_t type, uint32_t capability)
+    : HwDisplayPlane(-1, id),
+      mType(type),
+      mShowCount(0) {
+    mCapability = capability;
+    switch (type) {
+        case OSD_PLANE:
+            snprintf(mName, sizeof(mName), "OSD-%u", id);
+            break;
+        case LEGACY_VIDEO_PLANE:
+            snprintf(mName, sizeof(mName), "AmVideo-%u", id);
+            break;
+        case LEGACY_EXT_VIDEO_PLANE:
+            snprintf(mName, sizeof(mName), "AmVideoExt-%u", id);
+            break;
+        case HWC_VIDEO_PLANE:
+            snprintf(mName, sizeof(mName), "HwcVideo-%u", id);
+            break;
+        default:
+            snprintf(mName, sizeof(mName), "Plane-%u", id);
+            break;
+    }
+}
+
+MockPlane::~MockPlane() {
+}
+
+const char * MockPlane::getName() {
+    return mName;
+}
+
+int32_t MockPlane::getFixedZorder() {
+    switch (mType) {
+        case OSD_PLANE:
+            if (mCapability & PLANE_SUPPORT_ZORDER)
+                return INVALID_ZORDER;
+            return OSD_PLANE_FIXED_ZORDER;
+        case LEGACY_VIDEO_PLANE:
+            return LEGACY_VIDEO_PLANE_FIXED_ZORDER;
+        default:
+            return INVALID_ZORDER;
+    }
+}
+
+/*same rules as OsdPlane, without the log.*/
+bool MockPlane::isOsdFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
+    if (fb->isRotated())
+        return false;
+
+    switch (fb->mFbType) {
+        case DRM_FB_CURSOR:
+            if (!fb->mBufferInfo.coherent)
+                return false;
+        case DRM_FB_SCANOUT:
+            break;
+        default:
+            return false;
+    }
+
+    if (fb->mBlendMode != DRM_BLEND_MODE_NONE
+        && fb->mBlendMode != DRM_BLEND_MODE_PREMULTIPLIED
+        && fb->mBlendMode != DRM_BLEND_MODE_COVERAGE)
+        return false;
+
+    int format = fb->mBufferInfo.format;
+    int afbc = fb->mBufferInfo.afbcMask;
+    if (fb->mBlendMode == DRM_BLEND_MODE_NONE && format == HAL_PIXEL_FORMAT_BGRA_8888)
+        return false;
+
+    switch (format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+            break;
+        case HAL_PIXEL_FORMAT_RGB_888:
+        case HAL_PIXEL_FORMAT_RGB_565:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            if (afbc == 0)
+                break;
+        default:
+            return false;
+    }
+    if (afbc != 0 && !(mCapability & PLANE_SUPPORT_AFBC))
+        return false;
+
+    uint32_t sourceWidth = fb->mSourceCrop.right - fb->mSourceCrop.left;
+    uint32_t sourceHeight = fb->mSourceCrop.bottom - fb->mSourceCrop.top;
+    if (sourceWidth > OSD_INPUT_MAX_WIDTH || sourceHeight > OSD_INPUT_MAX_HEIGHT)
+        return false;
+    if (sourceWidth < OSD_INPUT_MIN_WIDTH || sourceHeight < OSD_INPUT_MIN_HEIGHT)
+        return false;
+    return true;
+}
+
+bool MockPlane::isFbSupport(std::shared_ptr<DrmFramebuffer> & fb) {
+    switch (mType) {
+        case OSD_PLANE:
+            return isOsdFbSupport(fb);
+        case LEGACY_VIDEO_PLANE:
+            return fb->mFbType == DRM_FB_VIDEO_OVERLAY ||
+                fb->mFbType == DRM_FB_VIDEO_SIDEBAND ||
+                fb->mFbType == DRM_FB_VIDEO_OMX_PTS;
+        case LEGACY_EXT_VIDEO_PLANE:
+            return fb->mFbType == DRM_FB_VIDEO_SIDEBAND_SECOND ||
+                fb->mFbType == DRM_FB_VIDEO_OMX_PTS_SECOND;
+        case HWC_VIDEO_PLANE:
+            return fb->mFbType == DRM_FB_VIDEO_OMX_V4L;
+        default:
+            return false;
+    }
+}
+
+int32_t MockPlane::setPlane(std::shared_ptr<DrmFramebuffer> fb,
+    uint32_t zorder __unused, int blankOp) {
+    if (fb && blankOp == UNBLANK)
+        mShowCount++;
+    return 0;
+}
+
+void MockPlane::dump(String8 & dumpstr) {
+    dumpstr.appendFormat("%s: type %u, cap 0x%x, shown %u\n",
+        mName, mType, mCapability, mShowCount);
+}
+
+/*MockComposer*/
+MockComposer::MockComposer(meson_compositon_t type)
+    : mType(type) {
+    mName = (type == MESON_COMPOSITION_DUMMY) ? "MockDummy" : "MockClient";
+}
+
+MockComposer::~MockComposer() {
+}
+
+bool MockComposer::isFbsSupport(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & fbs __unused,
+    std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs __unused) {
+    return true;
+}
+
+int32_t MockComposer::prepare() {
+    mOverlayFbs.clear();
+    return 0;
+}
+
+int32_t MockComposer::addInputs(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & fbs __unused,
+    std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs) {
+    mOverlayFbs = overlayfbs;
+    return 0;
+}
+
+int32_t MockComposer::setOutput(std::shared_ptr<DrmFramebuffer> & fb,
+    hwc_region_t damage __unused) {
+    mTarget = fb;
+    return 0;
+}
+
+int32_t MockComposer::start() {
+    return 0;
+}
+
+int32_t MockComposer::getOverlyFbs(
+    std::vector<std::shared_ptr<DrmFramebuffer>> & overlays) {
+    overlays = mOverlayFbs;
+    return 0;
+}
+
+std::shared_ptr<DrmFramebuffer> MockComposer::getOutput() {
+    if (mType == MESON_COMPOSITION_DUMMY)
+        return NULL;
+    return mTarget;
+}
+
+void MockComposer::setTargetSize(int32_t w, int32_t h) {
+    if (mType == MESON_COMPOSITION_DUMMY)
+        return;
+
+    if (mTarget && mTarget->mSourceCrop.right == w && mTarget->mSourceCrop.bottom == h)
+        return;
+
+    trace_layer_t target;
+    memset(&target, 0, sizeof(target));
+    target.fbType = DRM_FB_SCANOUT;
+    target.crop[2] = target.frame[2] = target.bufferWidth = w;
+    target.crop[3] = target.frame[3] = target.bufferHeight = h;
+    target.blendMode = DRM_BLEND_MODE_PREMULTIPLIED;
+    target.planeAlpha = 1.0f;
+    target.format = HAL_PIXEL_FORMAT_RGBA_8888;
+    mTarget = createReplayFb(target);
+}
+
+/*Replay helpers*/
+std::shared_ptr<HwDisplayCrtc> createReplayCrtc(int32_t id) {
+    return std::make_shared<HwDisplayCrtc>(-1, id);
+}
+
+std::shared_ptr<DrmFramebuffer> createReplayFb(trace_layer_t & layer) {
+    native_handle_t * hnd = NULL;
+    if (layer.fbType == DRM_FB_SCANOUT || layer.fbType == DRM_FB_CURSOR ||
+        layer.fbType == DRM_FB_RENDER) {
+        hnd = native_handle_create(0, REPLAY_HND_INTS);
+        hnd->data[REPLAY_HND_FORMAT] = layer.format;
+        hnd->data[REPLAY_HND_AFBC] = layer.afbc;
+        hnd->data[REPLAY_HND_WIDTH] = layer.bufferWidth;
+        hnd->data[REPLAY_HND_HEIGHT] = layer.bufferHeight;
+        hnd->data[REPLAY_HND_COHERENT] = layer.coherent;
+        hnd->data[REPLAY_HND_SECURE] = layer.secure;
+    }
+
+    std::shared_ptr<DrmFramebuffer> fb = std::make_shared<DrmFramebuffer>(hnd, -1);
+    if (hnd)
+        native_handle_delete(hnd);
+
+    fb->mFbType = (drm_fb_type_t)layer.fbType;
+    fb->mZorder = layer.zorder;
+    fb->mCompositionType = layer.compositionType;
+    fb->mSourceCrop.left = layer.crop[0];
+    fb->mSourceCrop.top = layer.crop[1];
+    fb->mSourceCrop.right = layer.crop[2];
+    fb->mSourceCrop.bottom = layer.crop[3];
+    fb->mDisplayFrame.left = layer.frame[0];
+    fb->mDisplayFrame.top = layer.frame[1];
+    fb->mDisplayFrame.right = layer.frame[2];
+    fb->mDisplayFrame.bottom = layer.frame[3];
+    fb->mBlendMode = (drm_blend_mode_t)layer.blendMode;
+    fb->mPlaneAlpha = layer.planeAlpha;
+    fb->mTransform = layer.transform;
+    fb->mSecure = layer.secure != 0;
+    return fb;
+}
+
+void setReplayProp(const char * prop, const char * val) {
+    sReplayProps[prop] = val;
+}
+
+/*
+ * Link time replacements of device only code.
+ */
+HwDisplayCrtc::HwDisplayCrtc(int drvFd, int32_t id) {
+    mId = id;
+    mDrvFd = drvFd;
+    mOsdChannels = 1;
+    mScaleUpdated = true;
+    mFirstPresent = true;
+    mConnected = false;
+    mBinded = false;
+    hdrVideoInfo = NULL;
+    memset(&mCurModeInfo, 0, sizeof(mCurModeInfo));
+    memset(&mScaleInfo, 0, sizeof(mScaleInfo));
+}
+
+HwDisplayCrtc::~HwDisplayCrtc() {
+}
+
+int32_t HwDisplayCrtc::getId() {
+    return mId;
+}
+
+int32_t HwDisplayCrtc::setMode(drm_mode_info_t & mode) {
+    mCurModeInfo = mode;
+    mConnected = true;
+    return 0;
+}
+
+int32_t HwDisplayCrtc::getMode(drm_mode_info_t & mode) {
+    if (!mConnected)
+        return -EFAULT;
+    mode = mCurModeInfo;
+    return 0;
+}
+
+int32_t HwDisplayCrtc::setDisplayFrame(display_zoom_info_t & info) {
+    mScaleInfo = info;
+    return 0;
+}
+
+int32_t HwDisplayCrtc::setOsdChannels(int32_t channels) {
+    mOsdChannels = channels;
+    return 0;
+}
+
+int am_gralloc_get_format(const native_handle_t * hnd) {
+    return replayHandleInt(hnd, REPLAY_HND_FORMAT);
+}
+
+int am_gralloc_get_vpu_afbc_mask(const native_handle_t * hnd) {
+    return replayHandleInt(hnd, REPLAY_HND_AFBC);
+}
+
+int am_gralloc_get_width(const native_handle_t * hnd) {
+    return replayHandleInt(hnd, REPLAY_HND_WIDTH);
+}
+
+int am_gralloc_get_height(const native_handle_t * hnd) {
+    return replayHandleInt(hnd, REPLAY_HND_HEIGHT);
+}
+
+bool am_gralloc_is_coherent_buffer(const native_handle_t * hnd) {
+    return replayHandleInt(hnd, REPLAY_HND_COHERENT) != 0;
+}
+
+bool am_gralloc_is_secure_buffer(const native_handle_t * hnd) {
+    return replayHandleInt(hnd, REPLAY_HND_SECURE) != 0;
+}
+
+int am_gralloc_get_buffer_fd(const native_handle_t * hnd __unused) {
+    return -1;
+}
+
+/*replay handles have no gralloc id, buffer info is never cached.*/
+uint64_t gralloc_get_buffer_id(const native_handle_t * hnd __unused) {
+    return 0;
+}
+
+int am_gralloc_get_stride_in_byte(const native_handle_t * hnd __unused) {
+    return 0;
+}
+
+int am_gralloc_get_stride_in_pixel(const native_handle_t * hnd __unused) {
+    return 0;
+}
+
+bool am_gralloc_is_omx_metadata_buffer(const native_handle_t * hnd __unused) {
+    return false;
+}
+
+bool am_gralloc_is_overlay_buffer(const native_handle_t * hnd __unused) {
+    return false;
+}
+
+native_handle_t * gralloc_ref_dma_buf(const native_handle_t * hnd) {
+    return native_handle_clone(hnd);
+}
+
+int32_t gralloc_unref_dma_buf(native_handle_t * hnd) {
+    return native_handle_delete(hnd);
+}
+
+int32_t gralloc_lock_dma_buf(native_handle_t * handle __unused, void** vaddr __unused) {
+    return -EINVAL;
+}
+
+int32_t gralloc_unlock_dma_buf(native_handle_t * handle __unused) {
+    return 0;
+}
+
+bool sys_get_bool_prop(const char* prop, bool defVal) {
+    auto it = sReplayProps.find(prop);
+    if (it == sReplayProps.end())
+        return defVal;
+    return it->second == "1" || it->second == "true";
+}
+
+int32_t sys_get_string_prop(const char* prop, char * val) {
+    auto it = sReplayProps.find(prop);
+    if (it == sReplayProps.end())
+        return 0;
+    strncpy(val, it->second.c_str(), PROP_VALUE_LEN_MAX - 1);
+    val[PROP_VALUE_LEN_MAX - 1] = 0;
+    return strlen(val);
+}
+
+int32_t sys_set_prop(const char *prop, const char *val) {
+    setReplayProp(prop, val);
+    return 0;
+}
+
+int sync_wait(int fd __unused, int timeout __unused) {
+    return 0;
+}
+
+int sync_merge(const char * name __unused, int fd1 __unused, int fd2 __unused) {
+    return -1;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ */
+
+#ifndef REPLAY_MOCK_H
+#define REPLAY_MOCK_H
+
+#include <BasicTypes.h>
+#include <DrmFramebuffer.h>
+#include <HwDisplayPlane.h>
+#include <HwDisplayCrtc.h>
+#include <IComposer.h>
+#include <CompositionTrace.h>
+
+/*
+ * Host mocks for composition replay.
+ * Planes and composers only record what strategy asks them to do, the crtc
+ * and gralloc/property functions are replaced at link time by ReplayMock.cpp.
+ */
+
+class MockPlane : public HwDisplayPlane {
+public:
+    MockPlane(uint32_t id, uint32_t type, uint32_t capability);
+    ~MockPlane();
+
+    const char * getName();
+    uint32_t getPlaneType() { return mType; }
+    uint32_t getCapabilities() { return mCapability; }
+    int32_t getFixedZorder();
+    uint32_t getPossibleCrtcs() { return CRTC_VOUT1; }
+    bool isFbSupport(std::shared_ptr<DrmFramebuffer> & fb);
+
+    int32_t setPlane(std::shared_ptr<DrmFramebuffer> fb,
+        uint32_t zorder, int blankOp);
+    void dump(String8 & dumpstr);
+
+    /*fbs shown since last reset.*/
+    uint32_t getShowCount() { return mShowCount; }
+    void resetShowCount() { mShowCount = 0; }
+
+protected:
+    bool isOsdFbSupport(std::shared_ptr<DrmFramebuffer> & fb);
+
+protected:
+    uint32_t mType;
+    char mName[32];
+    uint32_t mShowCount;
+};
+
+class MockComposer : public IComposer {
+public:
+    MockComposer(meson_compositon_t type);
+    ~MockComposer();
+
+    const char* getName() { return mName; }
+    meson_compositon_t getType() { return mType; }
+
+    bool isFbsSupport(
+        std::vector<std::shared_ptr<DrmFramebuffer>> & fbs,
+        std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs);
+    int32_t prepare();
+    int32_t addInputs(
+        std::vector<std::shared_ptr<DrmFramebuffer>> & fbs,
+        std::vector<std::shared_ptr<DrmFramebuffer>> & overlayfbs);
+    int32_t setOutput(std::shared_ptr<DrmFramebuffer> & fb,
+        hwc_region_t damage);
+    int32_t start();
+    int32_t getOverlyFbs(std::vector<std::shared_ptr<DrmFramebuffer>> & overlays);
+    std::shared_ptr<DrmFramebuffer> getOutput();
+
+    /*client target sized as the display, as surfaceflinger does.*/
+    void setTargetSize(int32_t w, int32_t h);
+
+protected:
+    meson_compositon_t mType;
+    const char * mName;
+    std::vector<std::shared_ptr<DrmFramebuffer>> mOverlayFbs;
+    std::shared_ptr<DrmFramebuffer> mTarget;
+};
+
+/*crtc with a mode set, no sysfs access.*/
+std::shared_ptr<HwDisplayCrtc> createReplayCrtc(int32_t id);
+
+/*build a framebuffer backed by a fake gralloc handle from trace.*/
+std::shared_ptr<DrmFramebuffer> createReplayFb(trace_layer_t & layer);
+
+/*properties seen by hwc code in replay, set from command line.*/
+void setReplayProp(const char * prop, const char * val);
+
+#endif/*REPLAY_MOCK_H*/
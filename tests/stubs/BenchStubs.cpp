@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Gralloc, sync and property functions for host benches. Bench fbs
+ *     and layers have no buffer, buffer functions are never called.
+ */
+#include <errno.h>
+
+#include <sync/sync.h>
+
+#include <BasicTypes.h>
+#include <am_gralloc_ext.h>
+#include <misc.h>
+
+int am_gralloc_get_buffer_fd(const native_handle_t * hnd __unused) { return -1; }
+int am_gralloc_get_format(const native_handle_t * hnd __unused) { return 0; }
+int am_gralloc_get_width(const native_handle_t * hnd __unused) { return 0; }
+int am_gralloc_get_height(const native_handle_t * hnd __unused) { return 0; }
+int am_gralloc_get_vpu_afbc_mask(const native_handle_t * hnd __unused) { return 0; }
+int am_gralloc_get_stride_in_byte(const native_handle_t * hnd __unused) { return 0; }
+int am_gralloc_get_stride_in_pixel(const native_handle_t * hnd __unused) { return 0; }
+bool am_gralloc_is_coherent_buffer(const native_handle_t * hnd __unused) { return false; }
+bool am_gralloc_is_secure_buffer(const native_handle_t * hnd __unused) { return false; }
+bool am_gralloc_is_overlay_buffer(const native_handle_t * hnd __unused) { return false; }
+bool am_gralloc_is_omx_metadata_buffer(const native_handle_t * hnd __unused) { return false; }
+int am_gralloc_get_omx_metadata_tunnel(const native_handle_t * hnd __unused,
+    int * tunnel __unused) { return -EINVAL; }
+int am_gralloc_get_sideband_channel(const native_handle_t * hnd __unused,
+    int * channel __unused) { return -EINVAL; }
+
+uint64_t gralloc_get_buffer_id(const native_handle_t * hnd __unused) { return 0; }
+native_handle_t * gralloc_ref_dma_buf(const native_handle_t * hnd __unused) { return NULL; }
+int32_t gralloc_unref_dma_buf(native_handle_t * hnd __unused) { return 0; }
+int32_t gralloc_lock_dma_buf(native_handle_t * hnd __unused, void ** vaddr __unused) {
+    return -EINVAL;
+}
+int32_t gralloc_unlock_dma_buf(native_handle_t * hnd __unused) { return 0; }
+
+int sync_wait(int fd __unused, int timeout __unused) { return 0; }
+int sync_merge(const char * name __unused, int fd1 __unused, int fd2 __unused) { return -1; }
+struct sync_file_info * sync_file_info(int32_t fd __unused) { return NULL; }
+void sync_file_info_free(struct sync_file_info * info __unused) { }
+
+bool sys_get_bool_prop(const char * prop __unused, bool defVal) { return defVal; }
+int32_t sys_get_string_prop(const char * prop __unused, char * val __unused) { return 0; }
+int32_t sys_set_prop(const char * prop __unused, const char * val __unused) { return 0; }
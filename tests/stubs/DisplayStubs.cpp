@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Crtc, config and factory functions called by Hwc2Display, for host
+ *     benches that run display code without a device. Crtc and factories
+ *     are never reached, config is the default build config.
+ */
+#include <errno.h>
+
+#include <ComposerFactory.h>
+#include <CompositionStrategyFactory.h>
+#include <HwDisplayCrtc.h>
+#include <HwcConfig.h>
+
+int32_t HwDisplayCrtc::getId() { return mId; }
+int32_t HwDisplayCrtc::getMode(drm_mode_info_t & mode __unused) { return -EFAULT; }
+int32_t HwDisplayCrtc::waitVBlank(nsecs_t & timestamp __unused) { return -EFAULT; }
+int32_t HwDisplayCrtc::setDisplayFrame(display_zoom_info_t & info __unused) { return 0; }
+int32_t HwDisplayCrtc::setOsdChannels(int32_t channels __unused) { return 0; }
+int32_t HwDisplayCrtc::pageFlip(int32_t & out_fence) {
+    out_fence = -1;
+    return -EFAULT;
+}
+void HwDisplayCrtc::abortCommit() { }
+void HwDisplayCrtc::dump(String8 & dumpstr __unused) { }
+
+hwc_modes_policy_t HwcConfig::getModePolicy(int disp __unused) { return FIXED_SIZE_POLICY; }
+bool HwcConfig::isHeadlessMode() { return false; }
+bool HwcConfig::primaryHotplugEnabled() { return false; }
+bool HwcConfig::secureLayerProcessEnabled() { return false; }
+bool HwcConfig::defaultHdrCapEnabled() { return false; }
+bool HwcConfig::forceClientEnabled() { return false; }
+
+int32_t ComposerFactory::create(meson_composer_t type __unused,
+    std::shared_ptr<IComposer> & composer) {
+    composer.reset();
+    return -ENODEV;
+}
+
+std::shared_ptr<ICompositionStrategy> CompositionStrategyFactory::create(
+    uint32_t type __unused, uint32_t flags __unused) {
+    return NULL;
+}
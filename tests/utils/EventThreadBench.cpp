@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Check EventThread ordering/coalescing, and compare delayed event
+ *     lateness under load and sendEvent blocking with the old loop
+ *     (vector scan, handler called under lock, wait on condition).
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <inttypes.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <BenchUtils.h>
+#include <EventThread.h>
+
+#define BENCH_SENDERS           4
+#define BENCH_FLOOD_US          100     /*immediate event interval.*/
+#define BENCH_FLOOD_WORK_US     20
+#define BENCH_SLOW_MS           20
+#define BENCH_FLOOD_EVENT       1000
+#define BENCH_SLOW_EVENT        1001
+
+/*old EventThread loop, kept here to compare.*/
+class LegacyEventThread {
+public:
+    LegacyEventThread(const char * name __unused) : mHandler(NULL), mExit(false) { }
+    ~LegacyEventThread() {
+        std::unique_lock<std::mutex> eventLock(mEventMutex);
+        mExit = true;
+        eventLock.unlock();
+        mEventCond.notify_all();
+        pthread_join(mEventThread, NULL);
+    }
+
+    void setHandler(EventHandler * handler) { mHandler = handler; }
+    void start() { pthread_create(&mEventThread, NULL, threadMain, this); }
+
+    void sendEvent(int what) {
+        std::unique_lock<std::mutex> eventLock(mEventMutex);
+        mEvents.push_back({what, 0});
+        eventLock.unlock();
+        mEventCond.notify_one();
+    }
+
+    void sendEventDelayed(int what, uint32_t delayMs) {
+        nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        std::unique_lock<std::mutex> eventLock(mEventMutex);
+        mEvents.push_back({what, now + ms2ns(delayMs)});
+        eventLock.unlock();
+        mEventCond.notify_one();
+    }
+
+    void removeEvent(int what) {
+        std::unique_lock<std::mutex> eventLock(mEventMutex);
+        for (auto it = mEvents.begin(); it != mEvents.end();) {
+            if (it->what == what)
+                it = mEvents.erase(it);
+            else
+                ++ it;
+        }
+        eventLock.unlock();
+        mEventCond.notify_one();
+    }
+
+protected:
+    void processEvents() {
+        std::unique_lock<std::mutex> eventLock(mEventMutex);
+        nsecs_t closestDueTime = 0;
+
+        for (auto it = mEvents.begin(); it != mEvents.end();) {
+            bool bHandle = false;
+            if (it->dueTime == 0) {
+                bHandle = true;
+            } else {
+                nsecs_t now = systemTime(CLOCK_MONOTONIC);
+                if (it->dueTime < now)
+                    bHandle = true;
+            }
+
+            if (bHandle) {
+                mHandler->handleEvent(it->what);
+                it = mEvents.erase(it);
+            } else {
+                if (closestDueTime == 0 || closestDueTime > it->dueTime)
+                    closestDueTime = it->dueTime;
+                ++ it;
+            }
+        }
+
+        if (mExit)
+            return;
+
+        nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        if (closestDueTime > now)
+            mEventCond.wait_for(eventLock, std::chrono::nanoseconds(closestDueTime - now));
+        else
+            mEventCond.wait(eventLock);
+    }
+
+    static void * threadMain(void * data) {
+        LegacyEventThread * pThis = (LegacyEventThread *)data;
+        while (!pThis->mExit)
+            pThis->processEvents();
+        return NULL;
+    }
+
+    struct EventPack {
+        int what;
+        nsecs_t dueTime;
+    };
+
+    pthread_t mEventThread;
+    std::vector<EventPack> mEvents;
+    std::mutex mEventMutex;
+    std::condition_variable mEventCond;
+    EventHandler * mHandler;
+    bool mExit;
+};
+
+/*delayed events record lateness, flood events burn a little cpu.*/
+class LatencyHandler : public EventHandler {
+public:
+    LatencyHandler() : mFloods(0) {
+        for (int32_t i = 0; i < BENCH_SENDERS; i++) {
+            mDue[i] = 0;
+            mPending[i] = false;
+        }
+    }
+
+    void handleEvent(int what) {
+        nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        if (what == BENCH_FLOOD_EVENT) {
+            mFloods++;
+            spinNs(us2ns(BENCH_FLOOD_WORK_US));
+        } else if (what == BENCH_SLOW_EVENT) {
+            usleep(BENCH_SLOW_MS * 1000);
+        } else if (what >= 0 && what < BENCH_SENDERS) {
+            mLateness.push_back(now - mDue[what]);
+            mPending[what] = false;
+        }
+    }
+
+    std::atomic<nsecs_t> mDue[BENCH_SENDERS];
+    std::atomic<bool> mPending[BENCH_SENDERS];
+    std::atomic<int32_t> mFloods;
+    /*only touched on event thread until it is gone.*/
+    std::vector<nsecs_t> mLateness;
+};
+
+struct BenchResult {
+    size_t events;
+    int32_t floods;
+    double avgUs;
+    double p99Us;
+    double maxUs;
+    double maxSendUs;
+};
+
+template <typename T>
+static void runLatency(int32_t seconds, int32_t loaders, BenchResult & result) {
+    LatencyHandler handler;
+    std::atomic<bool> exit(false);
+    std::vector<std::thread> threads;
+
+    {
+        T thread("bench-event");
+        thread.setHandler(&handler);
+        thread.start();
+
+        for (int32_t i = 0; i < loaders; i++) {
+            threads.emplace_back([&exit] {
+                while (!exit)
+                    spinNs(us2ns(500));
+            });
+        }
+
+        threads.emplace_back([&] {
+            while (!exit) {
+                thread.sendEvent(BENCH_FLOOD_EVENT);
+                usleep(BENCH_FLOOD_US);
+            }
+        });
+
+        for (int32_t i = 0; i < BENCH_SENDERS; i++) {
+            threads.emplace_back([&, i] {
+                uint32_t seed = i + 1;
+                while (!exit) {
+                    uint32_t delayMs = 1 + rand_r(&seed) % 8;
+                    handler.mPending[i] = true;
+                    handler.mDue[i] = systemTime(CLOCK_MONOTONIC) + ms2ns(delayMs);
+                    thread.sendEventDelayed(i, delayMs);
+                    while (handler.mPending[i] && !exit)
+                        usleep(500);
+                }
+            });
+        }
+
+        sleep(seconds);
+        exit = true;
+        for (auto it = threads.begin(); it != threads.end(); ++it)
+            it->join();
+        /*let last delayed events land before the slow handler.*/
+        usleep(20000);
+
+        /*sendEvent blocked by a slow handler.*/
+        thread.sendEvent(BENCH_SLOW_EVENT);
+        usleep(2000);
+        nsecs_t maxSend = 0;
+        nsecs_t end = systemTime(CLOCK_MONOTONIC) + ms2ns(BENCH_SLOW_MS);
+        while (systemTime(CLOCK_MONOTONIC) < end) {
+            nsecs_t start = systemTime(CLOCK_MONOTONIC);
+            thread.sendEventDelayed(BENCH_SENDERS, 1000);
+            thread.removeEvent(BENCH_SENDERS);
+            maxSend = std::max(maxSend, systemTime(CLOCK_MONOTONIC) - start);
+            usleep(1000);
+        }
+        result.maxSendUs = maxSend / 1e3;
+    }
+
+    std::vector<nsecs_t> & lateness = handler.mLateness;
+    std::sort(lateness.begin(), lateness.end());
+    double sum = 0;
+    for (auto it = lateness.begin(); it != lateness.end(); ++it)
+        sum += *it;
+    result.events = lateness.size();
+    result.floods = handler.mFloods;
+    result.avgUs = lateness.empty() ? 0 : sum / lateness.size() / 1e3;
+    result.p99Us = lateness.empty() ? 0 : lateness[lateness.size() * 99 / 100] / 1e3;
+    result.maxUs = lateness.empty() ? 0 : lateness.back() / 1e3;
+}
+
+class OrderHandler : public EventHandler {
+public:
+    void handleEvent(int what) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOrder.push_back(what);
+    }
+    std::vector<int> get() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mOrder;
+    }
+    std::mutex mMutex;
+    std::vector<int> mOrder;
+};
+
+/*return error count.*/
+static int32_t checkOrder() {
+    int32_t errors = 0;
+    OrderHandler handler;
+    EventThread thread("bench-order");
+    thread.setHandler(&handler);
+    thread.start();
+
+    /*due order, duplicate only moves earlier, removed one not called.*/
+    thread.sendEventDelayed(1, 30);
+    thread.sendEventDelayed(2, 10);
+    thread.sendEventDelayed(1, 20);
+    thread.sendEventDelayed(1, 40);
+    thread.sendEventDelayed(3, 15);
+    thread.removeEvent(3);
+    thread.sendEvent(4);
+    thread.sendEvent(5);
+    usleep(80000);
+
+    std::vector<int> expect = {4, 5, 2, 1};
+    std::vector<int> order = handler.get();
+    std::string got;
+    for (auto it = order.begin(); it != order.end(); ++it)
+        got += " " + std::to_string(*it);
+    BENCH_CHECK(errors, order == expect, "event order:%s, expect 4 5 2 1", got.c_str());
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    int32_t seconds = 3;
+    int32_t loaders = sysconf(_SC_NPROCESSORS_ONLN);
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('s', "seconds per mode", &seconds, 1),
+        BENCH_INT_OPTION('l', "cpu load threads", &loaders, 0),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    int32_t errors = checkOrder();
+
+    BenchResult legacy, current;
+    runLatency<LegacyEventThread>(seconds, loaders, legacy);
+    runLatency<EventThread>(seconds, loaders, current);
+
+    printf("%d delayed senders (1-8ms), immediate event every %dus (%dus work), "
+        "%d cpu load threads\n", BENCH_SENDERS, BENCH_FLOOD_US, BENCH_FLOOD_WORK_US,
+        loaders);
+    printf("%8s %8s %8s %12s %12s %12s %14s\n", "mode", "delayed", "floods",
+        "late avg us", "late p99 us", "late max us", "max send us");
+    printf("%8s %8zu %8d %12.1f %12.1f %12.1f %14.1f\n", "legacy", legacy.events,
+        legacy.floods, legacy.avgUs, legacy.p99Us, legacy.maxUs, legacy.maxSendUs);
+    printf("%8s %8zu %8d %12.1f %12.1f %12.1f %14.1f\n", "current", current.events,
+        current.floods, current.avgUs, current.p99Us, current.maxUs, current.maxSendUs);
+
+    /*sender must not wait a running handler.*/
+    BENCH_CHECK(errors, current.maxSendUs <= BENCH_SLOW_MS * 1000 / 2,
+        "sendEvent blocked by handler.");
+    BENCH_CHECK(errors, current.events > 0, "no delayed event delivered.");
+
+    return finishBench(errors);
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Check reactor fd/timed event dispatch, and compare process context
+ *     switches of a dual display load (two vsyncs, uevents, idle timers
+ *     and async writes) on own threads and on the reactor.
+ */
+#include <atomic>
+#include <inttypes.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include <BenchUtils.h>
+#include <HwcReactor.h>
+
+#define BENCH_DISPLAYS          2
+#define BENCH_IDLE_TIMEOUT_MS   50
+#define BENCH_WRITE_INTERVAL    4       /*frames per async write.*/
+#define BENCH_UEVENT_MS         500
+#define BENCH_IDLE_EVENT        1
+#define BENCH_WRITE_EVENT       2
+
+static uint64_t getContextSwitches() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+class CountHandler : public EventHandler {
+public:
+    CountHandler() : mCount(0), mLastTime(0) { }
+    void handleEvent(int what __unused) {
+        mCount++;
+        mLastTime = systemTime(CLOCK_MONOTONIC);
+    }
+    std::atomic<int32_t> mCount;
+    std::atomic<int64_t> mLastTime;
+};
+
+class PipeHandler : public ReactorHandler {
+public:
+    PipeHandler() : mCount(0) { }
+    void handleFd(int fd, uint32_t events __unused) {
+        char buf[16];
+        read(fd, buf, sizeof(buf));
+        /*slow handler, removeFd has to wait it.*/
+        usleep(20000);
+        mCount++;
+    }
+    std::atomic<int32_t> mCount;
+};
+
+/*one display: vsync timer, idle timer reset each frame, async writes.*/
+class BenchDisplay : public ReactorHandler {
+public:
+    BenchDisplay(nsecs_t period, uint32_t clients)
+        : mPeriod(period), mFrames(0), mExit(false) {
+        mIdle = std::make_shared<EventThread>("bench-idle", clients & REACTOR_CLIENT_IDLE);
+        mIdle->setHandler(&mIdleHandler);
+        mIdle->start();
+        mWriter = std::make_shared<EventThread>("bench-sysfs", clients & REACTOR_CLIENT_SYSFS);
+        mWriter->setHandler(&mWriteHandler);
+        mWriter->start();
+
+        mReactor = clients & REACTOR_CLIENT_VSYNC;
+        if (mReactor) {
+            mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+            struct itimerspec spec;
+            spec.it_value.tv_sec = 0;
+            spec.it_value.tv_nsec = period;
+            spec.it_interval = spec.it_value;
+            timerfd_settime(mTimerFd, 0, &spec, NULL);
+            HwcReactor::getInstance().addFd(mTimerFd, EPOLLIN, this);
+        } else {
+            mTimerFd = -1;
+            pthread_create(&mThread, NULL, vsyncThread, this);
+        }
+    }
+
+    ~BenchDisplay() {
+        if (mReactor) {
+            HwcReactor::getInstance().removeFd(mTimerFd);
+            close(mTimerFd);
+        } else {
+            mExit = true;
+            pthread_join(mThread, NULL);
+        }
+    }
+
+    /*same work as HwcVsync observer and present of a display.*/
+    void onVsync() {
+        mFrames++;
+        mIdle->removeEvent(BENCH_IDLE_EVENT);
+        mIdle->sendEventDelayed(BENCH_IDLE_EVENT, BENCH_IDLE_TIMEOUT_MS);
+        if (mFrames % BENCH_WRITE_INTERVAL == 0)
+            mWriter->sendEvent(BENCH_WRITE_EVENT);
+    }
+
+    void handleFd(int fd, uint32_t events __unused) {
+        uint64_t val;
+        if (read(fd, &val, sizeof(val)) == sizeof(val))
+            onVsync();
+    }
+
+    static void * vsyncThread(void * data) {
+        BenchDisplay * pThis = (BenchDisplay *)data;
+        nsecs_t next = systemTime(CLOCK_MONOTONIC);
+        while (!pThis->mExit) {
+            next += pThis->mPeriod;
+            struct timespec spec;
+            spec.tv_sec = next / 1000000000;
+            spec.tv_nsec = next % 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL);
+            pThis->onVsync();
+        }
+        return NULL;
+    }
+
+    nsecs_t mPeriod;
+    std::atomic<int32_t> mFrames;
+    std::atomic<bool> mExit;
+    bool mReactor;
+    int mTimerFd;
+    pthread_t mThread;
+    CountHandler mIdleHandler;
+    CountHandler mWriteHandler;
+    std::shared_ptr<EventThread> mIdle;
+    std::shared_ptr<EventThread> mWriter;
+};
+
+/*uevent socket stand-in, a pipe written now and then.*/
+class BenchUevent : public ReactorHandler {
+public:
+    BenchUevent(bool reactor) : mReactor(reactor), mCount(0), mExit(false) {
+        pipe(mPipe);
+        if (mReactor)
+            HwcReactor::getInstance().addFd(mPipe[0], EPOLLIN, this);
+        else
+            pthread_create(&mThread, NULL, ueventThread, this);
+    }
+
+    ~BenchUevent() {
+        if (mReactor) {
+            HwcReactor::getInstance().removeFd(mPipe[0]);
+        } else {
+            mExit = true;
+            write(mPipe[1], "x", 1);
+            pthread_join(mThread, NULL);
+        }
+        close(mPipe[0]);
+        close(mPipe[1]);
+    }
+
+    void handleFd(int fd, uint32_t events __unused) {
+        char buf[16];
+        if (read(fd, buf, sizeof(buf)) > 0)
+            mCount++;
+    }
+
+    static void * ueventThread(void * data) {
+        BenchUevent * pThis = (BenchUevent *)data;
+        while (!pThis->mExit) {
+            struct pollfd fds = {pThis->mPipe[0], POLLIN, 0};
+            if (poll(&fds, 1, -1) > 0 && !pThis->mExit)
+                pThis->handleFd(pThis->mPipe[0], fds.revents);
+        }
+        return NULL;
+    }
+
+    bool mReactor;
+    int mPipe[2];
+    std::atomic<int32_t> mCount;
+    std::atomic<bool> mExit;
+    pthread_t mThread;
+};
+
+/*return error count.*/
+static int32_t checkReactor() {
+    int32_t errors = 0;
+    HwcReactor & reactor = HwcReactor::getInstance();
+
+    /*delayed events in due order, removed one not called.*/
+    CountHandler early, late, removed;
+    nsecs_t start = systemTime(CLOCK_MONOTONIC);
+    reactor.sendEvent(&late, 0, start + ms2ns(30));
+    reactor.sendEvent(&removed, 0, start + ms2ns(10));
+    reactor.sendEvent(&early, 0, start + ms2ns(20));
+    reactor.removeEvent(&removed, 0);
+    usleep(60000);
+    BENCH_CHECK(errors, early.mCount == 1 && late.mCount == 1 && removed.mCount == 0,
+        "timed events: early %d late %d removed %d",
+        (int32_t)early.mCount, (int32_t)late.mCount, (int32_t)removed.mCount);
+    BENCH_CHECK(errors, early.mLastTime >= start + ms2ns(20) &&
+        late.mLastTime >= early.mLastTime, "timed events out of order or early.");
+
+    /*removeFd returns after the running callback.*/
+    PipeHandler handler;
+    int fds[2];
+    pipe(fds);
+    reactor.addFd(fds[0], EPOLLIN, &handler);
+    write(fds[1], "x", 1);
+    usleep(5000);
+    reactor.removeFd(fds[0]);
+    BENCH_CHECK(errors, handler.mCount == 1, "removeFd did not wait the callback.");
+    write(fds[1], "x", 1);
+    usleep(30000);
+    BENCH_CHECK(errors, handler.mCount == 1, "removed fd still dispatched.");
+    close(fds[0]);
+    close(fds[1]);
+    return errors;
+}
+
+/*return context switches per second.*/
+static double runLoad(uint32_t clients, int32_t seconds, int32_t & frames) {
+    HwcReactor::setEnabledClients(clients);
+    uint64_t switches = getContextSwitches();
+    nsecs_t start = systemTime(CLOCK_MONOTONIC);
+
+    {
+        std::shared_ptr<BenchDisplay> displays[BENCH_DISPLAYS];
+        for (int32_t i = 0; i < BENCH_DISPLAYS; i++)
+            displays[i] = std::make_shared<BenchDisplay>(16666667, clients);
+        BenchUevent uevent(clients & REACTOR_CLIENT_UEVENT);
+
+        for (int32_t t = 0; t < seconds * 1000 / BENCH_UEVENT_MS; t++) {
+            usleep(BENCH_UEVENT_MS * 1000);
+            write(uevent.mPipe[1], "u", 1);
+        }
+
+        frames = 0;
+        for (int32_t i = 0; i < BENCH_DISPLAYS; i++)
+            frames += displays[i]->mFrames;
+    }
+
+    double elapsed = (systemTime(CLOCK_MONOTONIC) - start) / 1e9;
+    return (getContextSwitches() - switches) / elapsed;
+}
+
+int main(int argc, char ** argv) {
+    int32_t seconds = 3;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('s', "seconds per mode", &seconds, 1),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    int32_t errors = checkReactor();
+
+    uint32_t all = REACTOR_CLIENT_UEVENT | REACTOR_CLIENT_VSYNC |
+        REACTOR_CLIENT_IDLE | REACTOR_CLIENT_SYSFS;
+    int32_t threadFrames, reactorFrames;
+    double threadRate = runLoad(0, seconds, threadFrames);
+    double reactorRate = runLoad(all, seconds, reactorFrames);
+
+    printf("%d displays at 60hz, idle timer reset and write every %d frames, "
+        "uevent every %d ms\n", BENCH_DISPLAYS, BENCH_WRITE_INTERVAL, BENCH_UEVENT_MS);
+    printf("%8s %8s %10s %16s\n", "mode", "threads", "frames", "ctx switches/s");
+    printf("%8s %8d %10d %16.1f\n", "threads", 1 + BENCH_DISPLAYS * 3, threadFrames,
+        threadRate);
+    printf("%8s %8d %10d %16.1f\n", "reactor", 1, reactorFrames, reactorRate);
+
+    String8 dumpstr;
+    HwcReactor::getInstance().dump(dumpstr);
+    printf("%s", dumpstr.string());
+
+    /*same vsyncs on both.*/
+    BENCH_CHECK(errors, reactorFrames >= threadFrames * 9 / 10, "reactor lost vsyncs.");
+
+    return finishBench(errors);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Check value and ordering of sysfs writer on temp files, and compare
+ *     the time of video axis/angle writes per frame with open/write/close.
+ */
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include <BenchUtils.h>
+#include <SysfsWriter.h>
+
+#define BENCH_VALUE_LEN 32
+
+class BenchWriter : public SysfsWriter {
+public:
+    uint64_t getIssued() { std::lock_guard<std::mutex> lock(mMutex); return mIssued; }
+    uint64_t getSuppressed() { std::lock_guard<std::mutex> lock(mMutex); return mSuppressed; }
+    uint64_t getForcedMatched() { std::lock_guard<std::mutex> lock(mMutex); return mForcedMatched; }
+};
+
+/*values of a node have the same length, file is not truncated by writer.*/
+static bool checkValue(const char * path, const char * val) {
+    char buf[BENCH_VALUE_LEN] = {0};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len < 0 || strcmp(buf, val) != 0) {
+        printf("%s: read (%s) expect (%s)\n", path, buf, val);
+        return false;
+    }
+    return true;
+}
+
+static int32_t legacyWrite(const char * path, const char * val) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+        return -1;
+    write(fd, val, strlen(val));
+    close(fd);
+    return 0;
+}
+
+/*return error count.*/
+static int32_t checkWriter(const char * axisPath, const char * anglePath) {
+    int32_t errors = 0;
+    BenchWriter writer;
+
+    writer.write(anglePath, "0");
+    writer.write(anglePath, "0");
+    BENCH_CHECK(errors, writer.getIssued() == 1 && writer.getSuppressed() == 1,
+        "unchanged write not suppressed.");
+    /*forced write is skipped only if the node holds the value.*/
+    writer.write(anglePath, "1", true);
+    writer.write(anglePath, "1", true);
+    BENCH_CHECK(errors, writer.getIssued() == 2 && writer.getForcedMatched() == 1,
+        "forced write of value held by node not skipped.");
+    legacyWrite(anglePath, "2");
+    writer.write(anglePath, "1", true);
+    BENCH_CHECK(errors, writer.getIssued() == 3, "forced write over other writer not issued.");
+    if (!checkValue(anglePath, "1"))
+        errors++;
+
+    /*async writes of a node keep the last value.*/
+    char val[BENCH_VALUE_LEN];
+    for (int32_t i = 0; i < 1000; i++) {
+        snprintf(val, sizeof(val), "%4d %4d %4d %4d", i, i, 1000 + i, 1000 + i);
+        writer.writeAsync(axisPath, val);
+    }
+    writer.flush();
+    if (!checkValue(axisPath, val))
+        errors++;
+
+    /*sync write wins over an older async one.*/
+    writer.writeAsync(axisPath, "   1    1    1    1");
+    writer.write(axisPath, "   2    2    2    2");
+    writer.flush();
+    if (!checkValue(axisPath, "   2    2    2    2"))
+        errors++;
+
+    String8 dumpstr;
+    writer.dump(dumpstr);
+    printf("%s", dumpstr.string());
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    int32_t frames = 20000;
+    int32_t axisInterval = 30;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('f', "frames", &frames, 1),
+        BENCH_INT_OPTION('i', "frames per axis change", &axisInterval, 1),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+
+    char dir[] = "/tmp/hwc_sysfs_XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("create temp dir failed.\n");
+        return -1;
+    }
+    char axisPath[64], anglePath[64];
+    snprintf(axisPath, sizeof(axisPath), "%s/axis", dir);
+    snprintf(anglePath, sizeof(anglePath), "%s/angle", dir);
+    close(open(axisPath, O_CREAT | O_WRONLY, 0644));
+    close(open(anglePath, O_CREAT | O_WRONLY, 0644));
+
+    int32_t errors = checkWriter(axisPath, anglePath);
+
+    /*video moves every axisInterval frames, rotation stays.*/
+    char val[BENCH_VALUE_LEN];
+    int64_t start = nowNs();
+    for (int32_t f = 0; f < frames; f++) {
+        int32_t x = f / axisInterval % 100;
+        snprintf(val, sizeof(val), "%4d %4d %4d %4d", x, x, 1919 - x, 1079 - x);
+        legacyWrite(axisPath, val);
+        legacyWrite(anglePath, "0");
+    }
+    int64_t legacyNs = nowNs() - start;
+
+    BenchWriter writer;
+    start = nowNs();
+    for (int32_t f = 0; f < frames; f++) {
+        int32_t x = f / axisInterval % 100;
+        snprintf(val, sizeof(val), "%4d %4d %4d %4d", x, x, 1919 - x, 1079 - x);
+        /*forced as in the video planes.*/
+        writer.write(axisPath, val, true);
+        writer.write(anglePath, "0", true);
+    }
+    int64_t writerNs = nowNs() - start;
+
+    printf("%d frames, axis changes every %d frames\n", frames, axisInterval);
+    printf("%8s %12s %14s\n", "mode", "frame(ns)", "writes/frame");
+    printf("%8s %12.1f %14.2f\n", "legacy", (double)legacyNs / frames, 2.0);
+    printf("%8s %12.1f %14.2f\n", "writer", (double)writerNs / frames,
+        (double)writer.getIssued() / frames);
+
+    String8 dumpstr;
+    writer.dump(dumpstr);
+    printf("%s", dumpstr.string());
+
+    unlink(axisPath);
+    unlink(anglePath);
+    rmdir(dir);
+
+    return finishBench(errors);
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2019 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description:
+ *     Feed vsync model with simulated hw vsync timestamps (jitter, late
+ *     outliers, missed vsyncs, clock drift and a mode change), check it
+ *     converges and count hw vsync waits with the HwcVsync resample policy.
+ */
+#include <inttypes.h>
+#include <math.h>
+
+#include <BenchUtils.h>
+#include <VsyncModel.h>
+
+/*same policy as HwcVsync.*/
+#define BENCH_RESAMPLE_INTERVAL     120
+#define BENCH_RESAMPLE_COUNT        3
+#define BENCH_PREDICT_ERROR_DIV     40
+#define BENCH_RESYNC_ERROR_DIV      20
+
+struct HwVsyncSource {
+    double period;          /*real period of the display, with drift.*/
+    double time;            /*real time of the current vsync.*/
+    nsecs_t jitter;         /*max jitter of irq timestamp.*/
+    int32_t outlierPercent; /*timestamps taken late by a busy cpu.*/
+    int32_t missPercent;    /*vsyncs missed by the waiter.*/
+
+    void advance() {
+        time += period;
+    }
+
+    /*timestamp a waiter would get for the next vsync.*/
+    nsecs_t wait() {
+        advance();
+        if (rand() % 100 < missPercent)
+            advance();
+        nsecs_t ts = (nsecs_t)llround(time);
+        if (jitter > 0)
+            ts += rand() % (2 * jitter + 1) - jitter;
+        if (rand() % 100 < outlierPercent)
+            ts += (nsecs_t)(period * (0.3 + (rand() % 40) / 100.0));
+        return ts;
+    }
+};
+
+struct BenchStats {
+    int32_t vsyncs;
+    int32_t hwWaits;
+    int32_t resyncs;
+    int32_t convergeVsyncs;     /*hw vsyncs until the first stable model.*/
+    nsecs_t maxError;
+    double errorSum;
+    int32_t errorCount;
+};
+
+/*real vsync nearest to a predicted time.*/
+static nsecs_t predictionError(HwVsyncSource & src, nsecs_t predicted) {
+    double k = round((predicted - src.time) / src.period);
+    return predicted - (nsecs_t)llround(src.time + k * src.period);
+}
+
+/*run the HwcVsync policy for frames vsyncs.*/
+static void runPolicy(VsyncModel & model, HwVsyncSource & src, nsecs_t nominal,
+    int32_t frames, BenchStats & stats) {
+    bool predicting = model.isStable();
+    int32_t predicted = 0, resampled = 0;
+    nsecs_t last = (nsecs_t)src.time;
+
+    for (int32_t f = 0; f < frames; f++) {
+        stats.vsyncs++;
+        if (predicting && predicted < model.getPredictFrames(
+            model.getPeriod() / BENCH_PREDICT_ERROR_DIV, BENCH_RESAMPLE_INTERVAL)) {
+            nsecs_t next = model.nextVsync(last + model.getPeriod() / 2);
+            src.advance();
+            nsecs_t error = predictionError(src, next);
+            error = error < 0 ? -error : error;
+            stats.errorSum += error;
+            stats.errorCount++;
+            if (error > stats.maxError)
+                stats.maxError = error;
+            last = next;
+            predicted++;
+            continue;
+        }
+
+        nsecs_t ts = src.wait();
+        stats.hwWaits++;
+        last = ts;
+        if (!predicting) {
+            if (model.addSample(ts)) {
+                predicting = true;
+                predicted = resampled = 0;
+                if (stats.convergeVsyncs == 0)
+                    stats.convergeVsyncs = stats.hwWaits;
+            }
+            continue;
+        }
+
+        nsecs_t period = model.getPeriod();
+        nsecs_t error = model.getError(ts);
+        error = error < 0 ? -error : error;
+        if (error <= period / VSYNC_OUTLIER_DIV && error > period / BENCH_RESYNC_ERROR_DIV) {
+            stats.resyncs++;
+            predicting = false;
+            model.reset(nominal);
+            model.addSample(ts);
+            continue;
+        }
+        if (!model.addSample(ts))
+            predicting = false;
+        else if (++resampled >= BENCH_RESAMPLE_COUNT)
+            predicted = resampled = 0;
+    }
+}
+
+/*return error count.*/
+static int32_t checkModel() {
+    int32_t errors = 0;
+    nsecs_t nominal = 16666667;
+
+    /*clean samples with a missed vsync give the exact period.*/
+    VsyncModel model;
+    model.reset(nominal);
+    nsecs_t t = 1000000000;
+    for (int32_t i = 0; i < 10; i++) {
+        t += (i == 4) ? 2 * 16683333 : 16683333;
+        model.addSample(t);
+    }
+    BENCH_CHECK(errors, model.isStable() && llabs(model.getPeriod() - 16683333) <= 10,
+        "clean samples: stable %d period %" PRId64, model.isStable(), model.getPeriod());
+    BENCH_CHECK(errors, llabs(model.nextVsync(t) - t - 16683333) <= 10,
+        "next vsync %" PRId64 " after %" PRId64, model.nextVsync(t), t);
+
+    /*a late sample is rejected, model stays.*/
+    nsecs_t period = model.getPeriod();
+    model.addSample(t + period + period / 2);
+    BENCH_CHECK(errors, model.isStable() && model.getPeriod() == period,
+        "outlier changed model.");
+
+    /*samples of another timing restart the model.*/
+    for (int32_t i = 0; i < 2 * VSYNC_MODEL_SAMPLES; i++) {
+        t += 20000000;
+        model.addSample(t);
+    }
+    BENCH_CHECK(errors, model.isStable() && llabs(model.getPeriod() - 20000000) <= 10,
+        "model not restarted: stable %d period %" PRId64,
+        model.isStable(), model.getPeriod());
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    int32_t frames = 36000;
+    int32_t jitterUs = 100;
+    int32_t outliers = 2;
+    int32_t misses = 1;
+    bench_option_t options[] = {
+        BENCH_INT_OPTION('f', "frames", &frames, 1),
+        BENCH_INT_OPTION('j', "jitter us", &jitterUs, 0),
+        BENCH_INT_OPTION('o', "outlier %", &outliers, 0),
+        BENCH_INT_OPTION('m', "miss %", &misses, 0),
+    };
+    int32_t ret = parseBenchOptions(argc, argv, options, ARRAY_SIZE(options));
+    if (ret != 1)
+        return ret;
+    nsecs_t jitter = us2ns(jitterUs);
+    srand(1);
+
+    int32_t errors = checkModel();
+
+    /*60hz display running 0.1% slow, then drifting, then a switch to 50hz.*/
+    nsecs_t nominal = 16666667;
+    HwVsyncSource src = {nominal * 1.001, 1e9, jitter, outliers, misses};
+    VsyncModel model;
+    model.reset(nominal);
+    BenchStats stats = {};
+
+    runPolicy(model, src, nominal, frames / 3, stats);
+    src.period *= 1.0002;
+    runPolicy(model, src, nominal, frames / 3, stats);
+    int32_t resyncsBeforeMode = stats.resyncs;
+
+    nominal = 20000000;
+    src.period = nominal;
+    model.reset(nominal);
+    runPolicy(model, src, nominal, frames - frames / 3 * 2, stats);
+
+    double avgError = stats.errorCount ? stats.errorSum / stats.errorCount : 0;
+    printf("%d vsyncs, jitter %" PRId64 " us, %d%% outliers, %d%% missed\n",
+        stats.vsyncs, jitter / 1000, outliers, misses);
+    printf("converged after %d hw vsyncs, %d resyncs before mode change\n",
+        stats.convergeVsyncs, resyncsBeforeMode);
+    printf("hw vsync waits: %d (%.3f per vsync), resyncs %d\n",
+        stats.hwWaits, (double)stats.hwWaits / stats.vsyncs, stats.resyncs);
+    printf("prediction error: avg %.1f us, max %" PRId64 " us\n",
+        avgError / 1000, stats.maxError / 1000);
+
+    String8 dumpstr;
+    model.dump(dumpstr);
+    printf("%s", dumpstr.string());
+
+    BENCH_CHECK(errors, stats.convergeVsyncs > 0 &&
+        stats.convergeVsyncs <= 2 * VSYNC_MODEL_SAMPLES, "model did not converge.");
+    BENCH_CHECK(errors, model.isStable() && llabs(model.getPeriod() - nominal) <= nominal / 1000,
+        "model not stable after mode change, period %" PRId64, model.getPeriod());
+    BENCH_CHECK(errors, avgError <= jitter + 50000, "prediction error too large.");
+    BENCH_CHECK(errors, stats.hwWaits * 10 <= stats.vsyncs, "too many hw vsync waits.");
+
+    return finishBench(errors);
+}